@@ -0,0 +1,760 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Based on work by and "distanceBetween" and "courseTo" courtesy of Maarten Lamers.
+Suggestion to add satellites, courseTo(), and cardinal() by Matt Monson.
+Location precision improvements suggested by Wayne Holder.
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TinyGPS++.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Which fields each decoded sentence carries
+static const uint8_t sentenceFields[] =
+{
+  TINYGPS_TIME | TINYGPS_LOCATION | TINYGPS_ALTITUDE | TINYGPS_SATELLITES | TINYGPS_HDOP, // GGA
+  TINYGPS_TIME | TINYGPS_LOCATION | TINYGPS_DATE | TINYGPS_SPEED | TINYGPS_COURSE,        // RMC
+  TINYGPS_SPEED | TINYGPS_COURSE                                                         // VTG
+};
+
+uint32_t gpsMillis()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+TinyGPSPlus::TinyGPSPlus()
+  :  parity(0)
+  ,  isChecksumTerm(false)
+  ,  curSentenceType(GPS_SENTENCE_OTHER)
+  ,  curTermNumber(0)
+  ,  curTermOffset(0)
+  ,  sentenceHasFix(false)
+  ,  skipSentence(false)
+  ,  arrivalTime(0)
+  ,  customElts(0)
+  ,  customCandidates(0)
+  ,  encodedCharCount(0)
+  ,  sentencesWithFixCount(0)
+  ,  failedChecksumCount(0)
+  ,  passedChecksumCount(0)
+  ,  skippedSentenceCount(0)
+{
+  term[0] = '\0';
+  subscribe(TINYGPS_ALL);
+}
+
+void TinyGPSPlus::subscribe(uint8_t fields)
+{
+  fieldMask = fields;
+  sentenceMask = 0;
+  for (uint8_t t = 0; t < GPS_SENTENCE_OTHER; ++t)
+    if (sentenceFields[t] & fields)
+      sentenceMask |= 1 << t;
+}
+
+//
+// public methods
+//
+
+bool TinyGPSPlus::encode(char c)
+{
+  ++encodedCharCount;
+
+  // A byte at a time has no read() to time, the sentence is done once its checksum starts
+  if (c == '*')
+    arrivalTime = gpsMillis();
+
+  // Nobody wants this sentence, wait for the next one
+  if (skipSentence && c != '$')
+    return false;
+
+  switch(c)
+  {
+  case ',': // term terminators
+  case '\r':
+  case '\n':
+  case '*':
+  case '$': // sentence begin
+    return encodeDelimiter(c);
+
+  default: // ordinary characters
+    if (curTermOffset < sizeof(term) - 1)
+      term[curTermOffset++] = c;
+    if (!isChecksumTerm)
+      parity ^= c;
+    return false;
+  }
+
+  return false;
+}
+
+// The $ , * CR LF half of encode(char), shared with the bulk path
+inline bool TinyGPSPlus::encodeDelimiter(char c)
+{
+  if (c == '$')
+  {
+    curTermNumber = curTermOffset = 0;
+    parity = 0;
+    curSentenceType = GPS_SENTENCE_OTHER;
+    isChecksumTerm = false;
+    sentenceHasFix = false;
+    skipSentence = false;
+    return false;
+  }
+
+  if (c == ',')
+    parity ^= (uint8_t)c;
+
+  bool isValidSentence = false;
+  if (curTermOffset < sizeof(term))
+  {
+    term[curTermOffset] = 0;
+    isValidSentence = endOfTermHandler();
+  }
+  ++curTermNumber;
+  curTermOffset = 0;
+  isChecksumTerm = c == '*';
+  return isValidSentence;
+}
+
+// The characters encode(char) treats specially, everything else is term text
+static inline bool isNMEASpecial(char c)
+{
+  return c == '$' || c == ',' || c == '*' || c == '\r' || c == '\n';
+}
+
+// Scans one block of up to 16 bytes.  Returns a bit per special character and
+// fills prefix[j] with carry ^ s[0] ^ ... ^ s[j], so the XOR of any run inside
+// the buffer is two lookups.  Full blocks use SSE2 or NEON when available.
+static uint32_t scanBlock(const char *s, size_t n, uint8_t carry, uint8_t *prefix)
+{
+#if defined(__SSE2__)
+  if (n == 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)s);
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('$')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))),
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    v = _mm_xor_si128(v, _mm_slli_si128(v, 1));
+    v = _mm_xor_si128(v, _mm_slli_si128(v, 2));
+    v = _mm_xor_si128(v, _mm_slli_si128(v, 4));
+    v = _mm_xor_si128(v, _mm_slli_si128(v, 8));
+    _mm_storeu_si128((__m128i *)prefix, _mm_xor_si128(v, _mm_set1_epi8((char)carry)));
+    return (uint32_t)_mm_movemask_epi8(m);
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  if (n == 16)
+  {
+    static const uint8_t bit[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t zero = vdupq_n_u8(0);
+    uint8x16_t v = vld1q_u8((const uint8_t *)s);
+    uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('$')), vceqq_u8(v, vdupq_n_u8(','))),
+                   vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('*')), vceqq_u8(v, vdupq_n_u8('\r'))),
+                   vceqq_u8(v, vdupq_n_u8('\n'))));
+    v = veorq_u8(v, vextq_u8(zero, v, 15));
+    v = veorq_u8(v, vextq_u8(zero, v, 14));
+    v = veorq_u8(v, vextq_u8(zero, v, 12));
+    v = veorq_u8(v, vextq_u8(zero, v, 8));
+    vst1q_u8(prefix, veorq_u8(v, vdupq_n_u8(carry)));
+    // Fold the byte mask down to one bit per lane
+    m = vandq_u8(m, vld1q_u8(bit));
+    uint8x8_t p = vpadd_u8(vget_low_u8(m), vget_high_u8(m));
+    p = vpadd_u8(p, p);
+    p = vpadd_u8(p, p);
+    return vget_lane_u8(p, 0) | ((uint32_t)vget_lane_u8(p, 1) << 8);
+  }
+#endif
+
+  // Tail block, and the whole job on targets without SIMD
+  uint32_t mask = 0;
+  uint8_t x = carry;
+  for (size_t j = 0; j < n; ++j)
+  {
+    x ^= s[j];
+    prefix[j] = x;
+    if (isNMEASpecial(s[j]))
+      mask |= 1u << j;
+  }
+  return mask;
+}
+
+// A run of ordinary characters with its XOR already known
+void TinyGPSPlus::encodeRun(const char *s, size_t n, uint8_t x)
+{
+  encodedCharCount += n;
+  for (size_t i = 0; i < n && curTermOffset < sizeof(term) - 1; ++i)
+    term[curTermOffset++] = s[i];
+  if (!isChecksumTerm)
+    parity ^= x;
+}
+
+// Bulk version of encode(char) for a whole read buffer.  Delimiters are found
+// 16 bytes at a time and the checksum of the text between them comes from a
+// block-wide prefix XOR, only the delimiters themselves go through the byte-wise
+// state machine.  Skipped sentences are jumped over with memchr.  Returns how
+// many sentences passed their checksum, the decoded fields end up exactly as
+// encode(char) would leave them.
+uint32_t TinyGPSPlus::encode(const char *s, size_t len, uint32_t arrivalMillis)
+{
+  arrivalTime = arrivalMillis;
+  uint32_t sentences = 0;
+  size_t runStart = 0;     // first byte not yet handed to the parser
+  uint8_t runX = 0;        // XOR of the run so far, up to the current block
+  uint8_t prefix[16];
+  size_t block = 0;
+
+  // Still inside a sentence nobody wants from the last buffer
+  if (skipSentence)
+  {
+    const char *d = (const char *)memchr(s, '$', len);
+    runStart = block = d ? d - s : len;
+    encodedCharCount += block;
+  }
+
+  while (block < len)
+  {
+    size_t n = len - block < 16 ? len - block : 16;
+    uint32_t mask = scanBlock(s + block, n, runX, prefix);
+    uint8_t base = 0;      // run XOR is prefix[j] ^ base
+    size_t next = block + n;
+
+    while (mask)
+    {
+      size_t k = __builtin_ctz(mask);
+      mask &= mask - 1;
+      size_t pos = block + k;
+      encodeRun(s + runStart, pos - runStart, (k ? prefix[k - 1] : runX) ^ base);
+      ++encodedCharCount;
+      if (encodeDelimiter(s[pos]))
+        ++sentences;
+      runStart = pos + 1;
+      base = prefix[k];
+
+      if (skipSentence)
+      {
+        const char *d = (const char *)memchr(s + runStart, '$', len - runStart);
+        next = d ? d - s : len;
+        encodedCharCount += next - runStart;
+        runStart = next;
+        base = prefix[n - 1];
+        break;
+      }
+    }
+
+    runX = prefix[n - 1] ^ base;
+    block = next;
+  }
+  encodeRun(s + runStart, len - runStart, runX);
+
+  return sentences;
+}
+
+//
+// internal utilities
+//
+int TinyGPSPlus::fromHex(char a)
+{
+  if (a >= 'A' && a <= 'F')
+    return a - 'A' + 10;
+  else if (a >= 'a' && a <= 'f')
+    return a - 'a' + 10;
+  else
+    return a - '0';
+}
+
+// static
+// Parse a (potentially negative) number with up to 2 decimal digits -xxxx.yy
+int32_t TinyGPSPlus::parseDecimal(const char *term)
+{
+  bool negative = *term == '-';
+  if (negative) ++term;
+  int32_t ret = 100 * (int32_t)atol(term);
+  while (isdigit(*term)) ++term;
+  if (*term == '.' && isdigit(term[1]))
+  {
+    ret += 10 * (term[1] - '0');
+    if (isdigit(term[2]))
+      ret += term[2] - '0';
+  }
+  return negative ? -ret : ret;
+}
+
+// static
+// Parse degrees in that funny NMEA format DDMM.MMMM
+void TinyGPSPlus::parseDegrees(const char *term, RawDegrees &deg)
+{
+  uint32_t leftOfDecimal = (uint32_t)atol(term);
+  uint16_t minutes = (uint16_t)(leftOfDecimal % 100);
+  uint32_t multiplier = 10000000UL;
+  uint32_t tenMillionthsOfMinutes = minutes * multiplier;
+
+  deg.deg = (int16_t)(leftOfDecimal / 100);
+
+  while (isdigit(*term))
+    ++term;
+
+  if (*term == '.')
+    while (isdigit(*++term))
+    {
+      multiplier /= 10;
+      tenMillionthsOfMinutes += (*term - '0') * multiplier;
+    }
+
+  deg.billionths = (5 * tenMillionthsOfMinutes + 1) / 3;
+  deg.negative = false;
+}
+
+// static
+// Sentence type from the first term, e.g. GNRMC.  The last two letters of the
+// formatter hash to a distinct slot for every sentence a receiver normally sends
+// (GGA RMC VTG GSA GSV GLL ZDA TXT GNS GST), so one compare confirms the match.
+uint8_t TinyGPSPlus::sentenceType(const char *term)
+{
+  static const struct { char name[4]; uint8_t type; } table[16] =
+  {
+    {"GLL", GPS_SENTENCE_OTHER}, {"", GPS_SENTENCE_OTHER},    {"RMC", GPS_SENTENCE_RMC},   {"GNS", GPS_SENTENCE_OTHER},
+    {"TXT", GPS_SENTENCE_OTHER}, {"VTG", GPS_SENTENCE_VTG},   {"", GPS_SENTENCE_OTHER},    {"", GPS_SENTENCE_OTHER},
+    {"", GPS_SENTENCE_OTHER},    {"", GPS_SENTENCE_OTHER},    {"GSA", GPS_SENTENCE_OTHER}, {"ZDA", GPS_SENTENCE_OTHER},
+    {"", GPS_SENTENCE_OTHER},    {"GSV", GPS_SENTENCE_OTHER}, {"GGA", GPS_SENTENCE_GGA},   {"GST", GPS_SENTENCE_OTHER}
+  };
+
+  // Two letter talker then a three letter formatter, nothing else
+  if (term[0] != 'G' || term[1] == 0 || term[2] == 0 || term[3] == 0 || term[4] == 0 || term[5] != 0)
+    return GPS_SENTENCE_OTHER;
+  switch (term[1])
+  {
+  case 'P': // GPS
+  case 'N': // multi-constellation
+  case 'L': // GLONASS
+  case 'A': // Galileo
+  case 'B': // BeiDou
+    break;
+  default:
+    return GPS_SENTENCE_OTHER;
+  }
+
+  const char *f = term + 2;
+  uint8_t h = ((uint8_t)f[1] + 7 * (uint8_t)f[2]) & 15;
+  if (f[0] == table[h].name[0] && f[1] == table[h].name[1] && f[2] == table[h].name[2])
+    return table[h].type;
+  return GPS_SENTENCE_OTHER;
+}
+
+#define COMBINE(sentence_type, term_number) (((unsigned)(sentence_type) << 5) | term_number)
+
+// Processes a just-completed term
+// Returns true if new sentence has just passed checksum test and is validated
+bool TinyGPSPlus::endOfTermHandler()
+{
+  // If it's the checksum term, and the checksum checks out, commit
+  if (isChecksumTerm)
+  {
+    uint8_t checksum = 16 * fromHex(term[0]) + fromHex(term[1]);
+    if (checksum == parity)
+    {
+      passedChecksumCount++;
+      if (sentenceHasFix)
+        ++sentencesWithFixCount;
+
+      switch(curSentenceType)
+      {
+      case GPS_SENTENCE_RMC:
+        if (wants(TINYGPS_DATE))
+          date.commit(arrivalTime);
+        if (wants(TINYGPS_TIME))
+          time.commit(arrivalTime);
+        if (sentenceHasFix)
+        {
+          if (wants(TINYGPS_LOCATION))
+            location.commit(arrivalTime);
+          if (wants(TINYGPS_SPEED))
+            speed.commit(arrivalTime);
+          if (wants(TINYGPS_COURSE))
+            course.commit(arrivalTime);
+        }
+        break;
+      case GPS_SENTENCE_GGA:
+        if (wants(TINYGPS_TIME))
+          time.commit(arrivalTime);
+        if (sentenceHasFix)
+        {
+          if (wants(TINYGPS_LOCATION))
+            location.commit(arrivalTime);
+          if (wants(TINYGPS_ALTITUDE))
+            altitude.commit(arrivalTime);
+        }
+        if (wants(TINYGPS_SATELLITES))
+          satellites.commit(arrivalTime);
+        if (wants(TINYGPS_HDOP))
+          hdop.commit(arrivalTime);
+        break;
+      case GPS_SENTENCE_VTG:
+        if (sentenceHasFix)
+        {
+          if (wants(TINYGPS_SPEED))
+            speed.commit(arrivalTime);
+          if (wants(TINYGPS_COURSE))
+            course.commit(arrivalTime);
+        }
+        break;
+      }
+
+      // Commit all custom listeners of this sentence type
+      for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0; p = p->next)
+         p->commit(arrivalTime);
+      return true;
+    }
+
+    else
+    {
+      ++failedChecksumCount;
+    }
+
+    return false;
+  }
+
+  // the first term determines the sentence type
+  if (curTermNumber == 0)
+  {
+    curSentenceType = sentenceType(term);
+    if (curSentenceType != GPS_SENTENCE_OTHER && !(sentenceMask & (1 << curSentenceType)))
+      curSentenceType = GPS_SENTENCE_OTHER;
+
+    // Any custom candidates of this sentence type?
+    for (customCandidates = customElts; customCandidates != NULL && strcmp(customCandidates->sentenceName, term) < 0; customCandidates = customCandidates->next);
+    if (customCandidates != NULL && strcmp(customCandidates->sentenceName, term) > 0)
+       customCandidates = NULL;
+
+    // Nothing here for anyone, don't bother tokenizing the rest
+    if (curSentenceType == GPS_SENTENCE_OTHER && customCandidates == NULL)
+    {
+      skipSentence = true;
+      ++skippedSentenceCount;
+    }
+
+    return false;
+  }
+
+  // Only terms somebody subscribed to get converted
+  if (curSentenceType != GPS_SENTENCE_OTHER && term[0])
+    switch(COMBINE(curSentenceType, curTermNumber))
+  {
+    case COMBINE(GPS_SENTENCE_RMC, 1): // Time in both sentences
+    case COMBINE(GPS_SENTENCE_GGA, 1):
+      if (wants(TINYGPS_TIME))
+        time.setTime(term);
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 2): // RMC validity
+      sentenceHasFix = term[0] == 'A';
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 3): // Latitude
+    case COMBINE(GPS_SENTENCE_GGA, 2):
+      if (wants(TINYGPS_LOCATION))
+        location.setLatitude(term);
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 4): // N/S
+    case COMBINE(GPS_SENTENCE_GGA, 3):
+      location.rawNewLatData.negative = term[0] == 'S';
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 5): // Longitude
+    case COMBINE(GPS_SENTENCE_GGA, 4):
+      if (wants(TINYGPS_LOCATION))
+        location.setLongitude(term);
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 6): // E/W
+    case COMBINE(GPS_SENTENCE_GGA, 5):
+      location.rawNewLngData.negative = term[0] == 'W';
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 7): // Speed (RMC)
+    case COMBINE(GPS_SENTENCE_VTG, 5): // Speed over ground, knots (VTG)
+      if (curSentenceType == GPS_SENTENCE_VTG)
+        sentenceHasFix = true;
+      if (wants(TINYGPS_SPEED))
+        speed.set(term);
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 8): // Course (RMC)
+    case COMBINE(GPS_SENTENCE_VTG, 1): // Course over ground, true (VTG)
+      if (wants(TINYGPS_COURSE))
+        course.set(term);
+      break;
+    case COMBINE(GPS_SENTENCE_RMC, 9): // Date (RMC)
+      if (wants(TINYGPS_DATE))
+        date.setDate(term);
+      break;
+    case COMBINE(GPS_SENTENCE_VTG, 9): // NMEA 2.3 mode indicator (VTG)
+      if (term[0] == 'N')
+        sentenceHasFix = false;
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 6): // Fix data (GGA)
+      sentenceHasFix = term[0] > '0';
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 7): // Satellites used (GGA)
+      if (wants(TINYGPS_SATELLITES))
+        satellites.set(term);
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 8): // HDOP
+      if (wants(TINYGPS_HDOP))
+        hdop.set(term);
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 9): // Altitude (GGA)
+      if (wants(TINYGPS_ALTITUDE))
+        altitude.set(term);
+      break;
+  }
+
+  // Set custom values as needed
+  for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0 && p->termNumber <= curTermNumber; p = p->next)
+    if (p->termNumber == curTermNumber)
+         p->set(term);
+
+  return false;
+}
+
+/* static */
+double TinyGPSPlus::distanceBetween(double lat1, double long1, double lat2, double long2)
+{
+  // returns distance in meters between two positions, both specified
+  // as signed decimal-degrees latitude and longitude. Uses great-circle
+  // distance computation for hypothetical sphere of radius 6372795 meters.
+  // Because Earth is no exact sphere, rounding errors may be up to 0.5%.
+  // Courtesy of Maarten Lamers
+  double delta = radians(long1-long2);
+  double sdlong = sin(delta);
+  double cdlong = cos(delta);
+  lat1 = radians(lat1);
+  lat2 = radians(lat2);
+  double slat1 = sin(lat1);
+  double clat1 = cos(lat1);
+  double slat2 = sin(lat2);
+  double clat2 = cos(lat2);
+  delta = (clat1 * slat2) - (slat1 * clat2 * cdlong);
+  delta = sq(delta);
+  delta += sq(clat2 * sdlong);
+  delta = sqrt(delta);
+  double denom = (slat1 * slat2) + (clat1 * clat2 * cdlong);
+  delta = atan2(delta, denom);
+  return delta * 6372795;
+}
+
+double TinyGPSPlus::courseTo(double lat1, double long1, double lat2, double long2)
+{
+  // returns course in degrees (North=0, West=270) from position 1 to position 2,
+  // both specified as signed decimal-degrees latitude and longitude.
+  // Because Earth is no exact sphere, calculated course may be off by a tiny fraction.
+  // Courtesy of Maarten Lamers
+  double dlon = radians(long2-long1);
+  lat1 = radians(lat1);
+  lat2 = radians(lat2);
+  double a1 = sin(dlon) * cos(lat2);
+  double a2 = sin(lat1) * cos(lat2) * cos(dlon);
+  a2 = cos(lat1) * sin(lat2) - a2;
+  a2 = atan2(a1, a2);
+  if (a2 < 0.0)
+  {
+    a2 += TWO_PI;
+  }
+  return degrees(a2);
+}
+
+const char *TinyGPSPlus::cardinal(double course)
+{
+  static const char* directions[] = {"N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE", "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW"};
+  int direction = (int)((course + 11.25f) / 22.5f);
+  return directions[direction % 16];
+}
+
+void TinyGPSLocation::commit(uint32_t arrival)
+{
+   rawLatData = rawNewLatData;
+   rawLngData = rawNewLngData;
+   lastCommitTime = arrival;
+   valid = updated = true;
+}
+
+void TinyGPSLocation::setLatitude(const char *term)
+{
+   TinyGPSPlus::parseDegrees(term, rawNewLatData);
+}
+
+void TinyGPSLocation::setLongitude(const char *term)
+{
+   TinyGPSPlus::parseDegrees(term, rawNewLngData);
+}
+
+double TinyGPSLocation::lat()
+{
+   updated = false;
+   double ret = rawLatData.deg + rawLatData.billionths / 1000000000.0;
+   return rawLatData.negative ? -ret : ret;
+}
+
+double TinyGPSLocation::lng()
+{
+   updated = false;
+   double ret = rawLngData.deg + rawLngData.billionths / 1000000000.0;
+   return rawLngData.negative ? -ret : ret;
+}
+
+void TinyGPSDate::commit(uint32_t arrival)
+{
+   date = newDate;
+   lastCommitTime = arrival;
+   valid = updated = true;
+}
+
+void TinyGPSTime::commit(uint32_t arrival)
+{
+   time = newTime;
+   lastCommitTime = arrival;
+   valid = updated = true;
+}
+
+void TinyGPSTime::setTime(const char *term)
+{
+   newTime = (uint32_t)TinyGPSPlus::parseDecimal(term);
+}
+
+void TinyGPSDate::setDate(const char *term)
+{
+   newDate = atol(term);
+}
+
+uint16_t TinyGPSDate::year()
+{
+   updated = false;
+   uint16_t year = date % 100;
+   return year + 2000;
+}
+
+uint8_t TinyGPSDate::month()
+{
+   updated = false;
+   return (date / 100) % 100;
+}
+
+uint8_t TinyGPSDate::day()
+{
+   updated = false;
+   return date / 10000;
+}
+
+uint8_t TinyGPSTime::hour()
+{
+   updated = false;
+   return time / 1000000;
+}
+
+uint8_t TinyGPSTime::minute()
+{
+   updated = false;
+   return (time / 10000) % 100;
+}
+
+uint8_t TinyGPSTime::second()
+{
+   updated = false;
+   return (time / 100) % 100;
+}
+
+uint8_t TinyGPSTime::centisecond()
+{
+   updated = false;
+   return time % 100;
+}
+
+void TinyGPSDecimal::commit(uint32_t arrival)
+{
+   val = newval;
+   lastCommitTime = arrival;
+   valid = updated = true;
+}
+
+void TinyGPSDecimal::set(const char *term)
+{
+   newval = TinyGPSPlus::parseDecimal(term);
+}
+
+void TinyGPSInteger::commit(uint32_t arrival)
+{
+   val = newval;
+   lastCommitTime = arrival;
+   valid = updated = true;
+}
+
+void TinyGPSInteger::set(const char *term)
+{
+   newval = atol(term);
+}
+
+TinyGPSCustom::TinyGPSCustom(TinyGPSPlus &gps, const char *_sentenceName, int _termNumber)
+{
+   begin(gps, _sentenceName, _termNumber);
+}
+
+void TinyGPSCustom::begin(TinyGPSPlus &gps, const char *_sentenceName, int _termNumber)
+{
+   lastCommitTime = 0;
+   updated = valid = false;
+   sentenceName = _sentenceName;
+   termNumber = _termNumber;
+   memset(stagingBuffer, '\0', sizeof(stagingBuffer));
+   memset(buffer, '\0', sizeof(buffer));
+
+   // Insert this item into the GPS tree
+   gps.insertCustom(this, _sentenceName, _termNumber);
+}
+
+void TinyGPSCustom::commit(uint32_t arrival)
+{
+   strcpy(this->buffer, this->stagingBuffer);
+   lastCommitTime = arrival;
+   valid = updated = true;
+}
+
+void TinyGPSCustom::set(const char *term)
+{
+   strncpy(this->stagingBuffer, term, sizeof(this->stagingBuffer));
+}
+
+void TinyGPSPlus::insertCustom(TinyGPSCustom *pElt, const char *sentenceName, int termNumber)
+{
+   TinyGPSCustom **ppelt;
+
+   for (ppelt = &this->customElts; *ppelt != NULL; ppelt = &(*ppelt)->next)
+   {
+      int cmp = strcmp(sentenceName, (*ppelt)->sentenceName);
+      if (cmp < 0 || (cmp == 0 && termNumber < (*ppelt)->termNumber))
+         break;
+   }
+
+   pElt->next = *ppelt;
+   *ppelt = pElt;
+}
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define __TinyGPSPlus_h
 
 #include <limits.h>
+#include <stddef.h>
 
 #define _GPS_VERSION "0.92" // software version of this library
 #define _GPS_MPH_PER_KNOT 1.15077945
@@ -43,6 +44,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define radians(deg) ((deg)*DEG_TO_RAD)
 #define sq(x) ((x)*(x))
 
+// Fields a consumer can ask TinyGPSPlus to decode, see subscribe()
+#define TINYGPS_LOCATION   0x01
+#define TINYGPS_DATE       0x02
+#define TINYGPS_TIME       0x04
+#define TINYGPS_SPEED      0x08
+#define TINYGPS_COURSE     0x10
+#define TINYGPS_ALTITUDE   0x20
+#define TINYGPS_SATELLITES 0x40
+#define TINYGPS_HDOP       0x80
+#define TINYGPS_ALL        0xff
+
 typedef unsigned short uint16_t;
 typedef unsigned int uint32_t;
 
@@ -50,6 +62,10 @@ typedef int int32_t;
 typedef unsigned char uint8_t;
 //typedef char byte;
 
+// Monotonic milliseconds, what Arduino's millis() is to upstream TinyGPS++.
+// Named apart from wiringPi's millis(), which counts from wiringPiSetup().
+uint32_t gpsMillis();
+
 
 struct RawDegrees
 {
@@ -67,7 +83,7 @@ struct TinyGPSLocation
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
-   uint32_t age() const    { return 0;}
+   uint32_t age() const    { return valid ? gpsMillis() - lastCommitTime : (uint32_t)ULONG_MAX; }
    const RawDegrees &rawLat()     { updated = false; return rawLatData; }
    const RawDegrees &rawLng()     { updated = false; return rawLngData; }
    double lat();
@@ -80,7 +96,7 @@ private:
    bool valid, updated;
    RawDegrees rawLatData, rawLngData, rawNewLatData, rawNewLngData;
    uint32_t lastCommitTime;
-   void commit();
+   void commit(uint32_t arrival);
    void setLatitude(const char *term);
    void setLongitude(const char *term);
 };
@@ -91,7 +107,7 @@ struct TinyGPSDate
 public:
    bool isValid() const       { return valid; }
    bool isUpdated() const     { return updated; }
-   uint32_t age() const       { return 0;}
+   uint32_t age() const       { return valid ? gpsMillis() - lastCommitTime : (uint32_t)ULONG_MAX; }
 
    uint32_t value()           { updated = false; return date; }
    uint16_t year();
@@ -105,7 +121,7 @@ private:
    bool valid, updated;
    uint32_t date, newDate;
    uint32_t lastCommitTime;
-   void commit();
+   void commit(uint32_t arrival);
    void setDate(const char *term);
 };
 
@@ -115,7 +131,7 @@ struct TinyGPSTime
 public:
    bool isValid() const       { return valid; }
    bool isUpdated() const     { return updated; }
-   uint32_t age() const       { return 0;}
+   uint32_t age() const       { return valid ? gpsMillis() - lastCommitTime : (uint32_t)ULONG_MAX; }
 
    uint32_t value()           { updated = false; return time; }
    uint8_t hour();
@@ -130,7 +146,7 @@ private:
    bool valid, updated;
    uint32_t time, newTime;
    uint32_t lastCommitTime;
-   void commit();
+   void commit(uint32_t arrival);
    void setTime(const char *term);
 };
 
@@ -140,7 +156,7 @@ struct TinyGPSDecimal
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
-   uint32_t age() const    { return 0;}
+   uint32_t age() const    { return valid ? gpsMillis() - lastCommitTime : (uint32_t)ULONG_MAX; }
    int32_t value()         { updated = false; return val; }
 
    TinyGPSDecimal() : valid(false), updated(false), val(0)
@@ -150,7 +166,7 @@ private:
    bool valid, updated;
    uint32_t lastCommitTime;
    int32_t val, newval;
-   void commit();
+   void commit(uint32_t arrival);
    void set(const char *term);
 };
 
@@ -160,7 +176,7 @@ struct TinyGPSInteger
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
-   uint32_t age() const    { return 0;}
+   uint32_t age() const    { return valid ? gpsMillis() - lastCommitTime : (uint32_t)ULONG_MAX; }
    uint32_t value()        { updated = false; return val; }
 
    TinyGPSInteger() : valid(false), updated(false), val(0)
@@ -170,7 +186,7 @@ private:
    bool valid, updated;
    uint32_t lastCommitTime;
    uint32_t val, newval;
-   void commit();
+   void commit(uint32_t arrival);
    void set(const char *term);
 };
 
@@ -205,11 +221,11 @@ public:
 
    bool isUpdated() const  { return updated; }
    bool isValid() const    { return valid; }
-   uint32_t age() const    { return 0;}
+   uint32_t age() const    { return valid ? gpsMillis() - lastCommitTime : (uint32_t)ULONG_MAX; }
    const char *value()     { updated = false; return buffer; }
 
 private:
-   void commit();
+   void commit(uint32_t arrival);
    void set(const char *term);
 
    char stagingBuffer[_GPS_MAX_FIELD_SIZE + 1];
@@ -227,6 +243,10 @@ class TinyGPSPlus
 public:
   TinyGPSPlus();
   bool encode(char c); // process one character received from GPS
+  // process a whole buffer, returns sentences that passed checksum.  arrivalMillis is the
+  // gpsMillis() when the buffer came off the UART, fields committed from it get that time.
+  uint32_t encode(const char *s, size_t len, uint32_t arrivalMillis);
+  uint32_t encode(const char *s, size_t len) { return encode(s, len, gpsMillis()); }
   TinyGPSPlus &operator << (char c) {encode(c); return *this;}
 
   TinyGPSLocation location;
@@ -238,6 +258,11 @@ public:
   TinyGPSInteger satellites;
   TinyGPSDecimal hdop;
 
+  // Only decode these TINYGPS_ fields.  Sentences that carry none of them (and
+  // have no TinyGPSCustom listener) are skipped without being tokenized.
+  void subscribe(uint8_t fields);
+  uint8_t subscribed() const { return fieldMask; }
+
   static const char *libraryVersion() { return _GPS_VERSION; }
 
   static double distanceBetween(double lat1, double long1, double lat2, double long2);
@@ -251,9 +276,11 @@ public:
   uint32_t sentencesWithFix() const { return sentencesWithFixCount; }
   uint32_t failedChecksum()   const { return failedChecksumCount; }
   uint32_t passedChecksum()   const { return passedChecksumCount; }
+  uint32_t sentencesSkipped() const { return skippedSentenceCount; }
 
 private:
-  enum {GPS_SENTENCE_GPGGA, GPS_SENTENCE_GPRMC, GPS_SENTENCE_OTHER};
+  // Any GP/GN/GL/GA/GB talker, only these three are decoded
+  enum {GPS_SENTENCE_GGA, GPS_SENTENCE_RMC, GPS_SENTENCE_VTG, GPS_SENTENCE_OTHER};
 
   // parsing state variables
   uint8_t parity;
@@ -263,6 +290,15 @@ private:
   uint8_t curTermNumber;
   uint8_t curTermOffset;
   bool sentenceHasFix;
+  bool skipSentence;
+  uint32_t arrivalTime;    // when the bytes being parsed arrived, stamped on every commit
+
+  // subscription, fieldMask is what consumers asked for, sentenceMask the
+  // GPS_SENTENCE_ types that carry any of it
+  uint8_t fieldMask;
+  uint8_t sentenceMask;
+  bool wants(uint8_t field) const { return fieldMask & field; }
+  static uint8_t sentenceType(const char *term);
 
   // custom element support
   friend class TinyGPSCustom;
@@ -275,10 +311,13 @@ private:
   uint32_t sentencesWithFixCount;
   uint32_t failedChecksumCount;
   uint32_t passedChecksumCount;
+  uint32_t skippedSentenceCount;
 
   // internal utilities
   int fromHex(char a);
   bool endOfTermHandler();
+  bool encodeDelimiter(char c);
+  void encodeRun(const char *s, size_t n, uint8_t x);
 };
 
 #endif // def(__TinyGPSPlus_h)
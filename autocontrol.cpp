@@ -18,11 +18,28 @@
 #include <string>
 #include <fstream>
 #include <sys/time.h>
+#include <time.h>
 #include <sstream>
+#include <algorithm>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <signal.h>
 using namespace std;
 
 //Custom Includes
 #include "gps.h"
+#include "enu.h"
+#include "track.h"
+#include "fence.h"
+#include "mission.h"
+#include "playback.h"
+#include "trajectory.h"
+#include "recorder.h"
+#include "declination.h"
+#include "estimator.h"
+#include "controlbyte.h"
+#include "headingcontrol.h"
 #include "i2c.h"
 #include "screen.h"
 #include "heading.h"
@@ -34,6 +51,8 @@ using namespace std;
 
 //Define Global Objects
 WayPoint *recordWayPoints =  NULL;
+//Picks which fixes of a macro recording go into recordWayPoints
+MacroRecorder recorder;
 WayPoint *wayPoints = NULL;
 OledScreen screen;
 
@@ -44,14 +63,41 @@ OledScreen screen;
 
 
 
-//In HZ (samples per second).  Currenly Microstack GPS only sends at 1hz so sampling faster is pointless.
+//Seconds between the points of a macro saved before points carried their time
 #define MACROREADPERIOD .5 
 
 
-//Default 7000, which is 7000 seconds or 116 minutes or nearly 2 hours if sample rate is 1HZ.  
-//1 HZ is the default microstack sample rate and currently does not appear to accept changes.
+//Default 7000.  Points are only kept when the quad moves, turns or climbs (and every RECORDMAXPERIOD
+//seconds at a hover) so that is 14 km of flying at RECORDDISTANCE or over 19 hours of hovering.
 #define MAXRECORDWAYPOINTS 7000
 
+//Feet either side of the mission altitude before the quad climbs or dives
+#define ALTDEADBAND	1
+
+//Waypoints closer than this on average are a recorded macro, played back by pursuit instead of leg by leg
+#define MACRODENSESPACING	(2 * MISSIONARRIVAL)
+//Macro playback speed, times the recorded speed, 0 for a fixed PLAYBACKSPEED.  Second argument overrides.
+#define MACROPLAYBACKRATE	1.0
+//1 flies waypoint missions along a smooth trajectory fitted when they load, 0 leg by leg
+#define MISSIONTRAJECTORY	1
+//Seconds, the most the trajectory clock moves between two fixes
+#define TRAJECTORYMAXTICK	0.5
+//Seconds, the most one estimator step covers if the loop stalls
+#define ESTIMATORMAXTICK	0.5
+//Meters, the auto loop steers on the estimate while its horizontal sigma is under this, otherwise on the fix
+#define ESTIMATORSTEERSIGMA	5.0
+//Seconds between mission updates from the estimate while waiting for the next fix
+#define ESTIMATORSTEERPERIOD	0.1
+
+//Startup, see Setup()
+#define GPSWARMUPMAX	120		//Seconds to wait for a first fix before flying without one
+#define MAGRETRYPERIOD	250000		//Microseconds between magnetometer Initialize() attempts
+
+//Geofence polygons and ceiling, see fence.h for the format.  No file, no fence.
+#define FENCEFILE	"/home/pi/waypoints/fence.txt"
+//World Magnetic Model coefficients from NOAA.  No file, the heading keeps HEADINGDECLINATION.
+#define WMMFILE		"/home/pi/WMM.COF"
+
 //Error Defines
 #define ERR_HEARTBEAT 1
 #define ERR_CONTROLBYTE 2
@@ -78,7 +124,10 @@ bool macroRecordMode = false;
 bool forceManual = false;
 bool macroInProgress = false;
 bool autoModeInProgress = false;
-bool holdWayPoint = false;
+//Auto mode is on but there has been no position to fly from, see the auto loop
+bool waitingForPosition = false;
+//Set by CheckFence() while the quad is outside the fence or over its ceiling, the auto loop does nothing else
+bool fenceOverride = false;
 
 //control Bytes
 int currentControlByte = 65535;
@@ -92,6 +141,33 @@ bool requestRotateRight = false;
 
 double distanceTraveled = 0.00;
 double distanceTraveledABS = 0.00;
+GPSFix lastDistanceFix = GPSFix();
+//Odometer frame, follows the quad around so consecutive fixes are a subtraction apart
+ENUFrame odometerFrame;
+ENUPoint lastDistancePoint;
+//Flies wayPoints, legs worked out once when they load
+MissionExecutor mission;
+MacroPlayer player;
+bool playMacro = false;
+Trajectory trajectory;
+bool flyTrajectory = false;
+double lastTrajectoryTick;
+int lastMissionLeg = -2;
+Geofence fence;
+//Declination where we fly, the grid is built again whenever the quad leaves it
+MagneticModel magModel;
+DeclinationGrid declinationGrid;
+uint32_t lastDeclinationFix = 0;
+//Position, velocity and heading every pass of the loops, between fixes as well
+StateEstimator estimator;
+double lastEstimatorTick = 0;
+uint32_t lastEstimatorFix = 0;
+unsigned long lastEstimatorHeading = 0;
+uint32_t lastSteerFix = 0;
+double lastSteerTime = 0;
+//Turns to the mission heading a pass at a time, see StepHeading()
+HeadingController headingControl;
+uint32_t lastHeadingTimeouts = 0;
 
 
 //File Descriptors for I2C communication
@@ -131,6 +207,7 @@ double lastHeartBeat = 0;
 timeval currentTime;
 long lastScreenUpdate = 0;
 long bootup = 0;
+string gpsDevice = GPSDEVICE;
 
 double lastMacroRead;
 
@@ -140,7 +217,7 @@ double lastMacroRead;
 int currentStep = 0;
 int maxSteps = 0;
 int recordCounter;
-int currentWayPoint;
+int wayPointCount = 0;
 
 
 //Starts a global timer
@@ -188,16 +265,32 @@ double GetTimerLapse()
 WayPoint *GetCurrentLocation()
 {
 	WayPoint *wp = new WayPoint;
+	GPSFix fix = gps->GetFix();
 
-	wp->lat = gps->GetLat();
-        wp->lng = gps->GetLong();
-        wp->alt = gps->GetAlt();
-        wp->heading = magHeading -> GetHeading();
+	wp->lat = fix.lat;
+        wp->lng = fix.lng;
+        wp->alt = fix.alt;
+	//The heading when the fix was measured, not now
+	magHeading->GetHeading();
+        wp->heading = magHeading->HeadingAt(fix.arrivalTime - GPSFIXLATENCY);
+	wp->seconds = 0;
 
 	return wp;
 	
 }
 
+
+//The estimate's position in p once it has a fix and is tight enough to steer on, p is left alone otherwise
+bool SteeringPosition(GeoPoint &p)
+{
+	EstimatorState s = estimator.Get();
+	if(s.fixes == 0 || s.positionSigma > ESTIMATORSTEERSIGMA)
+		return false;
+	p = GeoFromDegrees(s.lat,s.lng);
+	return true;
+}
+
+
 //A basic function for logging, simply uses STOUT for now
 void Logger(const char* function, const char* toLog)
 {
@@ -212,18 +305,45 @@ void DisplayOLED()
 	{
 	cout.precision( 10 );
 
-	double lat = gps->GetLat();
-	double lng = gps->GetLong();
-	double alt = gps->GetAlt();
+	GPSFix fix = gps->GetFix();
+	double lat = fix.lat;
+	double lng = fix.lng;
+	double alt = fix.alt;
+	//Where the estimate has the quad now, once it is good enough to steer on
+	GeoPoint here;
+	if(SteeringPosition(here))
+	{
+		lat = GeoToDegrees(here.lat);
+		lng = GeoToDegrees(here.lng);
+	}
 
-	double lastTraveled = fabs(gps->DistanceBetween(lat,lng,gps->previousLat,gps->previousLong));
+	//Only count a new fix, and only once it has moved past the deadband
+	if(lastDistanceFix.sequence == 0)
+	{
+		lastDistanceFix = fix;
+		odometerFrame.Update(fix.position,0);
+		lastDistancePoint = odometerFrame.vehicle;
+	}
+	else if(fix.sequence != lastDistanceFix.sequence)
+	{
+		if(odometerFrame.Update(fix.position,0))
+			lastDistancePoint = odometerFrame.ToENU(lastDistanceFix.position,0);
+		ENUPoint p = odometerFrame.vehicle;
+		double lastTraveled = GeoLength(p.north - lastDistancePoint.north,p.east - lastDistancePoint.east) * METERSTOINCHES / 1000;
 
-	if(lastTraveled >= GPSINCHESDEADBAND)
-		distanceTraveled += fabs(gps->DistanceBetween(lat,lng,gps->previousLat,gps->previousLong));
+		if(lastTraveled >= GPSINCHESDEADBAND)
+		{
+			distanceTraveled += lastTraveled;
+			lastDistanceFix = fix;
+			lastDistancePoint = p;
+		}
+	}
 
 
-	double head = magHeading-> GetHeading();
-	double headGPS = gps->GetHeading();
+	//Read now, shown as it was when the fix was measured so it lines up with the course
+	magHeading->GetHeading();
+	double head = magHeading->HeadingAt(fix.arrivalTime - GPSFIXLATENCY);
+	double headGPS = fix.course;
 
 	std::ostringstream sLat;
 	std::ostringstream sLng;
@@ -258,7 +378,10 @@ void DisplayOLED()
 		d += "RECORD";
 
 	//Assume GPS FIXED
-	d += "  FIXED";	
+	if(fenceOverride)
+		d += "  FENCE";
+	else
+		d += "  FIXED";	
 
 	d += "\n\n";
 
@@ -327,12 +450,15 @@ bool SaveWayPoints(WayPoint *toSave)
 {
 	fstream oFile;
 	oFile.open("/home/pi/waypoints/waypoints.txt",std::fstream::out);  	
+	//The default 6 digits is only 10 m of latitude
+	oFile.precision(10);
 	for(int i=0;i<recordCounter;i++)
 	{
 		oFile << toSave[i].lat << ";";
                 oFile << toSave[i].lng << ";";
                 oFile << toSave[i].alt << ";";
-		oFile << toSave[i].heading;
+		oFile << toSave[i].heading << ";";
+		oFile << toSave[i].seconds;
 		oFile << endl;
 
 	}
@@ -343,43 +469,25 @@ bool SaveWayPoints(WayPoint *toSave)
 
 
 
-//an absolute direction move that is relative to the quadcopter orientation
-//Allows the ControlSwitch to use the defaults speed
-int MakeControlByte(int forward,int reverse,int left,int right,int climb, int dive, int rright,int rleft)
+//Length and reach of a recording, one pass of the batch kernels over the whole track
+void LogMissionStats(WayPoint *wp,int count)
 {
-        unsigned int cb = 0;
-        unsigned int m = 0;
-        if(forward)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(reverse)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(left)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(right)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(climb)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(dive)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(rright)
-                cb = cb | 1;
-        cb = cb << 1;
-        if(rleft)
-                cb = cb | 1;
-        m =  cb % 17;
-        cb = cb << 8;
-        cb = cb | m;
-
-
+	Track track;
+	track.Load(wp,count);
+	if(track.Count() < 2)
+		return;
+	vector<float> length(count),bearing(count),cumulative(count),fromStart(count);
+	float total = track.Legs(length.data(),bearing.data(),cumulative.data());
+	track.Distances(GeoFromDegrees(wp[0].lat,wp[0].lng),fromStart.data());
+	float farthest = *max_element(fromStart.begin(),fromStart.end());
+
+	std::ostringstream sL;
+	sL << count << " waypoints, " << total << " m long, " << farthest << " m from the start at most";
+	Logger("MissionStats",sL.str().c_str());
 }
 
 
+
 //This function is to handle errors, however I choose to do that eventually
 void ErrorOut(int code)
 {
@@ -395,119 +503,158 @@ void ErrorOut(int code)
 
 
 //Main startup function, sets up devices, and I2c.
-int Setup()
+//Each device comes up on its own thread, Setup() just watches the futures
+bool SetupI2C()
 {
-        
-	string d("");
-
-	Logger("setup",VERSION);
-       wiringPiSetup();
-       Logger("setup","Initializing pins");
-       pinMode(PIAUTOMODE, INPUT);
-       pinMode(PIMACRORECORD, INPUT);
-	pullUpDnControl     (PIAUTOMODE,PUD_DOWN);
-	pullUpDnControl     (PIMACRORECORD,PUD_DOWN);
-	
-	Logger("setup","Starting I2C");
-	//Setup I2C
 	controlSwitch = wiringPiI2CSetup(I2C_CONTROLSWITCH_ID);
 	sensorArray = wiringPiI2CSetup(I2C_SENSORARRAY_ID);
 	memsBoard = wiringPiI2CSetup(I2C_MEMS_ID);
-	Logger("setup","Starting GPS");
+	return controlSwitch >= 0 && sensorArray >= 0 && memsBoard >= 0;
+}
+
+
+//Ready once the receiver has a position, a hot start from the saved fix takes seconds
+bool SetupGPS()
+{
 	gps = new GPS();
 	gps->Initialize();
+	gps->devicePath = gpsDevice;
+	//Ask for 115200 baud and 10 Hz, the GPS thread falls back to whatever the receiver takes
+	gps->targetBaud = GPSHIGHBAUD;
+	gps->targetRate = GPSHIGHRATE;
+	gps->warmStartPath = GPSWARMSTARTFILE;
 	gps->Start();
+	return gps->WaitForFix(GPSWARMUPMAX);
+}
 
 
-
-        d = "QUADCOP ";
-        d += VERSION;
-	d += "\n\n";
-	d += "INITIALIZING\n\n";
-	
-
-	screen.WriteText(d);
-
-	float lng, lat;
-
-	lng = gps->GetLong();
-	lat = gps->GetLat();
-
-	int c = 0;
-/*
-	while(lng ==0 && lat == 0)
-	{
-		usleep(1000000);
-	        lng = gps->GetLong();
-        	lat = gps->GetLat();
-	        d = "QUADCOP ";
-
-	        d += VERSION;
-	        d += "\n\n";
-       	 	d += "INITIALIZING GPS \n\n";
-		d += c++;
-
-		screen.WriteText(d);
-	} 
-*/
-	bootup = GetTimeStamp();
-
-        d = "QUADCOP ";
-        d += VERSION;
-        d += "\n\n";
-        d += "INITIALIZING\n\n";
-
+bool SetupMagnetometer()
+{
 	magHeading = new Heading(HEADINGADDRESS);
-       int t = magHeading -> Initialize();
-
- while(t < 0)
-        {
-                usleep(1000000);
-		t = magHeading -> Initialize();
-                d = "QUADCOP ";
-
-                d += VERSION;
-                d += "\n\n";
-                d += "INITIALIZING MAG \n\n";
-                d += c++;
+	while(magHeading -> Initialize() < 0)
+		usleep(MAGRETRYPERIOD);
+	return true;
+}
 
-                screen.WriteText(d);
-        }
-        d = "QUADCOP ";
-        d += VERSION;
-        d += "\n\n";
-        d += "Warming up GPS\n\n";
 
-	long l;
+//Builds the fence grid, a big fence takes a moment on the Pi so it loads alongside the devices
+bool SetupFence()
+{
+	return fence.Load(FENCEFILE) && fence.Count() > 0;
+}
 
 
+//Magnetic model coefficients, the grid waits for a fix
+bool SetupDeclination()
+{
+	return magModel.Load(WMMFILE);
+}
 
 
+//Sets the heading's declination from the grid for each new fix, building the grid around the fix the first
+//time and whenever the quad has flown off it.  False until there is a model and a fix.
+bool UpdateDeclination(const GPSFix &fix)
+{
+	if(!magModel.Loaded() || fix.sequence == 0)
+		return false;
+	if(fix.sequence == lastDeclinationFix)
+		return true;
+	float declination,inclination;
+	if(!declinationGrid.Lookup(fix.lat,fix.lng,declination,inclination))
+	{
+		//Past the model's years the secular change is extrapolated no further
+		double year = 1970 + time(NULL) / 31557600.0;
+		year = max(magModel.epoch,min(year,magModel.epoch + WMMVALIDYEARS));
+		declinationGrid.Build(magModel,fix.lat,fix.lng,fix.alt * FEETTOMM / 1e6,year);
+		if(!declinationGrid.Lookup(fix.lat,fix.lng,declination,inclination))
+			return false;
+	}
+	magHeading->declination = declination;
+	lastDeclinationFix = fix.sequence;
+	return true;
+}
 
 
-	while(l<10)
-	{
-	  	std::ostringstream sL;
-       		d = "QUADCOP ";
-		d += VERSION;
-       		d += "\n\n";
-        	d += "Warming up GPS\n\n";
-		l = GetLapsedTime(bootup);
+//Shows which devices are still coming up
+void ShowSetupStatus(const char *what,int seconds)
+{
+	std::ostringstream sL;
+	string d = "QUADCOP ";
+	d += VERSION;
+	d += "\n\n";
+	d += what;
+	d += "\n\n";
+	sL << seconds;
+	d += sL.str();
+	screen.WriteText(d);
+}
 
-		sL << (10-l);
 
-		d+= sL.str();
-		screen.WriteText(d);	
-		cout << d << endl;
-		usleep(1000000);
+int Setup()
+{
+	Logger("setup",VERSION);
+	wiringPiSetup();
+	Logger("setup","Initializing pins");
+	pinMode(PIAUTOMODE, INPUT);
+	pinMode(PIMACRORECORD, INPUT);
+	pullUpDnControl     (PIAUTOMODE,PUD_DOWN);
+	pullUpDnControl     (PIMACRORECORD,PUD_DOWN);
 
+	bootup = GetTimeStamp();
+	ShowSetupStatus("INITIALIZING",0);
+
+	//I2C, GPS and magnetometer in parallel, the GPS warm up no longer waits for the others
+	Logger("setup","Starting I2C, GPS and magnetometer");
+	future<bool> i2cReady = async(launch::async, SetupI2C);
+	future<bool> gpsReady = async(launch::async, SetupGPS);
+	future<bool> magReady = async(launch::async, SetupMagnetometer);
+	future<bool> fenceReady = async(launch::async, SetupFence);
+	future<bool> declinationReady = async(launch::async, SetupDeclination);
+
+	if(!i2cReady.get())
+		Logger("setup","I2C device missing");
+
+	while(magReady.wait_for(chrono::milliseconds(250)) != future_status::ready)
+		ShowSetupStatus("INITIALIZING MAG",(int)GetLapsedTime(bootup));
+	magReady.get();
+
+	while(gpsReady.wait_for(chrono::milliseconds(250)) != future_status::ready)
+		ShowSetupStatus("Warming up GPS",(int)GetLapsedTime(bootup));
+	if(gpsReady.get())
+		Logger("setup","GPS has a fix");
+	else
+		Logger("setup","No GPS fix, altitude calibration will be off");
 
+	if(fenceReady.get())
+	{
+		std::ostringstream sF;
+		sF << fence.Count() << " fence polygons, ceiling " << fence.ceiling << " ft";
+		Logger("setup",sF.str().c_str());
 	}
+	else
+		Logger("setup","No geofence loaded");
 
-	gps->CalibrateAltitude();
+	if(declinationReady.get())
+	{
+		std::ostringstream sD;
+		sD << magModel.name << " epoch " << magModel.epoch;
+		Logger("setup",sD.str().c_str());
+		if(UpdateDeclination(gps->GetFix()))
+		{
+			std::ostringstream sG;
+			sG << "Declination " << magHeading->declination * GEODEGREES << " degrees";
+			Logger("setup",sG.str().c_str());
+		}
+	}
+	else
+		Logger("setup","No magnetic model, fixed declination");
 
-	
+	std::ostringstream sT;
+	sT << "Ready in " << GetLapsedTime(bootup) << " s";
+	Logger("setup",sT.str().c_str());
 
+	gps->CalibrateAltitude();
+	return 0;
 }
 
 //Splits a string by a deliminator
@@ -529,45 +676,40 @@ int split(string toSplit,char delim,string *r)
 }
 
 
-//Load the waypoints from the standard location
+//Load the waypoints from the standard location, lat;lng;alt;heading;seconds a line as SaveWayPoints() writes them.
+//Older files without the seconds were recorded every MACROREADPERIOD.
 bool LoadMacro()
 {
-	
-/*	recordWayPoints = new WayPoint[1];
-	recordWayPoints = GetCurrentLocation();
-	recordCounter = 1;
-	return true; */
-	
-
-
 	ifstream iFile("/home/pi/waypoints/waypoints.txt");
-	string *r = new string[10];
-	int i = 0;
-	string t;
-	string *a;
-	if(iFile.is_open())
+	if(!iFile.is_open())
 	{
-		recordWayPoints = new WayPoint[MAXRECORDWAYPOINTS];
-        	while(getline(iFile,t))
-		{
-			cout << "." << endl;
-			if(t.length() > 0)
-				cout << split(t,';',r) << endl;
-			i++;
-			
-		}
-        }
-	else
-		cout << "ERROR" << endl;
-	recordCounter = i;
-
-        iFile.close();
-        return true;
+		Logger("LoadMacro","No waypoint file");
+		return false;
+	}
+	if(wayPoints == NULL)
+		wayPoints = new WayPoint[MAXRECORDWAYPOINTS];
 
+	string t;
+	string r[10];
+	wayPointCount = 0;
+	while(getline(iFile,t) && wayPointCount < MAXRECORDWAYPOINTS)
+	{
+		for(int i=0;i<10;i++)
+			r[i].clear();
+		if(t.length() == 0 || split(t,';',r) < 4)
+			continue;
+		wayPoints[wayPointCount].lat = atof(r[0].c_str());
+		wayPoints[wayPointCount].lng = atof(r[1].c_str());
+		wayPoints[wayPointCount].alt = atof(r[2].c_str());
+		wayPoints[wayPointCount].heading = atof(r[3].c_str());
+		wayPoints[wayPointCount].seconds = r[4].length() > 0 ? atof(r[4].c_str()) : wayPointCount * MACROREADPERIOD;
+		wayPointCount++;
+	}
+	iFile.close();
+	return wayPointCount > 0;
 }
 
 
-
 //Checks the Automode pin which is connected to the control switch
 inline void GetAutoMode()
 {
@@ -641,110 +783,58 @@ bool CheckHeartBeat()
 //Note:  It does not shut off motors since the quadCOP be hovering.
 void AllStop()
 {
-	SendControlByte(MakeControlByte(0,0,0,0,0,0,0,0));
+	currentControlByte = MakeControlByte(0,0,0,0,0,0,0,0);
+	SendControlByte(currentControlByte);
 
 }
 
 
-//This function determines which direction we need to rotate to get to the desired heading
-//This function does not set the heading, but set vars that are used in the main loop
-//The ratation is then combinded with other motiion
-bool SetHeadingRequest(double toHeading)
+//Sends cb only when it differs from the byte last sent, trying twice.  currentControlByte only changes
+//once cb has gone out, so a failed send is tried again on the next pass.
+void SetControlByte(int cb)
 {
-	if(!magHeading->HeadingReached(toHeading))
-	{
-		double heading = gps->GetHeading();
-		requestRotateRight = false;
-		requestRotateLeft = false;
-                if(toHeading > heading)
-                {
-                        if(toHeading - heading > 180)
-                        {
-                                requestRotateRight = false;
-                                requestRotateLeft= true;
-                        }
-                        else
-                        {
-                                requestRotateRight = true;
-                                requestRotateLeft = false;
-                        }
-                }
-                else
-                {
-                        if(heading - toHeading > 180)
-                        {
-                                requestRotateRight = true;
-                                requestRotateLeft= false;
-                        }
-                        else
-                        {
-                                requestRotateRight = false;
-                                requestRotateLeft= true;
-                        }
-                }
-        }
+	if(cb == currentControlByte)
+		return;
+	if(SendControlByte(cb) < 0 && SendControlByte(cb) < 0)
+		return;
+	currentControlByte = cb;
 }
 
-//This functions stops all motion and sets the heading
-bool  SetHeading(double toHeading)
+
+//Where the heading controller wants the rotation, read into requestRotateRight and requestRotateLeft for
+//MakeControlByte().  The magnetometer is only read when it has measured again.
+int StepHeading()
 {
-	double start = GetTimeStamp();
-	double heading = gps->GetHeading();
-	bool rotateRight = true;
-	//Determine which way to rotate
-	while(!magHeading->HeadingReached(toHeading) && GetLapsedTime(start) < 3)
+	double now = GetTimeStamp();
+	if(headingControl.ReadDue(now))
+		magHeading->GetHeading();
+	int rotate = headingControl.Step(now,magHeading->currentHeading);
+	requestRotateRight = rotate == CONTROLROTATERIGHT;
+	requestRotateLeft = rotate == CONTROLROTATELEFT;
+	if(headingControl.timeouts != lastHeadingTimeouts)
 	{
-		nextControlByte = 0;
-
-		if(toHeading > heading)
-                {
-                    //Need to rotate right, but left may be quicker
-                        if(toHeading - heading > 180)
-                        {
-                                rotateRight = false;
-                                
-                        }
-                        else
-                        {
-                                rotateRight = true;
-                                
-                        }
-                }
-                else
-                {
-                        if(heading - toHeading > 180)
-                        {
-                                rotateRight = true;
-                        }
-                        else
-                        {
-                                rotateRight = false;
-                        }
-                }	
-		if(rotateRight)
-		{
-			nextControlByte = currentControlByte;
-			nextControlByte >>= 2;
-			nextControlByte <<= 2;
-			nextControlByte |= 1;
-
-		}
-		else
-		{
-                        nextControlByte = currentControlByte;
-                        nextControlByte >>= 2;
-                        nextControlByte <<= 2;
-                        nextControlByte |= 2;
+		Logger("Heading","Turn timed out, rotation stopped");
+		lastHeadingTimeouts = headingControl.timeouts;
+	}
+	return rotate;
+}
 
-		}
-		SendControlByte(nextControlByte);
 
-	}
-	if(!magHeading->HeadingReached(toHeading))
-		return true;
-	else
-		return false;
+//Points the heading controller at the desired heading and steps it, the short way round
+//This function does not set the heading, but set vars that are used in the main loop
+//The ratation is then combinded with other motiion
+bool SetHeadingRequest(double toHeading)
+{
+	headingControl.Target(toHeading,GetTimeStamp());
+	return StepHeading() != 0;
+}
 
+//Starts a turn to the heading and returns, StepHeading() each pass of the loop carries it out.
+//True while the quad is still turning.
+bool  SetHeading(double toHeading)
+{
+	headingControl.Target(toHeading,GetTimeStamp());
+	return headingControl.State() == HEADINGTURNING;
 }
 
 
@@ -774,14 +864,86 @@ bool CheckAltitude()
 
 
 
-//a temp prototype for moving to a waypoint, but actually tries to hold it.
- 
-bool HoldWayPoint(WayPoint *wp)
+//Checked every pass of the control loops, sets fenceOverride on a breach and the dive request over the ceiling.
+//Nothing is decided on an old fix.
+bool CheckFence()
 {
-	if(gps->WayPointReached(wp))
-		return true;
-	else
-		return false;
+	GPSFix fix = gps->GetFix();
+	if(fix.sequence == 0 || gps->IsStale(fix))
+		return fenceOverride;
+	FenceStatus status = fence.Check(fix.position,fix.alt);
+	bool breach = (status.flags & (FENCEBREACH | FENCECEILING)) != 0;
+	if(breach != fenceOverride)
+	{
+		std::ostringstream sF;
+		if(status.flags & FENCEBREACH)
+			sF << "Breach, outside the fence by " << -status.margin << " m";
+		else if(status.flags & FENCECEILING)
+			sF << "Breach, over the ceiling at " << fix.alt << " ft";
+		else
+			sF << "Back inside, " << status.margin << " m from the edge";
+		Logger("Geofence",sF.str().c_str());
+	}
+	fenceOverride = breach;
+	if(breach)
+	{
+		climbRequest = false;
+		diveRequest = (status.flags & FENCECEILING) != 0;
+	}
+	return fenceOverride;
+}
+
+
+
+//Moves the estimate on to now with the control byte last sent, then folds in a new fix and any magnetometer
+//read made since the last pass, each at its age.  The pilot's sticks are not seen, so outside auto mode the
+//model coasts.
+void UpdateEstimator()
+{
+	double now = GetTimeStamp();
+	if(lastEstimatorTick > 0)
+		estimator.Predict(min(now - lastEstimatorTick,ESTIMATORMAXTICK),autoModeInProgress ? currentControlByte : 0);
+	lastEstimatorTick = now;
+
+	double monotonic = gps->GetMonotonicTime();
+	GPSFix fix = gps->GetFix();
+	if(fix.sequence != lastEstimatorFix && !gps->IsStale(fix))
+		estimator.UpdateGPS(fix,monotonic - fix.arrivalTime + GPSFIXLATENCY);
+	lastEstimatorFix = fix.sequence;
+	if(magHeading->reads != lastEstimatorHeading)
+		estimator.UpdateHeading(magHeading->currentHeading,monotonic - magHeading->readTime);
+	lastEstimatorHeading = magHeading->reads;
+	estimator.Publish(now);
+}
+
+
+//Turns the mission executor's requests into a control byte.  Nothing in here waits,
+//the turn goes out combined with the move and the climb or dive, and only when the byte changes.
+void FlyMissionRequest(const MissionRequest &r)
+{
+	//A new leg gets its turn even if the last one timed out
+	if(r.leg != lastMissionLeg)
+		headingControl.Rearm(GetTimeStamp());
+	SetHeadingRequest(r.heading);
+	double target = min(max(r.alt,minAlt),maxAlt);
+	double alt = gps->GetAlt();
+	climbRequest = alt < target - ALTDEADBAND;
+	diveRequest = alt > target + ALTDEADBAND;
+	SetControlByte(MakeControlByte(r.speed > 0,false,false,false,climbRequest,diveRequest,requestRotateRight,requestRotateLeft));
+
+	//Every leg of a mission, a macro only when it starts and finishes
+	if(playMacro ? (r.leg < 0) != (lastMissionLeg < 0) : r.leg != lastMissionLeg)
+	{
+		std::ostringstream sL;
+		if(r.leg < 0)
+			sL << "Holding the last waypoint";
+		else if(playMacro)
+			sL << "Playing back " << player.Length() << " m of macro from " << r.alongTrack << " m";
+		else
+			sL << "Leg " << r.leg + 1 << " of " << mission.Count();
+		Logger("Mission",sL.str().c_str());
+		lastMissionLeg = r.leg;
+	}
 }
 
 
@@ -802,9 +964,24 @@ int SendSensorCommand(int command,int param)
 }
 
 
-//Main Loop that never ends.
-int main(void)
+//Cleared by SIGINT/SIGTERM so the GPS can save its warm start on the way out
+volatile sig_atomic_t running = 1;
+
+void Shutdown(int)
 {
+	running = 0;
+}
+
+
+//Main Loop, runs until SIGINT or SIGTERM
+//usage: autocontrol [gps device] [playback rate], e.g. the pty tools/gpssim prints
+int main(int argc,char **argv)
+{
+	if(argc > 1)
+		gpsDevice = argv[1];
+	player.rate = argc > 2 ? atof(argv[2]) : MACROPLAYBACKRATE;
+	signal(SIGINT, Shutdown);
+	signal(SIGTERM, Shutdown);
 	Setup();
 	Logger("main","Starting main control loop");
 	StartTimer();
@@ -815,7 +992,7 @@ int main(void)
 	else
 		cout << "Entering Manual Mode" << endl;
 	
-	while(1)
+	while(running)
 	{
 		DisplayOLED();
 
@@ -841,87 +1018,124 @@ int main(void)
 		GetAutoMode();
 		GetMacroMode();
 		CheckHeartBeat();
+		CheckFence();
+		UpdateEstimator();
 
 		//This inner loop is for autocontrol mode and the RPFS is flying the quad.
-		while(autoMode)
+		while(autoMode && running)
 		{
 			DisplayOLED();
 			if(!autoModeInProgress)
 			{
+				//Nothing to fly or hold on before a position fix, stop once and wait for one
+				GPSFix fix = gps->GetFix();
+				if(gps->IsStale(fix))
+				{
+					if(!waitingForPosition)
+					{
+						Logger("AutoLoop","No position fix, all stop until there is one");
+						AllStop();
+						waitingForPosition = true;
+					}
+					GetAutoMode();
+					continue;
+				}
+				waitingForPosition = false;
+
 				Logger("AutoLoop","Entering auto flight mode");
 				autoModeInProgress = true;
 
-				/*
-				if(wayPoints == NULL)
+				if(wayPointCount > 1 && playMacro)
+					cout << "Resuming macro at point " << player.Rejoin(fix.position) + 1 << endl;
+				else if(wayPointCount > 1)
+				{
+					int leg = mission.Rejoin(fix.position);
+					if(flyTrajectory)
+						trajectory.Rejoin(leg);
+					cout << "Resuming waypoints at leg " << leg + 1 << endl;
+				}
+				else if(LoadMacro())
 				{
-						
-					Logger("AutoLoop","load waypoint macros");
-					LoadMacro();
-					cout << recordCounter << " waypoints loaded" << endl;
-					currentWayPoint = 0;
+					mission.Load(wayPoints,wayPointCount);
+					player.Load(wayPoints,wayPointCount);
+					playMacro = player.Count() > 1 && player.Length() / (player.Count() - 1) < MACRODENSESPACING;
+					trajectory.maxSpeed = mission.cruise;
+					flyTrajectory = MISSIONTRAJECTORY && !playMacro && trajectory.Build(mission.track);
+					cout << wayPointCount << (playMacro ? " macro points loaded" : " waypoints loaded") << endl;
 				}
 				else
-					cout << "Resuming ways points " << endl;
-				*/
-
-				//hard coded waypoint here
-				//Waypoints consist of current location only
-
-				if(wayPoints == NULL)
-					wayPoints = new WayPoint[1];
-				wayPoints[0].lng = gps->GetLong();
-				wayPoints[0].lat = gps->GetLat();
-				wayPoints[0].alt = gps->GetAlt();
-
+				{
+					//No mission, hold where auto mode was switched on
+					WayPoint here;
+					here.lat = fix.lat;
+					here.lng = fix.lng;
+					here.alt = fix.alt;
+					here.heading = fix.course;
+					here.seconds = 0;
+					mission.Load(&here,1);
+					playMacro = false;
+					flyTrajectory = false;
+					Logger("AutoLoop","Holding the current position");
+				}
+				lastMissionLeg = -2;
+				lastTrajectoryTick = GetTimeStamp();
+				//Known to the switch, from here bytes only go out when they change
+				AllStop();
+			}
 
+			UpdateEstimator();
 
+			//A breach overrides the mission, stop and come down under the ceiling until it clears
+			if(CheckFence())
+			{
+				SetControlByte(MakeControlByte(false,false,false,false,false,diveRequest,false,false));
+				headingControl.Release();
+				GetAutoMode();
+				continue;
 			}
 
-			//HARD CODED var here for testing
-			// will be removed
-
-			holdWayPoint = true;
-			if(holdWayPoint)
+			//Each new position fix steers, and between fixes the estimate every ESTIMATORSTEERPERIOD.  The
+			//estimate stands in for the fix whenever it is good, nothing steers once the fix is stale.
+			GPSFix fix = gps->GetFix();
+			GeoPoint here = fix.position;
+			bool estimated = SteeringPosition(here);
+			bool newFix = fix.sequence != lastSteerFix && (fix.fields & GPSFIX_POSITION);
+			if(!gps->IsStale(fix) && (newFix || (estimated && GetLapsedTime(lastSteerTime) >= ESTIMATORSTEERPERIOD)))
 			{
-				if(!HoldWayPoint(&wayPoints[0]))
+				if(newFix)
+					UpdateDeclination(fix);
+				lastSteerFix = fix.sequence;
+				lastSteerTime = GetTimeStamp();
+				if(playMacro)
+					FlyMissionRequest(player.Update(here));
+				else if(flyTrajectory)
 				{
-					SetHeading(wayPoints[0].heading);
-					CheckAltitude();
-					if(SendControlByte(MakeControlByte(true,false,false,false,climbRequest, diveRequest, false,false)) < 0)
-					{
-						SendControlByte(MakeControlByte(true,false,false,false,climbRequest, diveRequest, false,false));
-					}
-
+					double seconds = min(GetLapsedTime(lastTrajectoryTick),TRAJECTORYMAXTICK);
+					lastTrajectoryTick = GetTimeStamp();
+					FlyMissionRequest(trajectory.Update(here,seconds));
 				}
+				else
+					FlyMissionRequest(mission.Update(here));
 			}
-			//fly the Quad here
-			/*
-			if(gps->WayPointReached(&wayPoints[currentWayPoint]))
-			{
-				currentWayPoint++;
-				currentWayPoint %= recordCounter;
-			}
+			//Every other pass only the turn goes on, the byte goes out when the rotation changes
 			else
-			{
-				//SetHeading(wayPoints[currentWayPoint].heading);
-
-			}	
-			*/
-			
+				SetControlByte(RotateControlByte(currentControlByte,StepHeading()));
 
 			 GetAutoMode();
 
 			
 		}
+		waitingForPosition = false;
 		if(autoModeInProgress)
 		{
 			autoModeInProgress = false;
+			headingControl.Release();
 			Logger("AutoLoop","Exiting auto flight mode");
 		}	
 
 		//This inner loop is still for manual control, but here the RPFS is recording waypoint macros.
 
-		while(macroRecordMode)
+		while(macroRecordMode && running)
 		{
                        DisplayOLED();
 
@@ -932,23 +1146,20 @@ int main(void)
 				lastMacroRead = GetTimeStamp();
 				recordWayPoints = new WayPoint[MAXRECORDWAYPOINTS];
 				recordCounter = 0;
+				recorder.Start(recordWayPoints,MAXRECORDWAYPOINTS);
 			}
 			//Record Macros Here
-			//Record a macro every MACROREADPERIOD (in seconds)
-			if(GetLapsedTime(lastMacroRead) > MACROREADPERIOD)
+			//Every fix is offered to the recorder, which keeps the ones where the quad moved, turned or climbed
+			if(GetLapsedTime(lastMacroRead) > gps->GetUpdatePeriod())
 			{
-				recordWayPoints[recordCounter].lat = gps->GetLat();
-                                recordWayPoints[recordCounter].lng = gps->GetLong();
-                                recordWayPoints[recordCounter].alt = gps->GetAlt();
-				recordWayPoints[recordCounter].heading = gps->GetHeading();
-				recordCounter++;
-				//Here we ensure no buffer overflow
-				//If we fill up the buffer the buffer starts getting overwritten at the beginning
-				//Need work here to inform the user and stop recording.
-				if(recordCounter >= MAXRECORDWAYPOINTS)
-				{	
-					recordCounter %= MAXRECORDWAYPOINTS;
-					cout << "WAYPOINT RECORD LOOOPING" << endl;
+				GPSFix fix = gps->GetFix();
+				if(!gps->IsStale(fix) && !recorder.Full())
+				{
+					recorder.Add(fix);
+					recordCounter = recorder.Count();
+					//A full buffer stops the recording, what is there is saved on the way out
+					if(recorder.Full())
+						Logger("MacroRecordLoop","Waypoint buffer full, recording stopped");
 				}
 				lastMacroRead = GetTimeStamp();
 			}
@@ -957,15 +1168,25 @@ int main(void)
 			GetAutoMode();
 			GetMacroMode();
 			CheckHeartBeat();
+			CheckFence();
+			UpdateEstimator();
 		}
 		if(macroInProgress)
 		{
 			macroInProgress = false;
 			Logger("MacroRecordLoop","Exiting macro record mode");
+			std::ostringstream sL;
+			sL << "Kept " << recorder.Count() << " of " << recorder.offered << " fixes";
+			Logger("MacroRecordLoop",sL.str().c_str());
 			SaveWayPoints(recordWayPoints);	
+			LogMissionStats(recordWayPoints,recordCounter);
 			delete recordWayPoints;
 		}
-	}	
+	}
+	Logger("main","Shutting down");
+	AllStop();
+	//Stop() saves the last fix for the next hot start
+	gps->Stop();
 	return 0;
 }
 
@@ -0,0 +1,79 @@
+/************************************************
+Bench helpers
+
+The clock every benchmark times with, the LCG it
+draws its test data from, the paths and missions
+built from it and a quad flying a tick.  Benches that want the same data every run set
+seed first.
+
+***********************************************/
+#ifndef __Bench_h
+#define __Bench_h
+
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <vector>
+#include "../geo.h"
+#include "../gps.h"
+
+//Seconds on the monotonic clock
+static inline double Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static uint32_t seed = 12345;
+static inline uint32_t Next()
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed;
+}
+
+
+//A recording, a metre between samples on a wandering heading
+static inline std::vector<GeoPoint> Recording(int count)
+{
+	std::vector<GeoPoint> r(count);
+	GeoPoint p = GeoFromDegrees(35.2058,-97.4457);
+	double heading = 0;
+	for(int i=0;i<count;i++)
+	{
+		heading += ((int)(Next() % 21) - 10) * M_PI / 180;
+		p = GeoOffset(p,(int64_t)(1000 * cos(heading)),(int64_t)(1000 * sin(heading)));
+		r[i] = p;
+	}
+	return r;
+}
+
+
+//Waypoints spacing apart on a heading that wanders up to swing degrees a leg, climbing and descending a little
+static inline std::vector<WayPoint> Mission(int count,double spacing,int swing)
+{
+	std::vector<WayPoint> wp(count);
+	GeoPoint p = GeoFromDegrees(35.2058,-97.4457);
+	double heading = 0;
+	for(int i=0;i<count;i++)
+	{
+		heading += ((int)(Next() % (2 * swing + 1)) - swing) * M_PI / 180;
+		p = GeoOffset(p,(int64_t)(spacing * 1000 * cos(heading)),(int64_t)(spacing * 1000 * sin(heading)));
+		wp[i].lat = GeoToDegrees(p.lat);
+		wp[i].lng = GeoToDegrees(p.lng);
+		wp[i].alt = 6 + 3 * sin(i * 0.1);
+		wp[i].heading = 0;
+	}
+	return wp;
+}
+
+
+//Where p is after meters on a heading, degrees true
+static inline GeoPoint Step(const GeoPoint &p,double heading,double meters)
+{
+	double a = heading * M_PI / 180;
+	return GeoOffset(p,(int64_t)(meters * 1000 * cos(a)),(int64_t)(meters * 1000 * sin(a)));
+}
+
+#endif // def(__Bench_h)
@@ -0,0 +1,150 @@
+/************************************************
+Declination grid benchmark
+
+Loads the magnetic model from a WMM.COF, or when
+none is given writes a synthetic one: an Earth
+sized dipole with made up terms to degree 12.
+The synthetic field is only for timing and for
+checking the grid against the model, its
+declinations are not real ones.  An axial dipole
+is checked first, its declination is zero
+everywhere.  Then at a few mission areas: the
+cost of evaluating the model against a grid
+lookup, the time to build a grid and the furthest
+the bilinear blend is from the model inside it.
+
+usage: bench_declination [WMM.COF]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../declination.h"
+#include "bench.h"
+using namespace std;
+
+#define SYNTHETICFILE	"/tmp/bench_declination.cof"
+#define LOOKUPS		1000000
+#define EVALUATIONS	20000
+#define YEAR		2027.0
+
+
+//-1..1
+double Random()
+{
+	return (Next() >> 8) / 16777216.0 * 2 - 1;
+}
+
+
+//Just the axial dipole, or the dipole, a tilt and made up higher terms falling off with degree
+bool WriteModel(const char *path,bool dipoleOnly)
+{
+	FILE *f = fopen(path,"w");
+	if(f == NULL)
+		return false;
+	fprintf(f,"    2025.0            SYNTHETIC       01/01/2025\n");
+	for(int n=1;n<=WMMMAXDEGREE;n++)
+		for(int m=0;m<=n;m++)
+		{
+			double g = 0,h = 0,gDot = 0,hDot = 0;
+			if(n == 1 && m == 0)
+			{
+				g = -29400;
+				gDot = 6;
+			}
+			else if(!dipoleOnly)
+			{
+				double size = 4000 / pow(2.2,n - 1);
+				g = size * Random();
+				h = m ? size * Random() : 0;
+				gDot = size / 200 * Random();
+				hDot = m ? size / 200 * Random() : 0;
+			}
+			fprintf(f,"%3d%3d%11.1f%10.1f%10.1f%10.1f\n",n,m,g,h,gDot,hDot);
+		}
+	fprintf(f,"999999999999999999999999999999999999999999999999\n");
+	fclose(f);
+	return true;
+}
+
+
+int main(int argc,char **argv)
+{
+	MagneticModel model;
+	const char *path = argc > 1 ? argv[1] : SYNTHETICFILE;
+
+	//Axial dipole, no declination anywhere
+	if(!WriteModel(SYNTHETICFILE,true) || !model.Load(SYNTHETICFILE))
+	{
+		cerr << "unable to write " << SYNTHETICFILE << endl;
+		return 1;
+	}
+	double worst = 0;
+	for(double lat=-85;lat<=85;lat+=5)
+		for(double lng=-180;lng<180;lng+=10)
+			worst = max(worst,fabs(model.Evaluate(lat,lng,0,YEAR).declination));
+	MagneticField pole = model.Evaluate(89.999,0,0,YEAR);
+	printf("axial dipole: largest declination %.2g deg, inclination near the north pole %.2f deg\n",worst,pole.inclination);
+
+	if(argc <= 1 && !WriteModel(SYNTHETICFILE,false))
+		return 1;
+	if(!model.Load(path))
+	{
+		cerr << "unable to load " << path << endl;
+		return 1;
+	}
+	printf("%smodel %s epoch %.1f, year %.1f, grid %d x %d at %.3f deg\n",argc > 1 ? "" : "synthetic ",model.name,model.epoch,YEAR,
+		DECLINATIONNODES,DECLINATIONNODES,DECLINATIONSPACING);
+
+	double areas[][2] = { { 35.2058, -97.4457 }, { 51.4779, -0.0015 }, { -33.8568, 151.2153 }, { 64.8378, -147.7164 }, { 78.2232, 15.6267 } };
+	printf("%10s %10s %8s %8s %10s %10s %10s %12s %12s\n","lat","lng","dec","inc","model ns","lookup ns","build ms","dec err deg","inc err deg");
+	for(size_t a=0;a<sizeof(areas)/sizeof(areas[0]);a++)
+	{
+		double lat = areas[a][0],lng = areas[a][1];
+		MagneticField here = model.Evaluate(lat,lng,0.1,YEAR);
+
+		double t = Now();
+		double sink = 0;
+		for(int i=0;i<EVALUATIONS;i++)
+			sink += model.Evaluate(lat + i * 1e-6,lng,0.1,YEAR).declination;
+		double modelNs = (Now() - t) / EVALUATIONS * 1e9;
+
+		DeclinationGrid grid;
+		t = Now();
+		grid.Build(model,lat,lng,0.1,YEAR);
+		double buildMs = (Now() - t) * 1000;
+
+		float dec,inc;
+		t = Now();
+		for(int i=0;i<LOOKUPS;i++)
+		{
+			grid.Lookup(lat + (i % 1000) * 1e-5,lng - (i % 997) * 1e-5,dec,inc);
+			sink += dec;
+		}
+		double lookupNs = (Now() - t) / LOOKUPS * 1e9;
+
+		//Every point of a 100 x 100 mesh across the whole grid
+		double decError = 0,incError = 0;
+		double side = DECLINATIONSPACING * (DECLINATIONNODES - 1);
+		for(int i=0;i<=100;i++)
+			for(int j=0;j<=100;j++)
+			{
+				double pLat = grid.south + side * i / 100,pLng = grid.west + side * j / 100;
+				MagneticField f = model.Evaluate(pLat,pLng,0.1,YEAR);
+				if(!grid.Lookup(pLat,pLng,dec,inc))
+					decError = incError = 999;
+				decError = max(decError,fabs(dec * GEODEGREES - f.declination));
+				incError = max(incError,fabs(inc - f.inclination));
+			}
+		bool outside = grid.Lookup(lat + side,lng,dec,inc);
+
+		printf("%10.4f %10.4f %8.2f %8.2f %10.0f %10.1f %10.3f %12.5f %12.5f%s\n",lat,lng,here.declination,here.inclination,modelNs,lookupNs,buildMs,
+			decError,incError,outside ? " LOOKUP OUTSIDE GRID" : "");
+		if(sink == 12345)
+			printf("\n");
+	}
+	remove(SYNTHETICFILE);
+	return 0;
+}
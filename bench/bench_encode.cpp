@@ -0,0 +1,152 @@
+/************************************************
+NMEA encode benchmark
+
+Times TinyGPSPlus::encode(char) one byte at a time
+against the bulk encode(const char*,size_t) on the
+same generated stream, and checks both leave every
+decoded field and counter identical.
+
+usage: bench_encode [epochs] [passes]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../nmea.h"
+#include "bench.h"
+using namespace std;
+
+
+//A moving fix with the usual satellite chatter, some sentences damaged
+string MakeStream(int epochs)
+{
+	string s;
+	srand(1657);
+	for(int e=0;e<epochs;e++)
+	{
+		NMEAFix fix;
+		fix.lat = 35.1 + e * 0.000013;
+		fix.lng = -97.4 - e * 0.000021;
+		fix.altMeters = 370 + (e % 50) * 0.1;
+		fix.speedKnots = 2.5 + (e % 7) * 0.1;
+		fix.course = (e * 3) % 360;
+		fix.utcSeconds = 40000 + e;
+		fix.satellites = 6 + e % 5;
+
+		string epoch = NMEAMakeGGA(fix);
+		epoch += NMEASentence("GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.8,0.9,1.5");
+		epoch += NMEASentence("GPGSV,3,1,11,04,38,284,42,05,15,039,35,09,29,171,40,12,73,049,44");
+		epoch += NMEASentence("GPGSV,3,2,11,24,25,304,38,25,55,106,45,29,41,238,41,31,09,090,30");
+		epoch += NMEASentence("GPGSV,3,3,11,02,05,312,,14,02,150,,21,01,052,");
+		epoch += NMEAMakeRMC(fix);
+		epoch += NMEAMakeVTG(fix);
+
+		//Roughly one epoch in ten gets a flipped byte, a dropped byte or line noise
+		int r = rand() % 30;
+		if(r == 0)
+			epoch[rand() % epoch.length()] ^= 0x20;
+		else if(r == 1)
+			epoch.erase(rand() % epoch.length(),1);
+		else if(r == 2)
+			epoch.insert(rand() % epoch.length(),"\x7f\x01junk$$,,**");
+		s += epoch;
+	}
+	return s;
+}
+
+
+struct Result
+{
+	double lat,lng,alt,speed,course;
+	uint32_t time,date,sats;
+	int32_t hdop;
+	uint32_t chars,passed,failed,withFix,sentences;
+};
+
+
+Result Snapshot(TinyGPSPlus &g,uint32_t sentences)
+{
+	Result r;
+	r.lat = g.location.lat();
+	r.lng = g.location.lng();
+	r.alt = g.altitude.meters();
+	r.speed = g.speed.knots();
+	r.course = g.course.deg();
+	r.time = g.time.value();
+	r.date = g.date.value();
+	r.sats = g.satellites.value();
+	r.hdop = g.hdop.value();
+	r.chars = g.charsProcessed();
+	r.passed = g.passedChecksum();
+	r.failed = g.failedChecksum();
+	r.withFix = g.sentencesWithFix();
+	r.sentences = sentences;
+	return r;
+}
+
+
+bool Same(const Result &a,const Result &b)
+{
+	return a.lat == b.lat && a.lng == b.lng && a.alt == b.alt && a.speed == b.speed &&
+		a.course == b.course && a.time == b.time && a.date == b.date && a.sats == b.sats &&
+		a.hdop == b.hdop && a.chars == b.chars && a.passed == b.passed && a.failed == b.failed &&
+		a.withFix == b.withFix && a.sentences == b.sentences;
+}
+
+
+int main(int argc,char **argv)
+{
+	int epochs = argc > 1 ? atoi(argv[1]) : 20000;
+	int passes = argc > 2 ? atoi(argv[2]) : 5;
+	string stream = MakeStream(epochs);
+	const char *buf = stream.c_str();
+	size_t len = stream.length();
+
+	//Feed in read()-sized chunks the way GPSMainThread does
+	const size_t chunk = 82;
+
+	Result byteResult,bulkResult;
+	double byteTime = 1e9,bulkTime = 1e9;
+
+	for(int p=0;p<passes;p++)
+	{
+		TinyGPSPlus g;
+		uint32_t sentences = 0;
+		double t = Now();
+		for(size_t i=0;i<len;i++)
+			if(g.encode(buf[i]))
+				sentences++;
+		t = Now() - t;
+		if(t < byteTime)
+			byteTime = t;
+		byteResult = Snapshot(g,sentences);
+	}
+
+	for(int p=0;p<passes;p++)
+	{
+		TinyGPSPlus g;
+		uint32_t sentences = 0;
+		double t = Now();
+		for(size_t i=0;i<len;i+=chunk)
+			sentences += g.encode(buf + i,len - i < chunk ? len - i : chunk);
+		t = Now() - t;
+		if(t < bulkTime)
+			bulkTime = t;
+		bulkResult = Snapshot(g,sentences);
+	}
+
+	printf("%lu bytes, %u sentences passed, %u failed checksum\n",(unsigned long)len,byteResult.passed,byteResult.failed);
+	printf("encode(char)        %8.1f MB/s\n",len / byteTime / 1e6);
+	printf("encode(buf,%3lu)     %8.1f MB/s  (%.2fx)\n",(unsigned long)chunk,len / bulkTime / 1e6,byteTime / bulkTime);
+
+	if(!Same(byteResult,bulkResult))
+	{
+		printf("MISMATCH between byte-wise and bulk decode\n");
+		return 1;
+	}
+	printf("decoded fields identical\n");
+	return 0;
+}
@@ -0,0 +1,157 @@
+/************************************************
+ENU frame benchmark
+
+Flies a vehicle round a mission of random waypoints
+and times the per fix navigation work, distance and
+bearing to the current waypoint plus the reached
+test, done three ways: TinyGPSPlus haversine on
+doubles, geo.cpp on each fix, and the ENU frame.
+The hold loop only needs the reached test, that is
+timed on its own as well.  Reports how far the ENU
+answers are from haversine and how often the frame
+re-based.
+
+usage: bench_enu [fixes] [waypoints]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../geo.h"
+#include "../enu.h"
+#include "bench.h"
+using namespace std;
+
+#define DEADBANDMM	250	//About the 10 inches GPSMMDEADBAND works out to
+
+
+int main(int argc,char **argv)
+{
+	int fixes = argc > 1 ? atoi(argv[1]) : 200000;
+	int count = argc > 2 ? atoi(argv[2]) : 16;
+	double radii[] = { 100, 1000, 5000 };
+	GeoPoint home = GeoFromDegrees(35.2058,-97.4457);
+
+	printf("%d fixes round %d waypoints, ns per fix and worst difference from haversine\n",fixes,count);
+	printf("nav is distance, bearing and reached, hold is reached only\n");
+	printf("%8s %10s %10s %10s %10s %10s %12s %12s %8s %8s\n","radius m","nav hav","nav geo","nav enu","hold hav","hold enu","distance mm","bearing deg","reached","rebases");
+	for(size_t r=0;r<sizeof(radii)/sizeof(radii[0]);r++)
+	{
+		//Waypoints scattered over a square of the radius
+		int64_t range = (int64_t)(radii[r] * 1000);
+		vector<GeoPoint> mission(count);
+		for(int i=0;i<count;i++)
+			mission[i] = GeoOffset(home,(int64_t)(Next() % (2 * range + 1)) - range,(int64_t)(Next() % (2 * range + 1)) - range);
+
+		//The track, flying at each waypoint in turn, 1/200 of the radius a fix
+		int64_t step = range / 200;
+		vector<GeoPoint> track(fixes);
+		vector<int> target(fixes);
+		GeoPoint p = home;
+		int t = 0;
+		for(int i=0;i<fixes;i++)
+		{
+			int64_t n,e;
+			GeoDelta(p,mission[t],n,e);
+			int64_t d = GeoLength(n,e);
+			if(d <= step)
+			{
+				p = mission[t];
+				t = (t + 1) % count;
+			}
+			else
+				p = GeoOffset(p,n * step / d,e * step / d);
+			track[i] = p;
+			target[i] = t;
+		}
+		vector<double> lat(fixes),lng(fixes),wlat(count),wlng(count);
+		for(int i=0;i<fixes;i++)
+		{
+			lat[i] = GeoToDegrees(track[i].lat);
+			lng[i] = GeoToDegrees(track[i].lng);
+		}
+		for(int i=0;i<count;i++)
+		{
+			wlat[i] = GeoToDegrees(mission[i].lat);
+			wlng[i] = GeoToDegrees(mission[i].lng);
+		}
+
+		vector<double> hDist(fixes),hCourse(fixes);
+		vector<int64_t> eDist(fixes),eBearing(fixes);
+		unsigned long hReached = 0,gReached = 0,eReached = 0;
+
+		double start = Now();
+		for(int i=0;i<fixes;i++)
+		{
+			int w = target[i];
+			hDist[i] = TinyGPSPlus::distanceBetween(lat[i],lng[i],wlat[w],wlng[w]);
+			hCourse[i] = TinyGPSPlus::courseTo(lat[i],lng[i],wlat[w],wlng[w]);
+			hReached += hDist[i] * 1000 <= DEADBANDMM;
+		}
+		double tHaversine = Now() - start;
+
+		volatile int64_t sink = 0;
+		start = Now();
+		for(int i=0;i<fixes;i++)
+		{
+			int w = target[i];
+			int64_t d = GeoDistance(track[i],mission[w]);
+			sink += d + GeoBearing(track[i],mission[w]);
+			gReached += d <= DEADBANDMM;
+		}
+		double tGeo = Now() - start;
+
+		ENUFrame frame;
+		for(int i=0;i<count;i++)
+			frame.Add(mission[i],0);
+		start = Now();
+		for(int i=0;i<fixes;i++)
+		{
+			int w = target[i];
+			frame.Update(track[i],0);
+			eDist[i] = frame.DistanceTo(w);
+			eBearing[i] = frame.BearingTo(w);
+			eReached += frame.Reached(w,DEADBANDMM);
+		}
+		double tENU = Now() - start;
+
+		//What HoldWayPoint() does each pass
+		unsigned long hHold = 0,eHold = 0;
+		start = Now();
+		for(int i=0;i<fixes;i++)
+		{
+			int w = target[i];
+			hHold += TinyGPSPlus::distanceBetween(lat[i],lng[i],wlat[w],wlng[w]) * 1000 <= DEADBANDMM;
+		}
+		double tHaversineHold = Now() - start;
+
+		start = Now();
+		for(int i=0;i<fixes;i++)
+		{
+			frame.Update(track[i],0);
+			eHold += frame.Reached(target[i],DEADBANDMM);
+		}
+		double tENUHold = Now() - start;
+
+		double worstDist = 0,worstBearing = 0;
+		for(int i=0;i<fixes;i++)
+		{
+			worstDist = max(worstDist,fabs(eDist[i] / 1000.0 - hDist[i]));
+			//courseTo is the initial great circle bearing, only compare legs the receiver can resolve
+			if(hDist[i] > 1.0)
+			{
+				double b = fabs(eBearing[i] / 1e9 - hCourse[i]);
+				worstBearing = max(worstBearing,min(b,360 - b));
+			}
+		}
+
+		bool same = hReached == eReached && gReached == eReached && hHold == eReached && eHold == eReached;
+		printf("%8.0f %10.1f %10.1f %10.1f %10.1f %10.1f %12.2f %12.6f %8s %8lu\n",radii[r],tHaversine * 1e9 / fixes,tGeo * 1e9 / fixes,
+			tENU * 1e9 / fixes,tHaversineHold * 1e9 / fixes,tENUHold * 1e9 / fixes,worstDist * 1000,worstBearing,same ? "same" : "DIFFER",frame.rebases);
+	}
+	return 0;
+}
@@ -0,0 +1,265 @@
+/************************************************
+State estimator benchmark
+
+Flies a simulated quad for ten minutes on a script
+of control bytes (runs, strafes, turns, climbs and
+hovers), with a control loop at 50 Hz.  The quad
+is not the estimator's model: it flies 10% slower,
+responds faster, turns slower and drifts in a half
+metre per second wind.  GPS at 1 and at 10 Hz with
+1.5 m of noise, the magnetometer at 10 Hz with 3
+degrees of noise and 2 of bias.  Then at 10 Hz
+with every fix LATE seconds old when it arrives,
+fused as if it were new and fused at its age
+against the estimator's history.  Last at 10 Hz
+after BLIND seconds of Predict() with no fix, as
+when warm-up gives up on the GPS, which must come
+out with P positive and nothing gated.
+
+Compares what the loop had before, the last fix
+and the last magnetometer read held until the next,
+with the estimator's output every tick.  Then times
+each step of the estimator.
+
+usage: bench_estimator [minutes]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../gps.h"
+#include "../geo.h"
+#include "../estimator.h"
+#include "../history.h"
+#include "bench.h"
+using namespace std;
+
+#define TICK		0.02	//Seconds, the control loop
+#define MAGPERIOD	0.1
+#define GPSNOISE	1.5	//Meters
+#define ALTNOISE	3.0
+#define VELOCITYNOISE	0.1	//Meters per second
+#define MAGNOISE	3.0	//Degrees
+#define MAGBIAS		2.0
+#define TRUESPEED	1.8	//What the quad really does with the bits
+#define TRUERESPONSE	0.7
+#define TRUEYAWRATE	40.0
+#define WINDEAST	0.4
+#define WINDNORTH	-0.3
+#define STEPS		1000000
+#define LATE		0.3	//Seconds
+#define RADIANS		0.01745329252
+#define BLIND		60	//Seconds flown before the first fix
+
+
+double Gauss()
+{
+	double u = ((Next() >> 8) + 1) / 16777218.0;
+	double v = (Next() >> 8) / 16777216.0;
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+
+//A few seconds of one manoeuvre, forward more often than not
+int NextCommand()
+{
+	int pick = Next() % 10;
+	if(pick < 4)
+		return CONTROLFORWARD | (Next() % 3 == 0 ? (Next() % 2 ? CONTROLROTATERIGHT : CONTROLROTATELEFT) : 0);
+	if(pick == 4)
+		return CONTROLREVERSE;
+	if(pick == 5)
+		return Next() % 2 ? CONTROLLEFT : CONTROLRIGHT;
+	if(pick == 6)
+		return Next() % 2 ? CONTROLROTATERIGHT : CONTROLROTATELEFT;
+	if(pick == 7)
+		return CONTROLFORWARD | (Next() % 2 ? CONTROLCLIMB : CONTROLDIVE);
+	return 0;
+}
+
+
+struct Truth
+{
+	double east,north,up;
+	double vEast,vNorth,vUp;
+	double heading;		//Radians
+};
+
+
+void Fly(Truth &t,int cb,double dt)
+{
+	double forward = ((cb & CONTROLFORWARD) != 0) - ((cb & CONTROLREVERSE) != 0);
+	double right = ((cb & CONTROLRIGHT) != 0) - ((cb & CONTROLLEFT) != 0);
+	double climb = ((cb & CONTROLCLIMB) != 0) - ((cb & CONTROLDIVE) != 0);
+	double rotate = ((cb & CONTROLROTATERIGHT) != 0) - ((cb & CONTROLROTATELEFT) != 0);
+	double s = sin(t.heading),c = cos(t.heading);
+	double a = min(dt / TRUERESPONSE,1.0);
+	t.vEast += a * (TRUESPEED * (forward * s + right * c) + WINDEAST - t.vEast);
+	t.vNorth += a * (TRUESPEED * (forward * c - right * s) + WINDNORTH - t.vNorth);
+	t.vUp += a * (0.9 * climb - t.vUp);
+	t.east += t.vEast * dt;
+	t.north += t.vNorth * dt;
+	t.up = max(t.up + t.vUp * dt,1.0);
+	t.heading = fmod(t.heading + rotate * TRUEYAWRATE * RADIANS * dt + 4 * M_PI,2 * M_PI);
+}
+
+
+double AngleError(double a,double b)
+{
+	double d = fmod(a - b + 540,360) - 180;
+	return fabs(d);
+}
+
+
+void Run(double gpsRate,double minutes,double late,bool compensate,double blind = 0)
+{
+	GeoPoint origin = GeoFromDegrees(35.2058,-97.4457);
+	Truth t = { 0, 0, 10, 0, 0, 0, 0 };
+	StateEstimator estimator;
+	GPSFix fix = GPSFix();
+	int command = 0;
+	double nextCommand = 0,nextFix = blind,nextMag = 0;
+	double heldEast = 0,heldNorth = 0,heldVEast = 0,heldVNorth = 0,heldHeading = 0;
+	double heldSq = 0,heldWorst = 0,ekfSq = 0,ekfWorst = 0;
+	double heldVSq = 0,ekfVSq = 0,heldHSq = 0,ekfHSq = 0;
+	long samples = 0;
+	seed = 777;
+	//Where the quad was, for fixes that arrive late
+	SensorHistory<Truth,256,HoldBlend<Truth> > past;
+
+	for(double now=0;now<minutes * 60;now+=TICK)
+	{
+		if(now >= nextCommand)
+		{
+			command = NextCommand();
+			nextCommand = now + 2 + Next() % 7;
+		}
+		Fly(t,command,TICK);
+		estimator.Predict(TICK,command);
+		past.Add(now,t);
+
+		if(now >= nextMag)
+		{
+			double m = t.heading / RADIANS + MAGBIAS + MAGNOISE * Gauss();
+			heldHeading = fmod(m + 360,360);
+			estimator.UpdateHeading(heldHeading);
+			nextMag += MAGPERIOD;
+		}
+		if(now >= nextFix + late)
+		{
+			Truth m = t;
+			past.At(now - late + TICK / 2,m);
+			double e = m.east + GPSNOISE * Gauss(),n = m.north + GPSNOISE * Gauss();
+			fix.position = GeoOffset(origin,(int64_t)(n * 1000),(int64_t)(e * 1000));
+			fix.lat = GeoToDegrees(fix.position.lat);
+			fix.lng = GeoToDegrees(fix.position.lng);
+			fix.alt = (m.up + ALTNOISE * Gauss()) * 1000 / FEETTOMM;
+			double ve = m.vEast + VELOCITYNOISE * Gauss(),vn = m.vNorth + VELOCITYNOISE * Gauss();
+			fix.speed = sqrt(ve * ve + vn * vn);
+			fix.course = fmod(atan2(ve,vn) / RADIANS + 360,360);
+			fix.fields = GPSFIX_EPOCHFIELDS;
+			fix.sequence++;
+			estimator.UpdateGPS(fix,compensate ? late : 0);
+			heldEast = e;
+			heldNorth = n;
+			heldVEast = ve;
+			heldVNorth = vn;
+			nextFix += 1 / gpsRate;
+		}
+		estimator.Publish(now);
+
+		//Scored once the estimator has had ten seconds to settle
+		if(now < blind + 10)
+			continue;
+		EstimatorState s = estimator.Get();
+		GeoPoint p = GeoFromDegrees(s.lat,s.lng);
+		int64_t northMM,eastMM;
+		GeoDelta(origin,p,northMM,eastMM);
+		double ekf = hypot(eastMM / 1000.0 - t.east,northMM / 1000.0 - t.north);
+		double held = hypot(heldEast - t.east,heldNorth - t.north);
+		heldSq += held * held;
+		ekfSq += ekf * ekf;
+		heldWorst = max(heldWorst,held);
+		ekfWorst = max(ekfWorst,ekf);
+		heldVSq += pow(heldVEast - t.vEast,2) + pow(heldVNorth - t.vNorth,2);
+		ekfVSq += pow(s.velocityEast - t.vEast,2) + pow(s.velocityNorth - t.vNorth,2);
+		heldHSq += pow(AngleError(heldHeading,t.heading / RADIANS),2);
+		ekfHSq += pow(AngleError(s.heading,t.heading / RADIANS),2);
+		samples++;
+	}
+	char source[32];
+	snprintf(source,sizeof(source),"%.0f s blind",blind);
+	if(!blind && (!late || !compensate))
+		printf("%6.0f Hz %6.1f %12s %10.2f %10.2f %10.2f %10.2f\n",gpsRate,late,"held",sqrt(heldSq / samples),heldWorst,sqrt(heldVSq / samples),
+			sqrt(heldHSq / samples));
+	printf("%9s %6s %12s %10.2f %10.2f %10.2f %10.2f   %u gated\n","","",blind ? source : !late ? "estimator" : compensate ? "at its age" : "as new",sqrt(ekfSq / samples),ekfWorst,
+		sqrt(ekfVSq / samples),sqrt(ekfHSq / samples),estimator.rejected);
+	for(int i=0;i<EKFSTATES;i++)
+		if(!(estimator.P[i][i] > 0))
+			printf("%9s P[%d][%d] %g, not positive\n","",i,i,estimator.P[i][i]);
+}
+
+
+int main(int argc,char **argv)
+{
+	double minutes = argc > 1 ? atof(argv[1]) : 10;
+
+	printf("%.0f minutes, control loop at %.0f Hz, errors every tick\n",minutes,1 / TICK);
+	printf("%9s %6s %12s %10s %10s %10s %10s\n","gps","late s","source","rms m","worst m","vel m/s","heading");
+	Run(1,minutes,0,false);
+	Run(10,minutes,0,false);
+	Run(10,minutes,LATE,false);
+	Run(10,minutes,LATE,true);
+	Run(10,minutes,0,false,BLIND);
+
+	//Cost of each step on its own
+	StateEstimator estimator;
+	GPSFix fix = GPSFix();
+	fix.position = GeoFromDegrees(35.2058,-97.4457);
+	fix.lat = 35.2058;
+	fix.lng = -97.4457;
+	fix.alt = 30;
+	fix.speed = 1;
+	fix.course = 45;
+	fix.fields = GPSFIX_EPOCHFIELDS;
+	estimator.UpdateGPS(fix);
+	int commands[] = { 0, CONTROLFORWARD, CONTROLFORWARD | CONTROLROTATERIGHT, CONTROLLEFT | CONTROLCLIMB };
+
+	double t = Now();
+	for(int i=0;i<STEPS;i++)
+		estimator.Predict(0.02f,commands[i & 3]);
+	double predictNs = (Now() - t) / STEPS * 1e9;
+
+	t = Now();
+	for(int i=0;i<STEPS;i++)
+	{
+		fix.course = i % 360;
+		estimator.UpdateGPS(fix);
+		estimator.Predict(0.1f,0);
+	}
+	double gpsNs = (Now() - t) / STEPS * 1e9 - predictNs;
+
+	t = Now();
+	for(int i=0;i<STEPS;i++)
+		estimator.UpdateHeading(i % 360);
+	double headingNs = (Now() - t) / STEPS * 1e9;
+
+	t = Now();
+	for(int i=0;i<STEPS;i++)
+		estimator.Publish(i);
+	double publishNs = (Now() - t) / STEPS * 1e9;
+
+	t = Now();
+	double sink = 0;
+	for(int i=0;i<STEPS;i++)
+		sink += estimator.Get().heading;
+	double getNs = (Now() - t) / STEPS * 1e9;
+
+	printf("ns a step: predict %.0f, GPS update %.0f, heading update %.0f, publish %.0f, get %.0f\n",predictNs,gpsNs,headingNs,publishNs,getNs);
+	printf("a 50 Hz tick with a 10 Hz magnetometer and GPS: %.2f us\n",(predictNs + publishNs + (gpsNs + headingNs) / 5) / 1000);
+	if(sink == 12345)
+		printf("\n");
+	return 0;
+}
@@ -0,0 +1,173 @@
+/************************************************
+Geofence benchmark
+
+A wobbly 400 m include polygon with three small
+exclusions inside it, at several vertex counts.
+Times Geofence::Check() against testing every edge
+of every polygon on each fix, the only way to get
+the same answer without the grid.  Half the fixes
+are near the boundary, where the exact margin is
+needed.  Checks inside/outside and the margin
+against the brute force answer.
+
+usage: bench_fence [fixes]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include "../geo.h"
+#include "../fence.h"
+#include "bench.h"
+using namespace std;
+
+
+//Radius wobbles with angle and a little noise, count vertices
+vector<GeoPoint> Wobbly(const GeoPoint &center,double radius,int count)
+{
+	vector<GeoPoint> v(count);
+	for(int i=0;i<count;i++)
+	{
+		double a = 2 * M_PI * i / count;
+		double r = radius * (1 + 0.1 * sin(7 * a)) + radius * 0.01 * ((int)(Next() % 201) - 100) / 100;
+		v[i] = GeoOffset(center,(int64_t)(r * 1000 * cos(a)),(int64_t)(r * 1000 * sin(a)));
+	}
+	return v;
+}
+
+
+struct Polygon
+{
+	vector<float> e,n;
+	bool exclude;
+};
+
+
+//Crossing number and nearest edge over every polygon, what a fence check costs without the grid
+bool BruteForce(const vector<Polygon> &polygons,float pe,float pn,float &distance)
+{
+	bool included = false,excluded = false;
+	float best2 = FLT_MAX;
+	for(size_t k=0;k<polygons.size();k++)
+	{
+		const Polygon &p = polygons[k];
+		int count = (int)p.e.size();
+		bool inside = false;
+		for(int i=0,j=count - 1;i<count;j=i++)
+		{
+			if((p.n[i] > pn) != (p.n[j] > pn) && pe < p.e[i] + (pn - p.n[i]) * (p.e[j] - p.e[i]) / (p.n[j] - p.n[i]))
+				inside = !inside;
+			float de = p.e[i] - p.e[j],dn = p.n[i] - p.n[j];
+			float we = pe - p.e[j],wn = pn - p.n[j];
+			float dd = de * de + dn * dn;
+			float t = dd > 0 ? (we * de + wn * dn) / dd : 0;
+			t = t < 0 ? 0 : (t > 1 ? 1 : t);
+			float qe = we - t * de,qn = wn - t * dn;
+			best2 = min(best2,qe * qe + qn * qn);
+		}
+		if(inside && p.exclude)
+			excluded = true;
+		if(inside && !p.exclude)
+			included = true;
+	}
+	distance = sqrtf(best2);
+	return included && !excluded;
+}
+
+
+int main(int argc,char **argv)
+{
+	int fixes = argc > 1 ? atoi(argv[1]) : 100000;
+	int sizes[] = { 16, 256, 4096, 16384 };
+	GeoPoint home = GeoFromDegrees(35.2058,-97.4457);
+
+	printf("%d fixes, half within 10 m of the include boundary, ns per check\n",fixes);
+	printf("%8s %8s %9s %7s %6s %10s %10s %8s %9s %8s\n","vertices","build ms","cells","cell m","near","brute","grid","speedup","bound gap","answers");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		int count = sizes[s];
+		Geofence fence;
+		vector< vector<GeoPoint> > geo;
+		geo.push_back(Wobbly(home,400,count));
+		geo.push_back(Wobbly(GeoOffset(home,150000,0),30,max(count / 8,8)));
+		geo.push_back(Wobbly(GeoOffset(home,-100000,120000),30,max(count / 8,8)));
+		geo.push_back(Wobbly(GeoOffset(home,0,-200000),30,max(count / 8,8)));
+
+		double t = Now();
+		for(size_t k=0;k<geo.size();k++)
+			fence.AddPolygon(geo[k],k == 0 ? FENCE_INCLUDE : FENCE_EXCLUDE);
+		fence.Build();
+		double tBuild = Now() - t;
+
+		vector<Polygon> polygons(geo.size());
+		for(size_t k=0;k<geo.size();k++)
+		{
+			polygons[k].exclude = k != 0;
+			for(size_t i=0;i<geo[k].size();i++)
+			{
+				float e,n;
+				fence.Project(geo[k][i],e,n);
+				polygons[k].e.push_back(e);
+				polygons[k].n.push_back(n);
+			}
+		}
+
+		vector<GeoPoint> q(fixes);
+		for(int i=0;i<fixes;i++)
+		{
+			if(i & 1)
+				q[i] = GeoOffset(geo[0][Next() % count],(int64_t)(Next() % 20001) - 10000,(int64_t)(Next() % 20001) - 10000);
+			else
+				q[i] = GeoOffset(home,(int64_t)(Next() % 1000001) - 500000,(int64_t)(Next() % 1000001) - 500000);
+		}
+
+		vector<char> bAllowed(fixes);
+		vector<float> bDistance(fixes);
+		t = Now();
+		for(int i=0;i<fixes;i++)
+		{
+			float e,n;
+			fence.Project(q[i],e,n);
+			bAllowed[i] = BruteForce(polygons,e,n,bDistance[i]);
+		}
+		double tBrute = Now() - t;
+
+		vector<FenceStatus> status(fixes);
+		t = Now();
+		for(int i=0;i<fixes;i++)
+			status[i] = fence.Check(q[i],0);
+		double tGrid = Now() - t;
+
+		//Inside/outside may only differ right on an edge, exact margins must match,
+		//the far ones must never be more than the real distance
+		int wrong = 0,near = 0;
+		double gap = 0;
+		for(int i=0;i<fixes;i++)
+		{
+			bool allowed = !(status[i].flags & FENCEBREACH);
+			float margin = fabsf(status[i].margin);
+			if(allowed != (bool)bAllowed[i] && bDistance[i] > 0.001f)
+				wrong++;
+			if(status[i].exact)
+			{
+				near++;
+				if(fabsf(margin - bDistance[i]) > 0.001f)
+					wrong++;
+			}
+			else
+			{
+				if(margin > bDistance[i] + 0.001f)
+					wrong++;
+				gap += bDistance[i] - margin;
+			}
+		}
+
+		printf("%8d %8.2f %9d %7.2f %5.0f%% %10.1f %10.1f %7.0fx %8.1fm %8s\n",count,tBuild * 1000,fence.columns * fence.rows,fence.cell,
+			100.0 * near / fixes,tBrute * 1e9 / fixes,tGrid * 1e9 / fixes,tBrute / tGrid,fixes > near ? gap / (fixes - near) : 0.0,wrong ? "DIFFER" : "same");
+	}
+	return 0;
+}
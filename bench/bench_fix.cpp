@@ -0,0 +1,133 @@
+/************************************************
+GPS fix snapshot benchmark
+
+One thread publishes fixes as fast as it can while
+reader threads hammer GetFix().  Every field of a
+published fix is derived from the same counter so a
+torn read shows up as fields that disagree.  Also
+counts how often the old GetLat()/GetLong() pair
+mixes two different fixes.
+
+usage: bench_fix [seconds] [readers]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../gps.h"
+using namespace std;
+
+
+GPS gps;
+volatile bool done = false;
+unsigned long published = 0;
+
+struct ReaderStats
+{
+	pthread_t thread;
+	unsigned long reads;
+	unsigned long torn;
+	unsigned long backwards;
+	unsigned long pairs;
+	unsigned long mixedPairs;
+};
+
+
+void *Publisher(void *)
+{
+	double i = 0;
+	while(!done)
+	{
+		i++;
+		GPSFix fix;
+		fix.lat = i;
+		fix.lng = -i;
+		fix.alt = 2 * i;
+		fix.course = i + 0.5;
+		fix.speed = i * 0.25;
+		fix.timeStamp = i * 3;
+		gps.PublishFix(fix);
+	}
+	published = (unsigned long)i;
+	return NULL;
+}
+
+
+bool Coherent(const GPSFix &f)
+{
+	if(f.sequence == 0)
+		return true;
+	double i = f.lat;
+	return f.lng == -i && f.alt == 2 * i && f.course == i + 0.5 &&
+		f.speed == i * 0.25 && f.timeStamp == i * 3 && (double)f.sequence == i;
+}
+
+
+void *Reader(void *arg)
+{
+	ReaderStats *st = (ReaderStats *)arg;
+	uint32_t last = 0;
+	while(!done)
+	{
+		GPSFix f = gps.GetFix();
+		st->reads++;
+		if(!Coherent(f))
+			st->torn++;
+		if(f.sequence < last)
+			st->backwards++;
+		last = f.sequence;
+
+		//The old way, two getters that can straddle a publish
+		if((st->reads & 15) == 0)
+		{
+			double lat = gps.GetLat();
+			double lng = gps.GetLong();
+			st->pairs++;
+			if(lng != -lat)
+				st->mixedPairs++;
+		}
+	}
+	return NULL;
+}
+
+
+int main(int argc,char **argv)
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 3;
+	int readers = argc > 2 ? atoi(argv[2]) : 3;
+
+	ReaderStats *stats = new ReaderStats[readers];
+	pthread_t publisher;
+	pthread_create(&publisher,NULL,Publisher,NULL);
+	for(int i=0;i<readers;i++)
+	{
+		stats[i] = ReaderStats();
+		pthread_create(&stats[i].thread,NULL,Reader,&stats[i]);
+	}
+
+	sleep(seconds);
+	done = true;
+	pthread_join(publisher,NULL);
+
+	unsigned long reads = 0,torn = 0,backwards = 0,pairs = 0,mixed = 0;
+	for(int i=0;i<readers;i++)
+	{
+		pthread_join(stats[i].thread,NULL);
+		reads += stats[i].reads;
+		torn += stats[i].torn;
+		backwards += stats[i].backwards;
+		pairs += stats[i].pairs;
+		mixed += stats[i].mixedPairs;
+	}
+
+	printf("%d readers, %d s\n",readers,seconds);
+	printf("publishes/s   %12.0f\n",(double)published / seconds);
+	printf("GetFix/s      %12.0f\n",(double)reads / seconds);
+	printf("torn fixes    %12lu\n",torn);
+	printf("out of order  %12lu\n",backwards);
+	printf("GetLat+GetLong pairs from different fixes  %lu of %lu\n",mixed,pairs);
+
+	delete[] stats;
+	return torn == 0 && backwards == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/************************************************
+Fixed point geodesy benchmark
+
+Cost per distance and bearing query of geo.cpp
+against TinyGPSPlus::distanceBetween/courseTo on
+the same random legs, how far apart the answers
+are, and a hash of every fixed point result so two
+hosts can be compared bit for bit.
+
+usage: bench_geo [queries] [passes]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../geo.h"
+#include "bench.h"
+using namespace std;
+
+
+//Small deterministic generator, rand() differs between C libraries
+//Random point within range nanodegrees of the field the quad flies over
+RawDegrees RandomRaw(int64_t centre,int64_t range)
+{
+	int64_t n = centre + (int64_t)(Next() % (2 * range + 1)) - range;
+	RawDegrees r;
+	r.negative = n < 0;
+	if(n < 0)
+		n = -n;
+	r.deg = n / GEONANO;
+	r.billionths = n % GEONANO;
+	return r;
+}
+
+
+double RawToDouble(const RawDegrees &r)
+{
+	double d = r.deg + r.billionths / 1000000000.0;
+	return r.negative ? -d : d;
+}
+
+
+int main(int argc,char **argv)
+{
+	int queries = argc > 1 ? atoi(argv[1]) : 200000;
+	int passes = argc > 2 ? atoi(argv[2]) : 5;
+
+	//Legs up to about 2 km around Norman, OK
+	vector<GeoPoint> ga(queries),gb(queries);
+	vector<double> la(queries),lna(queries),lb(queries),lnb(queries);
+	for(int i=0;i<queries;i++)
+	{
+		RawDegrees alat = RandomRaw(35205800000LL,10000000LL);
+		RawDegrees alng = RandomRaw(-97445700000LL,10000000LL);
+		RawDegrees blat = RandomRaw(35205800000LL,10000000LL);
+		RawDegrees blng = RandomRaw(-97445700000LL,10000000LL);
+		ga[i] = GeoFromRaw(alat,alng);
+		gb[i] = GeoFromRaw(blat,blng);
+		la[i] = RawToDouble(alat);
+		lna[i] = RawToDouble(alng);
+		lb[i] = RawToDouble(blat);
+		lnb[i] = RawToDouble(blng);
+	}
+
+	vector<double> dDouble(queries),cDouble(queries);
+	vector<int64_t> dFixed(queries),cFixed(queries);
+	double tDist = 1e9,tGeoDist = 1e9,tCourse = 1e9,tGeoBearing = 1e9;
+	for(int p=0;p<passes;p++)
+	{
+		double t = Now();
+		for(int i=0;i<queries;i++)
+			dDouble[i] = TinyGPSPlus::distanceBetween(la[i],lna[i],lb[i],lnb[i]);
+		tDist = min(tDist,Now() - t);
+
+		t = Now();
+		for(int i=0;i<queries;i++)
+			dFixed[i] = GeoDistance(ga[i],gb[i]);
+		tGeoDist = min(tGeoDist,Now() - t);
+
+		t = Now();
+		for(int i=0;i<queries;i++)
+			cDouble[i] = TinyGPSPlus::courseTo(la[i],lna[i],lb[i],lnb[i]);
+		tCourse = min(tCourse,Now() - t);
+
+		t = Now();
+		for(int i=0;i<queries;i++)
+			cFixed[i] = GeoBearing(ga[i],gb[i]);
+		tGeoBearing = min(tGeoBearing,Now() - t);
+	}
+
+	double worstDist = 0,worstBearing = 0,worstOffset = 0;
+	uint64_t hash = 1469598103934665603ULL;
+	for(int i=0;i<queries;i++)
+	{
+		worstDist = max(worstDist,fabs(dFixed[i] / 1000.0 - dDouble[i]));
+		//Bearing is meaningless on legs shorter than the receiver can resolve
+		if(dDouble[i] > 1.0)
+		{
+			double b = fabs(cFixed[i] / 1e9 - cDouble[i]);
+			worstBearing = max(worstBearing,min(b,360 - b));
+		}
+
+		//Going back along the delta must land where we started
+		int64_t n,e;
+		GeoDelta(ga[i],gb[i],n,e);
+		GeoPoint o = GeoOffset(ga[i],n,e);
+		int64_t miss = GeoDistance(o,gb[i]);
+		worstOffset = max(worstOffset,(double)miss);
+
+		uint64_t v[3] = { (uint64_t)dFixed[i],(uint64_t)cFixed[i],(uint64_t)(o.lat ^ o.lng) };
+		for(int k=0;k<3;k++)
+		{
+			hash ^= v[k];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	printf("%d queries, best of %d\n",queries,passes);
+	printf("distanceBetween   %7.1f ns\n",tDist * 1e9 / queries);
+	printf("GeoDistance       %7.1f ns  (%.2fx)  worst difference %.2f mm\n",tGeoDist * 1e9 / queries,tDist / tGeoDist,worstDist * 1000);
+	printf("courseTo          %7.1f ns\n",tCourse * 1e9 / queries);
+	printf("GeoBearing        %7.1f ns  (%.2fx)  worst difference %.6f deg\n",tGeoBearing * 1e9 / queries,tCourse / tGeoBearing,worstBearing);
+	printf("GeoOffset round trip worst miss %.0f mm\n",worstOffset);
+	printf("result hash %016llx\n",(unsigned long long)hash);
+	return 0;
+}
@@ -0,0 +1,149 @@
+/************************************************
+Track grid benchmark
+
+Rejoin queries against a recording, a point up to
+30 m off a random spot on the track, answered by
+the TrackGrid and by the linear scans it replaces:
+haversine over every waypoint, the Track batch
+kernels, and a plain float scan for the radius
+search.  Checks every answer matches the scan.
+
+usage: bench_grid [queries]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../geo.h"
+#include "../track.h"
+#include "../grid.h"
+#include "bench.h"
+using namespace std;
+
+#define WITHINRADIUS	10.0f	//Meters
+
+
+int main(int argc,char **argv)
+{
+	int queries = argc > 1 ? atoi(argv[1]) : 1000;
+	int sizes[] = { 1000, 7000, 100000 };
+
+	printf("%d rejoin queries, us per query\n",queries);
+	printf("%7s %8s %6s %10s %10s %10s %10s %10s %10s %10s %8s\n","points","build ms","cell m","haversine","scan pt","grid pt","scan leg","grid leg","scan R","grid R","answers");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		int count = sizes[s];
+		vector<GeoPoint> rec = Recording(count);
+		Track track;
+		for(int i=0;i<count;i++)
+			track.Add(rec[i],0);
+		double t = Now();
+		TrackGrid grid;
+		grid.Build(track);
+		double tBuild = Now() - t;
+
+		vector<GeoPoint> q(queries);
+		vector<float> qe(queries),qn(queries);
+		for(int i=0;i<queries;i++)
+		{
+			q[i] = GeoOffset(rec[Next() % count],(int64_t)(Next() % 60001) - 30000,(int64_t)(Next() % 60001) - 30000);
+			track.Project(q[i],qe[i],qn[i]);
+		}
+		vector<double> lat(count),lng(count);
+		for(int i=0;i<count;i++)
+		{
+			lat[i] = GeoToDegrees(rec[i].lat);
+			lng[i] = GeoToDegrees(rec[i].lng);
+		}
+
+		//The scan rejoin would do today, haversine to every waypoint
+		vector<int> hPoint(queries);
+		t = Now();
+		for(int k=0;k<queries;k++)
+		{
+			double qLat = GeoToDegrees(q[k].lat),qLng = GeoToDegrees(q[k].lng);
+			double best = 1e30;
+			for(int i=0;i<count;i++)
+			{
+				double d = TinyGPSPlus::distanceBetween(qLat,qLng,lat[i],lng[i]);
+				if(d < best)
+				{
+					best = d;
+					hPoint[k] = i;
+				}
+			}
+		}
+		double tHaversine = Now() - t;
+
+		vector<int> sPoint(queries),gPoint(queries),sLeg(queries),gLeg(queries);
+		vector<float> sPointD(queries),gPointD(queries),sLegD(queries),gLegD(queries);
+		vector<float> dist(count);
+		t = Now();
+		for(int k=0;k<queries;k++)
+		{
+			track.Distances(q[k],dist.data());
+			sPoint[k] = (int)(min_element(dist.begin(),dist.end()) - dist.begin());
+			sPointD[k] = dist[sPoint[k]];
+		}
+		double tScanPoint = Now() - t;
+
+		t = Now();
+		for(int k=0;k<queries;k++)
+			gPoint[k] = grid.Nearest(qe[k],qn[k],gPointD[k]);
+		double tGridPoint = Now() - t;
+
+		t = Now();
+		for(int k=0;k<queries;k++)
+			sLeg[k] = track.NearestLeg(q[k],sLegD[k]);
+		double tScanLeg = Now() - t;
+
+		t = Now();
+		for(int k=0;k<queries;k++)
+			gLeg[k] = grid.NearestLeg(qe[k],qn[k],gLegD[k]);
+		double tGridLeg = Now() - t;
+
+		vector< vector<int> > sWithin(queries),gWithin(queries);
+		const float *e = track.east.data();
+		const float *n = track.north.data();
+		t = Now();
+		for(int k=0;k<queries;k++)
+			for(int i=0;i<count;i++)
+			{
+				float de = e[i] - qe[k],dn = n[i] - qn[k];
+				if(de * de + dn * dn <= WITHINRADIUS * WITHINRADIUS)
+					sWithin[k].push_back(i);
+			}
+		double tScanWithin = Now() - t;
+
+		t = Now();
+		for(int k=0;k<queries;k++)
+			grid.Within(qe[k],qn[k],WITHINRADIUS,gWithin[k]);
+		double tGridWithin = Now() - t;
+
+		//Ties and float rounding may pick a different index at the same distance
+		int wrong = 0;
+		for(int k=0;k<queries;k++)
+		{
+			if(gPoint[k] != sPoint[k] && fabsf(gPointD[k] - sPointD[k]) > 1e-4f)
+				wrong++;
+			if(gLeg[k] != sLeg[k] && fabsf(gLegD[k] - sLegD[k]) > 1e-4f)
+				wrong++;
+			if(gWithin[k] != sWithin[k])
+				wrong++;
+			//Haversine and the flat frame may only disagree between points a few mm apart in range
+			if(hPoint[k] != gPoint[k] && llabs(GeoDistance(q[k],rec[hPoint[k]]) - GeoDistance(q[k],rec[gPoint[k]])) > 10)
+				wrong++;
+		}
+
+		double us = 1e6 / queries;
+		printf("%7d %8.2f %6.2f %10.2f %10.2f %10.3f %10.2f %10.3f %10.2f %10.3f %8s\n",count,tBuild * 1000,grid.cell,tHaversine * us,
+			tScanPoint * us,tGridPoint * us,tScanLeg * us,tGridLeg * us,tScanWithin * us,tGridWithin * us,wrong ? "DIFFER" : "same");
+	}
+	return 0;
+}
@@ -0,0 +1,262 @@
+/************************************************
+Heading controller benchmark
+
+A 180 degree turn on a simulated clock, the old
+SetHeading() loop against HeadingController.  The
+quad yaws at 40 degrees a second, reached and lost
+over 0.15 s.  The magnetometer measures at 15 Hz
+with a degree of noise, a read is six register
+reads.  A control byte is five byte writes to the
+control switch.  At 100 kHz a register read takes
+0.4 ms and a byte write 0.2 ms.  The rest of a pass
+of the control loop (GPS, display, mode pins,
+heartbeat) is LOOPWORK.
+
+The old loop spins on HeadingReached() and
+SendControlByte() for up to 3 s at a time, the loop
+calls it again until the heading is reached and
+stops the rotation when it returns.  The controller
+steps once a pass and the mission retargets it every
+0.1 s, as the auto loop does on fixes and estimates.
+"every pass" sends the control byte each mission
+update, "controller" only when it changes.  Reports the pass period (mean,
+jitter, worst), I2C transactions a second, when the
+quad got within 2 degrees to stay and the most it
+was off after first getting there.  Then the CPU
+a Step() costs.
+
+usage: bench_heading [degrees]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include "../controlbyte.h"
+#include "../headingcontrol.h"
+#include "bench.h"
+using namespace std;
+
+#define LOOPWORK	0.004	//Seconds
+#define I2CREAD		0.0004
+#define I2CWRITE	0.0002
+#define MAGREADS	6	//Register reads a heading
+#define BYTEWRITES	5	//Writes a control byte
+#define MAGPERIOD	(1 / 15.0)
+#define MAGNOISE	1.0	//Degrees
+#define TRUEYAWRATE	40.0	//Degrees per second
+#define YAWRESPONSE	0.15	//Seconds
+#define OLDTIMEOUT	3	//Seconds, SetHeading()
+#define OLDDEADBAND	2	//Degrees, HEADINGDEADBAND
+#define UPDATEPERIOD	0.1	//Seconds between mission updates, a fix or ESTIMATORSTEERPERIOD
+#define START		10.0
+#define SECONDS		12
+#define STEPS		10000000
+
+
+double Gauss()
+{
+	double u = ((Next() >> 8) + 1) / 16777218.0;
+	double v = (Next() >> 8) / 16777216.0;
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+
+double Wrap(double d)
+{
+	d = fmod(d,360);
+	return d < 0 ? d + 360 : d;
+}
+
+
+double Off(double a,double b)
+{
+	return fabs(fmod(a - b + 540,360) - 180);
+}
+
+
+//The quad, the magnetometer and the bus on one clock
+struct Sim
+{
+	double clock;
+	double heading,yawRate;
+	int rotate;
+	double measured,nextMeasure;
+	long transactions;
+
+	Sim() : clock(0), heading(START), yawRate(0), rotate(0), measured(START), nextMeasure(0), transactions(0) {}
+
+	void Advance(double seconds)
+	{
+		double end = clock + seconds;
+		while(clock < end)
+		{
+			double dt = min(0.0005,end - clock);
+			double want = rotate == CONTROLROTATERIGHT ? TRUEYAWRATE : rotate == CONTROLROTATELEFT ? -TRUEYAWRATE : 0;
+			yawRate += (want - yawRate) * min(dt / YAWRESPONSE,1.0);
+			heading = Wrap(heading + yawRate * dt);
+			clock += dt;
+			if(clock >= nextMeasure)
+			{
+				measured = Wrap(heading + MAGNOISE * Gauss());
+				nextMeasure += MAGPERIOD;
+			}
+		}
+	}
+
+	double ReadHeading()
+	{
+		Advance(MAGREADS * I2CREAD);
+		transactions += MAGREADS;
+		return measured;
+	}
+
+	void Send(int bits)
+	{
+		Advance(BYTEWRITES * I2CWRITE);
+		transactions += BYTEWRITES;
+		rotate = bits & (CONTROLROTATERIGHT | CONTROLROTATELEFT);
+	}
+};
+
+
+struct Result
+{
+	vector<double> periods;
+	double settled;		//Seconds, within 2 degrees from then on
+	double worstOff;	//After first reaching it
+	long transactions;
+	double turnSeconds;	//Of I2C traffic counted over
+};
+
+
+//Periods of the loop and when the quad settled, over SECONDS
+void Score(Sim &sim,double target,double &lastPass,double &settledAt,bool &reached,double &worstOff,Result &r)
+{
+	r.periods.push_back(sim.clock - lastPass);
+	lastPass = sim.clock;
+	double off = Off(sim.heading,target);
+	if(off > OLDDEADBAND)
+		settledAt = -1;
+	else if(settledAt < 0)
+		settledAt = sim.clock;
+	if(reached)
+		worstOff = max(worstOff,off);
+	else if(off <= OLDDEADBAND)
+		reached = true;
+}
+
+
+//SetHeading() as it was: the direction worked out once from the heading it started with
+Result Old(double target)
+{
+	Sim sim;
+	Result r;
+	double lastPass = 0,settledAt = -1,worstOff = 0;
+	bool reached = false;
+	seed = 99;
+	while(sim.clock < SECONDS)
+	{
+		sim.Advance(LOOPWORK);
+		double heading = sim.ReadHeading();
+		if(Off(heading,target) > OLDDEADBAND)
+		{
+			double start = sim.clock;
+			bool rotateRight = target > heading ? target - heading <= 180 : heading - target > 180;
+			while(Off(sim.ReadHeading(),target) > OLDDEADBAND && sim.clock - start < OLDTIMEOUT)
+				sim.Send(rotateRight ? CONTROLROTATERIGHT : CONTROLROTATELEFT);
+			sim.Send(0);
+		}
+		Score(sim,target,lastPass,settledAt,reached,worstOff,r);
+	}
+	r.settled = settledAt;
+	r.worstOff = worstOff;
+	r.transactions = sim.transactions;
+	r.turnSeconds = sim.clock;
+	return r;
+}
+
+
+//The auto loop: every UPDATEPERIOD the mission retargets and a full byte is made, moving forward with the
+//rotation.  Every other pass only the rotation is stepped.  everyPass sends the byte each mission update
+//as first shipped, otherwise only when it changes.
+Result New(double target,bool everyPass)
+{
+	Sim sim;
+	Result r;
+	HeadingController control;
+	double lastPass = 0,settledAt = -1,worstOff = 0,lastUpdate = -1e9;
+	bool reached = false;
+	int current = MakeControlByte(0,0,0,0,0,0,0,0);
+	seed = 99;
+	while(sim.clock < SECONDS)
+	{
+		sim.Advance(LOOPWORK);
+		bool update = sim.clock - lastUpdate >= UPDATEPERIOD;
+		if(update)
+		{
+			control.Target(target,sim.clock);
+			lastUpdate = sim.clock;
+		}
+		if(control.ReadDue(sim.clock))
+			sim.ReadHeading();
+		int rotate = control.Step(sim.clock,sim.measured);
+		int cb = update ? MakeControlByte(1,0,0,0,0,0,rotate == CONTROLROTATERIGHT,rotate == CONTROLROTATELEFT) : RotateControlByte(current,rotate);
+		if(cb != current || (update && everyPass))
+		{
+			sim.Send(cb);
+			current = cb;
+		}
+		Score(sim,target,lastPass,settledAt,reached,worstOff,r);
+	}
+	r.settled = settledAt;
+	r.worstOff = worstOff;
+	r.transactions = sim.transactions;
+	r.turnSeconds = sim.clock;
+	return r;
+}
+
+
+void Print(const char *name,Result r)
+{
+	double sum = 0,sq = 0;
+	for(size_t i=0;i<r.periods.size();i++)
+		sum += r.periods[i];
+	double mean = sum / r.periods.size();
+	for(size_t i=0;i<r.periods.size();i++)
+		sq += pow(r.periods[i] - mean,2);
+	sort(r.periods.begin(),r.periods.end());
+	printf("%12s %8lu %9.2f %9.2f %9.1f %9.1f %8.0f %9.2f %8.1f\n",name,(unsigned long)r.periods.size(),mean * 1000,sqrt(sq / r.periods.size()) * 1000,
+		r.periods[r.periods.size() * 99 / 100] * 1000,r.periods.back() * 1000,r.transactions / r.turnSeconds,r.settled,r.worstOff);
+}
+
+
+int main(int argc,char **argv)
+{
+	double turn = argc > 1 ? atof(argv[1]) : 180;
+	double target = Wrap(START + turn);
+
+	printf("%.0f degree turn, %.0f to %.0f, %d s, %.0f ms of other work a pass\n",turn,START,target,SECONDS,LOOPWORK * 1000);
+	printf("%12s %8s %9s %9s %9s %9s %8s %9s %8s\n","","passes","mean ms","jitter ms","p99 ms","worst ms","i2c/s","settled s","worst off");
+	Print("SetHeading",Old(target));
+	Print("every pass",New(target,true));
+	Print("controller",New(target,false));
+
+	HeadingController control;
+	double t = Now();
+	int sink = 0;
+	control.Target(target,0);
+	for(int i=0;i<STEPS;i++)
+	{
+		double now = i * 0.004;
+		if(i % 5000 == 0)
+			control.Target(Wrap(target + (i / 5000) * 90),now);
+		control.ReadDue(now);
+		sink += control.Step(now,(float)Wrap(i * 0.16));
+	}
+	printf("ReadDue() and Step() a pass: %.1f ns%s\n",(Now() - t) / STEPS * 1e9,sink == 12345 ? " " : "");
+	return 0;
+}
@@ -0,0 +1,95 @@
+/************************************************
+High rate configuration benchmark
+
+Runs GPS against the simulated receiver in tools/
+and checks that ConfigureReceiver() ends up at the
+baud and update rate the receiver allows, how long
+it takes, and how many fixes a second come out.
+
+usage: bench_highrate [seconds]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../gps.h"
+#include "../tools/gpssim.h"
+using namespace std;
+
+
+struct Scenario
+{
+	const char *name;
+	int receiverType;
+	int protocol;
+	int startBaud;
+	int maxBaud;
+	int maxRateHz;
+	int expectBaud;
+	int expectRate;
+	int expectProtocol;
+};
+
+
+Scenario scenarios[] =
+{
+	{ "mtk accepts all",	GPSSIM_MTK,	GPS_PROTOCOL_NMEA,	9600,	921600,	10,	115200,	10,	GPS_PROTOCOL_NMEA },
+	{ "mtk at 115200",	GPSSIM_MTK,	GPS_PROTOCOL_NMEA,	115200,	921600,	10,	115200,	10,	GPS_PROTOCOL_NMEA },
+	{ "mtk keeps baud",	GPSSIM_MTK,	GPS_PROTOCOL_NMEA,	9600,	9600,	10,	9600,	3,	GPS_PROTOCOL_NMEA },
+	{ "mtk refuses rate",	GPSSIM_MTK,	GPS_PROTOCOL_NMEA,	9600,	921600,	1,	115200,	1,	GPS_PROTOCOL_NMEA },
+	{ "ublox accepts all",	GPSSIM_UBLOX,	GPS_PROTOCOL_NMEA,	9600,	921600,	10,	115200,	10,	GPS_PROTOCOL_NMEA },
+	{ "ublox refuses rate",	GPSSIM_UBLOX,	GPS_PROTOCOL_NMEA,	9600,	921600,	5,	115200,	1,	GPS_PROTOCOL_NMEA },
+	{ "ublox binary",	GPSSIM_UBLOX,	GPS_PROTOCOL_UBX,	9600,	921600,	10,	115200,	10,	GPS_PROTOCOL_UBX },
+	{ "mtk asked for ubx",	GPSSIM_MTK,	GPS_PROTOCOL_UBX,	9600,	921600,	10,	115200,	10,	GPS_PROTOCOL_NMEA },
+};
+
+
+int main(int argc,char **argv)
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 3;
+	int failures = 0;
+
+	printf("%-20s %8s %8s %6s %6s %8s %5s %7s %5s\n","scenario","config s","baud","Hz","sim Hz","fixes/s","cmds","ignored","proto");
+	for(size_t s=0;s<sizeof(scenarios)/sizeof(scenarios[0]);s++)
+	{
+		Scenario &sc = scenarios[s];
+		GPSSim sim;
+		sim.receiverType = sc.receiverType;
+		sim.baud = sc.startBaud;
+		sim.maxBaud = sc.maxBaud;
+		sim.maxRateHz = sc.maxRateHz;
+		if(!sim.Open())
+		{
+			cerr << "unable to create pty" << endl;
+			return 1;
+		}
+		sim.Start();
+
+		GPS gps;
+		gps.devicePath = sim.SlavePath();
+		gps.receiverType = sc.receiverType == GPSSIM_UBLOX ? GPS_RECEIVER_UBLOX : GPS_RECEIVER_MTK;
+		gps.targetBaud = GPSHIGHBAUD;
+		gps.targetRate = GPSHIGHRATE;
+		gps.protocol = sc.protocol;
+		gps.Start();
+		while(!gps.receiverConfigured)
+			usleep(10000);
+
+		uint32_t first = gps.GetFix().sequence;
+		usleep(seconds * 1000000);
+		uint32_t last = gps.GetFix().sequence;
+		gps.Stop();
+		sim.Stop();
+
+		int rate = (int)(1.0 / gps.GetUpdatePeriod() + 0.5);
+		double fixRate = (double)(last - first) / seconds;
+		bool ok = gps.baud == sc.expectBaud && rate == sc.expectRate && sim.rateHz == sc.expectRate &&
+			gps.protocol == sc.expectProtocol && fixRate > sc.expectRate * 0.8;
+		printf("%-20s %8.2f %8d %6d %6d %8.1f %5lu %7lu %5s %s\n",sc.name,gps.configSeconds,gps.baud,rate,sim.rateHz,
+			fixRate,sim.commandsSeen,sim.commandsIgnored,gps.protocol == GPS_PROTOCOL_UBX ? "ubx" : "nmea",ok ? "" : "MISMATCH");
+		if(!ok)
+			failures++;
+	}
+	return failures;
+}
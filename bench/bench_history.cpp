@@ -0,0 +1,174 @@
+/************************************************
+Sensor history benchmark
+
+Times SensorHistory::Add() and At() for ring sizes
+from 16 to 4096 samples, At() against a linear
+scan back from the newest sample, which is what
+finding a time costs without the binary search.
+Checks At() is exact on a ramp and takes the short
+way round 0 degrees.  Then runs the streams the
+quad keeps for an hour: the magnetometer's reads
+and the estimator's states at the loop rate, both
+looked back into at each fix, and reports the CPU
+they cost a second.
+
+usage: bench_history
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../gps.h"
+#include "../estimator.h"
+#include "../history.h"
+#include "bench.h"
+using namespace std;
+
+#define OPERATIONS	4000000
+#define PERIOD		0.01	//Seconds between samples in the timing runs
+#define LOOPRATE	50	//Hz
+#define FIXRATE		10
+#define HEADINGS	64	//As HEADINGHISTORY, heading.h needs wiringPi
+
+
+//The same ring searched from the newest back one sample at a time
+template <int CAPACITY>
+bool ScanAt(const double *times,const float *values,int newest,int count,double time,float &value)
+{
+	for(int i=0;i + 1<count;i++)
+	{
+		int b = (newest - i) & (CAPACITY - 1),a = (newest - i - 1) & (CAPACITY - 1);
+		if(times[a] <= time)
+		{
+			value = values[a] + (values[b] - values[a]) * (float)((time - times[a]) / (times[b] - times[a]));
+			return true;
+		}
+	}
+	return false;
+}
+
+
+template <int CAPACITY>
+void Time()
+{
+	SensorHistory<float,CAPACITY> history;
+	static double times[CAPACITY];
+	static float values[CAPACITY];
+
+	double t = Now();
+	for(int i=0;i<OPERATIONS;i++)
+		history.Add(i * PERIOD,(float)(i & 1023));
+	double addNs = (Now() - t) / OPERATIONS * 1e9;
+
+	int newest = (OPERATIONS - 1) & (CAPACITY - 1);
+	for(int i=0;i<CAPACITY;i++)
+	{
+		int n = OPERATIONS - CAPACITY + i;
+		times[n & (CAPACITY - 1)] = n * PERIOD;
+		values[n & (CAPACITY - 1)] = (float)(n & 1023);
+	}
+	double oldest = history.Oldest(),span = history.Newest() - oldest;
+	int queries = OPERATIONS / 4;
+	double *at = new double[queries];
+	for(int i=0;i<queries;i++)
+		at[i] = oldest + span * (Next() % 100000) / 100000.0;
+
+	float sink = 0,v = 0;
+	t = Now();
+	for(int i=0;i<queries;i++)
+	{
+		history.At(at[i],v);
+		sink += v;
+	}
+	double atNs = (Now() - t) / queries * 1e9;
+
+	t = Now();
+	for(int i=0;i<queries;i++)
+	{
+		ScanAt<CAPACITY>(times,values,newest,CAPACITY,at[i],v);
+		sink += v;
+	}
+	double scanNs = (Now() - t) / queries * 1e9;
+
+	//Recent times only, the usual question is where were we a fix's latency ago
+	for(int i=0;i<queries;i++)
+		at[i] = history.Newest() - PERIOD * (Next() % 30) / 2;
+	t = Now();
+	for(int i=0;i<queries;i++)
+	{
+		history.At(at[i],v);
+		sink += v;
+	}
+	double recentNs = (Now() - t) / queries * 1e9;
+	t = Now();
+	for(int i=0;i<queries;i++)
+	{
+		ScanAt<CAPACITY>(times,values,newest,CAPACITY,at[i],v);
+		sink += v;
+	}
+	double recentScanNs = (Now() - t) / queries * 1e9;
+	delete [] at;
+
+	printf("%8d %8.1f %10.1f %10.1f %12.1f %12.1f%s\n",CAPACITY,addNs,atNs,scanNs,recentNs,recentScanNs,sink == 12345 ? " " : "");
+}
+
+
+int main()
+{
+	//A ramp comes back exactly, between samples and at them, and nothing outside
+	SensorHistory<double,64> ramp;
+	for(int i=0;i<200;i++)
+		ramp.Add(i * 0.1,i * 3.0);
+	double worst = 0,v;
+	bool outside = ramp.At(ramp.Oldest() - 0.01,v) || ramp.At(ramp.Newest() + 0.01,v);
+	for(double t=ramp.Oldest();t<=ramp.Newest();t+=0.0137)
+	{
+		if(!ramp.At(t,v))
+			outside = true;
+		worst = max(worst,fabs(v - t * 30));
+	}
+	SensorHistory<float,4,AngleBlend> angle;
+	angle.Add(0,350);
+	angle.Add(1,20);
+	float a;
+	angle.At(0.5,a);
+	printf("ramp error %.2g, outside the history %s, 350 to 20 degrees halfway %.1f\n\n",worst,outside ? "ANSWERED" : "refused",a);
+
+	printf("%8s %8s %10s %10s %12s %12s\n","samples","add ns","at ns","scan ns","recent at ns","recent scan");
+	Time<16>();
+	Time<64>();
+	Time<256>();
+	Time<1024>();
+	Time<4096>();
+
+	//The quad's streams for an hour, every loop pass a heading read and an estimator state, every fix a
+	//look back at both a fix's latency ago
+	SensorHistory<float,HEADINGS,AngleBlend> headings;
+	SensorHistory<EstimatorSample,EKFHISTORY,EstimatorBlend> states;
+	EstimatorSample state,then;
+	for(int k=0;k<EKFSTATES;k++)
+		state.x[k] = 0;
+	then = state;
+	int passes = LOOPRATE * 3600;
+	float sink = 0,h = 0;
+	double t = Now();
+	for(int i=0;i<passes;i++)
+	{
+		double now = i / (double)LOOPRATE;
+		state.x[EKFEAST] = i * 0.01f;
+		headings.Add(now,(float)(i % 360));
+		states.Add(now,state);
+		if(i % (LOOPRATE / FIXRATE) == 0)
+		{
+			headings.At(now - GPSFIXLATENCY,h);
+			states.At(now - GPSFIXLATENCY,then);
+			sink += h + then.x[EKFEAST];
+		}
+	}
+	t = Now() - t;
+	printf("\nloop at %d Hz, fixes at %d Hz: %d headings and %d estimator states kept, %.2f us of CPU a second%s\n",LOOPRATE,FIXRATE,HEADINGS,EKFHISTORY,
+		t / 3600 * 1e6,sink == 12345 ? " " : "");
+	return 0;
+}
@@ -0,0 +1,101 @@
+/************************************************
+Mission executor benchmark
+
+Flies a simulated quad (turns at once, holds the
+requested speed, half a metre of GPS noise) round
+missions of 10 to 7000 waypoints at 10 Hz, then
+replays the same fixes to time a tick.  Against it,
+the per tick work without the precomputed legs:
+TinyGPSPlus distance and course to the leg end and
+from the leg start for the cross track error.
+
+usage: bench_mission [waypoint spacing m]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../gps.h"
+#include "../geo.h"
+#include "../mission.h"
+#include "bench.h"
+using namespace std;
+
+#define TICK		0.1	//Seconds
+#define NOISEMM		500
+#define TURNS		30	//Degrees a leg wanders from the last at most
+
+
+int main(int argc,char **argv)
+{
+	double spacing = argc > 1 ? atof(argv[1]) : 10;
+	int sizes[] = { 10, 1000, 7000 };
+
+	printf("waypoints %.0f m apart, ns per tick\n",spacing);
+	printf("%9s %8s %8s %10s %10s %10s %12s %8s\n","waypoints","load ms","ticks","executor","recompute","speedup","max xtrack m","finished");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		int count = sizes[s];
+		vector<WayPoint> wp = Mission(count,spacing,TURNS);
+		MissionExecutor mission;
+		double t = Now();
+		mission.Load(wp.data(),count);
+		double tLoad = Now() - t;
+
+		//Fly it, keeping every fix the executor saw
+		vector<GeoPoint> fixes;
+		GeoPoint quad = GeoFromDegrees(wp[0].lat,wp[0].lng);
+		float maxCross = 0;
+		int legsFlown = 0,lastLeg = -1;
+		for(int tick=0;tick<10000000;tick++)
+		{
+			GeoPoint fix = GeoOffset(quad,(int64_t)(Next() % (2 * NOISEMM + 1)) - NOISEMM,(int64_t)(Next() % (2 * NOISEMM + 1)) - NOISEMM);
+			fixes.push_back(fix);
+			const MissionRequest &r = mission.Update(fix);
+			if(r.leg != lastLeg)
+			{
+				legsFlown++;
+				lastLeg = r.leg;
+			}
+			maxCross = max(maxCross,fabsf(r.crossTrack));
+			if(r.done && r.speed == 0)
+				break;
+			quad = Step(quad,r.heading,r.speed * TICK);
+		}
+		int ticks = (int)fixes.size();
+
+		//The same fixes again, timed
+		mission.Start();
+		volatile double sink = 0;
+		t = Now();
+		for(int i=0;i<ticks;i++)
+			sink += mission.Update(fixes[i]).heading;
+		double tExecutor = Now() - t;
+
+		//Leg geometry worked out again on every tick
+		mission.Start();
+		t = Now();
+		for(int i=0;i<ticks;i++)
+		{
+			int leg = mission.Update(fixes[i]).leg;
+			if(leg < 0)
+				leg = count - 2;
+			double lat = GeoToDegrees(fixes[i].lat),lng = GeoToDegrees(fixes[i].lng);
+			double toEnd = TinyGPSPlus::distanceBetween(lat,lng,wp[leg + 1].lat,wp[leg + 1].lng);
+			double course = TinyGPSPlus::courseTo(lat,lng,wp[leg + 1].lat,wp[leg + 1].lng);
+			double fromStart = TinyGPSPlus::distanceBetween(wp[leg].lat,wp[leg].lng,lat,lng);
+			double legCourse = TinyGPSPlus::courseTo(wp[leg].lat,wp[leg].lng,wp[leg + 1].lat,wp[leg + 1].lng);
+			double fromCourse = TinyGPSPlus::courseTo(wp[leg].lat,wp[leg].lng,lat,lng);
+			sink += toEnd + course + fromStart * sin((fromCourse - legCourse) * M_PI / 180);
+		}
+		double tRecompute = Now() - t - tExecutor;
+
+		printf("%9d %8.2f %8d %10.1f %10.1f %9.0fx %12.2f %4d/%-4d\n",count,tLoad * 1000,ticks,tExecutor * 1e9 / ticks,
+			tRecompute * 1e9 / ticks,tRecompute / tExecutor,maxCross,legsFlown - 1,count - 1);
+	}
+	return 0;
+}
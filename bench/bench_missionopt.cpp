@@ -0,0 +1,107 @@
+/************************************************
+Mission order optimizer benchmark
+
+Inspection missions of 100 to 10000 waypoints
+scattered over a square (about 20 m apart, 5 to
+40 m up) in the order they were written down,
+which is no order at all.  Optimizes each on one
+thread and on every core, checks the result visits
+every waypoint once with the ends in place, and
+reports the flight time saved and the runtime of
+each stage.
+
+usage: bench_missionopt [threads]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../gps.h"
+#include "../geo.h"
+#include "../tools/missionopt.h"
+#include "bench.h"
+using namespace std;
+
+#define SPACING		20.0	//Meters between waypoints on average
+
+
+//Waypoints scattered over a square, SPACING apart on average
+vector<WayPoint> Scatter(int count)
+{
+	vector<WayPoint> wp(count);
+	GeoPoint origin = GeoFromDegrees(35.2058,-97.4457);
+	double side = SPACING * sqrt((double)count);
+	for(int i=0;i<count;i++)
+	{
+		GeoPoint p = GeoOffset(origin,(int64_t)(side * 1000 * (Next() % 10000) / 10000),(int64_t)(side * 1000 * (Next() % 10000) / 10000));
+		wp[i].lat = GeoToDegrees(p.lat);
+		wp[i].lng = GeoToDegrees(p.lng);
+		wp[i].alt = (5 + (Next() % 36)) * 1000 / FEETTOMM;
+		wp[i].heading = 0;
+		wp[i].seconds = -1;
+	}
+	return wp;
+}
+
+
+//Every waypoint once, first first and last last
+bool Valid(const vector<int> &order,int count,bool openEnd)
+{
+	vector<char> seen(count,0);
+	for(size_t i=0;i<order.size();i++)
+	{
+		if(order[i] < 0 || order[i] >= count || seen[order[i]])
+			return false;
+		seen[order[i]] = 1;
+	}
+	return (int)order.size() == count && order[0] == 0 && (openEnd || order.back() == count - 1);
+}
+
+
+int main(int argc,char **argv)
+{
+	int threads = argc > 1 ? atoi(argv[1]) : (int)thread::hardware_concurrency();
+	int sizes[] = { 100, 1000, 10000 };
+
+	printf("flight seconds at %.0f m/s and %.0f m/s climb, optimized on 1 and %d threads\n",MISSIONOPTSPEED,MISSIONOPTCLIMB,threads);
+	printf("%9s %5s %10s %10s %10s %8s %10s %10s %8s %8s %8s %6s\n","waypoints","end","file s","nearest s","optimized","saved","1 thr ms","N thr ms",
+		"nbr ms","rounds","whole ms","valid");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		for(int open=0;open<2;open++)
+		{
+			int count = sizes[s];
+			seed = 12345 + count;
+			vector<WayPoint> wp = Scatter(count);
+			Track track;
+			track.Load(wp.data(),count);
+			MissionOptimizer optimizer;
+			optimizer.Load(track);
+			optimizer.openEnd = open;
+			vector<int> order;
+			for(int i=0;i<count;i++)
+				order.push_back(i);
+			float fileCost = optimizer.Cost(order);
+
+			double t = Now();
+			float serialCost = optimizer.Optimize(order,1);
+			double tSerial = Now() - t;
+			bool valid = Valid(order,count,open);
+			t = Now();
+			float cost = optimizer.Optimize(order,threads);
+			double tParallel = Now() - t;
+			valid = valid && Valid(order,count,open) && fabsf(optimizer.Cost(order) - cost) < 1;
+
+			printf("%9d %5s %10.0f %10.0f %10.0f %7.1f%% %10.1f %10.1f %8.1f %8d %8.1f %6s\n",count,open ? "open" : "fixed",fileCost,optimizer.seedCost,cost,
+				100 * (fileCost - cost) / fileCost,tSerial * 1000,tParallel * 1000,optimizer.neighborSeconds * 1000,optimizer.rounds,
+				optimizer.finishSeconds * 1000,valid ? "yes" : "NO");
+			if(fabsf(serialCost - cost) > 0.02f * cost)
+				printf("%9s 1 thread found %.0f s\n","",serialCost);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,109 @@
+/************************************************
+NMEA sentence filter benchmark
+
+Sentences per second through TinyGPSPlus on a
+multi-GNSS receiver's 1 Hz output, which is mostly
+GSV and GSA.  Compares the subscription GPS uses
+against a parser made to tokenize everything (a
+TinyGPSCustom listener on every sentence type, the
+way the old parser treated all input).
+
+usage: bench_parse [epochs] [passes]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../nmea.h"
+#include "bench.h"
+using namespace std;
+
+
+#define SENTENCESPEREPOCH 14
+
+
+//What a GPS+GLONASS receiver sends every second
+string MakeStream(int epochs)
+{
+	string s;
+	for(int e=0;e<epochs;e++)
+	{
+		NMEAFix fix;
+		fix.lat = 35.1 + e * 0.000013;
+		fix.lng = -97.4 - e * 0.000021;
+		fix.altMeters = 370;
+		fix.speedKnots = 3.1;
+		fix.course = (e * 3) % 360;
+		fix.utcSeconds = 40000 + e;
+
+		s += NMEAMakeGGA(fix,"GN");
+		s += NMEASentence("GNGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.8,0.9,1.5");
+		s += NMEASentence("GNGSA,A,3,65,66,72,73,81,,,,,,,,1.8,0.9,1.5");
+		s += NMEASentence("GPGSV,4,1,14,04,38,284,42,05,15,039,35,09,29,171,40,12,73,049,44");
+		s += NMEASentence("GPGSV,4,2,14,24,25,304,38,25,55,106,45,29,41,238,41,31,09,090,30");
+		s += NMEASentence("GPGSV,4,3,14,02,05,312,,14,02,150,,21,01,052,,26,12,210,22");
+		s += NMEASentence("GPGSV,4,4,14,32,03,330,,36,,,,");
+		s += NMEASentence("GLGSV,3,1,10,65,52,047,40,66,20,327,33,72,31,105,38,73,48,022,41");
+		s += NMEASentence("GLGSV,3,2,10,74,14,067,29,80,09,263,,81,60,191,43,82,22,287,35");
+		s += NMEASentence("GLGSV,3,3,10,83,04,315,,88,11,149,");
+		s += NMEAMakeRMC(fix,"GN");
+		s += NMEAMakeVTG(fix,"GN");
+		s += NMEASentence("GNZDA,110640.00,21,04,2015,00,00");
+	}
+	return s;
+}
+
+
+double Run(TinyGPSPlus &g,const string &stream,int passes,uint32_t &passed)
+{
+	double best = 1e9;
+	for(int p=0;p<passes;p++)
+	{
+		double t = Now();
+		for(size_t i=0;i<stream.length();i+=82)
+			g.encode(stream.c_str() + i,stream.length() - i < 82 ? stream.length() - i : 82);
+		t = Now() - t;
+		if(t < best)
+			best = t;
+	}
+	passed = g.passedChecksum();
+	return best;
+}
+
+
+int main(int argc,char **argv)
+{
+	int epochs = argc > 1 ? atoi(argv[1]) : 20000;
+	int passes = argc > 2 ? atoi(argv[2]) : 5;
+	string stream = MakeStream(epochs);
+	double sentences = (double)epochs * SENTENCESPEREPOCH;
+	uint32_t passed;
+
+	printf("%d epochs, %d sentences each, %lu bytes\n",epochs,SENTENCESPEREPOCH,(unsigned long)stream.length());
+
+	//Everything tokenized, listeners on every sentence type
+	TinyGPSPlus all;
+	TinyGPSCustom c1(all,"GNGSA",1),c2(all,"GPGSV",1),c3(all,"GLGSV",1),c4(all,"GNZDA",1);
+	double t = Run(all,stream,passes,passed);
+	printf("tokenize all            %10.0f sentences/s  (%u checksummed)\n",sentences / t,passed / passes);
+
+	//The GPS object's subscription
+	TinyGPSPlus gps;
+	gps.subscribe(TINYGPS_TIME | TINYGPS_LOCATION | TINYGPS_ALTITUDE | TINYGPS_COURSE | TINYGPS_SPEED);
+	double tg = Run(gps,stream,passes,passed);
+	printf("GPS subscription        %10.0f sentences/s  (%u checksummed, %u skipped)  %.2fx\n",
+		sentences / tg,passed / passes,gps.sentencesSkipped() / passes,t / tg);
+
+	//Position only, RMC and GGA
+	TinyGPSPlus pos;
+	pos.subscribe(TINYGPS_LOCATION);
+	double tp = Run(pos,stream,passes,passed);
+	printf("location only           %10.0f sentences/s  (%u checksummed, %u skipped)  %.2fx\n",
+		sentences / tp,passed / passes,pos.sentencesSkipped() / passes,t / tp);
+
+	printf("GN talker decoded: lat %.6f lng %.6f alt %.1f course %.2f\n",
+		gps.location.lat(),gps.location.lng(),gps.altitude.meters(),gps.course.deg());
+	return 0;
+}
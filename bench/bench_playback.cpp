@@ -0,0 +1,128 @@
+/************************************************
+Macro playback benchmark
+
+Records macros of 100 to 7000 points (a metre a
+sample on a wandering, self crossing path, with
+hovers where the same spot is recorded again and
+again), flies them back with MacroPlayer at 10 Hz
+with half a metre of GPS noise, then replays the
+same fixes to time a tick.  Against it, finding
+the nearest segment by scanning the whole macro
+with the Track batch kernel every tick, and how
+often that scan would have jumped to another pass
+of the path.
+
+usage: bench_playback [speed m/s] [rate]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../gps.h"
+#include "../geo.h"
+#include "../playback.h"
+#include "bench.h"
+using namespace std;
+
+#define TICK		0.1	//Seconds
+#define NOISEMM		500
+#define RECORDPERIOD	0.5	//Seconds, MACROREADPERIOD
+
+
+//A metre a sample on a wandering heading, one sample in fifty starts a 20 sample hover
+vector<WayPoint> Macro(int count)
+{
+	vector<WayPoint> wp(count);
+	GeoPoint p = GeoFromDegrees(35.2058,-97.4457);
+	double heading = 0;
+	int hover = 0;
+	for(int i=0;i<count;i++)
+	{
+		if(hover > 0)
+			hover--;
+		else
+		{
+			if(Next() % 50 == 0)
+				hover = 20;
+			heading += ((int)(Next() % 21) - 10) * M_PI / 180;
+			p = GeoOffset(p,(int64_t)(1000 * cos(heading)),(int64_t)(1000 * sin(heading)));
+		}
+		wp[i].lat = GeoToDegrees(p.lat);
+		wp[i].lng = GeoToDegrees(p.lng);
+		wp[i].alt = 6;
+		wp[i].heading = 0;
+		wp[i].seconds = i * RECORDPERIOD;
+	}
+	return wp;
+}
+
+
+int main(int argc,char **argv)
+{
+	float speed = argc > 1 ? atof(argv[1]) : 2;
+	float rate = argc > 2 ? atof(argv[2]) : 0;
+	int sizes[] = { 100, 1000, 7000 };
+
+	printf("playback at %.1f m/s, rate %.1f, ns per tick\n",speed,rate);
+	printf("%7s %7s %8s %8s %10s %10s %12s %12s %8s\n","points","kept","load ms","ticks","player","full scan","max xtrack m","scan jumps","finished");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		int count = sizes[s];
+		seed = 12345 + count;
+		vector<WayPoint> wp = Macro(count);
+		MacroPlayer player;
+		player.speed = speed;
+		player.rate = rate;
+		double t = Now();
+		player.Load(wp.data(),count);
+		double tLoad = Now() - t;
+
+		//Fly it, keeping every fix the player saw
+		vector<GeoPoint> fixes;
+		vector<int> cursor;
+		GeoPoint quad = GeoFromDegrees(wp[0].lat,wp[0].lng);
+		float maxCross = 0;
+		bool finished = false;
+		for(int tick=0;tick<10000000;tick++)
+		{
+			GeoPoint fix = GeoOffset(quad,(int64_t)(Next() % (2 * NOISEMM + 1)) - NOISEMM,(int64_t)(Next() % (2 * NOISEMM + 1)) - NOISEMM);
+			fixes.push_back(fix);
+			const MissionRequest &r = player.Update(fix);
+			cursor.push_back(r.leg);
+			maxCross = max(maxCross,fabsf(r.crossTrack));
+			if(r.done && r.speed == 0)
+			{
+				finished = true;
+				break;
+			}
+			quad = Step(quad,r.heading,r.speed * TICK);
+		}
+		int ticks = (int)fixes.size();
+
+		//The same fixes again, timed
+		player.Start();
+		volatile double sink = 0;
+		t = Now();
+		for(int i=0;i<ticks;i++)
+			sink += player.Update(fixes[i]).heading;
+		double tPlayer = Now() - t;
+
+		//Nearest segment over the whole macro instead of the window past the cursor
+		int jumps = 0;
+		float distance;
+		t = Now();
+		for(int i=0;i<ticks;i++)
+			sink += player.track.NearestLeg(fixes[i],distance);
+		double tScan = Now() - t;
+		for(int i=0;i<ticks;i++)
+			if(cursor[i] >= 0 && abs(player.track.NearestLeg(fixes[i],distance) - cursor[i]) > PLAYBACKWINDOW)
+				jumps++;
+
+		printf("%7d %7d %8.2f %8d %10.1f %10.1f %12.2f %12d %8s\n",count,player.Count(),tLoad * 1000,ticks,tPlayer * 1e9 / ticks,
+			tScan * 1e9 / ticks,maxCross,jumps,finished ? "yes" : "no");
+	}
+	return 0;
+}
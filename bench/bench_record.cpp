@@ -0,0 +1,196 @@
+/************************************************
+Macro recording benchmark
+
+Simulates survey flights like the ones macros are
+recorded on: 2 m/s runs of 20 to 80 m with gentle
+wander, climbs, and 30 to 120 second hovers between
+them, fixes at 2 Hz with a slowly drifting half
+metre of GPS error.  Each is recorded the old way
+(every fix, 7000 slots that wrap) and with
+MacroRecorder, then simplified with Douglas-Peucker
+and Visvalingam.  For each: points, file bytes,
+furthest point off the recording, then the load
+time, the time to fly it back with MacroPlayer at
+a fixed speed and the cost of a tick.
+
+usage: bench_record [tolerance inches]
+
+***********************************************/
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../gps.h"
+#include "../geo.h"
+#include "../recorder.h"
+#include "../playback.h"
+#include "../tools/simplify.h"
+#include "bench.h"
+using namespace std;
+
+#define FIXPERIOD	0.5	//Seconds, the old MACROREADPERIOD
+#define MAXPOINTS	7000	//MAXRECORDWAYPOINTS
+#define TICK		0.1
+
+
+double Uniform(double lo,double hi)
+{
+	return lo + (hi - lo) * (Next() % 100000) / 100000.0;
+}
+
+
+//Every fix of a flight of about minutes long
+vector<GPSFix> Flight(double minutes)
+{
+	vector<GPSFix> fixes;
+	GeoPoint start = GeoFromDegrees(35.2058,-97.4457);
+	double e = 0,n = 0,alt = 20,heading = 0,t = 0;
+	double driftE = 0,driftN = 0;
+	while(t < minutes * 60)
+	{
+		//A run, then a hover
+		double run = Uniform(20,80);
+		double climb = Uniform(-5,5);
+		heading += Uniform(-120,120) * M_PI / 180;
+		double hover = Uniform(30,120);
+		double end = t + run / 2 + hover;
+		for(double s=0;t<end;t+=FIXPERIOD,s+=FIXPERIOD)
+		{
+			if(s < run / 2)
+			{
+				heading += Uniform(-3,3) * M_PI / 180;
+				e += 2 * FIXPERIOD * sin(heading);
+				n += 2 * FIXPERIOD * cos(heading);
+				alt += climb * FIXPERIOD * 2 / run;
+			}
+			driftE = 0.98 * driftE + Uniform(-0.05,0.05);
+			driftN = 0.98 * driftN + Uniform(-0.05,0.05);
+			GPSFix fix;
+			fix.position = GeoOffset(start,(int64_t)((n + driftN) * 1000),(int64_t)((e + driftE) * 1000));
+			fix.lat = GeoToDegrees(fix.position.lat);
+			fix.lng = GeoToDegrees(fix.position.lng);
+			fix.alt = alt + Uniform(-0.3,0.3);
+			fix.course = fmod(heading * 180 / M_PI + Uniform(-20,20) + 720,360);
+			fix.speed = s < run / 2 ? 2 : 0;
+			fix.timeStamp = t;
+			fixes.push_back(fix);
+		}
+	}
+	return fixes;
+}
+
+
+//Bytes of waypoints.txt as SaveWayPoints() writes it
+size_t FileBytes(const vector<WayPoint> &wp)
+{
+	ostringstream o;
+	o.precision(10);
+	for(size_t i=0;i<wp.size();i++)
+		o << wp[i].lat << ";" << wp[i].lng << ";" << wp[i].alt << ";" << wp[i].heading << ";" << wp[i].seconds << endl;
+	return o.str().size();
+}
+
+
+void Report(const char *name,const vector<WayPoint> &wp,double simplifyMs)
+{
+	MacroPlayer player;
+	double t = Now();
+	player.Load(wp.data(),(int)wp.size());
+	double tLoad = Now() - t;
+
+	//Fly it back at PLAYBACKSPEED without noise, timing every tick
+	GeoPoint quad = GeoFromDegrees(wp[0].lat,wp[0].lng);
+	int ticks = 0;
+	double tFly = 0;
+	bool finished = false;
+	for(;ticks<1000000;ticks++)
+	{
+		t = Now();
+		const MissionRequest &r = player.Update(quad);
+		tFly += Now() - t;
+		if(r.done && r.speed == 0)
+		{
+			finished = true;
+			break;
+		}
+		quad = Step(quad,r.heading,r.speed * TICK);
+	}
+
+	char flown[32];
+	snprintf(flown,sizeof(flown),finished ? "%.1f" : "never",ticks * TICK);
+	printf("%-15s %7d %9lu %11.2f %9.2f %9s %10.1f\n",name,(int)wp.size(),(unsigned long)FileBytes(wp),simplifyMs,tLoad * 1000,
+		flown,tFly * 1e9 / ticks);
+}
+
+
+int main(int argc,char **argv)
+{
+	double inches = argc > 1 ? atof(argv[1]) : SIMPLIFYTOLERANCE;
+	double lengths[] = { 10, 60, 240 };
+
+	for(size_t l=0;l<sizeof(lengths)/sizeof(lengths[0]);l++)
+	{
+		seed = 12345 + (uint32_t)lengths[l];
+		vector<GPSFix> fixes = Flight(lengths[l]);
+
+		//Every fix into 7000 slots that wrap, as macroRecordMode did
+		vector<WayPoint> every;
+		bool wrapped = false;
+		for(size_t i=0;i<fixes.size();i++)
+		{
+			WayPoint p;
+			p.lat = fixes[i].lat;
+			p.lng = fixes[i].lng;
+			p.alt = fixes[i].alt;
+			p.heading = fixes[i].course;
+			p.seconds = fixes[i].timeStamp;
+			if(every.size() < MAXPOINTS)
+				every.push_back(p);
+			else
+			{
+				every[i % MAXPOINTS] = p;
+				wrapped = true;
+			}
+		}
+
+		vector<WayPoint> buffer(MAXPOINTS);
+		MacroRecorder recorder;
+		double t = Now();
+		recorder.Start(buffer.data(),MAXPOINTS);
+		for(size_t i=0;i<fixes.size();i++)
+			recorder.Add(fixes[i]);
+		double tRecord = Now() - t;
+		vector<WayPoint> adaptive(buffer.begin(),buffer.begin() + recorder.Count());
+
+		//Both simplifiers on the adaptive recording, checked against it
+		Track track;
+		track.Load(adaptive.data(),(int)adaptive.size());
+		vector<int> dpKeep,vwKeep;
+		t = Now();
+		SimplifyDouglasPeucker(track,inches * INCHESTOMETERS,dpKeep);
+		double tDP = Now() - t;
+		t = Now();
+		SimplifyVisvalingam(track,inches * INCHESTOMETERS,vwKeep);
+		double tVW = Now() - t;
+		vector<WayPoint> dp,vw;
+		for(size_t i=0;i<dpKeep.size();i++)
+			dp.push_back(adaptive[dpKeep[i]]);
+		for(size_t i=0;i<vwKeep.size();i++)
+			vw.push_back(adaptive[vwKeep[i]]);
+
+		printf("%.0f minute flight, %d fixes, recorder %.0f ns a fix, tolerance %.1f in: douglas-peucker %.2f in, visvalingam %.2f in furthest off\n",
+			lengths[l],(int)fixes.size(),tRecord * 1e9 / fixes.size(),inches,SimplifyError(track,dpKeep) / INCHESTOMETERS,SimplifyError(track,vwKeep) / INCHESTOMETERS);
+		printf("%-15s %7s %9s %11s %9s %9s %10s\n","recording","points","bytes","simplify ms","load ms","flown s","ns a tick");
+		Report(wrapped ? "every fix*" : "every fix",every,0);
+		Report("adaptive",adaptive,0);
+		Report("douglas-peucker",dp,tDP * 1000);
+		Report("visvalingam",vw,tVW * 1000);
+		if(wrapped)
+			printf("* wrapped, the start of the flight was overwritten\n");
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,135 @@
+/************************************************
+NMEA replay benchmark
+
+Memory maps recorded NMEA logs and pushes them a
+line at a time, the way Rx() hands them over in
+canonical mode, through the same encode() then
+GetGPS() path as GPSMainThread, as fast as it can.
+
+corpus/clean.nmea	30 s of 10 Hz GGA/RMC/VTG, GSA and GSV once a second, GP then GN
+corpus/noisy.nmea	the same with flipped, dropped and doubled bytes and line noise
+corpus/truncated.nmea	the same with overrun sentences cut short, ends mid sentence
+
+usage: bench_replay [passes] [file ...]
+	with no files the corpus above is replayed
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../gps.h"
+#include "bench.h"
+using namespace std;
+
+
+//One read() worth of log, what canonical mode returns up to and including '\n'
+static const char *NextLine(const char *p,const char *end)
+{
+	const char *nl = (const char *)memchr(p, '\n', end - p);
+	return nl ? nl + 1 : end;
+}
+
+
+struct Replay
+{
+	unsigned long sentences;
+	unsigned long fixes;
+	uint32_t failed;
+	uint32_t passed;
+};
+
+
+//Runs the log through a fresh GPS like GPSMainThread would, times each line if asked
+static Replay Run(const char *log,size_t len,vector<double> *latency)
+{
+	GPS gps;
+	Replay r;
+	r.sentences = 0;
+	r.fixes = 0;
+	const char *end = log + len;
+	for(const char *p=log;p<end;)
+	{
+		const char *next = NextLine(p, end);
+		double start = latency ? Now() : 0;
+		gps.rxTime = start;
+		if(gps.tinyGPS.encode(p, next - p, (uint32_t)(unsigned long long)(start * 1000)))
+		{
+			if(gps.GetGPS())
+				r.fixes++;
+		}
+		if(latency)
+			latency->push_back(Now() - start);
+		r.sentences++;
+		p = next;
+	}
+	r.failed = gps.tinyGPS.failedChecksum();
+	r.passed = gps.tinyGPS.passedChecksum();
+	return r;
+}
+
+
+static double Percentile(vector<double> &v,double p)
+{
+	size_t k = (size_t)(p * (v.size() - 1));
+	nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+
+int main(int argc,char **argv)
+{
+	int passes = argc > 1 ? atoi(argv[1]) : 200;
+	vector<const char *> files;
+	for(int i=2;i<argc;i++)
+		files.push_back(argv[i]);
+	if(files.empty())
+	{
+		files.push_back("corpus/clean.nmea");
+		files.push_back("corpus/noisy.nmea");
+		files.push_back("corpus/truncated.nmea");
+	}
+
+	printf("%-24s %8s %6s %6s %11s %8s %7s %7s %7s %7s\n","log","lines","fixes","badsum","sentences/s","MB/s","p50 ns","p90 ns","p99 ns","max ns");
+	for(size_t f=0;f<files.size();f++)
+	{
+		int fd = open(files[f], O_RDONLY);
+		struct stat st;
+		if(fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0)
+		{
+			cerr << "unable to open " << files[f] << endl;
+			return 1;
+		}
+		const char *log = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(log == MAP_FAILED)
+		{
+			cerr << "unable to map " << files[f] << endl;
+			return 1;
+		}
+		madvise((void *)log, st.st_size, MADV_SEQUENTIAL);
+
+		//Throughput without the clock calls, then one pass timing every line
+		Replay r = Run(log, st.st_size, NULL);
+		double start = Now();
+		for(int p=0;p<passes;p++)
+			Run(log, st.st_size, NULL);
+		double seconds = Now() - start;
+
+		vector<double> latency;
+		latency.reserve(r.sentences);
+		Run(log, st.st_size, &latency);
+		double worst = *max_element(latency.begin(), latency.end());
+
+		printf("%-24s %8lu %6lu %6u %11.0f %8.1f %7.0f %7.0f %7.0f %7.0f\n",files[f],r.sentences,r.fixes,r.failed,
+			r.sentences * passes / seconds,(double)st.st_size * passes / seconds / 1e6,
+			Percentile(latency, 0.5) * 1e9,Percentile(latency, 0.9) * 1e9,Percentile(latency, 0.99) * 1e9,worst * 1e9);
+		munmap((void *)log, st.st_size);
+	}
+	return 0;
+}
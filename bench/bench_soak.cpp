@@ -0,0 +1,94 @@
+/************************************************
+GPS soak benchmark
+
+Runs the threaded reader against the simulator in
+tools/ flying a circle over a damaged line, and
+checks what comes out of GetFix(): fixes per second
+against epochs sent, checksum failures, and that
+every published position is on the circle.
+
+usage: bench_soak [seconds] [rate hz] [bad checksum fraction] [drop fraction]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../gps.h"
+#include "../tools/gpssim.h"
+using namespace std;
+
+#define SOAKRADIUS	20.0	//Meters
+#define SOAKSPEED	5.0	//Meters per second
+#define SOAKTOLERANCE	0.5	//Meters off the circle a good fix may be, NMEA rounding and flat earth
+
+
+int main(int argc,char **argv)
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 10;
+	int rate = argc > 2 ? atoi(argv[2]) : GPSHIGHRATE;
+	double badsum = argc > 3 ? atof(argv[3]) : 0.02;
+	double drop = argc > 4 ? atof(argv[4]) : 0.0005;
+
+	GPSSim sim;
+	sim.trajectory = GPSSIM_CIRCLE;
+	sim.radius = SOAKRADIUS;
+	sim.speed = SOAKSPEED;
+	sim.maxRateHz = GPSSIMMAXRATE;
+	sim.badChecksumRate = badsum;
+	sim.dropRate = drop;
+	GeoPoint center = GeoFromDegrees(sim.fix.lat, sim.fix.lng);
+	if(!sim.Open())
+	{
+		cerr << "unable to create pty" << endl;
+		return 1;
+	}
+	sim.Start();
+
+	GPS gps;
+	gps.devicePath = sim.SlavePath();
+	//Above 40 Hz GGA/RMC/VTG no longer fit in 115200
+	gps.targetBaud = rate > 40 ? 230400 : GPSHIGHBAUD;
+	gps.targetRate = rate;
+	gps.Start();
+	while(!gps.receiverConfigured)
+		usleep(10000);
+
+	unsigned long epochsBefore = sim.epochsSent;
+	uint32_t failedBefore = gps.tinyGPS.failedChecksum();
+	uint32_t first = gps.GetFix().sequence;
+	uint32_t last = first;
+	unsigned long offCircle = 0;
+	double worst = 0;
+	double end = gps.GetMonotonicTime() + seconds;
+	while(gps.GetMonotonicTime() < end)
+	{
+		GPSFix fix = gps.GetFix();
+		if(fix.sequence != last)
+		{
+			last = fix.sequence;
+			double off = fabs(GeoDistance(center, fix.position) / 1000.0 - SOAKRADIUS);
+			if(off > worst)
+				worst = off;
+			if(off > SOAKTOLERANCE)
+				offCircle++;
+		}
+		usleep(1000);
+	}
+	unsigned long epochs = sim.epochsSent - epochsBefore;
+	uint32_t failed = gps.tinyGPS.failedChecksum() - failedBefore;
+	gps.Stop();
+	sim.Stop();
+
+	unsigned long fixes = last - first;
+	printf("rate %d Hz at %d baud for %d s\n",(int)(1.0 / gps.GetUpdatePeriod() + 0.5),gps.baud,seconds);
+	printf("epochs sent %lu  fixes %lu (%.1f/s)  bad checksums sent %lu  failed %u  bytes dropped %lu\n",
+		epochs,fixes,(double)fixes / seconds,sim.checksumsCorrupted,failed,sim.bytesDropped);
+	printf("worst distance off the circle %.3f m, %lu fixes over %.1f m\n",worst,offCircle,SOAKTOLERANCE);
+
+	//Every epoch should come out as a fix, damage only merges a few into the next
+	bool ok = sim.rateHz == rate && fixes > epochs * 0.8 && offCircle == 0;
+	if(!ok)
+		printf("MISMATCH\n");
+	return ok ? 0 : 1;
+}
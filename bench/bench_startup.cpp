@@ -0,0 +1,144 @@
+/************************************************
+Startup benchmark
+
+Time from power on to ready to fly against the
+simulated receiver in tools/.  The old Setup() ran
+the magnetometer retries and a fixed 10 second GPS
+warm up one after the other, the new one brings the
+devices up together and is ready on the first fix,
+which a warm start file turns into a hot start.
+
+usage: bench_startup [cold start seconds]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <future>
+#include <chrono>
+#include "../gps.h"
+#include "../tools/gpssim.h"
+#include "bench.h"
+using namespace std;
+
+#define WARMSTARTFILE	"/tmp/bench_startup_warmstart.txt"
+#define MAGFAILURES	2	//Initialize() calls that fail before the stub magnetometer answers
+
+
+//Stands in for Heading, fails the first few Initialize() calls like a slow I2C device
+struct StubMag
+{
+	int calls;
+	StubMag() { calls = 0; }
+	int Initialize()
+	{
+		usleep(5000);
+		return ++calls > MAGFAILURES ? 0 : -1;
+	}
+};
+
+
+struct Result
+{
+	double ready;
+	bool haveFix;
+	bool hinted;
+};
+
+
+static void StartGPS(GPS &gps,GPSSim &sim,const char *warmStart)
+{
+	gps.devicePath = sim.SlavePath();
+	gps.targetBaud = GPSHIGHBAUD;
+	gps.targetRate = GPSHIGHRATE;
+	if(warmStart)
+		gps.warmStartPath = warmStart;
+	gps.Start();
+}
+
+
+//The old Setup(): mag retries a second apart, then 10 seconds from bootup
+static Result Sequential(GPSSim &sim)
+{
+	double bootup = Now();
+	GPS gps;
+	StartGPS(gps, sim, NULL);
+	StubMag mag;
+	while(mag.Initialize() < 0)
+		usleep(1000000);
+	while(Now() - bootup < 10)
+		usleep(100000);
+
+	Result r;
+	r.ready = Now() - bootup;
+	r.haveFix = gps.GetFix().fields & GPSFIX_POSITION;
+	r.hinted = sim.hinted;
+	gps.Stop();
+	return r;
+}
+
+
+//The new Setup(): everything in parallel, ready on the first fix
+static Result Parallel(GPSSim &sim,const char *warmStart)
+{
+	double bootup = Now();
+	GPS gps;
+	future<bool> gpsReady = async(launch::async, [&]()
+	{
+		StartGPS(gps, sim, warmStart);
+		return gps.WaitForFix(60);
+	});
+	future<bool> magReady = async(launch::async, []()
+	{
+		StubMag mag;
+		while(mag.Initialize() < 0)
+			usleep(250000);
+		return true;
+	});
+	magReady.get();
+
+	Result r;
+	r.haveFix = gpsReady.get();
+	r.ready = Now() - bootup;
+	r.hinted = sim.hinted;
+	gps.Stop();
+	return r;
+}
+
+
+int main(int argc,char **argv)
+{
+	double cold = argc > 1 ? atof(argv[1]) : 6;
+	const char *names[] = { "sequential", "parallel cold", "parallel warm" };
+	int failures = 0;
+
+	unlink(WARMSTARTFILE);
+	printf("%-16s %8s %5s %7s\n","setup","ready s","fix","hinted");
+	for(int s=0;s<3;s++)
+	{
+		GPSSim sim;
+		sim.coldStartSeconds = cold;
+		if(!sim.Open())
+		{
+			cerr << "unable to create pty" << endl;
+			return 1;
+		}
+		sim.Start();
+
+		Result r;
+		if(s == 0)
+			r = Sequential(sim);
+		else
+			r = Parallel(sim, WARMSTARTFILE);
+		sim.Stop();
+
+		//Parallel setups must never be ready without a fix, the warm one must hot start
+		bool ok = s == 0 || (r.haveFix && (s == 1 || (r.hinted && r.ready < cold)));
+		printf("%-16s %8.2f %5s %7s %s\n",names[s],r.ready,r.haveFix ? "yes" : "no",r.hinted ? "yes" : "no",ok ? "" : "MISMATCH");
+		if(!ok)
+			failures++;
+	}
+	unlink(WARMSTARTFILE);
+	return failures;
+}
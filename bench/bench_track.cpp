@@ -0,0 +1,117 @@
+/************************************************
+Track batch kernel benchmark
+
+Times the Track kernels at several mission sizes
+up to a full 7000 point recording, once per kernel
+this CPU can run, against the one pair at a time
+TinyGPSPlus calls gps.cpp makes.  Also reports how
+far each kernel lands from the scalar one and from
+the fixed point geo.cpp answers.
+
+usage: bench_track [repeats]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../geo.h"
+#include "../track.h"
+#include "bench.h"
+using namespace std;
+
+
+float AngleDiff(float a,float b)
+{
+	float d = fabsf(a - b);
+	return d > 180 ? 360 - d : d;
+}
+
+
+int main(int argc,char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 200;
+	int sizes[] = { 16, 256, 1024, 7000 };
+	const char *names[] = { "scalar", "avx2", "neon" };
+	int best = Track::Kernel();
+
+	printf("best kernel here: %s, ns per waypoint, best of %d\n",names[best],repeats);
+	printf("%6s %-8s %9s %9s %9s %9s %9s %11s %11s\n","N","kernel","distance","bearing","legs","nearest","pairwise","dist err mm","bearing deg");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		int count = sizes[s];
+		vector<GeoPoint> rec = Recording(count);
+		Track track;
+		for(int i=0;i<count;i++)
+			track.Add(rec[i],0);
+		GeoPoint from = GeoOffset(rec[count / 2],30000,-40000);
+
+		vector<float> dist(count),bearing(count),length(count),legBearing(count),cumulative(count);
+		vector<float> refDist(count),refBearing(count);
+
+		//What gps.cpp does today, a waypoint at a time on doubles
+		double fromLat = GeoToDegrees(from.lat),fromLng = GeoToDegrees(from.lng);
+		vector<double> lat(count),lng(count);
+		for(int i=0;i<count;i++)
+		{
+			lat[i] = GeoToDegrees(rec[i].lat);
+			lng[i] = GeoToDegrees(rec[i].lng);
+		}
+		double tPair = 1e9;
+		volatile double sink = 0;
+		for(int r=0;r<repeats;r++)
+		{
+			double t = Now();
+			for(int i=0;i<count;i++)
+				sink += TinyGPSPlus::distanceBetween(fromLat,fromLng,lat[i],lng[i]) + TinyGPSPlus::courseTo(fromLat,fromLng,lat[i],lng[i]);
+			tPair = min(tPair,Now() - t);
+		}
+
+		for(int k=TRACK_SCALAR;k<=TRACK_NEON;k++)
+		{
+			if(!Track::Use(k))
+				continue;
+			double tDist = 1e9,tBearing = 1e9,tLegs = 1e9,tNearest = 1e9;
+			float near = 0;
+			for(int r=0;r<repeats;r++)
+			{
+				double t = Now();
+				track.Distances(from,dist.data());
+				tDist = min(tDist,Now() - t);
+				t = Now();
+				track.Bearings(from,bearing.data());
+				tBearing = min(tBearing,Now() - t);
+				t = Now();
+				track.Legs(length.data(),legBearing.data(),cumulative.data());
+				tLegs = min(tLegs,Now() - t);
+				t = Now();
+				track.NearestLeg(from,near);
+				tNearest = min(tNearest,Now() - t);
+			}
+			if(k == TRACK_SCALAR)
+			{
+				refDist = dist;
+				refBearing = bearing;
+			}
+
+			//Against the scalar kernel and against geo.cpp's fixed point
+			float distErr = 0,bearingErr = 0,geoDistErr = 0,geoBearingErr = 0;
+			for(int i=0;i<count;i++)
+			{
+				distErr = max(distErr,fabsf(dist[i] - refDist[i]) * 1000);
+				bearingErr = max(bearingErr,AngleDiff(bearing[i],refBearing[i]));
+				geoDistErr = max(geoDistErr,fabsf(dist[i] * 1000 - GeoDistance(from,rec[i])));
+				geoBearingErr = max(geoBearingErr,AngleDiff(bearing[i],GeoBearing(from,rec[i]) / 1e9f));
+			}
+			printf("%6d %-8s %9.2f %9.2f %9.2f %9.2f %9.2f %11.2f %11.5f\n",count,names[k],tDist * 1e9 / count,tBearing * 1e9 / count,
+				tLegs * 1e9 / count,tNearest * 1e9 / count,tPair * 1e9 / count,geoDistErr,geoBearingErr);
+			if(k != TRACK_SCALAR && (distErr > 1 || bearingErr > 0.001))
+				printf("%6s %-8s MISMATCH against scalar, %.3f mm %.6f deg\n","",names[k],distErr,bearingErr);
+		}
+		Track::Use(best);
+	}
+	return 0;
+}
@@ -0,0 +1,168 @@
+/************************************************
+Trajectory benchmark
+
+Fits minimum jerk trajectories through missions of
+100 to 10000 waypoints on one thread and on every
+core, sweeps each one at 100 Hz to check it stays
+inside the speed and acceleration limits, and times
+Evaluate() at random times.  Then flies a quad that
+can only accelerate at the limit (half a metre of
+GPS noise, 10 Hz) round the same mission with the
+mission executor and with the trajectory, counting
+the flight time and how often the requested
+heading swings by more than 10 degrees in a tick.
+
+usage: bench_trajectory [waypoint spacing m] [threads]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../gps.h"
+#include "../geo.h"
+#include "../mission.h"
+#include "../trajectory.h"
+#include "bench.h"
+using namespace std;
+
+#define TICK		0.1	//Seconds
+#define NOISEMM		500
+#define TURNS		45	//Degrees a leg wanders from the last at most
+#define SWEEP		0.01f	//Seconds
+#define EVALUATIONS	1000000
+#define SWING		10	//Degrees
+
+
+//A quad whose velocity turns toward the request no faster than accel allows
+struct Quad
+{
+	GeoPoint p;
+	double ve,vn;
+	bool Fly(const MissionRequest &r,double accel)
+	{
+		double a = r.heading * M_PI / 180;
+		double we = r.speed * sin(a) - ve;
+		double wn = r.speed * cos(a) - vn;
+		double change = sqrt(we * we + wn * wn);
+		double most = accel * TICK;
+		if(change > most)
+		{
+			we *= most / change;
+			wn *= most / change;
+		}
+		ve += we;
+		vn += wn;
+		p = GeoOffset(p,(int64_t)(vn * TICK * 1000),(int64_t)(ve * TICK * 1000));
+		return !(r.done && r.speed == 0 && sqrt(ve * ve + vn * vn) < 0.05);
+	}
+};
+
+
+struct Flight
+{
+	double seconds;
+	int swings;
+	float maxCross;
+};
+
+
+template <class Follower> Flight Fly(Follower follow,const WayPoint &start,double accel)
+{
+	Flight f = { 0, 0, 0 };
+	Quad quad = { GeoFromDegrees(start.lat,start.lng), 0, 0 };
+	double last = -1;
+	for(int tick=0;tick<1000000;tick++)
+	{
+		GeoPoint fix = GeoOffset(quad.p,(int64_t)(Next() % (2 * NOISEMM + 1)) - NOISEMM,(int64_t)(Next() % (2 * NOISEMM + 1)) - NOISEMM);
+		const MissionRequest &r = follow(fix);
+		if(last >= 0 && r.speed > 0)
+		{
+			double swing = fabs(fmod(r.heading - last + 540,360) - 180);
+			if(swing > SWING)
+				f.swings++;
+		}
+		last = r.heading;
+		if(!r.done)
+			f.maxCross = max(f.maxCross,fabsf(r.crossTrack));
+		if(!quad.Fly(r,accel))
+			break;
+		f.seconds += TICK;
+	}
+	return f;
+}
+
+
+int main(int argc,char **argv)
+{
+	double spacing = argc > 1 ? atof(argv[1]) : 10;
+	int threads = argc > 2 ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+	int sizes[] = { 100, 1000, 10000 };
+
+	printf("waypoints %.0f m apart, fitting on 1 and %d threads\n",spacing,threads);
+	printf("%9s %10s %10s %8s %10s %10s %10s %12s\n","waypoints","1 thr ms","N thr ms","speedup","mission s","max m/s","max m/s2","evaluate ns");
+	for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		int count = sizes[s];
+		seed = 12345 + count;
+		vector<WayPoint> wp = Mission(count,spacing,TURNS);
+		Track track;
+		track.Load(wp.data(),count);
+		Trajectory trajectory;
+		double t = Now();
+		trajectory.Build(track,1);
+		double tSerial = Now() - t;
+		t = Now();
+		trajectory.Build(track,threads);
+		double tParallel = Now() - t;
+
+		//Speed and acceleration by differencing a fine sweep of positions
+		float duration = trajectory.Duration();
+		float maxSpeed = 0,maxAccel = 0;
+		TrajectoryState before = trajectory.Evaluate(0);
+		float lastEast = before.velocityEast,lastNorth = before.velocityNorth;
+		for(float at=SWEEP;at<=duration;at+=SWEEP)
+		{
+			TrajectoryState now = trajectory.Evaluate(at);
+			float ae = (now.velocityEast - lastEast) / SWEEP;
+			float an = (now.velocityNorth - lastNorth) / SWEEP;
+			maxSpeed = max(maxSpeed,now.speed);
+			maxAccel = max(maxAccel,sqrtf(ae * ae + an * an));
+			lastEast = now.velocityEast;
+			lastNorth = now.velocityNorth;
+		}
+
+		vector<float> times(EVALUATIONS);
+		for(int i=0;i<EVALUATIONS;i++)
+			times[i] = duration * (Next() % 1000000) / 1000000.0f;
+		volatile float sink = 0;
+		t = Now();
+		for(int i=0;i<EVALUATIONS;i++)
+			sink += trajectory.Evaluate(times[i]).heading;
+		double tEvaluate = Now() - t;
+
+		printf("%9d %10.2f %10.2f %7.1fx %10.0f %10.2f %10.2f %12.1f\n",count,tSerial * 1000,tParallel * 1000,tSerial / tParallel,
+			duration,maxSpeed,maxAccel,tEvaluate * 1e9 / EVALUATIONS);
+	}
+
+	//Both followers on the same mission and the same accel limited quad
+	int count = 100;
+	seed = 12345 + count;
+	vector<WayPoint> wp = Mission(count,spacing,TURNS);
+	MissionExecutor mission;
+	mission.Load(wp.data(),count);
+	mission.cruise = TRAJECTORYSPEED;
+	Trajectory trajectory;
+	trajectory.Build(mission.track);
+	Flight executor = Fly([&](const GeoPoint &p) -> const MissionRequest & { return mission.Update(p); },wp[0],TRAJECTORYACCEL);
+	Flight smooth = Fly([&](const GeoPoint &p) -> const MissionRequest & { return trajectory.Update(p,TICK); },wp[0],TRAJECTORYACCEL);
+
+	printf("\n%d waypoints flown by a quad limited to %.1f m/s2\n",count,TRAJECTORYACCEL);
+	printf("%10s %10s %14s %12s\n","follower","seconds","swings > 10deg","max xtrack m");
+	printf("%10s %10.1f %14d %12.2f\n","executor",executor.seconds,executor.swings,executor.maxCross);
+	printf("%10s %10.1f %14d %12.2f\n","trajectory",smooth.seconds,smooth.swings,smooth.maxCross);
+	return 0;
+}
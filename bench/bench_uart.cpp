@@ -0,0 +1,212 @@
+/************************************************
+UART reader benchmark
+
+Feeds a Microstack-like 1 Hz NMEA burst into a
+pseudo-terminal and measures how much CPU the GPS
+reader thread burns and how often it wakes up, and
+how long a fix takes from read() to publish and on
+to a GetFix() caller polling every millisecond.
+
+usage: bench_uart [seconds] [baud] [--spin]
+	--spin also runs the old O_NDELAY read() loop for comparison
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../gps.h"
+#include "../nmea.h"
+using namespace std;
+
+
+int master = -1;
+int seconds = 5;
+int baud = 9600;
+volatile bool writerDone = false;
+
+
+//One epoch the way the Microstack sends it, GGA, GSA, 3x GSV, RMC, VTG
+string MakeBurst(int epoch)
+{
+	NMEAFix fix;
+	fix.lat = 35.0 + epoch * 0.00001;
+	fix.lng = -97.5 - epoch * 0.00001;
+	fix.altMeters = 370.2;
+	fix.speedKnots = 1.3;
+	fix.course = 88.7;
+	fix.utcSeconds = 43200 + epoch;
+
+	string s = NMEAMakeGGA(fix);
+	s += NMEASentence("GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.8,0.9,1.5");
+	s += NMEASentence("GPGSV,3,1,11,04,38,284,42,05,15,039,35,09,29,171,40,12,73,049,44");
+	s += NMEASentence("GPGSV,3,2,11,24,25,304,38,25,55,106,45,29,41,238,41,31,09,090,30");
+	s += NMEASentence("GPGSV,3,3,11,02,05,312,,14,02,150,,21,01,052,");
+	s += NMEAMakeRMC(fix);
+	s += NMEAMakeVTG(fix);
+	return s;
+}
+
+
+//Writes one burst per second, paced like a UART with a 16 byte FIFO
+void *Writer(void *)
+{
+	double usPerByte = 10.0 * 1000000.0 / baud;
+	for(int epoch=0;epoch<seconds;epoch++)
+	{
+		timespec start;
+		clock_gettime(CLOCK_MONOTONIC,&start);
+		string b = MakeBurst(epoch);
+		for(size_t i=0;i<b.length();i+=16)
+		{
+			size_t n = b.length() - i < 16 ? b.length() - i : 16;
+			if(write(master,b.c_str() + i,n) < 0)
+				break;
+			usleep((useconds_t)(usPerByte * n));
+		}
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC,&now);
+		long used = (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+		if(used < 1000000)
+			usleep(1000000 - used);
+	}
+	writerDone = true;
+	return NULL;
+}
+
+
+//A control loop stand-in, notes how old each new fix is when it first sees it
+GPS *consumerGPS = NULL;
+unsigned long consumed = 0;
+double consumedTotal = 0;
+double consumedWorst = 0;
+void *Consumer(void *)
+{
+	uint32_t seen = 0;
+	while(!writerDone)
+	{
+		GPSFix fix = consumerGPS->GetFix();
+		if(fix.sequence != seen)
+		{
+			double l = consumerGPS->GetMonotonicTime() - fix.arrivalTime;
+			seen = fix.sequence;
+			consumed++;
+			consumedTotal += l;
+			if(l > consumedWorst)
+				consumedWorst = l;
+		}
+		usleep(1000);
+	}
+	return NULL;
+}
+
+
+double ThreadCPU(pthread_t t)
+{
+	clockid_t cid;
+	timespec ts;
+	if(pthread_getcpuclockid(t,&cid) != 0 || clock_gettime(cid,&ts) != 0)
+		return 0;
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+//The reader as it was before, O_NDELAY and read() in a tight loop
+unsigned long spinReads = 0;
+unsigned long spinBytes = 0;
+void *SpinReader(void *arg)
+{
+	const char *path = (const char *)arg;
+	int fd = open(path,O_RDWR | O_NOCTTY | O_NDELAY);
+	struct termios options;
+	tcgetattr(fd,&options);
+	options.c_cflag = B9600 | CS8 | CLOCAL | CREAD;
+	options.c_iflag = IGNPAR;
+	options.c_oflag = 0;
+	options.c_lflag = 0;
+	tcsetattr(fd,TCSANOW,&options);
+	unsigned char b[2001];
+	while(!writerDone)
+	{
+		int n = read(fd,b,2000);
+		spinReads++;
+		if(n > 0)
+			spinBytes += n;
+	}
+	close(fd);
+	return NULL;
+}
+
+
+void Report(const char *name,double cpu,unsigned long wakeups,unsigned long bytes)
+{
+	printf("%-8s cpu %6.2f%%  wakeups/s %10.1f  bytes %lu\n",name,100.0 * cpu / seconds,(double)wakeups / seconds,bytes);
+}
+
+
+int main(int argc,char **argv)
+{
+	bool spin = false;
+	int pos = 0;
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"--spin") == 0)
+			spin = true;
+		else if(pos++ == 0)
+			seconds = atoi(argv[i]);
+		else
+			baud = atoi(argv[i]);
+	}
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		cerr << "unable to create pty" << endl;
+		return 1;
+	}
+	string slave = ptsname(master);
+	printf("pty %s, %d s at %d baud\n",slave.c_str(),seconds,baud);
+
+	GPS gps;
+	gps.devicePath = slave;
+	gps.Start();
+	//Let SetupUART finish before the first burst
+	usleep(100000);
+
+	consumerGPS = &gps;
+	pthread_t consumer;
+	pthread_create(&consumer,NULL,Consumer,NULL);
+	pthread_t writer;
+	pthread_create(&writer,NULL,Writer,NULL);
+	pthread_join(writer,NULL);
+	pthread_join(consumer,NULL);
+	usleep(100000);
+
+	double cpu = ThreadCPU(gps.gpsThread);
+	unsigned long wakeups = gps.rxWakeups;
+	unsigned long bytes = gps.rxBytes;
+	gps.Stop();
+	Report("poll",cpu,wakeups,bytes);
+	printf("         sentences %u, checksum failures %u, fixes published %u\n",gps.tinyGPS.passedChecksum(),gps.tinyGPS.failedChecksum(),gps.GetFix().sequence);
+	if(gps.latencyCount && consumed)
+		printf("         read->publish avg %.3f ms worst %.3f ms, read->GetFix avg %.3f ms worst %.3f ms\n",
+			1000 * gps.latencyTotal / gps.latencyCount,1000 * gps.latencyWorst,
+			1000 * consumedTotal / consumed,1000 * consumedWorst);
+
+	if(spin)
+	{
+		writerDone = false;
+		pthread_t reader;
+		pthread_create(&reader,NULL,SpinReader,(void *)slave.c_str());
+		pthread_create(&writer,NULL,Writer,NULL);
+		pthread_join(writer,NULL);
+		double spinCPU = ThreadCPU(reader);
+		pthread_join(reader,NULL);
+		Report("spin",spinCPU,spinReads,spinBytes);
+	}
+
+	close(master);
+	return 0;
+}
@@ -0,0 +1,166 @@
+/************************************************
+UBX vs NMEA decode benchmark
+
+Decode cost per fix of the same trajectory as
+NMEA text through TinyGPSPlus (the GGA/RMC/VTG
+GPS configures, and the receiver's full default
+output) and as UBX NAV-PVT through UBXParser.
+Also checks both decodes give the same fix.
+
+usage: bench_ubx [epochs] [passes]
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../TinyGPS++.h"
+#include "../nmea.h"
+#include "../ubx.h"
+#include "../tools/gpssim.h"
+#include "bench.h"
+using namespace std;
+
+
+//What GetGPS()/GetUBX() pull out of each epoch
+struct Decoded
+{
+	double lat;
+	double lng;
+	double altMeters;
+	double course;
+	double speed;
+};
+
+
+//One chunk per epoch, the way Rx() hands them over at high rate
+struct Stream
+{
+	string bytes;
+	vector<size_t> epochEnd;
+};
+
+
+NMEAFix MakeFix(int e)
+{
+	NMEAFix fix;
+	fix.lat = 35.1 + e * 0.0000013;
+	fix.lng = -97.4 - e * 0.0000021;
+	fix.altMeters = 370 + (e % 100) * 0.1;
+	fix.speedKnots = 3.1 + (e % 7) * 0.2;
+	fix.course = (e * 3) % 360 + 0.5;
+	fix.utcSeconds = 40000 + e * 0.1;
+	return fix;
+}
+
+
+void MakeStreams(int epochs,Stream &nmea,Stream &full,Stream &ubx)
+{
+	for(int e=0;e<epochs;e++)
+	{
+		NMEAFix fix = MakeFix(e);
+		string gga = NMEAMakeGGA(fix);
+		string rmc = NMEAMakeRMC(fix);
+		string vtg = NMEAMakeVTG(fix);
+
+		nmea.bytes += gga + rmc + vtg;
+		nmea.epochEnd.push_back(nmea.bytes.length());
+
+		full.bytes += gga;
+		full.bytes += NMEASentence("GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.8,0.9,1.5");
+		full.bytes += NMEASentence("GPGSV,3,1,11,04,38,284,42,05,15,039,35,09,29,171,40,12,73,049,44");
+		full.bytes += NMEASentence("GPGSV,3,2,11,24,25,304,38,25,55,106,45,29,41,238,41,31,09,090,30");
+		full.bytes += NMEASentence("GPGSV,3,3,11,02,05,312,,14,02,150,,21,01,052,");
+		full.bytes += rmc + vtg;
+		full.epochEnd.push_back(full.bytes.length());
+
+		ubx.bytes += UBXMakeNavPVT(GPSSim::MakeSolution(fix));
+		ubx.epochEnd.push_back(ubx.bytes.length());
+	}
+}
+
+
+double RunNMEA(const Stream &s,vector<Decoded> &out)
+{
+	TinyGPSPlus g;
+	g.subscribe(TINYGPS_TIME | TINYGPS_LOCATION | TINYGPS_ALTITUDE | TINYGPS_COURSE | TINYGPS_SPEED);
+	double t = Now();
+	size_t start = 0;
+	for(size_t e=0;e<s.epochEnd.size();e++)
+	{
+		g.encode(s.bytes.data() + start,s.epochEnd[e] - start);
+		start = s.epochEnd[e];
+		Decoded &d = out[e];
+		d.lat = g.location.lat();
+		d.lng = g.location.lng();
+		d.altMeters = g.altitude.meters();
+		d.course = g.course.deg();
+		d.speed = g.speed.mps();
+	}
+	return Now() - t;
+}
+
+
+double RunUBX(const Stream &s,vector<Decoded> &out)
+{
+	UBXParser p;
+	double t = Now();
+	size_t start = 0;
+	for(size_t e=0;e<s.epochEnd.size();e++)
+	{
+		p.encode((const uint8_t *)s.bytes.data() + start,s.epochEnd[e] - start);
+		start = s.epochEnd[e];
+		const UBXSolution &sol = p.solution;
+		Decoded &d = out[e];
+		d.lat = sol.lat * 1e-7;
+		d.lng = sol.lng * 1e-7;
+		d.altMeters = sol.hMSL / 1000.0;
+		d.course = sol.headMot * 1e-5;
+		d.speed = sol.gSpeed / 1000.0;
+	}
+	return Now() - t;
+}
+
+
+int main(int argc,char **argv)
+{
+	int epochs = argc > 1 ? atoi(argv[1]) : 20000;
+	int passes = argc > 2 ? atoi(argv[2]) : 5;
+
+	Stream nmea,full,ubx;
+	MakeStreams(epochs,nmea,full,ubx);
+	vector<Decoded> a(epochs),b(epochs),c(epochs);
+
+	double tNMEA = 1e9,tFull = 1e9,tUBX = 1e9;
+	for(int p=0;p<passes;p++)
+	{
+		tNMEA = min(tNMEA,RunNMEA(nmea,a));
+		tFull = min(tFull,RunNMEA(full,b));
+		tUBX = min(tUBX,RunUBX(ubx,c));
+	}
+
+	//NMEA rounds to 1e-6 minutes and 0.1 m, UBX to 1e-7 degrees and 1 mm
+	int mismatches = 0;
+	for(int e=0;e<epochs;e++)
+	{
+		if(fabs(a[e].lat - c[e].lat) > 1e-6 || fabs(a[e].lng - c[e].lng) > 1e-6 ||
+			fabs(a[e].altMeters - c[e].altMeters) > 0.06 || fabs(a[e].course - c[e].course) > 0.01 ||
+			fabs(a[e].speed - c[e].speed) > 0.01)
+		{
+			if(mismatches++ < 3)
+				printf("epoch %d: nmea %.7f %.7f %.2f %.2f %.3f  ubx %.7f %.7f %.2f %.2f %.3f\n",e,
+					a[e].lat,a[e].lng,a[e].altMeters,a[e].course,a[e].speed,
+					c[e].lat,c[e].lng,c[e].altMeters,c[e].course,c[e].speed);
+		}
+	}
+
+	printf("%d epochs, best of %d\n",epochs,passes);
+	printf("%-18s %10s %10s %10s\n","","bytes/fix","ns/fix","vs ubx");
+	printf("%-18s %10.1f %10.1f %9.1fx\n","nmea gga/rmc/vtg",(double)nmea.bytes.length() / epochs,tNMEA * 1e9 / epochs,tNMEA / tUBX);
+	printf("%-18s %10.1f %10.1f %9.1fx\n","nmea full",(double)full.bytes.length() / epochs,tFull * 1e9 / epochs,tFull / tUBX);
+	printf("%-18s %10.1f %10.1f %9.1fx\n","ubx nav-pvt",(double)ubx.bytes.length() / epochs,tUBX * 1e9 / epochs,1.0);
+	printf("mismatches %d\n",mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,32 @@
+#include "controlbyte.h"
+
+
+int MakeControlByte(int forward,int reverse,int left,int right,int climb,int dive,int rright,int rleft)
+{
+	int cb = 0;
+	if(forward)
+		cb |= CONTROLFORWARD;
+	if(reverse)
+		cb |= CONTROLREVERSE;
+	if(left)
+		cb |= CONTROLLEFT;
+	if(right)
+		cb |= CONTROLRIGHT;
+	if(climb)
+		cb |= CONTROLCLIMB;
+	if(dive)
+		cb |= CONTROLDIVE;
+	if(rright)
+		cb |= CONTROLROTATERIGHT;
+	if(rleft)
+		cb |= CONTROLROTATELEFT;
+	return cb | (cb >> 8) % 17;
+}
+
+
+int RotateControlByte(int cb,int rotate)
+{
+	cb &= ~(CONTROLROTATERIGHT | CONTROLROTATELEFT | CONTROLCHECKSUM);
+	cb |= rotate & (CONTROLROTATERIGHT | CONTROLROTATELEFT);
+	return cb | (cb >> 8) % 17;
+}
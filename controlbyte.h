@@ -0,0 +1,29 @@
+/************************************************
+Control byte - what the control switch is told
+
+Eight motion bits above an 8 bit checksum, the
+bits mod 17, sent to the control switch with
+SendControlByte().  The motion bits are relative
+to the quad's orientation and move it at the
+control switch's default speed.
+
+***********************************************/
+#ifndef __ControlByte_h
+#define __ControlByte_h
+
+#define CONTROLFORWARD		0x8000
+#define CONTROLREVERSE		0x4000
+#define CONTROLLEFT		0x2000
+#define CONTROLRIGHT		0x1000
+#define CONTROLCLIMB		0x0800
+#define CONTROLDIVE		0x0400
+#define CONTROLROTATERIGHT	0x0200
+#define CONTROLROTATELEFT	0x0100
+#define CONTROLCHECKSUM		0x00ff
+
+//Nonzero arguments set their bit
+int MakeControlByte(int forward,int reverse,int left,int right,int climb,int dive,int rright,int rleft);
+//cb with its rotate bits replaced by rotate's and its checksum made again
+int RotateControlByte(int cb,int rotate);
+
+#endif // def(__ControlByte_h)
@@ -0,0 +1,224 @@
+#include "declination.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+//WGS84 and the model's reference radius, km
+#define WMMA			6378.137
+#define WMMB			6356.7523142
+#define WMMRE			6371.2
+
+
+MagneticModel::MagneticModel()
+{
+	loaded = false;
+	epoch = 0;
+	name[0] = 0;
+	memset(g,0,sizeof(g));
+	memset(h,0,sizeof(h));
+	memset(gDot,0,sizeof(gDot));
+	memset(hDot,0,sizeof(hDot));
+	memset(k,0,sizeof(k));
+}
+
+
+bool MagneticModel::Loaded() const
+{
+	return loaded;
+}
+
+
+bool MagneticModel::Load(const char *path)
+{
+	loaded = false;
+	FILE *f = fopen(path,"r");
+	if(f == NULL)
+		return false;
+
+	//"    2020.0            WMM-2020        12/10/2019" then "n m g h gDot hDot" lines until the 9s
+	char line[256];
+	if(fgets(line,sizeof(line),f) == NULL || sscanf(line,"%lf %31s",&epoch,name) < 1)
+	{
+		fclose(f);
+		return false;
+	}
+	memset(g,0,sizeof(g));
+	memset(h,0,sizeof(h));
+	memset(gDot,0,sizeof(gDot));
+	memset(hDot,0,sizeof(hDot));
+	int terms = 0;
+	while(fgets(line,sizeof(line),f) != NULL && strncmp(line,"9999",4) != 0)
+	{
+		int n,m;
+		double gnm,hnm,gd,hd;
+		if(sscanf(line,"%d %d %lf %lf %lf %lf",&n,&m,&gnm,&hnm,&gd,&hd) != 6 || n < 1 || n > WMMMAXDEGREE || m < 0 || m > n)
+			continue;
+		g[n][m] = gnm;
+		h[n][m] = hnm;
+		gDot[n][m] = gd;
+		hDot[n][m] = hd;
+		terms++;
+	}
+	fclose(f);
+	if(terms == 0)
+		return false;
+
+	//Schmidt semi-normalization folded into the coefficients, so evaluation uses plain Legendre functions
+	double s[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];
+	s[0][0] = 1;
+	for(int n=1;n<=WMMMAXDEGREE;n++)
+	{
+		s[n][0] = s[n - 1][0] * (2 * n - 1) / n;
+		for(int m=1;m<=n;m++)
+			s[n][m] = s[n][m - 1] * sqrt((double)(n - m + 1) * (m == 1 ? 2 : 1) / (n + m));
+		for(int m=0;m<=n;m++)
+		{
+			g[n][m] *= s[n][m];
+			h[n][m] *= s[n][m];
+			gDot[n][m] *= s[n][m];
+			hDot[n][m] *= s[n][m];
+			k[n][m] = n > 1 ? (double)((n - 1) * (n - 1) - m * m) / ((2 * n - 1) * (2 * n - 3)) : 0;
+		}
+	}
+	loaded = true;
+	return true;
+}
+
+
+MagneticField MagneticModel::Evaluate(double lat,double lng,double altKm,double year) const
+{
+	MagneticField field = { 0, 0, 0 };
+	if(!loaded)
+		return field;
+	double dt = year - epoch;
+	double sinLat = sin(lat / GEODEGREES),cosLat = cos(lat / GEODEGREES);
+	double sinLat2 = sinLat * sinLat,cosLat2 = cosLat * cosLat;
+
+	//Geodetic to geocentric: ct and st are the cos and sin of the colatitude, ca and sa rotate the result back
+	double a2 = WMMA * WMMA,b2 = WMMB * WMMB,c2 = a2 - b2;
+	double a4 = a2 * a2,c4 = c2 * c2;
+	double q = sqrt(a2 - c2 * sinLat2);
+	double q1 = altKm * q;
+	double q2 = ((q1 + a2) / (q1 + b2)) * ((q1 + a2) / (q1 + b2));
+	double ct = sinLat / sqrt(q2 * cosLat2 + sinLat2);
+	double st = sqrt(1 - ct * ct);
+	double r = sqrt(altKm * altKm + 2 * q1 + (a4 - c4 * sinLat2) / (q * q));
+	double d = sqrt(a2 * cosLat2 + b2 * sinLat2);
+	double ca = (altKm + d) / r;
+	double sa = c2 * cosLat * sinLat / (r * d);
+
+	double sp[WMMMAXDEGREE + 1],cp[WMMMAXDEGREE + 1];
+	sp[0] = 0;
+	cp[0] = 1;
+	sp[1] = sin(lng / GEODEGREES);
+	cp[1] = cos(lng / GEODEGREES);
+	for(int m=2;m<=WMMMAXDEGREE;m++)
+	{
+		sp[m] = sp[1] * cp[m - 1] + cp[1] * sp[m - 1];
+		cp[m] = cp[1] * cp[m - 1] - sp[1] * sp[m - 1];
+	}
+
+	double p[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1],dp[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];
+	double pp[WMMMAXDEGREE + 1];	//Only for m = 1 at a pole
+	p[0][0] = 1;
+	dp[0][0] = 0;
+	pp[0] = 1;
+	double aor = WMMRE / r;
+	double ar = aor * aor;
+	double br = 0,bt = 0,bp = 0,bpp = 0;
+	for(int n=1;n<=WMMMAXDEGREE;n++)
+	{
+		ar *= aor;
+		for(int m=0;m<=n;m++)
+		{
+			if(n == m)
+			{
+				p[n][m] = st * p[n - 1][m - 1];
+				dp[n][m] = st * dp[n - 1][m - 1] + ct * p[n - 1][m - 1];
+			}
+			else
+			{
+				double p2 = m > n - 2 ? 0 : p[n - 2][m];
+				double dp2 = m > n - 2 ? 0 : dp[n - 2][m];
+				p[n][m] = ct * p[n - 1][m] - k[n][m] * p2;
+				dp[n][m] = ct * dp[n - 1][m] - st * p[n - 1][m] - k[n][m] * dp2;
+			}
+
+			double tg = g[n][m] + dt * gDot[n][m];
+			double th = h[n][m] + dt * hDot[n][m];
+			double temp1 = tg * cp[m] + th * sp[m];
+			double temp2 = tg * sp[m] - th * cp[m];
+			bt -= ar * temp1 * dp[n][m];
+			bp += m * temp2 * ar * p[n][m];
+			br += (n + 1) * temp1 * ar * p[n][m];
+			if(st == 0 && m == 1)
+			{
+				pp[n] = n == 1 ? pp[0] : ct * pp[n - 1] - k[n][m] * pp[n - 2];
+				bpp += m * temp2 * ar * pp[n];
+			}
+		}
+	}
+	bp = st == 0 ? bpp : bp / st;
+
+	//North, east and down in the geodetic frame
+	double bx = -bt * ca - br * sa;
+	double by = bp;
+	double bz = bt * sa - br * ca;
+	double bh = sqrt(bx * bx + by * by);
+	field.declination = atan2(by,bx) * GEODEGREES;
+	field.inclination = atan2(bz,bh) * GEODEGREES;
+	field.intensity = sqrt(bh * bh + bz * bz);
+	return field;
+}
+
+
+DeclinationGrid::DeclinationGrid()
+{
+	built = false;
+	south = west = 0;
+	spacing = DECLINATIONSPACING;
+}
+
+
+bool DeclinationGrid::Built() const
+{
+	return built;
+}
+
+
+void DeclinationGrid::Build(const MagneticModel &model,double lat,double lng,double altKm,double year)
+{
+	double half = spacing * (DECLINATIONNODES - 1) / 2;
+	south = lat - half;
+	west = lng - half;
+	for(int row=0;row<DECLINATIONNODES;row++)
+		for(int col=0;col<DECLINATIONNODES;col++)
+		{
+			MagneticField f = model.Evaluate(south + row * spacing,west + col * spacing,altKm,year);
+			declination[row * DECLINATIONNODES + col] = f.declination / GEODEGREES;
+			inclination[row * DECLINATIONNODES + col] = f.inclination;
+		}
+	built = true;
+}
+
+
+bool DeclinationGrid::Lookup(double lat,double lng,float &dec,float &inc) const
+{
+	if(!built)
+		return false;
+	float y = (lat - south) / spacing;
+	float x = (lng - west) / spacing;
+	if(!(x >= 0 && y >= 0 && x <= DECLINATIONNODES - 1 && y <= DECLINATIONNODES - 1))
+		return false;
+	int col = x >= DECLINATIONNODES - 1 ? DECLINATIONNODES - 2 : (int)x;
+	int row = y >= DECLINATIONNODES - 1 ? DECLINATIONNODES - 2 : (int)y;
+	float fx = x - col,fy = y - row;
+	int i = row * DECLINATIONNODES + col;
+	float s = declination[i] + fx * (declination[i + 1] - declination[i]);
+	float n = declination[i + DECLINATIONNODES] + fx * (declination[i + DECLINATIONNODES + 1] - declination[i + DECLINATIONNODES]);
+	dec = s + fy * (n - s);
+	s = inclination[i] + fx * (inclination[i + 1] - inclination[i]);
+	n = inclination[i + DECLINATIONNODES] + fx * (inclination[i + DECLINATIONNODES + 1] - inclination[i + DECLINATIONNODES]);
+	inc = s + fy * (n - s);
+	return true;
+}
@@ -0,0 +1,87 @@
+/************************************************
+Declination - magnetic declination where we fly
+
+MagneticModel evaluates the World Magnetic Model
+spherical harmonics (degree 12) from its WMM.COF
+coefficient file, as NOAA distributes it.  That is
+a few thousand multiplies, too much for every
+magnetometer read, so DeclinationGrid samples it
+once over the mission area and every lookup after
+is a bilinear blend of the four nodes around the
+fix.  Away from the magnetic poles declination
+changes by well under a tenth of a degree between
+nodes, the blend is far closer than the
+magnetometer.
+
+When the quad leaves the area the grid is built
+again around it.  Without a coefficient file the
+heading keeps the fixed HEADINGDECLINATION.
+
+***********************************************/
+#ifndef __Declination_h
+#define __Declination_h
+
+#include "geo.h"
+
+#define WMMMAXDEGREE		12
+#define WMMVALIDYEARS		5	//A model is good this long after its epoch
+#define DECLINATIONSPACING	0.125	//Degrees between grid nodes
+#define DECLINATIONNODES	9	//Nodes a side, 1 degree square
+
+
+struct MagneticField
+{
+	double declination;	//Degrees, east of true north is positive
+	double inclination;	//Degrees, down is positive
+	double intensity;	//Nanotesla
+};
+
+
+class MagneticModel
+{
+	public:
+		MagneticModel();
+
+		//WMM.COF format.  False if the file is missing or short.
+		bool Load(const char *path);
+		bool Loaded() const;
+
+		//Geodetic degrees, km above the WGS84 ellipsoid, decimal year
+		MagneticField Evaluate(double lat,double lng,double altKm,double year) const;
+
+		double epoch;
+		char name[32];
+
+	private:
+		bool loaded;
+		//Schmidt normalized at load, [n][m]
+		double g[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];
+		double h[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];
+		double gDot[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];
+		double hDot[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];
+		double k[WMMMAXDEGREE + 1][WMMMAXDEGREE + 1];	//Legendre recursion constants
+};
+
+
+class DeclinationGrid
+{
+	public:
+		DeclinationGrid();
+
+		//Samples model around lat,lng.  The year and altitude are fixed for the grid.
+		void Build(const MagneticModel &model,double lat,double lng,double altKm,double year);
+		bool Built() const;
+
+		//Declination in radians as the heading adds it, inclination in degrees.  False outside the grid.
+		bool Lookup(double lat,double lng,float &declination,float &inclination) const;
+
+		double south,west;	//Corner node
+		double spacing;
+
+	private:
+		bool built;
+		float declination[DECLINATIONNODES * DECLINATIONNODES];	//Radians, row by row from the south
+		float inclination[DECLINATIONNODES * DECLINATIONNODES];	//Degrees
+};
+
+#endif // def(__Declination_h)
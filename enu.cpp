@@ -0,0 +1,123 @@
+#include "enu.h"
+
+
+ENUFrame::ENUFrame()
+{
+	origin.lat = 0;
+	origin.lng = 0;
+	originUp = 0;
+	vehicle.east = 0;
+	vehicle.north = 0;
+	vehicle.up = 0;
+	haveOrigin = false;
+	rebases = 0;
+	eastScale = GEOMMPERNANOQ32;
+}
+
+
+//Moves the frame to p and projects every waypoint again
+void ENUFrame::SetOrigin(const GeoPoint &p,int64_t upMM)
+{
+	origin = p;
+	originUp = upMM;
+	eastScale = GeoMulShift(GEOMMPERNANOQ32,GeoCos(p.lat),GEOQ);
+	haveOrigin = true;
+	for(size_t i=0;i<points.size();i++)
+		points[i] = ToENU(geo[i],geoUp[i]);
+}
+
+
+ENUPoint ENUFrame::ToENU(const GeoPoint &p,int64_t upMM) const
+{
+	int64_t dLng = p.lng - origin.lng;
+	if(dLng > 180 * GEONANO)
+		dLng -= 360 * GEONANO;
+	else if(dLng < -180 * GEONANO)
+		dLng += 360 * GEONANO;
+
+	ENUPoint e;
+	e.east = GeoMulShift(dLng,eastScale,32);
+	e.north = GeoMulShift(p.lat - origin.lat,GEOMMPERNANOQ32,32);
+	e.up = upMM - originUp;
+	return e;
+}
+
+
+int ENUFrame::Add(const GeoPoint &p,int64_t upMM)
+{
+	//The first waypoint is the mission origin until the vehicle drags it away
+	if(!haveOrigin)
+		SetOrigin(p,upMM);
+	geo.push_back(p);
+	geoUp.push_back(upMM);
+	points.push_back(ToENU(p,upMM));
+	return (int)points.size() - 1;
+}
+
+
+void ENUFrame::Clear()
+{
+	geo.clear();
+	geoUp.clear();
+	points.clear();
+	haveOrigin = false;
+}
+
+
+int ENUFrame::Count() const
+{
+	return (int)points.size();
+}
+
+
+const ENUPoint &ENUFrame::Point(int i) const
+{
+	return points[i];
+}
+
+
+bool ENUFrame::Update(const GeoPoint &p,int64_t upMM)
+{
+	bool rebased = false;
+	if(!haveOrigin)
+	{
+		SetOrigin(p,upMM);
+		rebased = true;
+	}
+	vehicle = ToENU(p,upMM);
+
+	//Chebyshev is enough to decide, and needs no square root
+	int64_t e = vehicle.east < 0 ? -vehicle.east : vehicle.east;
+	int64_t n = vehicle.north < 0 ? -vehicle.north : vehicle.north;
+	if(e > ENUREBASEMM || n > ENUREBASEMM)
+	{
+		SetOrigin(p,originUp);
+		vehicle = ToENU(p,upMM);
+		rebases++;
+		rebased = true;
+	}
+	return rebased;
+}
+
+
+int64_t ENUFrame::DistanceTo(int i) const
+{
+	return GeoLength(points[i].north - vehicle.north,points[i].east - vehicle.east);
+}
+
+
+int64_t ENUFrame::BearingTo(int i) const
+{
+	return GeoAngle(points[i].north - vehicle.north,points[i].east - vehicle.east);
+}
+
+
+bool ENUFrame::Reached(int i,int64_t deadbandMM) const
+{
+	//Squared, legs long enough to overflow are nowhere near the deadband anyway
+	int64_t e = points[i].east - vehicle.east;
+	int64_t n = points[i].north - vehicle.north;
+	if(e > ENUREBASEMM * 4 || e < -ENUREBASEMM * 4 || n > ENUREBASEMM * 4 || n < -ENUREBASEMM * 4)
+		return false;
+	return e * e + n * n <= deadbandMM * deadbandMM;
+}
@@ -0,0 +1,69 @@
+/************************************************
+Mission ENU frame
+
+East/north/up millimetres from a mission origin.
+Waypoints are projected once when they are added,
+the vehicle once per fix, and after that distance,
+bearing and the reached test are integer vector
+arithmetic with no trig or table lookups.
+
+The projection is flat earth with the cos of the
+origin latitude, so it is re-based on the vehicle
+whenever it flies more than ENUREBASEMM away.
+
+***********************************************/
+#ifndef __ENU_h
+#define __ENU_h
+
+#include <vector>
+#include "geo.h"
+using namespace std;
+
+//Millimetres from the origin before the frame moves, keeps the scale error under 0.01%
+#define ENUREBASEMM		(1000 * 1000LL)
+#define FEETTOMM		304.8
+
+struct ENUPoint
+{
+	int64_t east;
+	int64_t north;
+	int64_t up;
+};
+
+
+class ENUFrame
+{
+	public:
+		ENUFrame();
+
+		void SetOrigin(const GeoPoint &p,int64_t upMM);
+		ENUPoint ToENU(const GeoPoint &p,int64_t upMM) const;
+
+		//Waypoints, kept in both forms so a re-base can project them again
+		int Add(const GeoPoint &p,int64_t upMM);
+		void Clear();
+		int Count() const;
+		const ENUPoint &Point(int i) const;
+
+		//Projects the vehicle, re-basing first if it is too far out.  True if it re-based.
+		bool Update(const GeoPoint &p,int64_t upMM);
+
+		//From the vehicle to waypoint i, horizontal only
+		int64_t DistanceTo(int i) const;
+		int64_t BearingTo(int i) const;
+		bool Reached(int i,int64_t deadbandMM) const;
+
+		GeoPoint origin;
+		int64_t originUp;
+		ENUPoint vehicle;
+		bool haveOrigin;
+		unsigned long rebases;
+
+	private:
+		int64_t eastScale;	//Millimetres per nanodegree of longitude at the origin, Q32
+		vector<GeoPoint> geo;
+		vector<int64_t> geoUp;
+		vector<ENUPoint> points;
+};
+
+#endif // def(__ENU_h)
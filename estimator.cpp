@@ -0,0 +1,328 @@
+#include "estimator.h"
+#include "gps.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+//Covariance terms that decay at a long hover are zeroed before they turn denormal, which is slow
+#define EKFTINY			1e-20f
+
+
+//-pi..pi, 180 degrees is 180 / GEODEGREES radians
+static float WrapAngle(float a)
+{
+	while(a > 180 / GEODEGREES)
+		a -= 360 / GEODEGREES;
+	while(a < -180 / GEODEGREES)
+		a += 360 / GEODEGREES;
+	return a;
+}
+
+
+EstimatorSample EstimatorBlend::operator()(const EstimatorSample &a,const EstimatorSample &b,double f) const
+{
+	EstimatorSample r;
+	for(int i=0;i<EKFSTATES;i++)
+		r.x[i] = a.x[i] + (b.x[i] - a.x[i]) * (float)f;
+	r.x[EKFHEADING] = a.x[EKFHEADING] + WrapAngle(b.x[EKFHEADING] - a.x[EKFHEADING]) * (float)f;
+	return r;
+}
+
+
+StateEstimator::StateEstimator()
+{
+	forwardSpeed = EKFFORWARDSPEED;
+	climbRate = EKFCLIMBRATE;
+	yawRate = EKFYAWRATE / GEODEGREES;
+	Reset();
+}
+
+
+//Nothing known until the first fix, except that the quad is not moving fast
+void StateEstimator::Reset()
+{
+	memset(x,0,sizeof(x));
+	memset(P,0,sizeof(P));
+	P[EKFEAST][EKFEAST] = P[EKFNORTH][EKFNORTH] = P[EKFUP][EKFUP] = 1e6f;
+	P[EKFVEAST][EKFVEAST] = P[EKFVNORTH][EKFVNORTH] = P[EKFVUP][EKFVUP] = forwardSpeed * forwardSpeed;
+	P[EKFHEADING][EKFHEADING] = (180 / GEODEGREES) * (180 / GEODEGREES);
+	P[EKFWINDEAST][EKFWINDEAST] = P[EKFWINDNORTH][EKFWINDNORTH] = EKFWINDSTART * EKFWINDSTART;
+	frame = ENUFrame();
+	fixes = 0;
+	rejected = 0;
+	late = 0;
+	clock = 0;
+	memset(shift,0,sizeof(shift));
+	history.Clear();
+}
+
+
+bool StateEstimator::Started() const
+{
+	return fixes > 0;
+}
+
+
+void StateEstimator::Predict(float seconds,int controlByte)
+{
+	if(seconds <= 0)
+		return;
+	float dt = seconds;
+	float forward = ((controlByte & CONTROLFORWARD) != 0) - ((controlByte & CONTROLREVERSE) != 0);
+	float right = ((controlByte & CONTROLRIGHT) != 0) - ((controlByte & CONTROLLEFT) != 0);
+	float climb = ((controlByte & CONTROLCLIMB) != 0) - ((controlByte & CONTROLDIVE) != 0);
+	float rotate = ((controlByte & CONTROLROTATERIGHT) != 0) - ((controlByte & CONTROLROTATELEFT) != 0);
+
+	//Commanded velocity, forward along the heading and right 90 degrees clockwise of it, plus the wind
+	float s = sinf(x[EKFHEADING]),c = cosf(x[EKFHEADING]);
+	float wantEast = forwardSpeed * (forward * s + right * c) + x[EKFWINDEAST];
+	float wantNorth = forwardSpeed * (forward * c - right * s) + x[EKFWINDNORTH];
+	float wantUp = climbRate * climb;
+	float a = min(dt / EKFRESPONSE,1.0f);
+
+	x[EKFEAST] += x[EKFVEAST] * dt;
+	x[EKFNORTH] += x[EKFVNORTH] * dt;
+	x[EKFUP] += x[EKFVUP] * dt;
+	x[EKFVEAST] += a * (wantEast - x[EKFVEAST]);
+	x[EKFVNORTH] += a * (wantNorth - x[EKFVNORTH]);
+	x[EKFVUP] += a * (wantUp - x[EKFVUP]);
+	for(int i=EKFVEAST;i<=EKFVUP;i++)
+		if(fabsf(x[i]) < EKFTINY)
+			x[i] = 0;
+	x[EKFHEADING] = WrapAngle(x[EKFHEADING] + yawRate * rotate * dt);
+	if(x[EKFHEADING] < 0)
+		x[EKFHEADING] += 360 / GEODEGREES;
+
+	//Jacobian, at most three terms a row so it is kept as lists of them
+	int terms[EKFSTATES];
+	int column[EKFSTATES][3];
+	float F[EKFSTATES][3];
+	for(int i=0;i<EKFSTATES;i++)
+	{
+		terms[i] = 1;
+		column[i][0] = i;
+		F[i][0] = 1;
+	}
+	for(int i=0;i<3;i++)
+	{
+		column[EKFEAST + i][1] = EKFVEAST + i;
+		F[EKFEAST + i][1] = dt;
+		terms[EKFEAST + i] = 2;
+		F[EKFVEAST + i][0] = 1 - a;
+	}
+	column[EKFVEAST][1] = EKFHEADING;
+	F[EKFVEAST][1] = a * forwardSpeed * (forward * c - right * s);
+	column[EKFVEAST][2] = EKFWINDEAST;
+	F[EKFVEAST][2] = a;
+	column[EKFVNORTH][1] = EKFHEADING;
+	F[EKFVNORTH][1] = -a * forwardSpeed * (forward * s + right * c);
+	column[EKFVNORTH][2] = EKFWINDNORTH;
+	F[EKFVNORTH][2] = a;
+	terms[EKFVEAST] = terms[EKFVNORTH] = 3;
+
+	//P = F P F' + Q
+	float FP[EKFSTATES][EKFSTATES];
+	for(int i=0;i<EKFSTATES;i++)
+		for(int j=0;j<EKFSTATES;j++)
+		{
+			float sum = 0;
+			for(int k=0;k<terms[i];k++)
+				sum += F[i][k] * P[column[i][k]][j];
+			FP[i][j] = sum;
+		}
+	for(int i=0;i<EKFSTATES;i++)
+		for(int j=i;j<EKFSTATES;j++)
+		{
+			float sum = 0;
+			for(int k=0;k<terms[j];k++)
+				sum += FP[i][column[j][k]] * F[j][k];
+			if(fabsf(sum) < EKFTINY)
+				sum = 0;
+			P[i][j] = P[j][i] = sum;
+		}
+
+	//Acceleration noise integrated into velocity and position
+	float q = EKFACCELNOISE * EKFACCELNOISE;
+	for(int i=0;i<3;i++)
+	{
+		P[EKFEAST + i][EKFEAST + i] += q * dt * dt * dt / 3;
+		P[EKFEAST + i][EKFVEAST + i] += q * dt * dt / 2;
+		P[EKFVEAST + i][EKFEAST + i] += q * dt * dt / 2;
+		P[EKFVEAST + i][EKFVEAST + i] += q * dt;
+	}
+	float yawNoise = EKFYAWNOISE / GEODEGREES;
+	P[EKFHEADING][EKFHEADING] += yawNoise * yawNoise * dt;
+	P[EKFWINDEAST][EKFWINDEAST] += EKFWINDNOISE * EKFWINDNOISE * dt;
+	P[EKFWINDNORTH][EKFWINDNORTH] += EKFWINDNOISE * EKFWINDNOISE * dt;
+
+	clock += dt;
+	EstimatorSample sample;
+	for(int i=0;i<EKFSTATES;i++)
+		sample.x[i] = x[i] - shift[i];
+	history.Add(clock,sample);
+}
+
+
+//Moves the state and everything in the history with it
+void StateEstimator::Shift(int state,float delta)
+{
+	x[state] += delta;
+	shift[state] += delta;
+	if(state == EKFHEADING)
+	{
+		x[EKFHEADING] = WrapAngle(x[EKFHEADING]);
+		if(x[EKFHEADING] < 0)
+			x[EKFHEADING] += 360 / GEODEGREES;
+		shift[EKFHEADING] = WrapAngle(shift[EKFHEADING]);
+	}
+}
+
+
+bool StateEstimator::StateAt(float age,EstimatorSample &sample) const
+{
+	if(age <= 0 || history.Count() == 0)
+	{
+		memcpy(sample.x,x,sizeof(x));
+		return true;
+	}
+	bool inside = history.At(clock - age,sample);
+	for(int i=0;i<EKFSTATES;i++)
+		sample.x[i] += shift[i];
+	sample.x[EKFHEADING] = WrapAngle(sample.x[EKFHEADING]);
+	if(sample.x[EKFHEADING] < 0)
+		sample.x[EKFHEADING] += 360 / GEODEGREES;
+	return inside;
+}
+
+
+//Measures state directly, then is the state when it was measured and moves with the correction so the
+//next measurement of the same time sees it.  False if the gate threw it away.
+bool StateEstimator::Correct(int state,EstimatorSample &then,float measured,float variance)
+{
+	float innovation = measured - then.x[state];
+	if(state == EKFHEADING)
+		innovation = WrapAngle(innovation);
+	float S = P[state][state] + variance;
+	if(innovation * innovation > EKFGATE * EKFGATE * S)
+	{
+		rejected++;
+		return false;
+	}
+	float K[EKFSTATES],row[EKFSTATES];
+	for(int i=0;i<EKFSTATES;i++)
+	{
+		K[i] = P[i][state] / S;
+		row[i] = P[state][i];
+	}
+	for(int i=0;i<EKFSTATES;i++)
+	{
+		Shift(i,K[i] * innovation);
+		then.x[i] += K[i] * innovation;
+		for(int j=0;j<EKFSTATES;j++)
+			P[i][j] -= K[i] * row[j];
+	}
+	return true;
+}
+
+
+//Moves the origin to p, the state moves with it
+void StateEstimator::Rebase(const GeoPoint &p)
+{
+	ENUPoint o = frame.ToENU(p,0);
+	frame.SetOrigin(p,0);
+	Shift(EKFEAST,-o.east / 1000.0f);
+	Shift(EKFNORTH,-o.north / 1000.0f);
+}
+
+
+void StateEstimator::UpdateGPS(const GPSFix &fix,float age)
+{
+	EstimatorSample then;
+	if(!StateAt(age,then))
+		late++;
+	if(fix.fields & GPSFIX_POSITION)
+	{
+		if(!frame.haveOrigin)
+		{
+			//The first fix is taken as it is.  What Predict() built up about position without one is
+			//dropped too, its covariance with velocity and wind would leave P indefinite.
+			for(int i=EKFEAST;i<=EKFUP;i++)
+				for(int j=0;j<EKFSTATES;j++)
+					P[i][j] = P[j][i] = 0;
+			frame.SetOrigin(fix.position,0);
+			Shift(EKFEAST,-x[EKFEAST]);
+			Shift(EKFNORTH,-x[EKFNORTH]);
+			P[EKFEAST][EKFEAST] = P[EKFNORTH][EKFNORTH] = EKFGPSPOSITION * EKFGPSPOSITION;
+			Shift(EKFUP,fix.alt * FEETTOMM / 1000 - x[EKFUP]);
+			P[EKFUP][EKFUP] = EKFGPSALTITUDE * EKFGPSALTITUDE;
+		}
+		else
+		{
+			if(fabsf(x[EKFEAST]) * 1000 > ENUREBASEMM || fabsf(x[EKFNORTH]) * 1000 > ENUREBASEMM)
+			{
+				Rebase(fix.position);
+				StateAt(age,then);
+			}
+			ENUPoint p = frame.ToENU(fix.position,0);
+			Correct(EKFEAST,then,p.east / 1000.0f,EKFGPSPOSITION * EKFGPSPOSITION);
+			Correct(EKFNORTH,then,p.north / 1000.0f,EKFGPSPOSITION * EKFGPSPOSITION);
+			if(fix.fields & GPSFIX_ALTITUDE)
+				Correct(EKFUP,then,fix.alt * FEETTOMM / 1000,EKFGPSALTITUDE * EKFGPSALTITUDE);
+		}
+		fixes++;
+	}
+
+	//Course and speed are the velocity, which through the motion model says which way the quad faces
+	if(frame.haveOrigin && (fix.fields & (GPSFIX_COURSE | GPSFIX_SPEED)) == (GPSFIX_COURSE | GPSFIX_SPEED))
+	{
+		float course = fix.course / GEODEGREES;
+		Correct(EKFVEAST,then,fix.speed * sinf(course),EKFGPSVELOCITY * EKFGPSVELOCITY);
+		Correct(EKFVNORTH,then,fix.speed * cosf(course),EKFGPSVELOCITY * EKFGPSVELOCITY);
+	}
+}
+
+
+void StateEstimator::UpdateHeading(float degrees,float age)
+{
+	EstimatorSample then;
+	if(!StateAt(age,then))
+		late++;
+	float sigma = EKFMAGHEADING / GEODEGREES;
+	Correct(EKFHEADING,then,degrees / GEODEGREES,sigma * sigma);
+}
+
+
+void StateEstimator::Publish(double timeStamp)
+{
+	EstimatorState s;
+	s.lat = s.lng = 0;
+	if(frame.haveOrigin)
+	{
+		GeoPoint p = GeoOffset(frame.origin,(int64_t)(x[EKFNORTH] * 1000),(int64_t)(x[EKFEAST] * 1000));
+		s.lat = GeoToDegrees(p.lat);
+		s.lng = GeoToDegrees(p.lng);
+	}
+	s.east = x[EKFEAST];
+	s.north = x[EKFNORTH];
+	s.up = x[EKFUP];
+	s.velocityEast = x[EKFVEAST];
+	s.velocityNorth = x[EKFVNORTH];
+	s.velocityUp = x[EKFVUP];
+	s.heading = x[EKFHEADING] * GEODEGREES;
+	s.positionSigma = sqrtf(P[EKFEAST][EKFEAST] + P[EKFNORTH][EKFNORTH]);
+	s.headingSigma = sqrtf(P[EKFHEADING][EKFHEADING]) * GEODEGREES;
+	s.windEast = x[EKFWINDEAST];
+	s.windNorth = x[EKFWINDNORTH];
+	s.timeStamp = timeStamp;
+	s.fixes = fixes;
+	published.Write(s);
+}
+
+
+EstimatorState StateEstimator::Get() const
+{
+	EstimatorState s;
+	published.Read(s);
+	return s;
+}
@@ -0,0 +1,158 @@
+/************************************************
+Estimator - position, velocity and heading between fixes
+
+An extended Kalman filter over nine states: east
+and north in meters from the first fix, up as the
+fix altitude in meters, their velocities, the
+heading and the wind.  Predict() runs every pass
+of the control loop with the control byte that
+went out.  The forward, sideways and climb bits ask
+for a velocity along the heading the quad is
+believed to have, which it reaches over
+EKFRESPONSE seconds, and the rotate bits turn it at
+EKFYAWRATE.  The wind is whatever steady drift the
+commands do not explain.  That velocity depends on
+the heading, so the heading is learned from the
+GPS velocity as well as from the magnetometer.
+
+Each GPS fix and magnetometer read is an update of
+single states (position, the velocity from course
+and speed, heading) so the corrections are scalar,
+no matrix is inverted.  Everything is fixed size,
+nothing is allocated after construction.
+
+Fixes arrive late, the receiver solves the epoch
+and sends it before the loop sees it.  The state
+after each Predict() is kept in a SensorHistory and
+a measurement given its age is compared with the
+state at the time it was measured, the correction
+then applies to the present.  Corrections shift the
+whole history, so one late fix is not counted again
+by the next.
+
+The estimate is published through a SeqLock, any
+thread may Get() it.
+
+***********************************************/
+#ifndef __Estimator_h
+#define __Estimator_h
+
+#include <stdint.h>
+#include "seqlock.h"
+#include "history.h"
+#include "enu.h"
+#include "controlbyte.h"
+
+struct GPSFix;
+
+#define EKFSTATES		9
+#define EKFEAST			0
+#define EKFNORTH		1
+#define EKFUP			2
+#define EKFVEAST		3
+#define EKFVNORTH		4
+#define EKFVUP			5
+#define EKFHEADING		6	//Radians clockwise from true north
+#define EKFWINDEAST		7	//Meters per second the quad drifts that no command explains
+#define EKFWINDNORTH		8
+
+//The motion model, what the flight controller does with the bits of a control byte
+#define EKFFORWARDSPEED		2.0f	//Meters per second for forward, reverse, left or right
+#define EKFCLIMBRATE		1.0f	//Meters per second
+#define EKFYAWRATE		45.0f	//Degrees per second
+#define EKFRESPONSE		1.0f	//Seconds to reach a commanded velocity
+
+//Noise, standard deviations
+#define EKFACCELNOISE		0.5f	//Meters per second squared the model misses, wind and the like
+#define EKFYAWNOISE		5.0f	//Degrees per second
+#define EKFWINDNOISE		0.05f	//Meters per second the wind changes by in a second
+#define EKFWINDSTART		2.0f	//Meters per second of wind believed possible before the first fix
+#define EKFGPSPOSITION		2.5f	//Meters
+#define EKFGPSALTITUDE		5.0f	//Meters
+#define EKFGPSVELOCITY		0.3f	//Meters per second
+#define EKFMAGHEADING		5.0f	//Degrees
+#define EKFGATE			5.0f	//Innovations past this many deviations are thrown away
+#define EKFHISTORY		128	//Predict() states kept for late measurements, 2.5 s at 50 Hz
+
+
+//What the estimator publishes
+struct EstimatorState
+{
+	double lat;
+	double lng;
+	float east;		//Meters from the estimator's origin
+	float north;
+	float up;		//Meters, the fix altitude
+	float velocityEast;	//Meters per second
+	float velocityNorth;
+	float velocityUp;
+	float heading;		//Degrees true, 0..360
+	float positionSigma;	//Meters, horizontal
+	float headingSigma;	//Degrees
+	float windEast;		//Meters per second
+	float windNorth;
+	double timeStamp;	//Of the last Predict() or update
+	uint32_t fixes;		//GPS fixes fused so far, 0 means nothing to steer on
+};
+
+
+//The state vector as the history keeps it
+struct EstimatorSample
+{
+	float x[EKFSTATES];
+};
+
+
+//Linear, but the heading the short way round
+struct EstimatorBlend
+{
+	EstimatorSample operator()(const EstimatorSample &a,const EstimatorSample &b,double f) const;
+};
+
+
+class StateEstimator
+{
+	public:
+		StateEstimator();
+
+		void Reset();
+		bool Started() const;
+
+		//seconds since the last call, with the control byte that was sent for them
+		void Predict(float seconds,int controlByte);
+		//Only the fields the fix flags are used, the first fix sets the origin.  age is seconds
+		//since it was measured, the history covers EKFHISTORY Predict() calls back.
+		void UpdateGPS(const GPSFix &fix,float age = 0);
+		void UpdateHeading(float degrees,float age = 0);
+		//The state age seconds ago, false and the oldest kept if the history does not reach back that far
+		bool StateAt(float age,EstimatorSample &sample) const;
+
+		void Publish(double timeStamp);
+		EstimatorState Get() const;
+
+		float x[EKFSTATES];
+		float P[EKFSTATES][EKFSTATES];
+		ENUFrame frame;
+		uint32_t fixes;
+		uint32_t rejected;	//Innovations thrown away by the gate
+		uint32_t late;		//Measurements older than the history, compared with the oldest state
+		double clock;		//Seconds of Predict() so far
+
+		//Motion model, the defaults above until tuned
+		float forwardSpeed;
+		float climbRate;
+		float yawRate;		//Radians per second
+
+	private:
+		bool Correct(int state,EstimatorSample &then,float measured,float variance);
+		void Shift(int state,float delta);
+		void Rebase(const GeoPoint &p);
+
+		//States as predicted less the corrections made since, so a correction shifts every one of them
+		SensorHistory<EstimatorSample,EKFHISTORY,EstimatorBlend> history;
+		float shift[EKFSTATES];
+
+		SeqLock<EstimatorState> published;
+};
+
+#endif // def(__Estimator_h)
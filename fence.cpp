@@ -0,0 +1,600 @@
+#include "fence.h"
+#include <math.h>
+#include <float.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+//Edges are registered in every cell they touch, widened by this for float rounding at cell edges
+#define FENCEEDGESLACK		0.001f
+#define FENCERINGMAX		65535
+
+
+static inline float SegmentDistance2(float ae,float an,float be,float bn,float pe,float pn)
+{
+	float de = be - ae;
+	float dn = bn - an;
+	float we = pe - ae;
+	float wn = pn - an;
+	float dd = de * de + dn * dn;
+	float t = dd > 0 ? (we * de + wn * dn) / dd : 0;
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	float qe = we - t * de;
+	float qn = wn - t * dn;
+	return qe * qe + qn * qn;
+}
+
+
+//Squared distance from the segment to the box x0,y0 x1,y1, zero if it enters it.
+//Apart, the closest pair always has an end of the segment or a corner of the box in it.
+static inline float SegmentBoxDistance2(float ae,float an,float be,float bn,float x0,float y0,float x1,float y1)
+{
+	//Clip the segment to the box, t0..t1 is what is left of it
+	float t0 = 0,t1 = 1;
+	float d[2] = { be - ae, bn - an };
+	float lo[2] = { x0 - ae, y0 - an };
+	float hi[2] = { x1 - ae, y1 - an };
+	for(int axis=0;axis<2 && t0 <= t1;axis++)
+	{
+		if(d[axis] == 0)
+		{
+			if(lo[axis] > 0 || hi[axis] < 0)
+				t0 = 2;
+			continue;
+		}
+		float a = lo[axis] / d[axis];
+		float b = hi[axis] / d[axis];
+		t0 = max(t0,min(a,b));
+		t1 = min(t1,max(a,b));
+	}
+	if(t0 <= t1)
+		return 0;
+
+	float best = FLT_MAX;
+	float ends[2][2] = { { ae, an }, { be, bn } };
+	for(int i=0;i<2;i++)
+	{
+		float de = max(max(x0 - ends[i][0],ends[i][0] - x1),0.0f);
+		float dn = max(max(y0 - ends[i][1],ends[i][1] - y1),0.0f);
+		best = min(best,de * de + dn * dn);
+	}
+	best = min(best,SegmentDistance2(ae,an,be,bn,x0,y0));
+	best = min(best,SegmentDistance2(ae,an,be,bn,x1,y0));
+	best = min(best,SegmentDistance2(ae,an,be,bn,x0,y1));
+	best = min(best,SegmentDistance2(ae,an,be,bn,x1,y1));
+	return best;
+}
+
+
+static bool CloserToCenter(const FenceEdge &a,const FenceEdge &b)
+{
+	return a.center < b.center;
+}
+
+
+//How the winding number changes from c to p across edge a to b, +1 going in to its left
+static inline int Crossing(float ae,float an,float be,float bn,float ce,float cn,float pe,float pn)
+{
+	float de = be - ae;
+	float dn = bn - an;
+	bool cLeft = de * (cn - an) - dn * (ce - ae) > 0;
+	bool pLeft = de * (pn - an) - dn * (pe - ae) > 0;
+	if(cLeft == pLeft)
+		return 0;
+	float se = pe - ce;
+	float sn = pn - cn;
+	bool aLeft = se * (an - cn) - sn * (ae - ce) > 0;
+	bool bLeft = se * (bn - cn) - sn * (be - ce) > 0;
+	if(aLeft == bLeft)
+		return 0;
+	return pLeft ? 1 : -1;
+}
+
+
+Geofence::Geofence()
+{
+	ceiling = 0;
+	warning = FENCEDEFAULTWARNING;
+	cell = 1;
+	columns = 0;
+	rows = 0;
+	polygons = 0;
+	includes = 0;
+	nearCells = FENCENEARCELLS;
+	minEast = minNorth = 0;
+	boxMinEast = boxMinNorth = boxMaxEast = boxMaxNorth = 0;
+}
+
+
+void Geofence::Clear()
+{
+	frame = ENUFrame();
+	columns = 0;
+	rows = 0;
+	polygons = 0;
+	includes = 0;
+	ae.clear();
+	an.clear();
+	be.clear();
+	bn.clear();
+	kind.clear();
+	edgeStart.clear();
+	edges.clear();
+	nearStart.clear();
+	nearEdges.clear();
+	includeWinding.clear();
+	excludeWinding.clear();
+	ring.clear();
+}
+
+
+int Geofence::Count() const
+{
+	return polygons;
+}
+
+
+void Geofence::Project(const GeoPoint &p,float &e,float &n) const
+{
+	ENUPoint q = frame.ToENU(p,0);
+	e = q.east / 1000.0f;
+	n = q.north / 1000.0f;
+}
+
+
+bool Geofence::AddPolygon(const vector<GeoPoint> &vertices,int polygonKind)
+{
+	if(!frame.haveOrigin && !vertices.empty())
+		frame.SetOrigin(vertices[0],0);
+
+	//Repeats, including a closing vertex equal to the first, would make zero length edges
+	vector<float> e,n;
+	for(size_t i=0;i<vertices.size();i++)
+	{
+		float pe,pn;
+		Project(vertices[i],pe,pn);
+		if(!e.empty() && pe == e.back() && pn == n.back())
+			continue;
+		e.push_back(pe);
+		n.push_back(pn);
+	}
+	while(e.size() > 1 && e.back() == e[0] && n.back() == n[0])
+	{
+		e.pop_back();
+		n.pop_back();
+	}
+	int count = (int)e.size();
+	if(count < 3)
+		return false;
+
+	//Counter clockwise so the inside is on the left of every edge
+	double area = 0;
+	for(int i=0;i<count;i++)
+	{
+		int j = (i + 1) % count;
+		area += (double)e[i] * n[j] - (double)e[j] * n[i];
+	}
+	if(area < 0)
+	{
+		reverse(e.begin(),e.end());
+		reverse(n.begin(),n.end());
+	}
+	for(int i=0;i<count;i++)
+	{
+		int j = (i + 1) % count;
+		ae.push_back(e[i]);
+		an.push_back(n[i]);
+		be.push_back(e[j]);
+		bn.push_back(n[j]);
+		kind.push_back(polygonKind == FENCE_EXCLUDE ? FENCE_EXCLUDE : FENCE_INCLUDE);
+	}
+	polygons++;
+	if(polygonKind != FENCE_EXCLUDE)
+		includes++;
+	return true;
+}
+
+
+bool Geofence::Load(const char *path)
+{
+	Clear();
+	ifstream iFile(path);
+	if(!iFile.is_open())
+		return false;
+
+	string line;
+	vector<GeoPoint> vertices;
+	int polygonKind = FENCE_INCLUDE;
+	bool inPolygon = false;
+	while(getline(iFile,line))
+	{
+		size_t hash = line.find('#');
+		if(hash != string::npos)
+			line.erase(hash);
+		istringstream sL(line);
+		string word;
+		if(!(sL >> word))
+			continue;
+
+		if(word == "include" || word == "exclude")
+		{
+			if(inPolygon)
+				AddPolygon(vertices,polygonKind);
+			vertices.clear();
+			polygonKind = word == "include" ? FENCE_INCLUDE : FENCE_EXCLUDE;
+			inPolygon = true;
+		}
+		else if(word == "ceiling")
+			sL >> ceiling;
+		else if(word == "warning")
+			sL >> warning;
+		else if(inPolygon)
+		{
+			double lat,lng;
+			char sep;
+			istringstream sP(line);
+			if(sP >> lat >> sep >> lng)
+				vertices.push_back(GeoFromDegrees(lat,lng));
+		}
+	}
+	if(inPolygon)
+		AddPolygon(vertices,polygonKind);
+	Build();
+	return true;
+}
+
+
+int Geofence::Cell(float e,float n) const
+{
+	int c = (int)floorf((e - minEast) / cell);
+	int r = (int)floorf((n - minNorth) / cell);
+	if(c < 0 || c >= columns || r < 0 || r >= rows)
+		return -1;
+	return r * columns + c;
+}
+
+
+void Geofence::CellCenter(int c,float &e,float &n) const
+{
+	e = minEast + (c % columns + 0.5f) * cell;
+	n = minNorth + (c / columns + 0.5f) * cell;
+}
+
+
+void Geofence::Build()
+{
+	int count = (int)ae.size();
+	columns = 0;
+	rows = 0;
+	if(count == 0)
+		return;
+
+	boxMinEast = boxMaxEast = ae[0];
+	boxMinNorth = boxMaxNorth = an[0];
+	for(int i=1;i<count;i++)
+	{
+		boxMinEast = min(boxMinEast,ae[i]);
+		boxMaxEast = max(boxMaxEast,ae[i]);
+		boxMinNorth = min(boxMinNorth,an[i]);
+		boxMaxNorth = max(boxMaxNorth,an[i]);
+	}
+
+	//A few cells per edge, padded so anything within warning of an edge is in a near cell
+	float width = boxMaxEast - boxMinEast;
+	float height = boxMaxNorth - boxMinNorth;
+	int target = min(max(count * FENCECELLSPEREDGE,FENCEMINCELLS),FENCEMAXCELLS);
+	cell = sqrtf(width * height / target);
+	if(cell < FENCEMINCELL)
+		cell = FENCEMINCELL;
+	for(;;)
+	{
+		nearCells = FENCENEARCELLS + (int)ceilf(warning / cell);
+		float pad = (nearCells + 1) * cell;
+		minEast = boxMinEast - pad;
+		minNorth = boxMinNorth - pad;
+		columns = (int)((width + 2 * pad) / cell) + 1;
+		rows = (int)((height + 2 * pad) / cell) + 1;
+		if((long)columns * rows <= FENCEMAXCELLS)
+			break;
+		cell *= 2;
+	}
+
+	RegisterEdges();
+	CenterWindings();
+	Rings();
+	NearLists();
+}
+
+
+//Every cell each edge passes through, a column slab at a time.  The padding keeps them all on the grid.
+void Geofence::RegisterEdges()
+{
+	int cells = columns * rows;
+	vector<int> edgeCell;
+	vector<int> edgeIndex;
+	for(int i=0;i<(int)ae.size();i++)
+	{
+		int c0 = (int)floorf((min(ae[i],be[i]) - FENCEEDGESLACK - minEast) / cell);
+		int c1 = (int)floorf((max(ae[i],be[i]) + FENCEEDGESLACK - minEast) / cell);
+		for(int c=c0;c<=c1;c++)
+		{
+			float lo = an[i],hi = bn[i];
+			if(c0 != c1 && be[i] != ae[i])
+			{
+				//Where the edge is while it crosses this column, never past its ends
+				float x0 = max(minEast + c * cell,min(ae[i],be[i])) - FENCEEDGESLACK;
+				float x1 = min(minEast + (c + 1) * cell,max(ae[i],be[i])) + FENCEEDGESLACK;
+				float slope = (bn[i] - an[i]) / (be[i] - ae[i]);
+				lo = an[i] + (x0 - ae[i]) * slope;
+				hi = an[i] + (x1 - ae[i]) * slope;
+				lo = min(max(lo,min(an[i],bn[i])),max(an[i],bn[i]));
+				hi = min(max(hi,min(an[i],bn[i])),max(an[i],bn[i]));
+			}
+			int r0 = (int)floorf((min(lo,hi) - FENCEEDGESLACK - minNorth) / cell);
+			int r1 = (int)floorf((max(lo,hi) + FENCEEDGESLACK - minNorth) / cell);
+			for(int r=r0;r<=r1;r++)
+			{
+				edgeCell.push_back(r * columns + c);
+				edgeIndex.push_back(i);
+			}
+		}
+	}
+	edgeStart.assign(cells + 1,0);
+	for(size_t k=0;k<edgeCell.size();k++)
+		edgeStart[edgeCell[k] + 1]++;
+	for(int c=0;c<cells;c++)
+		edgeStart[c + 1] += edgeStart[c];
+	edges.resize(edgeCell.size());
+	vector<int> fill(edgeStart.begin(),edgeStart.end() - 1);
+	for(size_t k=0;k<edgeCell.size();k++)
+		edges[fill[edgeCell[k]]++] = edgeIndex[k];
+}
+
+
+//Winding counts along the line through each row of centers, from the empty left edge of the grid
+void Geofence::CenterWindings()
+{
+	includeWinding.assign(columns * rows,0);
+	excludeWinding.assign(columns * rows,0);
+	vector< pair<float,int> > include,exclude;
+	for(int r=0;r<rows;r++)
+	{
+		float y = minNorth + (r + 0.5f) * cell;
+		include.clear();
+		exclude.clear();
+		for(int i=0;i<(int)ae.size();i++)
+		{
+			if((an[i] > y) == (bn[i] > y))
+				continue;
+			float x = ae[i] + (y - an[i]) * (be[i] - ae[i]) / (bn[i] - an[i]);
+			//Going east over an edge heading north leaves its left side
+			int delta = bn[i] > an[i] ? -1 : 1;
+			if(kind[i] == FENCE_EXCLUDE)
+				exclude.push_back(make_pair(x,delta));
+			else
+				include.push_back(make_pair(x,delta));
+		}
+		sort(include.begin(),include.end());
+		sort(exclude.begin(),exclude.end());
+		size_t nextInclude = 0,nextExclude = 0;
+		int inside = 0,excluded = 0;
+		for(int c=0;c<columns;c++)
+		{
+			float x = minEast + (c + 0.5f) * cell;
+			while(nextInclude < include.size() && include[nextInclude].first < x)
+				inside += include[nextInclude++].second;
+			while(nextExclude < exclude.size() && exclude[nextExclude].first < x)
+				excluded += exclude[nextExclude++].second;
+			includeWinding[r * columns + c] = inside;
+			excludeWinding[r * columns + c] = excluded;
+		}
+	}
+}
+
+
+//Chessboard distance to the nearest cell with an edge, two raster passes
+void Geofence::Rings()
+{
+	ring.assign(columns * rows,FENCERINGMAX);
+	for(int c=0;c<columns * rows;c++)
+		if(edgeStart[c + 1] > edgeStart[c])
+			ring[c] = 0;
+	for(int r=0;r<rows;r++)
+		for(int c=0;c<columns;c++)
+		{
+			int k = ring[r * columns + c];
+			if(c > 0)
+				k = min(k,ring[r * columns + c - 1] + 1);
+			if(r > 0)
+			{
+				k = min(k,ring[(r - 1) * columns + c] + 1);
+				if(c > 0)
+					k = min(k,ring[(r - 1) * columns + c - 1] + 1);
+				if(c + 1 < columns)
+					k = min(k,ring[(r - 1) * columns + c + 1] + 1);
+			}
+			ring[r * columns + c] = min(k,FENCERINGMAX);
+		}
+	for(int r=rows - 1;r>=0;r--)
+		for(int c=columns - 1;c>=0;c--)
+		{
+			int k = ring[r * columns + c];
+			if(c + 1 < columns)
+				k = min(k,ring[r * columns + c + 1] + 1);
+			if(r + 1 < rows)
+			{
+				k = min(k,ring[(r + 1) * columns + c] + 1);
+				if(c > 0)
+					k = min(k,ring[(r + 1) * columns + c - 1] + 1);
+				if(c + 1 < columns)
+					k = min(k,ring[(r + 1) * columns + c + 1] + 1);
+			}
+			ring[r * columns + c] = min(k,FENCERINGMAX);
+		}
+}
+
+
+//For cells near an edge, every edge that comes within the furthest any point in the cell
+//can be from its nearest edge.  Nothing else can be nearest to a point in the cell.
+void Geofence::NearLists()
+{
+	int cells = columns * rows;
+	vector<int> stamp(ae.size(),-1);
+	nearStart.assign(cells + 1,0);
+	nearEdges.clear();
+	for(int c=0;c<cells;c++)
+	{
+		nearStart[c] = (int)nearEdges.size();
+		if(ring[c] > nearCells)
+			continue;
+		float ce,cn;
+		CellCenter(c,ce,cn);
+		int c0 = c % columns;
+		int r0 = c / columns;
+
+		//Exact distance from the center, rings out until nothing further in could be closer
+		float best2 = FLT_MAX;
+		for(int k=0;;k++)
+		{
+			for(int r=max(r0 - k,0);r<=min(r0 + k,rows - 1);r++)
+			{
+				bool edge = r == r0 - k || r == r0 + k;
+				int step = edge ? 1 : 2 * k;
+				for(int col=c0 - k;col<=c0 + k;col+=step)
+				{
+					if(col < 0 || col >= columns)
+						continue;
+					int cellIndex = r * columns + col;
+					for(int j=edgeStart[cellIndex];j<edgeStart[cellIndex + 1];j++)
+					{
+						int i = edges[j];
+						best2 = min(best2,SegmentDistance2(ae[i],an[i],be[i],bn[i],ce,cn));
+					}
+				}
+			}
+			float reach = (k + 0.5f) * cell;
+			if(best2 <= reach * reach)
+				break;
+		}
+
+		//No point in the cell is further than this from its nearest edge
+		float reach = sqrtf(best2) + cell * 0.70710678f + FENCEEDGESLACK;
+		float x0 = ce - cell * 0.5f,y0 = cn - cell * 0.5f;
+		int k = (int)(reach / cell) + 1;
+		for(int r=max(r0 - k,0);r<=min(r0 + k,rows - 1);r++)
+			for(int col=max(c0 - k,0);col<=min(c0 + k,columns - 1);col++)
+			{
+				int cellIndex = r * columns + col;
+				for(int j=edgeStart[cellIndex];j<edgeStart[cellIndex + 1];j++)
+				{
+					int i = edges[j];
+					if(stamp[i] == c)
+						continue;
+					stamp[i] = c;
+					if(SegmentBoxDistance2(ae[i],an[i],be[i],bn[i],x0,y0,x0 + cell,y0 + cell) <= reach * reach)
+					{
+						FenceEdge edge = { ae[i], an[i], be[i], bn[i], sqrtf(SegmentDistance2(ae[i],an[i],be[i],bn[i],ce,cn)) };
+						nearEdges.push_back(edge);
+					}
+				}
+			}
+		sort(nearEdges.begin() + nearStart[c],nearEdges.end(),CloserToCenter);
+	}
+	nearStart[cells] = (int)nearEdges.size();
+}
+
+
+bool Geofence::Allowed(float e,float n) const
+{
+	if(columns == 0)
+		return true;
+	int inside = 0,excluded = 0;
+	int c = Cell(e,n);
+	if(c >= 0)
+	{
+		//From the center's winding counts, across whatever lies between it and the query
+		float ce,cn;
+		CellCenter(c,ce,cn);
+		inside = includeWinding[c];
+		excluded = excludeWinding[c];
+		for(int j=edgeStart[c];j<edgeStart[c + 1];j++)
+		{
+			int i = edges[j];
+			int d = Crossing(ae[i],an[i],be[i],bn[i],ce,cn,e,n);
+			if(kind[i] == FENCE_EXCLUDE)
+				excluded += d;
+			else
+				inside += d;
+		}
+	}
+	return (includes == 0 || inside != 0) && excluded == 0;
+}
+
+
+float Geofence::Distance(float e,float n,bool &exact) const
+{
+	exact = false;
+	if(columns == 0)
+		return FLT_MAX;
+	int c = Cell(e,n);
+	if(c < 0)
+	{
+		//Off the grid, at least as far as the box round every edge
+		float de = max(max(boxMinEast - e,e - boxMaxEast),0.0f);
+		float dn = max(max(boxMinNorth - n,n - boxMaxNorth),0.0f);
+		return sqrtf(de * de + dn * dn);
+	}
+
+	if(ring[c] > nearCells)
+	{
+		//The square of empty cells round this one holds no edge
+		int k = ring[c] - 1;
+		float left = minEast + (c % columns - k) * cell;
+		float bottom = minNorth + (c / columns - k) * cell;
+		float side = (2 * k + 1) * cell;
+		return min(min(e - left,left + side - e),min(n - bottom,bottom + side - n));
+	}
+
+	//An edge is at least its center distance less ours from the center away, stop once that is too far
+	float ce,cn;
+	CellCenter(c,ce,cn);
+	float offset = sqrtf((e - ce) * (e - ce) + (n - cn) * (n - cn));
+	float best = FLT_MAX;
+	for(int j=nearStart[c];j<nearStart[c + 1];j++)
+	{
+		const FenceEdge &edge = nearEdges[j];
+		if(edge.center - offset > best)
+			break;
+		float d2 = SegmentDistance2(edge.ae,edge.an,edge.be,edge.bn,e,n);
+		if(d2 < best * best)
+			best = sqrtf(d2);
+	}
+	exact = true;
+	return best;
+}
+
+
+FenceStatus Geofence::Check(const GeoPoint &p,double altFeet) const
+{
+	FenceStatus s;
+	s.flags = 0;
+	s.margin = FLT_MAX;
+	s.exact = false;
+	if(ceiling > 0 && altFeet > ceiling)
+		s.flags |= FENCECEILING;
+	if(columns == 0)
+		return s;
+
+	float e,n;
+	Project(p,e,n);
+	s.margin = Distance(e,n,s.exact);
+	if(!Allowed(e,n))
+	{
+		s.flags |= FENCEBREACH;
+		s.margin = -s.margin;
+	}
+	else if(s.margin < warning)
+		s.flags |= FENCEWARNING;
+	return s;
+}
@@ -0,0 +1,121 @@
+/************************************************
+Geofence - inclusion and exclusion polygons
+
+The quad must stay inside at least one include
+polygon (when there are any), out of every exclude
+polygon and under the ceiling.  Polygons are
+projected once into the fence's ENU meters and an
+acceleration grid is built over them, so a check
+costs the same with 10 vertices or 10000.
+
+Every cell keeps the winding counts of its center,
+the inside test only has to look at edges crossing
+the line from there to the query, all inside the
+one cell.  Cells within a few of an edge keep every
+edge that could be nearest to a point in them, the
+margin there is exact.  Further out it is a lower
+bound from the empty cells around, never more than
+the real distance.
+
+Fence file, one item per line, # comments:
+	ceiling 120		feet, same zero as GPSFix.alt
+	warning 5		meters
+	include			starts a polygon
+	35.2058;-97.4457	vertices, lat;lng as waypoints.txt
+	exclude
+
+***********************************************/
+#ifndef __Fence_h
+#define __Fence_h
+
+#include <vector>
+#include "enu.h"
+using namespace std;
+
+#define FENCE_INCLUDE		0
+#define FENCE_EXCLUDE		1
+
+//FenceStatus.flags
+#define FENCEBREACH		1	//Outside every include or inside an exclude
+#define FENCECEILING		2
+#define FENCEWARNING		4	//Allowed, but closer than warning to an edge
+
+#define FENCECELLSPEREDGE	4
+#define FENCEMINCELLS		4096
+#define FENCEMAXCELLS		(1 << 18)
+#define FENCEMINCELL		0.25f	//Meters
+#define FENCENEARCELLS		2	//Cells from an edge that get an exact margin, more if warning needs it
+#define FENCEDEFAULTWARNING	5.0f
+
+//An edge a to b, copied into every near list it is on so a margin reads one run of memory.
+//Lists are sorted by center, the distance from the cell's center.
+struct FenceEdge
+{
+	float ae,an,be,bn;
+	float center;
+};
+
+
+struct FenceStatus
+{
+	int flags;
+	float margin;		//Meters to the nearest edge, negative in a breach
+	bool exact;		//False when margin is a lower bound, far from every edge
+};
+
+
+class Geofence
+{
+	public:
+		Geofence();
+
+		//Clears, reads the file and builds the grid.  False if it cannot be read.
+		bool Load(const char *path);
+		void Clear();
+
+		//Call Build() after the last polygon, needs three or more vertices
+		bool AddPolygon(const vector<GeoPoint> &vertices,int polygonKind);
+		void Build();
+		int Count() const;
+
+		FenceStatus Check(const GeoPoint &p,double altFeet) const;
+
+		//In fence meters
+		bool Allowed(float e,float n) const;
+		float Distance(float e,float n,bool &exact) const;
+		void Project(const GeoPoint &p,float &e,float &n) const;
+
+		double ceiling;		//Feet, none when <= 0
+		float warning;		//Meters
+		ENUFrame frame;
+		float cell;
+		int columns;
+		int rows;
+
+	private:
+		int polygons;
+		int includes;
+		//Edges, a to b with the inside on the left
+		vector<float> ae,an,be,bn;
+		vector<unsigned char> kind;
+		float boxMinEast,boxMinNorth,boxMaxEast,boxMaxNorth;
+		float minEast,minNorth;
+		int nearCells;
+
+		vector<int> edgeStart;		//Edges crossing cell c are edges[edgeStart[c]..edgeStart[c + 1])
+		vector<int> edges;
+		vector<int> nearStart;		//Every edge that can be nearest to a point in cell c
+		vector<FenceEdge> nearEdges;
+		vector<short> includeWinding;	//At each cell center
+		vector<short> excludeWinding;
+		vector<unsigned short> ring;	//Chessboard cells to the nearest cell an edge crosses
+
+		int Cell(float e,float n) const;
+		void CellCenter(int c,float &e,float &n) const;
+		void RegisterEdges();
+		void CenterWindings();
+		void Rings();
+		void NearLists();
+};
+
+#endif // def(__Fence_h)
@@ -0,0 +1,262 @@
+#include "geo.h"
+#include <math.h>
+
+//cos table from 0 to 90 degrees, built once with CORDIC below.  Entries are 2^26
+//nanodegrees (0.067 degrees) apart so the lookup is shifts, not 64 bit divides.
+#define GEOCOSSHIFT		26
+#define GEOCOSENTRIES		((int)((90 * GEONANO) >> GEOCOSSHIFT) + 2)
+//CORDIC works in Q40 so the shifts keep precision, 2^40 / gain of 32 steps
+#define GEOCORDICX0		667681663043LL
+#define GEOCORDICQ		40
+#define GEOBEARINGSTEPS		16
+#define GEORADIANNANO		57295779513LL	//Nanodegrees per radian
+
+//atan(2^-i) in nanodegrees
+static const int64_t atanTable[GEOCORDICSTEPS] =
+{
+	45000000000LL, 26565051177LL, 14036243468LL, 7125016349LL,
+	3576334375LL, 1789910608LL, 895173710LL, 447614171LL,
+	223810500LL, 111905677LL, 55952892LL, 27976453LL,
+	13988227LL, 6994114LL, 3497057LL, 1748528LL,
+	874264LL, 437132LL, 218566LL, 109283LL,
+	54642LL, 27321LL, 13660LL, 6830LL,
+	3415LL, 1708LL, 854LL, 427LL,
+	213LL, 107LL, 53LL, 27LL,
+};
+
+static int32_t cosTable[GEOCOSENTRIES];
+
+
+//Rotation mode, turns (GEOCORDICX0, 0) through angle, leaving cos and sin in Q40
+static void CordicRotate(int64_t angle,int64_t &x,int64_t &y)
+{
+	x = GEOCORDICX0;
+	y = 0;
+	for(int i=0;i<GEOCORDICSTEPS;i++)
+	{
+		int64_t dx = y >> i;
+		int64_t dy = x >> i;
+		if(angle >= 0)
+		{
+			x -= dx;
+			y += dy;
+			angle -= atanTable[i];
+		}
+		else
+		{
+			x += dx;
+			y -= dy;
+			angle += atanTable[i];
+		}
+	}
+}
+
+
+//Filled before main() so GeoCos() never races a lazy build
+static struct GeoCosTable
+{
+	GeoCosTable()
+	{
+		for(int i=0;i<GEOCOSENTRIES;i++)
+		{
+			int64_t x,y;
+			CordicRotate((int64_t)i << GEOCOSSHIFT,x,y);
+			cosTable[i] = (int32_t)((x + (1LL << (GEOCORDICQ - GEOQ - 1))) >> (GEOCORDICQ - GEOQ));
+		}
+	}
+} geoCosTable;
+
+
+int64_t GeoMulShift(int64_t a,int64_t q,int shift)
+{
+	bool negative = a < 0;
+	uint64_t u = negative ? -(uint64_t)a : (uint64_t)a;
+	uint64_t hi = u >> shift;
+	uint64_t lo = u & ((1ULL << shift) - 1);
+	uint64_t r = hi * q + ((lo * q + (1ULL << (shift - 1))) >> shift);
+	return negative ? -(int64_t)r : (int64_t)r;
+}
+
+
+//Rounded square root.  The double sqrt() is only a first guess, the integer
+//correction makes the answer exact however the host rounds it.
+static uint64_t ISqrt(uint64_t n)
+{
+	uint64_t r = (uint64_t)sqrt((double)n);
+	while(r > 0 && r * r > n)
+		r--;
+	while((r + 1) * (r + 1) <= n)
+		r++;
+	if(n - r * r > r)
+		r++;
+	return r;
+}
+
+
+int64_t GeoFromRaw(const RawDegrees &raw)
+{
+	int64_t n = (int64_t)raw.deg * GEONANO + raw.billionths;
+	return raw.negative ? -n : n;
+}
+
+
+GeoPoint GeoFromRaw(const RawDegrees &lat,const RawDegrees &lng)
+{
+	GeoPoint p;
+	p.lat = GeoFromRaw(lat);
+	p.lng = GeoFromRaw(lng);
+	return p;
+}
+
+
+GeoPoint GeoFromDegrees(double lat,double lng)
+{
+	GeoPoint p;
+	p.lat = (int64_t)llround(lat * GEONANO);
+	p.lng = (int64_t)llround(lng * GEONANO);
+	return p;
+}
+
+
+//Same arithmetic as TinyGPSLocation::lat(), so both give the same double
+double GeoToDegrees(int64_t nano)
+{
+	int64_t u = nano < 0 ? -nano : nano;
+	double d = (double)(u / GEONANO) + (u % GEONANO) / 1000000000.0;
+	return nano < 0 ? -d : d;
+}
+
+
+int32_t GeoCos(int64_t lat)
+{
+	if(lat < 0)
+		lat = -lat;
+	if(lat >= 90 * GEONANO)
+		return 0;
+	int64_t i = lat >> GEOCOSSHIFT;
+	int64_t f = lat & ((1LL << GEOCOSSHIFT) - 1);
+	return (int32_t)(cosTable[i] + (((cosTable[i + 1] - cosTable[i]) * f) >> GEOCOSSHIFT));
+}
+
+
+void GeoDelta(const GeoPoint &a,const GeoPoint &b,int64_t &northMM,int64_t &eastMM)
+{
+	int64_t dLat = b.lat - a.lat;
+	int64_t dLng = b.lng - a.lng;
+	//The short way round across the date line
+	if(dLng > 180 * GEONANO)
+		dLng -= 360 * GEONANO;
+	else if(dLng < -180 * GEONANO)
+		dLng += 360 * GEONANO;
+
+	int32_t c = GeoCos((a.lat + b.lat) / 2);
+	northMM = GeoMulShift(dLat,GEOMMPERNANOQ32,32);
+	eastMM = GeoMulShift(GeoMulShift(dLng,c,GEOQ),GEOMMPERNANOQ32,32);
+}
+
+
+int64_t GeoLength(int64_t n,int64_t e)
+{
+	uint64_t un = n < 0 ? -n : n;
+	uint64_t ue = e < 0 ? -e : e;
+
+	//Squares must fit 64 bits, only matters past 3000 km
+	int shift = 0;
+	while((un | ue) >= (1ULL << 31))
+	{
+		un >>= 1;
+		ue >>= 1;
+		shift++;
+	}
+	return (int64_t)(ISqrt(un * un + ue * ue) << shift);
+}
+
+
+int64_t GeoDistance(const GeoPoint &a,const GeoPoint &b)
+{
+	int64_t n,e;
+	GeoDelta(a,b,n,e);
+	return GeoLength(n,e);
+}
+
+
+int64_t GeoAngle(int64_t x,int64_t y)
+{
+	if(x == 0 && y == 0)
+		return 0;
+
+	//Vectoring mode only converges for x >= 0, turn the back half round first
+	int64_t angle = 0;
+	if(x < 0)
+	{
+		x = -x;
+		y = -y;
+		angle = 180 * GEONANO;
+	}
+
+	//Scale up so the shifted terms keep their bits on short legs
+	uint64_t m = (uint64_t)x | (uint64_t)(y < 0 ? -y : y);
+	int up = __builtin_clzll(m) - 23;
+	if(up > 0)
+	{
+		x *= 1LL << up;
+		y *= 1LL << up;
+	}
+
+	//Branch free, which way each step turns is as random as the legs we are given
+	for(int i=0;i<GEOBEARINGSTEPS;i++)
+	{
+		int64_t s = y >> 63;		//0 turning clockwise, -1 back
+		int64_t dx = ((y >> i) ^ s) - s;
+		int64_t dy = ((x >> i) ^ s) - s;
+		x += dx;
+		y -= dy;
+		angle += (atanTable[i] ^ s) - s;
+	}
+
+	//What is left is under 2^-15 rad, where atan(t) is t to 1e-14.  One divide
+	//finishes it instead of another 16 steps.
+	int64_t t = y * (1LL << 34) / x;
+	angle += (t * GEORADIANNANO) >> 34;
+
+	if(angle < 0)
+		angle += 360 * GEONANO;
+	else if(angle >= 360 * GEONANO)
+		angle -= 360 * GEONANO;
+	return angle;
+}
+
+
+int64_t GeoBearing(const GeoPoint &a,const GeoPoint &b)
+{
+	int64_t n,e;
+	GeoDelta(a,b,n,e);
+	return GeoAngle(n,e);
+}
+
+
+GeoPoint GeoOffset(const GeoPoint &p,int64_t northMM,int64_t eastMM)
+{
+	GeoPoint r;
+	int64_t half = GEOMMPERNANOQ32 / 2;
+	int64_t dLat = (northMM * (1LL << 32) + (northMM < 0 ? -half : half)) / GEOMMPERNANOQ32;
+	int64_t equator = (eastMM * (1LL << 32) + (eastMM < 0 ? -half : half)) / GEOMMPERNANOQ32;
+
+	//Longitude degrees shrink with the cos of the latitude halfway along
+	int64_t c = GeoCos(p.lat + dLat / 2);
+	if(c < 1)
+		c = 1;
+	int64_t dLng = (equator / c) * (1LL << GEOQ) + (equator % c) * (1LL << GEOQ) / c;
+
+	r.lat = p.lat + dLat;
+	if(r.lat > 90 * GEONANO)
+		r.lat = 90 * GEONANO;
+	else if(r.lat < -90 * GEONANO)
+		r.lat = -90 * GEONANO;
+	r.lng = p.lng + dLng;
+	if(r.lng >= 180 * GEONANO)
+		r.lng -= 360 * GEONANO;
+	else if(r.lng < -180 * GEONANO)
+		r.lng += 360 * GEONANO;
+	return r;
+}
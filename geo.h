@@ -0,0 +1,78 @@
+/************************************************
+Fixed point geodesy
+
+Coordinates in integer nanodegrees, taken exactly
+from TinyGPS++ RawDegrees, and distance, bearing
+and offset done in integer arithmetic only.  The
+same inputs give the same bits on the Pi and on a
+desktop, there is no libm trig anywhere in here.
+
+Distances use a local flat earth (equirectangular)
+on the same 6372795 m sphere as TinyGPSPlus, good
+to well under a millimetre per km for the legs a
+quad flies, drifting from the great circle beyond
+a few tens of km.
+
+***********************************************/
+#ifndef __Geo_h
+#define __Geo_h
+
+#include <stdint.h>
+#include <math.h>
+#include "TinyGPS++.h"
+
+#define GEONANO			1000000000LL	//Nanodegrees per degree
+#define GEOQ			30		//Fraction bits of GeoCos()
+#define GEOCORDICSTEPS		32
+//Millimetres per nanodegree of arc, 2*pi*6372795/360/1e6, scaled by 2^32
+#define GEOMMPERNANOQ32		477713129LL
+//Degrees per radian, for the float bearings of the frames built on top of this
+#define GEODEGREES		57.29577951f
+
+//A position in nanodegrees, lat -90e9..90e9, lng -180e9..180e9
+struct GeoPoint
+{
+	int64_t lat;
+	int64_t lng;
+};
+
+
+//Exact, RawDegrees is whole degrees plus billionths
+int64_t GeoFromRaw(const RawDegrees &raw);
+GeoPoint GeoFromRaw(const RawDegrees &lat,const RawDegrees &lng);
+
+//Rounds to the nearest nanodegree, for waypoints stored as doubles
+GeoPoint GeoFromDegrees(double lat,double lng);
+double GeoToDegrees(int64_t nano);
+
+//cos of a latitude in nanodegrees, scaled by 2^GEOQ
+int32_t GeoCos(int64_t lat);
+
+//round(a * q / 2^shift), without the 128 bit product the Pi does not have.
+//Needs q < 2^(62 - shift).
+int64_t GeoMulShift(int64_t a,int64_t q,int shift);
+
+//North and east of a in millimetres to reach b
+void GeoDelta(const GeoPoint &a,const GeoPoint &b,int64_t &northMM,int64_t &eastMM);
+
+//Millimetres from a to b
+int64_t GeoDistance(const GeoPoint &a,const GeoPoint &b);
+
+//Bearing from a to b in nanodegrees clockwise from true north, 0..360e9
+int64_t GeoBearing(const GeoPoint &a,const GeoPoint &b);
+
+//Any angle in degrees as a heading, 0..360
+static inline double GeoCompass(double degrees)
+{
+	degrees = fmod(degrees,360);
+	return degrees < 0 ? degrees + 360 : degrees;
+}
+
+//The same two for a north/east vector already in millimetres
+int64_t GeoLength(int64_t northMM,int64_t eastMM);
+int64_t GeoAngle(int64_t northMM,int64_t eastMM);
+
+//The point northMM/eastMM millimetres from p, for offsets up to a few hundred km
+GeoPoint GeoOffset(const GeoPoint &p,int64_t northMM,int64_t eastMM);
+
+#endif // def(__Geo_h)
@@ -1,24 +1,66 @@
 #include "gps.h"
+#include "enu.h"
 #include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
 using namespace std;
 
 
 GPS::GPS()
 {
-
-}
-
-
-GPS::~GPS()
-{
-	bufferBlocked = false;
-	readBlock = false;
 	shutDown = false;
+	fixSequence = 0;
+	lastGPSCheck = 0;
+	prevLastGPSCheck = 0;
+	lapsedGPS = 0;
+	currentLat = currentLong = currentAlt = currentHeadingGPS = 0;
+	previousLat = previousLong = previousAlt = previousHeadingGPS = 0;
+	velocityX = velocityY = velocityZ = velocityR = 0;
+	traveledX = traveledY = traveledZ = 0;
+	epochFix = GPSFix();
+	publishedFix = GPSFix();
+	epochOpen = false;
+	epochTime = GPSNOTIME;
+	publishedTime = GPSNOTIME;
+	epochFields = GPSFIX_EPOCHFIELDS;
+	//Everything GetGPS() reads, the parser skips the rest
+	tinyGPS.subscribe(TINYGPS_TIME | TINYGPS_LOCATION | TINYGPS_ALTITUDE | TINYGPS_COURSE | TINYGPS_SPEED);
         bufferCount = 0;
         bufferIndex = 0;
 	altitudeOffset = 0;
         thisGPS = this;
 	age = 0;
+	uart0_filestream = -1;
+	devicePath = GPSDEVICE;
+	receiverType = GPS_RECEIVER_MTK;
+	protocol = GPS_PROTOCOL_NMEA;
+	baud = GPSDEFAULTBAUD;
+	targetBaud = GPSDEFAULTBAUD;
+	targetRate = 1;
+	updatePeriod = 1.0;
+	receiverConfigured = false;
+	configSeconds = 0;
+	haveWarmStart = false;
+	warmStartLat = 0;
+	warmStartLng = 0;
+	warmStartAlt = 0;
+	warmStartTime = 0;
+	rxWakeups = 0;
+	rxBytes = 0;
+	rxTime = 0;
+	latencyCount = 0;
+	latencyTotal = 0;
+	latencyWorst = 0;
+	gpsThread = 0;
+}
+
+
+GPS::~GPS()
+{
+	Stop();
 }
 
 
@@ -29,75 +71,243 @@ string GPS::GetGPStxt()
 	return r;
 }
 
+//Snapshot of the last published fix, never blocks the GPS thread
+GPSFix GPS::GetFix()
+{
+	GPSFix fix;
+	fixLock.Read(fix);
+	fix.alt -= altitudeOffset;
+	return fix;
+}
+
+//The single field getters each take their own snapshot, use GetFix() when fields must agree
 double GPS::GetLat()
 {
-        double l;
-        readBlock = true;
-	l = currentLat;
-        readBlock = false;
-        return l;
+        return GetFix().lat;
 }
 
 
 
 double GPS::GetLong()
 {
-        double l;
-        readBlock = true;
-        l = currentLong;
-        readBlock = false;
-        return l;
+        return GetFix().lng;
 }
 
 double GPS::GetAlt()
 {
-        double l;
-        readBlock = true;
-        l = currentAlt - altitudeOffset;
-        readBlock = false;
-        return l;
+        return GetFix().alt;
 }
 
 
 double GPS::GetHeading()
 {
-        double l;
-        readBlock = true;
-        l = currentHeading;
-        readBlock = false;
-        return l;
+        return GetFix().course;
 }
 
 
+//Seconds since the bytes of the current fix came off the UART
 double GPS::GetAge()
 {
-	age = GetLapsedTime(lastGPSCheck);
+	age = GetMonotonicTime() - GetFix().arrivalTime;
 	return age;
 }	
 
+
+//True when the position in fix is too old to steer on, or there is none yet.  Epochs keep coming with
+//only the time after a loss of lock, the position they carry over is measured from when it was new.
+bool GPS::IsStale(const GPSFix &fix)
+{
+	if(fix.sequence == 0 || fix.positionTime == 0)
+		return true;
+	return GetMonotonicTime() - fix.positionTime > GPSSTALEEPOCHS * GetUpdatePeriod();
+}
+
+//Stamps the fix with the next sequence number and makes it visible to GetFix()
+void GPS::PublishFix(GPSFix &fix)
+{
+	fix.sequence = ++fixSequence;
+	fixLock.Write(fix);
+}
+
+//Called for every sentence that passes its checksum.  Folds whatever the sentence
+//updated into the epoch for its UTC time and publishes the epoch once, either when
+//it has every field in epochFields or when the next epoch starts without them.
 bool GPS::GetGPS()
 {
-	while(readBlock);
+	uint32_t fields = 0;
+	uint32_t t = epochTime;
+	if(tinyGPS.time.isUpdated())
+	{
+		t = tinyGPS.time.value();
+		fields |= GPSFIX_TIME;
+	}
+
+	//Reading the values clears TinyGPS's updated flags for the next sentence
+	bool hasPosition = tinyGPS.location.isUpdated();
+	bool hasAltitude = tinyGPS.altitude.isUpdated();
+	bool hasCourse = tinyGPS.course.isUpdated();
+	bool hasSpeed = tinyGPS.speed.isUpdated();
+	GeoPoint position = GeoFromRaw(tinyGPS.location.rawLat(), tinyGPS.location.rawLng());
+	double alt = tinyGPS.altitude.feet();
+	double course = tinyGPS.course.deg();
+	double speed = tinyGPS.speed.mps();
+
+	if(hasPosition)
+		fields |= GPSFIX_POSITION;
+	if(hasAltitude)
+		fields |= GPSFIX_ALTITUDE;
+	if(hasCourse)
+		fields |= GPSFIX_COURSE;
+	if(hasSpeed)
+		fields |= GPSFIX_SPEED;
+
+	//GSA, GSV and friends, or nothing to place yet
+	if(fields == 0 || t == GPSNOTIME)
+		return false;
+
+	//Late sentence for an epoch that is already out, remember to wait for it next time
+	if(t == publishedTime)
+	{
+		epochFields |= fields;
+		return false;
+	}
+
+	//A new second started before the last one completed, send what we have and
+	//stop waiting for fields this receiver does not send
+	bool published = false;
+	if(epochOpen && t != epochTime)
+	{
+		epochFields = epochFix.fields;
+		PublishEpoch();
+		published = true;
+	}
+
+	if(!epochOpen)
+	{
+		epochFix = publishedFix;
+		epochFix.fields = 0;
+		epochFix.utcTime = t;
+		epochTime = t;
+		epochOpen = true;
+	}
+	epochFix.arrivalTime = rxTime;
+
+	if(hasPosition)
+	{
+		epochFix.positionTime = rxTime;
+		epochFix.position = position;
+		epochFix.lat = GeoToDegrees(position.lat);
+		epochFix.lng = GeoToDegrees(position.lng);
+	}
+	if(hasAltitude)
+		epochFix.alt = alt;
+	if(hasCourse)
+		epochFix.course = course;
+	if(hasSpeed)
+		epochFix.speed = speed;
+	epochFix.fields |= fields;
+
+	if((epochFix.fields & epochFields) == epochFields)
+	{
+		PublishEpoch();
+		published = true;
+	}
+
+        return published;
+}
+
+
+void GPS::PublishEpoch()
+{
         previousLat = currentLat;
         previousLong = currentLong;
 	previousAlt = currentAlt;
 	previousHeadingGPS = currentHeadingGPS;
 
-        currentLat = tinyGPS.location.lat();
-        currentLong = tinyGPS.location.lng();
-	currentAlt = tinyGPS.altitude.feet();
-	currentHeadingGPS = tinyGPS.course.deg();
+        currentLat = epochFix.lat;
+        currentLong = epochFix.lng;
+	currentAlt = epochFix.alt;
+	currentHeadingGPS = epochFix.course;
 	prevLastGPSCheck = lastGPSCheck;
 	lastGPSCheck = GetTimeStamp();
+	CalculateVars();
+
+	epochFix.timeStamp = lastGPSCheck;
+	PublishFix(epochFix);
+
+	double latency = GetMonotonicTime() - epochFix.arrivalTime;
+	latencyCount++;
+	latencyTotal += latency;
+	if(latency > latencyWorst)
+		latencyWorst = latency;
+	publishedFix = epochFix;
+	publishedTime = epochTime;
+	epochOpen = false;
+}
 
-        return true;
+
+//NAV-PVT carries a whole epoch, so there is nothing to assemble.  Its iTOW stands
+//in for the NMEA time as the epoch key, and a NAV-VELNED for the epoch already
+//out only refreshes course and speed.
+bool GPS::GetUBX(uint32_t msgs)
+{
+	const UBXSolution &sol = ubxParser.solution;
+
+	if(msgs & UBX_PVT)
+	{
+		epochFix = publishedFix;
+		epochFix.fields = 0;
+		epochFix.arrivalTime = rxTime;
+		if(sol.valid & UBXPVT_VALIDTIME)
+		{
+			//hhmmsscc like TinyGPSTime, iTOW has the milliseconds UTC lacks
+			epochFix.utcTime = sol.hour * 1000000 + sol.min * 10000 + sol.sec * 100 + (sol.iTOW % 1000) / 10;
+			epochFix.fields |= GPSFIX_TIME;
+		}
+		if((sol.flags & UBXPVT_GNSSFIXOK) && sol.fixType >= 2)
+		{
+			epochFix.positionTime = rxTime;
+			epochFix.position.lat = (int64_t)sol.lat * 100;
+			epochFix.position.lng = (int64_t)sol.lng * 100;
+			epochFix.lat = GeoToDegrees(epochFix.position.lat);
+			epochFix.lng = GeoToDegrees(epochFix.position.lng);
+			epochFix.course = sol.headMot * 1e-5;
+			epochFix.speed = sol.gSpeed / 1000.0;
+			epochFix.fields |= GPSFIX_POSITION | GPSFIX_COURSE | GPSFIX_SPEED;
+			if(sol.fixType >= 3)
+			{
+				epochFix.alt = sol.hMSL * METERSTOINCHES / 12000.0;
+				epochFix.fields |= GPSFIX_ALTITUDE;
+			}
+		}
+		if(epochFix.fields == 0)
+			return false;
+		epochTime = sol.iTOW;
+		PublishEpoch();
+		return true;
+	}
+
+	//The same epoch again, its position and time stand and nothing moved, so the velocity and previous
+	//position are left alone.  EnableUBX() only asks for NAV-PVT, this is for receivers set up elsewhere.
+	if(sol.iTOW == publishedTime && publishedFix.sequence > 0)
+	{
+		GPSFix fix = publishedFix;
+		fix.course = sol.headMot * 1e-5;
+		fix.speed = sol.gSpeed / 1000.0;
+		fix.fields |= GPSFIX_COURSE | GPSFIX_SPEED;
+		currentHeadingGPS = fix.course;
+		PublishFix(fix);
+		publishedFix = fix;
+		return true;
+	}
+	return false;
 }
 
 
 
 double GPS::DistanceBetween(WayPoint *wp1,WayPoint *wp2)
 {
-	return METERSTOINCHES*tinyGPS.distanceBetween(wp1->lng,wp2->lat,wp2->lng,wp2->lat);
+	return METERSTOINCHES*tinyGPS.distanceBetween(wp1->lat,wp1->lng,wp2->lat,wp2->lng);
 }
 
 
@@ -119,8 +329,10 @@ double GPS::DistanceBetween(WayPoint *wp,double lat,double lng)
 
 bool GPS::WayPointReached(WayPoint *wp)
 {
-	double distance = DistanceBetween(wp,GetLat(),GetLong());
-	if(distance <= GPSINCHESDEADBAND)
+	//Integer distance from the fix as received, no double trig in the hold loop
+	GPSFix fix = GetFix();
+	int64_t distance = GeoDistance(GeoFromDegrees(wp->lat,wp->lng),fix.position);
+	if(distance <= GPSMMDEADBAND)
 		return true;
 	else
 		return false; 
@@ -160,40 +372,38 @@ double GPS::CalibrateAltitude()
 }
 
 
+//Velocity between the last two published fixes, meters per second with X north, Y east and Z up.
+//The estimator has the better one between fixes, this is what the receiver's positions alone say.
 bool GPS::CalculateVars()
 {
-	double gpsLapsed = prevLastGPSCheck - lastGPSCheck;
-	double deltaX;
-	double deltaY;
-	double deltaZ;
-
-
-	deltaX = abs(currentLat - previousLat);
-	deltaY = abs(currentLong = previousLong);
-
-	if(currentLat >= previousLat)	
-		traveledX = deltaX;
-	else
-		traveledX = deltaX*-1;
-	
-	if(currentLong >= previousLong)
-		traveledY = deltaY;
-	else
-		traveledY = deltaY*-1;
-
-	
+	lapsedGPS = lastGPSCheck - prevLastGPSCheck;
+	if(prevLastGPSCheck <= 0 || lapsedGPS <= 0)
+		return false;
 
+	int64_t northMM,eastMM;
+	GeoDelta(GeoFromDegrees(previousLat,previousLong),GeoFromDegrees(currentLat,currentLong),northMM,eastMM);
+	traveledX = northMM / 1000.0;
+	traveledY = eastMM / 1000.0;
+	traveledZ = (currentAlt - previousAlt) * FEETTOMM / 1000;
 
-	
-	velocityX = traveledX / lapsedGPS; 
+	velocityX = traveledX / lapsedGPS;
 	velocityY = traveledY / lapsedGPS;
-	velocityZ = -.56;
+	velocityZ = traveledZ / lapsedGPS;
+	velocityR = sqrt(velocityX * velocityX + velocityY * velocityY);
 	return true;
-
 }
 
 
 
+//Seconds on CLOCK_MONOTONIC, for intervals that must not jump when NTP sets the clock
+double GPS::GetMonotonicTime()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+
 double GPS::GetTimeStamp()
 {
         double ts;
@@ -224,21 +434,35 @@ void * GPS::GPSMainThread(void *arg)
 	if(gps == NULL)
 		cerr << "UNABLE TO ATTACH GPS OBJECT" << endl;
 	gps->SetupUART();
-	cout << "here" << endl;
+	//ConfigureReceiver() sends the warm start hint itself as soon as it knows the baud
+	if(gps->targetBaud != gps->baud || gps->targetRate > 1 || gps->protocol == GPS_PROTOCOL_UBX)
+		gps->ConfigureReceiver();
+	else if(gps->haveWarmStart)
+		gps->SendWarmStart();
+	gps->receiverConfigured = true;
+	//Rx() sleeps in poll() until a full sentence is waiting, so this no longer spins
 	while(!gps->shutDown)
 	{
+		if(gps->protocol == GPS_PROTOCOL_UBX)
+		{
+			//Binary, Rx() wakes once a NAV-PVT worth of bytes is in
+			if(gps->Rx())
+			{
+				uint32_t msgs = gps->ubxParser.encode(gps->rx_buffer,gps->bufferCount);
+				if(msgs & (UBX_PVT | UBX_VELNED))
+					gps->GetUBX(msgs);
+			}
+			continue;
+		}
 		
 		if(gps->Rx())
 		{
-			for(int i=0;i<gps->bufferCount;i++)
+			//Whole line in one call, Rx() hands us a sentence at a time, GetGPS()
+			//publishes once the epoch it belongs to is complete
+			if(gps->tinyGPS.encode((const char*)gps->rx_buffer,gps->bufferCount,(uint32_t)(unsigned long long)(gps->rxTime * 1000)))
 			{
-				if(gps->tinyGPS.encode(gps->rx_buffer[i]))
-				{
-					gps->GetGPS();
-				}
-				
+				gps->GetGPS();
 			}
-			gps->bufferBlocked = false;
 		}	
 
 	}
@@ -254,11 +478,44 @@ int GPS::Initialize()
 
 int GPS::Start()
 {
+	shutDown = false;
+	LoadWarmStart();
 	pthread_create(&(gpsThread),NULL,this->GPSMainThread,this);
         return 0;
 
 }
 
+//Stops the reader thread, it notices within GPSPOLLTIMEOUT ms
+void GPS::Stop()
+{
+	if(gpsThread == 0)
+		return;
+	shutDown = true;
+	pthread_join(gpsThread,NULL);
+	gpsThread = 0;
+	SaveWarmStart();
+	if(uart0_filestream != -1)
+		close(uart0_filestream);
+	uart0_filestream = -1;
+}
+
+
+static speed_t BaudConstant(int b)
+{
+	switch(b)
+	{
+		case 4800: return B4800;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		case 460800: return B460800;
+		case 921600: return B921600;
+		default: return B9600;
+	}
+}
+
 
 void GPS::SetupUART()
 {
@@ -282,7 +539,7 @@ void GPS::SetupUART()
         //cause the terminal device to become the controlling terminal for the process.
 
 
-        uart0_filestream = open("/dev/ttyAMA0", O_RDWR | O_NOCTTY | O_NDELAY);          //Open in non blocking read/write mode
+        uart0_filestream = open(devicePath.c_str(), O_RDWR | O_NOCTTY | O_NDELAY);          //Open in non blocking read/write mode, Rx() waits in poll()
         if (uart0_filestream == -1)
         {
                 //ERROR - CAN'T OPEN SERIAL PORT
@@ -304,43 +561,384 @@ void GPS::SetupUART()
 
         struct termios options;
         tcgetattr(uart0_filestream, &options);
-        options.c_cflag = B9600 | CS8 | CLOCAL | CREAD;         //<Set baud rate
+        options.c_cflag = CS8 | CLOCAL | CREAD;
+        cfsetispeed(&options, BaudConstant(baud));               //<Set baud rate
+        cfsetospeed(&options, BaudConstant(baud));
         options.c_iflag = IGNPAR;
         options.c_oflag = 0;
-        options.c_lflag = 0;
         tcflush(uart0_filestream, TCIFLUSH);
         tcsetattr(uart0_filestream, TCSANOW, &options);
+        SetReadMode(0);
+}
+
+
+//0 is canonical mode, the kernel hands us one whole NMEA line per read and poll() only
+//wakes when a line is complete.  Line editing chars are disabled so noise cant eat a
+//sentence.  Otherwise raw mode for UBX, poll() wakes once minBytes have arrived.
+void GPS::SetReadMode(int minBytes)
+{
+        struct termios options;
+        if(tcgetattr(uart0_filestream, &options) != 0)
+                return;
+        if(minBytes == 0)
+        {
+                options.c_lflag = ICANON;
+                options.c_cc[VEOF] = _POSIX_VDISABLE;
+                options.c_cc[VEOL] = _POSIX_VDISABLE;
+                options.c_cc[VERASE] = _POSIX_VDISABLE;
+                options.c_cc[VKILL] = _POSIX_VDISABLE;
+        }
+        else
+        {
+                options.c_lflag = 0;
+                options.c_cc[VMIN] = minBytes;
+                options.c_cc[VTIME] = 0;
+        }
+        tcsetattr(uart0_filestream, TCSANOW, &options);
 }
 
 
 
 bool GPS::Rx()
 {
-	if(bufferBlocked)
-		return false;
+        if (uart0_filestream == -1)
+                return false;
+
+        //----- WAIT FOR A LINE -----
+        //Sleep until the UART has a complete line, timing out so Stop() is seen
+        struct pollfd pfd;
+        pfd.fd = uart0_filestream;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int r = poll(&pfd,1,GPSPOLLTIMEOUT);
+        rxWakeups++;
+        if (r <= 0)
+        {
+                //Timeout, or interrupted by a signal
+                return false;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+        {
+                //Port went away, back off rather than spin on a dead descriptor
+                usleep(GPSPOLLTIMEOUT*1000);
+                return false;
+        }
 
-        //----- CHECK FOR ANY RX BYTES -----
-        if (uart0_filestream != -1)
+        // Read up to 2000 characters from the port if they are there
+        bufferCount = read(uart0_filestream, (void*)rx_buffer, 2000);          //Filestream, buffer to store in, number of bytes to read (max)
+        rxTime = GetMonotonicTime();
+        if (bufferCount <= 0)
         {
-                // Read up to 2000 characters from the port if they are there
-                bufferCount = read(uart0_filestream, (void*)rx_buffer, 2000);          //Filestream, buffer to store in, number of bytes to read (max)
-                if (bufferCount < 0)
-                {
-                        //An error occured (will occur if there are no bytes)
-			return false;
-                }
-                else if (bufferCount == 0)
-                {
-                        //No data waiting
-			return false;
-                }
-                else
-                {
-                        rx_buffer[bufferCount] = '\0';
-			bufferBlocked = true;
-			return true;
-                }
+                //An error occured or the line was already consumed
+                bufferCount = 0;
+                return false;
         }
 
+        rx_buffer[bufferCount] = '\0';
+        rxBytes += bufferCount;
+        return true;
+}
 
+
+
+//Changes the UART speed, anything already buffered at the old speed is dropped
+bool GPS::SetBaud(int b)
+{
+	struct termios options;
+	if(tcgetattr(uart0_filestream, &options) != 0)
+		return false;
+	cfsetispeed(&options, BaudConstant(b));
+	cfsetospeed(&options, BaudConstant(b));
+	if(tcsetattr(uart0_filestream, TCSANOW, &options) != 0)
+		return false;
+	tcflush(uart0_filestream, TCIFLUSH);
+	baud = b;
+	return true;
+}
+
+
+//Writes a command and waits until it has left the UART
+bool GPS::SendCommand(const string &cmd)
+{
+	size_t sent = 0;
+	while(sent < cmd.length())
+	{
+		int n = write(uart0_filestream, cmd.data() + sent, cmd.length() - sent);
+		if(n < 0)
+		{
+			if(errno != EAGAIN)
+				return false;
+			usleep(1000);
+			continue;
+		}
+		sent += n;
+	}
+	tcdrain(uart0_filestream);
+	return true;
+}
+
+
+//True once a sentence with a good checksum arrives at the current baud.  A u-blox
+//left in UBX only output from an earlier run counts too, any valid frame will do.
+bool GPS::ListenForNMEA(double timeout)
+{
+	double start = GetTimeStamp();
+	uint32_t frames = ubxParser.framesDecoded;
+	while(GetLapsedTime(start) < timeout && !shutDown)
+	{
+		if(!Rx())
+			continue;
+		if(NMEAFindValid((const char*)rx_buffer, bufferCount) >= 0)
+			return true;
+		ubxParser.encode(rx_buffer, bufferCount);
+		if(ubxParser.framesDecoded != frames)
+			return true;
+	}
+	return false;
+}
+
+
+//1 for an ACK, -1 for a refusal, 0 if nothing came back.  MTK acks are
+//$PMTK001,<cmd>,<flag> where flag 3 is success, u-blox uses ACK-ACK/ACK-NAK.
+int GPS::WaitForAck(const char *prefix,int ubxClass,int ubxId,double timeout)
+{
+	double start = GetTimeStamp();
+	while(GetLapsedTime(start) < timeout && !shutDown)
+	{
+		if(!Rx())
+			continue;
+		if(prefix != NULL)
+		{
+			long i = NMEAFindValid((const char*)rx_buffer, bufferCount, prefix);
+			if(i >= 0)
+				return rx_buffer[i + strlen(prefix)] == '3' ? 1 : -1;
+		}
+		else if((ubxParser.encode(rx_buffer, bufferCount) & UBX_ACK) &&
+			ubxParser.ackClass == ubxClass && ubxParser.ackId == ubxId)
+			return ubxParser.acked;
+	}
+	return 0;
+}
+
+
+//Tries the likely speeds until one carries good NMEA, returns 0 if none do
+int GPS::DetectBaud()
+{
+	int candidates[] = { baud, targetBaud, GPSDEFAULTBAUD, GPSHIGHBAUD, 57600, 38400, 19200, 4800 };
+	int tried[8];
+	int count = 0;
+
+	for(int i=0;i<8 && !shutDown;i++)
+	{
+		bool seen = false;
+		for(int j=0;j<count;j++)
+			if(tried[j] == candidates[i])
+				seen = true;
+		if(seen)
+			continue;
+		tried[count++] = candidates[i];
+
+		SetBaud(candidates[i]);
+		if(ListenForNMEA(GPSAUTOBAUDLISTEN))
+			return candidates[i];
+	}
+	return 0;
+}
+
+
+//How many epochs a second the port can carry without falling behind
+int GPS::MaxRateForBaud(int b)
+{
+	int r = b / 10 / GPSEPOCHBYTES;
+	if(r < 1)
+		return 1;
+	if(r > GPSMAXRATE)
+		return GPSMAXRATE;
+	return r;
+}
+
+
+double GPS::GetUpdatePeriod()
+{
+	return updatePeriod;
+}
+
+
+//Finds the receiver's baud, raises it to targetBaud and the update rate to
+//targetRate.  Anything the receiver refuses is put back the way it was, so the
+//worst case is the 1 Hz we started with.
+bool GPS::ConfigureReceiver()
+{
+	double start = GetTimeStamp();
+	bool ublox = receiverType == GPS_RECEIVER_UBLOX;
+
+	int found = DetectBaud();
+	if(found == 0)
+	{
+		cerr << "GPS: no NMEA at any baud, staying at " << GPSDEFAULTBAUD << endl;
+		SetBaud(GPSDEFAULTBAUD);
+		protocol = GPS_PROTOCOL_NMEA;
+		configSeconds = GetLapsedTime(start);
+		return false;
+	}
+	cout << "GPS: receiver found at " << found << " baud" << endl;
+	if(haveWarmStart)
+		SendWarmStart();
+
+	if(targetBaud != found)
+	{
+		char body[32];
+		snprintf(body, sizeof(body), "PMTK251,%d", targetBaud);
+		SendCommand(ublox ? UBXSetBaud(targetBaud) : NMEASentence(body));
+		//Give the receiver a moment to switch before we do
+		usleep(100000);
+		SetBaud(targetBaud);
+		if(ListenForNMEA(GPSAUTOBAUDLISTEN))
+			cout << "GPS: now at " << targetBaud << " baud" << endl;
+		else
+		{
+			cerr << "GPS: receiver did not come up at " << targetBaud << ", back to " << found << endl;
+			SetBaud(found);
+			if(!ListenForNMEA(GPSAUTOBAUDLISTEN) && DetectBaud() == 0)
+				SetBaud(found);
+		}
+	}
+
+	int rate = targetRate < MaxRateForBaud(baud) ? targetRate : MaxRateForBaud(baud);
+	if(rate > 1)
+	{
+		int ack;
+		if(ublox)
+		{
+			SendCommand(UBXSetRate(1000 / rate));
+			ack = WaitForAck(NULL, UBXCLASSCFG, UBXCFGRATE, GPSACKTIMEOUT);
+		}
+		else
+		{
+			//Only GGA, RMC and VTG, GSA/GSV would not fit at the higher rate
+			SendCommand(NMEASentence("PMTK314,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0"));
+			WaitForAck("$PMTK001,314,", 0, 0, GPSACKTIMEOUT);
+
+			char body[32];
+			snprintf(body, sizeof(body), "PMTK220,%d", 1000 / rate);
+			SendCommand(NMEASentence(body));
+			ack = WaitForAck("$PMTK001,220,", 0, 0, GPSACKTIMEOUT);
+		}
+
+		if(ack == 1)
+		{
+			updatePeriod = 1.0 / rate;
+			cout << "GPS: update rate " << rate << " Hz" << endl;
+		}
+		else
+			cerr << "GPS: receiver refused " << rate << " Hz, staying at 1 Hz" << endl;
+	}
+
+	if(protocol == GPS_PROTOCOL_UBX && !EnableUBX())
+	{
+		cerr << "GPS: receiver would not switch to UBX, staying with NMEA" << endl;
+		protocol = GPS_PROTOCOL_NMEA;
+	}
+
+	configSeconds = GetLapsedTime(start);
+	return true;
+}
+
+
+//Turns NAV-PVT on and NMEA off, then puts the UART in raw mode.  If the
+//receiver refuses either step it is left talking NMEA in canonical mode.
+bool GPS::EnableUBX()
+{
+	if(receiverType != GPS_RECEIVER_UBLOX)
+		return false;
+
+	SendCommand(UBXSetMessageRate(UBXCLASSNAV, UBXNAVPVT, 1));
+	if(WaitForAck(NULL, UBXCLASSCFG, UBXCFGMSG, GPSACKTIMEOUT) != 1)
+		return false;
+
+	//No more text lines after this, so canonical reads would never return
+	SetReadMode(UBXNAVPVTLEN + UBXFRAMEOVERHEAD);
+	SendCommand(UBXSetBaud(baud, UBXPROTOUBX));
+	if(WaitForAck(NULL, UBXCLASSCFG, UBXCFGPRT, GPSACKTIMEOUT) != 1)
+	{
+		SetReadMode(0);
+		return false;
+	}
+	cout << "GPS: receiver now sending UBX NAV-PVT" << endl;
+	return true;
+}
+
+
+//Reads the position saved by the last run, if there is one
+bool GPS::LoadWarmStart()
+{
+	haveWarmStart = false;
+	if(warmStartPath.empty())
+		return false;
+	ifstream iFile(warmStartPath.c_str());
+	char sep;
+	long t;
+	if(!(iFile >> warmStartLat >> sep >> warmStartLng >> sep >> warmStartAlt >> sep >> t))
+		return false;
+	warmStartTime = t;
+	haveWarmStart = true;
+	return true;
+}
+
+
+//Keeps the last position fix for the next boot, lat;lng;meters;unix time
+bool GPS::SaveWarmStart()
+{
+	if(warmStartPath.empty())
+		return false;
+	GPSFix fix;
+	fixLock.Read(fix);
+	if(!(fix.fields & GPSFIX_POSITION))
+		return false;
+
+	ofstream oFile(warmStartPath.c_str());
+	oFile.precision(10);
+	oFile << fix.lat << ";" << fix.lng << ";" << fix.alt * 12 / METERSTOINCHES << ";" << (long)time(NULL) << endl;
+	return oFile.good();
+}
+
+
+//Hands the receiver the saved position and the time so it can hot start
+//instead of searching the whole sky.  The Pi has no RTC, so when its clock
+//is behind the save we trust the save instead.
+bool GPS::SendWarmStart()
+{
+	time_t now = time(NULL);
+	if(now < warmStartTime)
+		now = warmStartTime;
+	struct tm utc;
+	gmtime_r(&now, &utc);
+
+	if(receiverType == GPS_RECEIVER_UBLOX)
+	{
+		SendCommand(UBXInitTime(utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, 60));
+		return SendCommand(UBXInitPosition((int32_t)(warmStartLat * 1e7), (int32_t)(warmStartLng * 1e7),
+			(int32_t)(warmStartAlt * 100), GPSWARMSTARTACCURACY * 100));
+	}
+
+	char body[96];
+	snprintf(body, sizeof(body), "PMTK741,%.6f,%.6f,%.0f,%04d,%02d,%02d,%02d,%02d,%02d", warmStartLat, warmStartLng, warmStartAlt,
+		utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec);
+	return SendCommand(NMEASentence(body));
+}
+
+
+//Blocks until a fix with a position is published, false on timeout
+bool GPS::WaitForFix(double timeout)
+{
+	double start = GetMonotonicTime();
+	while(GetMonotonicTime() - start < timeout)
+	{
+		GPSFix fix;
+		fixLock.Read(fix);
+		if(fix.fields & GPSFIX_POSITION)
+			return true;
+		usleep(20000);
+	}
+	return false;
 }
@@ -5,6 +5,9 @@ Joey Thompson 4/21/2015
 multi-threaded GPS program
 
 ***********************************************/
+#ifndef __GPS_h
+#define __GPS_h
+
 #include <string>
 #include <sys/time.h>
 using namespace std;
@@ -12,8 +15,13 @@ using namespace std;
 #include <unistd.h>                     //Used for UART
 #include <fcntl.h>                      //Used for UART
 #include <termios.h>            //Used for UART
+#include <poll.h>                       //Used for UART
 #include <stdlib.h>
 #include "TinyGPS++.h"
+#include "seqlock.h"
+#include "nmea.h"
+#include "ubx.h"
+#include "geo.h"
 #include <math.h>
 
 #define METERSTOINCHES 		39.3701
@@ -22,6 +30,33 @@ using namespace std;
 #define GPSINCHESDEADBAND 	MININCHES*3
 #define GPSMETERSDEADBAND	.0836897
 #define GPSHEADINGDEADBAND	.5
+#define GPSMMDEADBAND		(MINMETERS*3*1000)
+
+//UART the Microstack GPS is wired to, override with devicePath (a pty works too)
+#define GPSDEVICE		"/dev/ttyAMA0"
+//How long the reader sleeps in poll() before rechecking shutDown, in ms
+#define GPSPOLLTIMEOUT		250
+
+//Receiver configuration, see ConfigureReceiver()
+#define GPS_RECEIVER_MTK	0	//Microstack and other MediaTek, PMTK commands
+#define GPS_RECEIVER_UBLOX	1	//u-blox, UBX CFG messages
+#define GPSDEFAULTBAUD		9600	//Microstack power on default
+#define GPSHIGHBAUD		115200
+#define GPSHIGHRATE		10	//Hz, the most MTK and u-blox NMEA will do
+#define GPSMAXRATE		50	//Hz, the most targetRate may ask for, receivers refuse what they cannot do
+#define GPSAUTOBAUDLISTEN	1.5	//Seconds to listen for good NMEA at each candidate baud
+#define GPSACKTIMEOUT		1.5	//Seconds to wait for a PMTK001 or UBX ACK
+#define GPSEPOCHBYTES		250	//GGA+RMC+VTG per epoch with headroom, caps the rate a baud can carry
+#define GPSSTALEEPOCHS		3	//A fix older than this many update periods is not steered on
+#define GPSFIXLATENCY		0.1	//Seconds from an epoch to its last byte arriving, the receiver's solve and send
+
+//Hot start cache, see SaveWarmStart()
+#define GPSWARMSTARTFILE	"/home/pi/waypoints/gpswarmstart.txt"
+#define GPSWARMSTARTACCURACY	1000	//Meters we claim for the saved position, the quad may have been carried
+
+//What the receiver talks once configured, GPS_PROTOCOL_UBX needs a u-blox
+#define GPS_PROTOCOL_NMEA	0	//Text sentences through TinyGPS++
+#define GPS_PROTOCOL_UBX	1	//Binary NAV-PVT, one 100 byte frame per epoch
 
 //Macro Waypoint Structure
 struct WayPoint
@@ -30,8 +65,36 @@ struct WayPoint
         double lat;
         double alt;
         double heading;
+	double seconds;		//Into the recording, 0 for a waypoint that was not recorded
 };
 
+//GPSFix.fields, which values the receiver sent for this epoch
+#define GPSFIX_TIME		1
+#define GPSFIX_POSITION		2
+#define GPSFIX_ALTITUDE		4
+#define GPSFIX_COURSE		8
+#define GPSFIX_SPEED		16
+//What GGA plus RMC give us, the Microstack sends both every epoch
+#define GPSFIX_EPOCHFIELDS	(GPSFIX_TIME | GPSFIX_POSITION | GPSFIX_ALTITUDE | GPSFIX_COURSE | GPSFIX_SPEED)
+#define GPSNOTIME		0xffffffff
+
+//One coherent GPS fix, every field comes from the same publish
+//Fields not flagged in fields hold the value from the last epoch that had them
+struct GPSFix
+{
+	double lat;
+	double lng;
+	GeoPoint position;	//lat/lng in nanodegrees, exactly as the receiver sent them
+	double alt;		//Feet, less the CalibrateAltitude() offset
+	double course;		//Degrees true
+	double speed;		//Meters per second
+	double timeStamp;	//GetTimeStamp() when the fix was published
+	double arrivalTime;	//GetMonotonicTime() when read() returned the bytes that completed it
+	double positionTime;	//arrivalTime of the last epoch with a position, 0 for none yet
+	uint32_t utcTime;	//hhmmsscc of the epoch, as TinyGPSTime::value()
+	uint32_t fields;	//GPSFIX_ flags
+	uint32_t sequence;	//Increments per publish, 0 means no fix yet
+};
 
 
 class GPS
@@ -44,16 +107,41 @@ class GPS
 	
 		GPS *thisGPS;	
 		bool GetGPS();
+		GPSFix GetFix();
+		void PublishFix(GPSFix &fix);
 		string GetGPStxt();
 		bool CheckGPS();
 		bool CalculateVars();
 		double GetTimeStamp();
 		double GetLapsedTime(double ts);
+		double GetMonotonicTime();
+		bool IsStale(const GPSFix &fix);
 		int Initialize();
 		int Start();
+		void Stop();
 		bool Rx();
 		void SetupUART();
+		void SetReadMode(int minBytes);
+		bool GetUBX(uint32_t msgs);
+		bool EnableUBX();
+
+		//Startup sequence for high rate mode, runs on the GPS thread before reading
+		bool ConfigureReceiver();
+		int DetectBaud();
+		bool SetBaud(int b);
+		bool SendCommand(const string &cmd);
+		bool ListenForNMEA(double timeout);
+		int WaitForAck(const char *prefix,int ubxClass,int ubxId,double timeout);
+		int MaxRateForBaud(int b);
+		double GetUpdatePeriod();
+
+		//Warm start, the last fix is saved on Stop() and sent back as a hint after the next Start()
+		bool LoadWarmStart();
+		bool SaveWarmStart();
+		bool SendWarmStart();
+		bool WaitForFix(double timeout);
 		TinyGPSPlus tinyGPS;	
+		UBXParser ubxParser;
 		double GetLat();
 		double GetLong();
 		double GetAlt();
@@ -92,7 +180,6 @@ class GPS
 		double velocityY;
 		double velocityZ;
 		double velocityR;
-                bool bufferBlocked;
 		bool shutDown;
                 int bufferCount;
                 int bufferIndex;
@@ -102,7 +189,20 @@ class GPS
 
 
 		bool isLocked;
-		bool readBlock;
+
+		//Written by the GPS thread only, read from anywhere through GetFix()
+		SeqLock<GPSFix> fixLock;
+		uint32_t fixSequence;
+
+		//Epoch assembly, GPS thread only.  Sentences sharing a UTC time are
+		//merged into epochFix, which is published once epochFields are all in.
+		void PublishEpoch();
+		GPSFix epochFix;
+		GPSFix publishedFix;
+		bool epochOpen;
+		uint32_t epochTime;
+		uint32_t publishedTime;
+		uint32_t epochFields;
 
 		double traveledX;
 		double traveledY;
@@ -113,8 +213,37 @@ class GPS
 		double lapsedGPS;
 		double prevLastGPSCheck;
 		int uart0_filestream;
+		string devicePath;
+
+		//Receiver settings, set before Start().  Leaving targetBaud at baud and
+		//targetRate at 1 skips ConfigureReceiver() entirely.
+		int receiverType;
+		int protocol;
+		int baud;
+		int targetBaud;
+		int targetRate;
+		std::atomic<double> updatePeriod;
+		std::atomic<bool> receiverConfigured;
+		double configSeconds;
+
+		//Empty turns the warm start cache off
+		string warmStartPath;
+		bool haveWarmStart;
+		double warmStartLat;
+		double warmStartLng;
+		double warmStartAlt;	//Meters
+		time_t warmStartTime;
+
+		//Reader statistics, a wakeup is one return from poll()
+		unsigned long rxWakeups;
+		unsigned long rxBytes;
+		double rxTime;		//GetMonotonicTime() when the last read() returned
+
+		//Arrival to publish latency in seconds, what parsing and epoch assembly add
+		unsigned long latencyCount;
+		double latencyTotal;
+		double latencyWorst;
 	
 };
 
-
-
+#endif // def(__GPS_h)
@@ -0,0 +1,298 @@
+#include "grid.h"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+//Legs are registered in every cell they cross, widened by this so float rounding
+//at a cell edge cannot leave a leg out of the cell its closest point is in
+#define GRIDEDGESLACK		0.001f
+
+
+static inline float SegmentDistance2(float ae,float an,float be,float bn,float pe,float pn)
+{
+	float de = be - ae;
+	float dn = bn - an;
+	float we = pe - ae;
+	float wn = pn - an;
+	float dd = de * de + dn * dn;
+	float t = dd > 0 ? (we * de + wn * dn) / dd : 0;
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	float qe = we - t * de;
+	float qn = wn - t * dn;
+	return qe * qe + qn * qn;
+}
+
+
+TrackGrid::TrackGrid()
+{
+	track = NULL;
+	cell = 1;
+	columns = 0;
+	rows = 0;
+	minEast = 0;
+	minNorth = 0;
+}
+
+
+int TrackGrid::Column(float e) const
+{
+	int c = (int)floorf((e - minEast) / cell);
+	return c < 0 ? 0 : (c >= columns ? columns - 1 : c);
+}
+
+
+int TrackGrid::Row(float n) const
+{
+	int r = (int)floorf((n - minNorth) / cell);
+	return r < 0 ? 0 : (r >= rows ? rows - 1 : r);
+}
+
+
+void TrackGrid::Build(const Track &t)
+{
+	track = &t;
+	int count = t.Count();
+	columns = 0;
+	rows = 0;
+	pointStart.clear();
+	points.clear();
+	legStart.clear();
+	legs.clear();
+	if(count == 0)
+		return;
+
+	const float *e = t.east.data();
+	const float *n = t.north.data();
+	float maxEast = e[0],maxNorth = n[0];
+	minEast = e[0];
+	minNorth = n[0];
+	for(int i=1;i<count;i++)
+	{
+		minEast = min(minEast,e[i]);
+		maxEast = max(maxEast,e[i]);
+		minNorth = min(minNorth,n[i]);
+		maxNorth = max(maxNorth,n[i]);
+	}
+
+	//Sized for GRIDPOINTSPERCELL on average if the points filled the box
+	float width = maxEast - minEast;
+	float height = maxNorth - minNorth;
+	cell = sqrtf(width * height * GRIDPOINTSPERCELL / count);
+	if(cell < GRIDMINCELL)
+		cell = GRIDMINCELL;
+	for(;;)
+	{
+		columns = (int)(width / cell) + 1;
+		rows = (int)(height / cell) + 1;
+		if((long)columns * rows <= GRIDMAXCELLS)
+			break;
+		cell *= 2;
+	}
+	int cells = columns * rows;
+
+	//Counting sort of the points by cell, stable so each cell lists them in order
+	vector<int> pointCell(count);
+	pointStart.assign(cells + 1,0);
+	for(int i=0;i<count;i++)
+	{
+		pointCell[i] = Row(n[i]) * columns + Column(e[i]);
+		pointStart[pointCell[i] + 1]++;
+	}
+	for(int c=0;c<cells;c++)
+		pointStart[c + 1] += pointStart[c];
+	points.resize(count);
+	vector<int> fill(pointStart.begin(),pointStart.end() - 1);
+	for(int i=0;i<count;i++)
+		points[fill[pointCell[i]]++] = i;
+
+	//Legs, every cell each one passes through, a column slab at a time
+	vector<int> legCell;
+	vector<int> legIndex;
+	for(int i=0;i + 1<count;i++)
+	{
+		float ae = e[i],an = n[i],be = e[i + 1],bn = n[i + 1];
+		int c0 = Column(min(ae,be) - GRIDEDGESLACK);
+		int c1 = Column(max(ae,be) + GRIDEDGESLACK);
+		for(int c=c0;c<=c1;c++)
+		{
+			float lo = an,hi = bn;
+			if(c0 != c1 && be != ae)
+			{
+				//Where the leg is while it crosses this column, never past its ends
+				float x0 = max(minEast + c * cell,min(ae,be)) - GRIDEDGESLACK;
+				float x1 = min(minEast + (c + 1) * cell,max(ae,be)) + GRIDEDGESLACK;
+				float slope = (bn - an) / (be - ae);
+				lo = an + (x0 - ae) * slope;
+				hi = an + (x1 - ae) * slope;
+				lo = min(max(lo,min(an,bn)),max(an,bn));
+				hi = min(max(hi,min(an,bn)),max(an,bn));
+			}
+			int r0 = Row(min(lo,hi) - GRIDEDGESLACK);
+			int r1 = Row(max(lo,hi) + GRIDEDGESLACK);
+			for(int r=r0;r<=r1;r++)
+			{
+				legCell.push_back(r * columns + c);
+				legIndex.push_back(i);
+			}
+		}
+	}
+	legStart.assign(cells + 1,0);
+	for(size_t k=0;k<legCell.size();k++)
+		legStart[legCell[k] + 1]++;
+	for(int c=0;c<cells;c++)
+		legStart[c + 1] += legStart[c];
+	legs.resize(legCell.size());
+	fill.assign(legStart.begin(),legStart.end() - 1);
+	for(size_t k=0;k<legCell.size();k++)
+		legs[fill[legCell[k]]++] = legIndex[k];
+}
+
+
+int TrackGrid::Nearest(float pe,float pn,float &distance) const
+{
+	distance = 0;
+	if(columns == 0)
+		return -1;
+	const float *e = track->east.data();
+	const float *n = track->north.data();
+	int c0 = Column(pe);
+	int r0 = Row(pn);
+	int maxRing = max(max(c0,columns - 1 - c0),max(r0,rows - 1 - r0));
+	int best = -1;
+	float best2 = FLT_MAX;
+	for(int ring=0;ring<=maxRing;ring++)
+	{
+		for(int r=max(r0 - ring,0);r<=min(r0 + ring,rows - 1);r++)
+		{
+			//Whole rows at the top and bottom of the ring, just the two ends in between
+			bool edge = r == r0 - ring || r == r0 + ring;
+			int step = edge ? 1 : 2 * ring;
+			for(int c=c0 - ring;c<=c0 + ring;c+=step)
+			{
+				if(c < 0 || c >= columns)
+					continue;
+				int cellIndex = r * columns + c;
+				for(int k=pointStart[cellIndex];k<pointStart[cellIndex + 1];k++)
+				{
+					int i = points[k];
+					float de = e[i] - pe;
+					float dn = n[i] - pn;
+					float d2 = de * de + dn * dn;
+					if(d2 < best2 || (d2 == best2 && i < best))
+					{
+						best2 = d2;
+						best = i;
+					}
+				}
+			}
+		}
+		//Cells further out are at least this far away
+		float reach = ring * cell;
+		if(best >= 0 && best2 <= reach * reach)
+			break;
+	}
+	distance = sqrtf(best2);
+	return best;
+}
+
+
+int TrackGrid::NearestLeg(float pe,float pn,float &distance) const
+{
+	distance = 0;
+	if(columns == 0 || track->Count() < 2)
+		return -1;
+	const float *e = track->east.data();
+	const float *n = track->north.data();
+	int c0 = Column(pe);
+	int r0 = Row(pn);
+	int maxRing = max(max(c0,columns - 1 - c0),max(r0,rows - 1 - r0));
+	int best = -1;
+	float best2 = FLT_MAX;
+	for(int ring=0;ring<=maxRing;ring++)
+	{
+		for(int r=max(r0 - ring,0);r<=min(r0 + ring,rows - 1);r++)
+		{
+			bool edge = r == r0 - ring || r == r0 + ring;
+			int step = edge ? 1 : 2 * ring;
+			for(int c=c0 - ring;c<=c0 + ring;c+=step)
+			{
+				if(c < 0 || c >= columns)
+					continue;
+				int cellIndex = r * columns + c;
+				for(int k=legStart[cellIndex];k<legStart[cellIndex + 1];k++)
+				{
+					int i = legs[k];
+					float d2 = SegmentDistance2(e[i],n[i],e[i + 1],n[i + 1],pe,pn);
+					if(d2 < best2 || (d2 == best2 && i < best))
+					{
+						best2 = d2;
+						best = i;
+					}
+				}
+			}
+		}
+		float reach = ring * cell;
+		if(best >= 0 && best2 <= reach * reach)
+			break;
+	}
+	distance = sqrtf(best2);
+	return best;
+}
+
+
+void TrackGrid::Within(float pe,float pn,float radius,vector<int> &found) const
+{
+	found.clear();
+	if(columns == 0)
+		return;
+	const float *e = track->east.data();
+	const float *n = track->north.data();
+	float r2 = radius * radius;
+	int c0 = Column(pe - radius),c1 = Column(pe + radius);
+	int r0 = Row(pn - radius),r1 = Row(pn + radius);
+	for(int r=r0;r<=r1;r++)
+		for(int c=c0;c<=c1;c++)
+		{
+			int cellIndex = r * columns + c;
+			for(int k=pointStart[cellIndex];k<pointStart[cellIndex + 1];k++)
+			{
+				int i = points[k];
+				float de = e[i] - pe;
+				float dn = n[i] - pn;
+				if(de * de + dn * dn <= r2)
+					found.push_back(i);
+			}
+		}
+	sort(found.begin(),found.end());
+}
+
+
+int TrackGrid::Nearest(const GeoPoint &p,float &distance) const
+{
+	float e,n;
+	if(track == NULL)
+		return -1;
+	track->Project(p,e,n);
+	return Nearest(e,n,distance);
+}
+
+
+int TrackGrid::NearestLeg(const GeoPoint &p,float &distance) const
+{
+	float e,n;
+	if(track == NULL)
+		return -1;
+	track->Project(p,e,n);
+	return NearestLeg(e,n,distance);
+}
+
+
+void TrackGrid::Within(const GeoPoint &p,float radius,vector<int> &found) const
+{
+	float e,n;
+	found.clear();
+	if(track == NULL)
+		return;
+	track->Project(p,e,n);
+	Within(e,n,radius,found);
+}
@@ -0,0 +1,64 @@
+/************************************************
+Track grid - spatial index over a Track
+
+A uniform grid over a track's ENU meters, built
+once when a mission loads, for rejoining a recorded
+macro after a manual override without scanning
+every waypoint.  Cells hold waypoint indexes and
+the legs whose bounding box touches them, both
+packed into flat arrays (counting sort, no per
+cell allocations).
+
+Nearest searches walk rings of cells outwards from
+the query and stop once no unsearched cell could
+hold anything closer.
+
+***********************************************/
+#ifndef __Grid_h
+#define __Grid_h
+
+#include <vector>
+#include "track.h"
+using namespace std;
+
+#define GRIDPOINTSPERCELL	4	//Average waypoints a cell is sized for
+#define GRIDMINCELL		0.5f	//Meters, keeps a hover recording from making millions of cells
+#define GRIDMAXCELLS		(1 << 20)
+
+
+class TrackGrid
+{
+	public:
+		TrackGrid();
+
+		//Indexes track as it is now, build again after it changes
+		void Build(const Track &track);
+
+		//Closest waypoint and closest leg (waypoint i to i + 1), -1 if there are none
+		int Nearest(const GeoPoint &p,float &distance) const;
+		int NearestLeg(const GeoPoint &p,float &distance) const;
+		int Nearest(float e,float n,float &distance) const;
+		int NearestLeg(float e,float n,float &distance) const;
+
+		//Every waypoint within radius meters, in index order
+		void Within(const GeoPoint &p,float radius,vector<int> &found) const;
+		void Within(float e,float n,float radius,vector<int> &found) const;
+
+		float cell;		//Meters per cell side
+		int columns;
+		int rows;
+
+	private:
+		const Track *track;
+		float minEast;
+		float minNorth;
+		vector<int> pointStart;		//Cell c holds points[pointStart[c]..pointStart[c + 1])
+		vector<int> points;
+		vector<int> legStart;
+		vector<int> legs;
+
+		int Column(float e) const;
+		int Row(float n) const;
+};
+
+#endif // def(__Grid_h)
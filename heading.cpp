@@ -1,10 +1,15 @@
 #include "heading.h"
 #include <iostream>
+#include <time.h>
 using namespace std;
 
 Heading::Heading(int address)
 {
 	this->address = address;
+	declination = HEADINGDECLINATION;
+	reads = 0;
+	readTime = 0;
+	currentHeading = previousHeading = 0;
 }
 
 
@@ -69,8 +74,7 @@ float Heading::GetHeading()
 
 	 float heading = atan2(fy,fx);
 
-        float declinationAngle = 0.22;
-  	heading += declinationAngle;
+  	heading += declination;
   	if(heading < 0)
     	heading += 2*PI;
 	if(heading > 2*PI)
@@ -78,6 +82,11 @@ float Heading::GetHeading()
 
 	previousHeading = currentHeading;
   	currentHeading = heading * 180/M_PI;
+	reads++;
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	readTime = ts.tv_sec + ts.tv_nsec / 1e9;
+	history.Add(readTime,currentHeading);
 	//currentHeading = CorrectHeading(currentHeading);
 
 	return currentHeading;
@@ -99,5 +108,9 @@ bool Heading::HeadingReached(double heading)
 }
 
 
-
-
+float Heading::HeadingAt(double time)
+{
+	float h = currentHeading;
+	history.At(time,h);
+	return h;
+}
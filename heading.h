@@ -1,10 +1,15 @@
 #include <wiringPi.h>
 #include <wiringPiI2C.h>
 #include <math.h>
+#include "history.h"
 #define SENSORS_GAUSS_TO_MICROTESLA       (100)
 #define     PI 3.1415926535897932384626433832795
 #define HEADINGADDRESS          0x1e
 #define HEADINGDEADBAND		2
+//Radians added to the magnetic heading until a declination grid is built where we fly
+#define HEADINGDECLINATION	0.22
+//Reads kept for HeadingAt(), a few seconds at the rate the loops read
+#define HEADINGHISTORY		64
 
 
 
@@ -21,10 +26,16 @@ class Heading
 	float fx,fy,fz;
 	short int x,y,z;
 	float currentHeading,previousHeading;
+	float declination;	//Radians, east positive
+	unsigned long reads;	//GetHeading() calls, so a reader can tell a new value
+	double readTime;	//CLOCK_MONOTONIC seconds of the last read, the clock GPSFix.arrivalTime uses
+	SensorHistory<float,HEADINGHISTORY,AngleBlend> history;
 
 	Heading(int address);
 	int Initialize();
 	float GetHeading();
 	bool HeadingReached(double);
+	//What the magnetometer read at a CLOCK_MONOTONIC time, the nearest read if it was not reading then
+	float HeadingAt(double time);
 	
 };
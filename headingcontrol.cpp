@@ -0,0 +1,175 @@
+#include "headingcontrol.h"
+#include "controlbyte.h"
+#include <math.h>
+#include <algorithm>
+using namespace std;
+
+#define HEADINGRATEFILTER	0.25f	//Of a new rate or held error taken each read
+
+
+HeadingController::HeadingController()
+{
+	deadband = HEADINGCONTROLBAND;
+	holdBand = HEADINGHOLDBAND;
+	settle = HEADINGSETTLE;
+	lead = HEADINGLEAD;
+	commandPeriod = HEADINGCOMMANDPERIOD;
+	readPeriod = HEADINGREADPERIOD;
+	timeout = HEADINGTIMEOUT;
+	retry = HEADINGRETRY;
+	commands = reads = timeouts = 0;
+	Release();
+}
+
+
+void HeadingController::Target(float degrees,double now)
+{
+	degrees = fmodf(degrees,360);
+	if(degrees < 0)
+		degrees += 360;
+	bool moved = fabsf(Error(degrees)) > holdBand;
+	target = degrees;
+	if(state == HEADINGIDLE || moved || (state == HEADINGTIMEDOUT && now - gaveUp >= retry))
+	{
+		state = HEADINGTURNING;
+		started = now;
+	}
+}
+
+
+void HeadingController::Rearm(double now)
+{
+	if(state != HEADINGTIMEDOUT)
+		return;
+	state = HEADINGTURNING;
+	started = now;
+}
+
+
+void HeadingController::Release()
+{
+	state = HEADINGIDLE;
+	target = 0;
+	rotate = 0;
+	started = 0;
+	lastStart = -1e9;
+	lastRead = -1e9;
+	settleUntil = 0;
+	gaveUp = 0;
+	yawRate = 0;
+	heldError = 0;
+	lastHeading = 0;
+	lastHeadingTime = 0;
+}
+
+
+bool HeadingController::ReadDue(double now)
+{
+	if(state == HEADINGIDLE || state == HEADINGTIMEDOUT || now - lastRead < readPeriod)
+		return false;
+	lastRead = now;
+	reads++;
+	return true;
+}
+
+
+int HeadingController::State() const
+{
+	return state;
+}
+
+
+float HeadingController::Error(float heading) const
+{
+	float d = fmodf(target - heading,360);
+	if(d > 180)
+		d -= 360;
+	else if(d <= -180)
+		d += 360;
+	return d;
+}
+
+
+//Stops at once, starts no sooner than commandPeriod after the last start
+void HeadingController::Command(int bits,double now)
+{
+	if(bits == rotate)
+		return;
+	if(bits)
+	{
+		if(now - lastStart < commandPeriod)
+			return;
+		lastStart = now;
+	}
+	rotate = bits;
+	commands++;
+}
+
+
+int HeadingController::Step(double now,float heading)
+{
+	//A new read, the turn rate from the last averaged with the rate before, a degree of noise over one
+	//read apart is 15 degrees a second
+	bool fresh = heading != lastHeading;
+	if(fresh)
+	{
+		float d = heading - lastHeading;
+		if(d > 180)
+			d -= 360;
+		else if(d < -180)
+			d += 360;
+		if(lastHeadingTime > 0 && now > lastHeadingTime)
+			yawRate += (d / (now - lastHeadingTime) - yawRate) * HEADINGRATEFILTER;
+		lastHeading = heading;
+		lastHeadingTime = now;
+	}
+
+	float error = Error(heading);
+	switch(state)
+	{
+		case HEADINGTURNING:
+		{
+			//Left to go in the direction already turning, past the target is negative
+			float togo = rotate == CONTROLROTATERIGHT ? error : rotate == CONTROLROTATELEFT ? -error : fabsf(error);
+			if(togo <= max(deadband,fabsf(yawRate) * (float)lead))
+			{
+				Command(0,now);
+				state = HEADINGSETTLING;
+				settleUntil = now + settle;
+			}
+			else if(now - started > timeout)
+			{
+				Command(0,now);
+				state = HEADINGTIMEDOUT;
+				gaveUp = now;
+				timeouts++;
+			}
+			else
+				Command(error > 0 ? CONTROLROTATERIGHT : CONTROLROTATELEFT,now);
+			break;
+		}
+
+		case HEADINGSETTLING:
+			heldError = error;
+			if(now >= settleUntil)
+				state = HEADINGHOLDING;
+			break;
+
+		//Averaged over reads, one noisy read does not start a turn
+		case HEADINGHOLDING:
+			if(fresh)
+				heldError += (error - heldError) * HEADINGRATEFILTER;
+			if(fabsf(heldError) > holdBand)
+			{
+				state = HEADINGTURNING;
+				started = now;
+				Command(error > 0 ? CONTROLROTATERIGHT : CONTROLROTATELEFT,now);
+			}
+			break;
+
+		default:
+			Command(0,now);
+			break;
+	}
+	return rotate;
+}
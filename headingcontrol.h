@@ -0,0 +1,99 @@
+/************************************************
+HeadingController - turning to a heading a tick at a time
+
+Replaces the loop that spun on the magnetometer and
+the control switch until the quad faced a heading.
+Step() is called once a pass of the control loop
+with the last heading read and returns the rotate
+bits for the control byte, nothing in here waits.
+
+Turns go the short way round.  A rotation stops
+once the heading is within deadband, or within the
+lead seconds of turn at the rate it is turning (the
+read is old and the quad coasts), or has gone past.
+Then the quad is given settle seconds to stop
+turning before the heading is looked at again.  A
+heading held is only turned back to once it is more
+than holdBand off on average, so the quad does not hunt about
+the target.  Starting a rotation is rate limited to
+one every commandPeriod seconds, stopping one never
+is.  ReadDue() says when the magnetometer has a new
+measurement worth the I2C reads.
+
+No I2C in here, the caller reads the magnetometer
+and sends the byte.
+
+***********************************************/
+#ifndef __HeadingControl_h
+#define __HeadingControl_h
+
+#include <stdint.h>
+
+#define HEADINGCONTROLBAND	2.0f	//Degrees either side of the target a turn stops in, as HEADINGDEADBAND
+#define HEADINGHOLDBAND		2.5f	//Degrees a held heading drifts before it is turned back to
+#define HEADINGSETTLE		0.3	//Seconds for the quad to stop turning
+#define HEADINGLEAD		0.22	//Seconds of turn a rotation is stopped short by, the coast and a read's age
+#define HEADINGCOMMANDPERIOD	0.25	//Seconds, the least between starting rotations
+#define HEADINGREADPERIOD	0.067	//Seconds between magnetometer reads, it measures at 15 Hz
+#define HEADINGTIMEOUT		10.0	//Seconds a turn may take, a 180 at 45 degrees a second is 4
+#define HEADINGRETRY		3.0	//Seconds after a timeout before Target() turns again
+
+//Step() states
+#define HEADINGIDLE		0	//No target, no rotation
+#define HEADINGTURNING		1
+#define HEADINGSETTLING		2
+#define HEADINGHOLDING		3
+#define HEADINGTIMEDOUT		4	//Gave up, waits retry seconds, a new target or Rearm()
+
+
+class HeadingController
+{
+	public:
+		HeadingController();
+
+		//Degrees true.  A target within holdBand of the last one only moves it, a turn under way carries on.
+		void Target(float degrees,double now);
+		//Turns again after a timeout without waiting for retry, for a new leg
+		void Rearm(double now);
+		void Release();
+
+		//True once a pass, at most every readPeriod, while there is a target
+		bool ReadDue(double now);
+		//The heading last read, degrees.  Returns CONTROLROTATERIGHT, CONTROLROTATELEFT or 0.
+		int Step(double now,float heading);
+
+		int State() const;
+		//Degrees to turn right to the target, -180..180
+		float Error(float heading) const;
+
+		float deadband;
+		float holdBand;
+		double settle;
+		double lead;
+		double commandPeriod;
+		double readPeriod;
+		double timeout;
+		double retry;
+
+		int rotate;		//Rotate bits Step() last returned
+		uint32_t commands;	//Times rotate has changed
+		uint32_t reads;		//ReadDue() answered true
+		uint32_t timeouts;
+		float yawRate;		//Degrees per second, from the reads
+
+	private:
+		void Command(int bits,double now);
+
+		int state;
+		float target;
+		double started;		//Of the turn
+		double lastStart;	//Of the last rotation
+		double lastRead;
+		double settleUntil;
+		double gaveUp;		//When the last turn timed out
+		float heldError;	//Degrees, averaged while holding
+		float lastHeading;
+		double lastHeadingTime;
+};
+
+#endif // def(__HeadingControl_h)
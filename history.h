@@ -0,0 +1,175 @@
+/************************************************
+SensorHistory - the last few seconds of a sensor
+
+A fixed size ring of timestamped samples, oldest
+overwritten first.  Times and values are kept in
+separate arrays so the binary search for a time
+only walks the times.  At() blends the two samples
+either side of a time, so a fix that arrived late
+can be paired with the heading the magnetometer
+read when the fix was measured, not the one it
+reads now.
+
+Times must not go backwards, any clock will do as
+long as a stream and its readers share it.  One
+thread writes and reads a history, a history
+shared between threads needs a lock around it.
+
+***********************************************/
+#ifndef __History_h
+#define __History_h
+
+#include <string.h>
+
+
+//a to b by f, 0..1
+template <class T>
+struct LinearBlend
+{
+	T operator()(const T &a,const T &b,double f) const
+	{
+		return a + (b - a) * f;
+	}
+};
+
+
+//Degrees, the short way round, 0..360
+struct AngleBlend
+{
+	float operator()(float a,float b,double f) const
+	{
+		float d = b - a;
+		if(d > 180)
+			d -= 360;
+		else if(d < -180)
+			d += 360;
+		float r = a + d * (float)f;
+		if(r < 0)
+			r += 360;
+		else if(r >= 360)
+			r -= 360;
+		return r;
+	}
+};
+
+
+//A value that holds until the next, like a control byte
+template <class T>
+struct HoldBlend
+{
+	T operator()(const T &a,const T &,double) const
+	{
+		return a;
+	}
+};
+
+
+//CAPACITY must be a power of two
+template <class T,int CAPACITY,class Blend = LinearBlend<T> >
+class SensorHistory
+{
+	public:
+		SensorHistory() : first(0), count(0)
+		{
+			static_assert((CAPACITY & (CAPACITY - 1)) == 0,"SensorHistory capacity must be a power of two");
+		}
+
+		void Clear()
+		{
+			first = count = 0;
+		}
+
+		//A time equal to the newest replaces it, an older one is dropped
+		void Add(double time,const T &value)
+		{
+			if(count > 0)
+			{
+				int newest = (first + count - 1) & MASK;
+				if(time < times[newest])
+					return;
+				if(time == times[newest])
+				{
+					values[newest] = value;
+					return;
+				}
+			}
+			int i;
+			if(count < CAPACITY)
+				i = (first + count++) & MASK;
+			else
+			{
+				i = first;
+				first = (first + 1) & MASK;
+			}
+			times[i] = time;
+			values[i] = value;
+		}
+
+		int Count() const
+		{
+			return count;
+		}
+
+		double Oldest() const
+		{
+			return times[first];
+		}
+
+		double Newest() const
+		{
+			return times[(first + count - 1) & MASK];
+		}
+
+		const T &Latest() const
+		{
+			return values[(first + count - 1) & MASK];
+		}
+
+		//Blended from the samples either side of time.  False outside the history, value is then the
+		//oldest or the newest sample.  Nothing is written with no samples.
+		bool At(double time,T &value) const
+		{
+			if(count == 0)
+				return false;
+			if(time <= times[first])
+			{
+				value = values[first];
+				return time == times[first];
+			}
+			int last = (first + count - 1) & MASK;
+			if(time >= times[last])
+			{
+				value = values[last];
+				return time == times[last];
+			}
+
+			//The last sample at or before time.  Most questions are about the last moment, so the search
+			//gallops back from the newest before it halves, log of how far back rather than of the size.
+			int hi = count - 1,step = 1;
+			while(step < hi && times[(first + hi - step) & MASK] > time)
+				step *= 2;
+			int lo = step < hi ? hi - step : 0;
+			hi -= step / 2;
+			while(hi - lo > 1)
+			{
+				int mid = (lo + hi) / 2;
+				if(times[(first + mid) & MASK] <= time)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			int a = (first + lo) & MASK,b = (first + hi) & MASK;
+			value = blend(values[a],values[b],(time - times[a]) / (times[b] - times[a]));
+			return true;
+		}
+
+	private:
+		enum { MASK = CAPACITY - 1 };
+		double times[CAPACITY];
+		T values[CAPACITY];
+		int first;
+		int count;
+		Blend blend;
+};
+
+#endif // def(__History_h)
@@ -0,0 +1,158 @@
+#include "mission.h"
+#include "gps.h"
+#include <math.h>
+
+
+MissionExecutor::MissionExecutor()
+{
+	cruise = MISSIONCRUISE;
+	leg = 0;
+	holdEast = 0;
+	holdNorth = 0;
+	holdAlt = 0;
+	holdArrival = MISSIONARRIVAL;
+	request.heading = 0;
+	request.alt = 0;
+	request.speed = 0;
+	request.leg = -1;
+	request.crossTrack = 0;
+	request.alongTrack = 0;
+	request.done = true;
+}
+
+
+void MissionExecutor::Clear()
+{
+	track.Clear();
+	grid.Build(track);
+	legs.clear();
+	leg = 0;
+	request.speed = 0;
+	request.leg = -1;
+	request.done = true;
+}
+
+
+int MissionExecutor::Count() const
+{
+	return (int)legs.size();
+}
+
+
+bool MissionExecutor::Load(const WayPoint *wp,int count)
+{
+	Clear();
+	if(count <= 0)
+		return false;
+	track.Load(wp,count);
+	grid.Build(track);
+
+	//One batch pass for lengths and bearings, the rest is per leg arithmetic
+	int n = count - 1;
+	vector<float> length(count),bearing(count),cumulative(count);
+	float total = track.Legs(length.data(),bearing.data(),cumulative.data());
+	legs.resize(n);
+	for(int i=0;i<n;i++)
+	{
+		MissionLeg &l = legs[i];
+		l.east = track.east[i];
+		l.north = track.north[i];
+		l.length = length[i];
+		l.unitEast = length[i] > 0 ? (track.east[i + 1] - l.east) / length[i] : 0;
+		l.unitNorth = length[i] > 0 ? (track.north[i + 1] - l.north) / length[i] : 0;
+		l.bearing = bearing[i];
+		l.startAlt = wp[i].alt;
+		l.climb = length[i] > 0 ? (wp[i + 1].alt - wp[i].alt) / length[i] : 0;
+		l.arrival = min(MISSIONARRIVAL,length[i] / 2);
+		l.remaining = total - cumulative[i];
+	}
+	holdEast = track.east[n];
+	holdNorth = track.north[n];
+	holdAlt = wp[n].alt;
+	holdArrival = MISSIONARRIVAL;
+	request.heading = n > 0 ? legs[0].bearing : wp[0].heading;
+	request.alt = wp[0].alt;
+	Start();
+	return true;
+}
+
+
+void MissionExecutor::Start()
+{
+	leg = 0;
+	request.done = track.Count() == 0;
+}
+
+
+int MissionExecutor::Rejoin(const GeoPoint &p)
+{
+	float distance;
+	int nearest = grid.NearestLeg(p,distance);
+	leg = nearest < 0 ? (int)legs.size() : nearest;
+	return leg;
+}
+
+
+//At the last waypoint, head back to it if the quad drifts out of the arrival radius
+void MissionExecutor::Hold(float e,float n)
+{
+	float de = holdEast - e;
+	float dn = holdNorth - n;
+	float distance = sqrtf(de * de + dn * dn);
+	request.leg = -1;
+	request.crossTrack = 0;
+	request.alongTrack = 0;
+	request.alt = holdAlt;
+	request.done = true;
+	if(distance > holdArrival)
+	{
+		request.heading = GeoCompass(atan2f(de,dn) * GEODEGREES);
+		request.speed = min(cruise,distance / MISSIONSLOWDOWN);
+	}
+	else
+		request.speed = 0;
+}
+
+
+const MissionRequest &MissionExecutor::Update(const GeoPoint &p)
+{
+	if(track.Count() == 0)
+	{
+		request.speed = 0;
+		request.done = true;
+		return request;
+	}
+	float e,n;
+	track.Project(p,e,n);
+
+	//Leg switching, a short leg can be done before the quad gets to it
+	float along = 0,cross = 0;
+	while(leg < (int)legs.size())
+	{
+		const MissionLeg &l = legs[leg];
+		float de = e - l.east;
+		float dn = n - l.north;
+		along = de * l.unitEast + dn * l.unitNorth;
+		cross = de * l.unitNorth - dn * l.unitEast;
+		if(along < l.length - l.arrival)
+			break;
+		leg++;
+	}
+	if(leg >= (int)legs.size())
+	{
+		Hold(e,n);
+		return request;
+	}
+
+	//Along the leg, turned back toward it by the cross track error
+	const MissionLeg &l = legs[leg];
+	float progress = min(max(along,0.0f),l.length);
+	request.leg = leg;
+	request.alongTrack = along;
+	request.crossTrack = cross;
+	request.heading = GeoCompass(l.bearing - atan2f(cross,MISSIONCORRECTION) * GEODEGREES);
+	request.alt = l.startAlt + l.climb * progress;
+	request.speed = min(cruise,(l.remaining + l.length - progress) / MISSIONSLOWDOWN);
+	request.done = false;
+	return request;
+}
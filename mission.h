@@ -0,0 +1,91 @@
+/************************************************
+Mission executor
+
+Flies a list of waypoints leg by leg.  Everything
+about a leg that does not depend on where the quad
+is (start, direction, length, bearing, climb and
+arrival radius) is worked out once in Load(), so a
+tick is one projection, two dot products and a
+compare, whatever the length of the mission.
+
+Update() flies nothing itself, it publishes a
+MissionRequest (heading, altitude, speed) for the
+control loop to turn into control bytes.  After the
+last leg, or with a single waypoint, it holds the
+last waypoint.
+
+***********************************************/
+#ifndef __Mission_h
+#define __Mission_h
+
+#include <vector>
+#include "track.h"
+#include "grid.h"
+using namespace std;
+
+#define MISSIONARRIVAL		2.0f	//Meters, a leg is done this close to its end, or half the leg if shorter
+#define MISSIONCRUISE		2.0f	//Meters per second
+#define MISSIONCORRECTION	5.0f	//Meters off the leg that turns the heading 45 degrees back toward it
+#define MISSIONSLOWDOWN		2.0f	//Seconds out from the last waypoint the speed starts to taper
+
+
+struct MissionLeg
+{
+	float east;		//Start, mission meters
+	float north;
+	float unitEast;		//Along the leg
+	float unitNorth;
+	float length;
+	float bearing;		//Degrees true
+	float startAlt;		//Feet
+	float climb;		//Feet per meter along the leg
+	float arrival;		//Meters
+	float remaining;	//Path length after this leg
+};
+
+
+struct MissionRequest
+{
+	double heading;		//Degrees true
+	double alt;		//Feet, same zero as GPSFix.alt
+	double speed;		//Meters per second, 0 to hold
+	int leg;		//-1 while holding the last waypoint
+	float crossTrack;	//Meters right of the leg
+	float alongTrack;	//Meters from the start of the leg
+	bool done;
+};
+
+
+class MissionExecutor
+{
+	public:
+		MissionExecutor();
+
+		//Precomputes every leg, the quad starts on leg 0.  False with no waypoints.
+		bool Load(const WayPoint *wp,int count);
+		void Clear();
+		int Count() const;
+
+		void Start();
+		//Back from a manual override, carry on along the closest leg.  Returns it.
+		int Rejoin(const GeoPoint &p);
+
+		const MissionRequest &Update(const GeoPoint &p);
+
+		float cruise;		//Meters per second
+		MissionRequest request;
+		Track track;
+		TrackGrid grid;
+
+	private:
+		vector<MissionLeg> legs;
+		int leg;
+		float holdEast;
+		float holdNorth;
+		double holdAlt;
+		float holdArrival;
+
+		void Hold(float e,float n);
+};
+
+#endif // def(__Mission_h)
@@ -0,0 +1,132 @@
+#include "nmea.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+
+unsigned char NMEAChecksum(const char *body,size_t len)
+{
+	unsigned char c = 0;
+	for(size_t i=0;i<len;i++)
+		c ^= (unsigned char)body[i];
+	return c;
+}
+
+
+string NMEASentence(const string &body)
+{
+	char tail[8];
+	snprintf(tail,sizeof(tail),"*%02X\r\n",NMEAChecksum(body.c_str(),body.length()));
+	return "$" + body + tail;
+}
+
+
+static int HexValue(char c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+
+long NMEAFindValid(const char *buf,size_t len,const char *prefix)
+{
+	size_t plen = prefix ? strlen(prefix) : 0;
+	for(size_t i=0;i<len;i++)
+	{
+		if(buf[i] != '$')
+			continue;
+		if(plen && (len - i < plen || memcmp(buf + i,prefix,plen) != 0))
+			continue;
+		size_t j = i + 1;
+		while(j < len && buf[j] != '*' && buf[j] != '$' && buf[j] != '\n')
+			j++;
+		if(j + 2 >= len || buf[j] != '*')
+			continue;
+		int hi = HexValue(buf[j+1]);
+		int lo = HexValue(buf[j+2]);
+		if(hi < 0 || lo < 0)
+			continue;
+		if(NMEAChecksum(buf + i + 1,j - i - 1) == (unsigned char)(hi * 16 + lo))
+			return (long)i;
+	}
+	return -1;
+}
+
+
+//NMEA wants DDMM.MMMMM, degrees and decimal minutes
+static string FormatDegrees(double deg,int degDigits,char pos,char neg)
+{
+	char b[32];
+	char hemi = deg < 0 ? neg : pos;
+	deg = fabs(deg);
+	int d = (int)deg;
+	double m = (deg - d) * 60.0;
+	//Guard against 59.999995 rounding up to 60.00000
+	if(m >= 59.999995)
+	{
+		d++;
+		m = 0;
+	}
+	snprintf(b,sizeof(b),"%0*d%08.5f,%c",degDigits,d,m,hemi);
+	return b;
+}
+
+
+static string FormatTime(double utcSeconds)
+{
+	char b[16];
+	long cs = lround(utcSeconds * 100.0) % 8640000;
+	snprintf(b,sizeof(b),"%02ld%02ld%02ld.%02ld",cs / 360000,(cs / 6000) % 60,(cs / 100) % 60,cs % 100);
+	return b;
+}
+
+
+string NMEAMakeGGA(const NMEAFix &fix,const char *talker)
+{
+	char b[128];
+	snprintf(b,sizeof(b),"%sGGA,%s,%s,%s,%d,%02d,%.2f,%.1f,M,0.0,M,,",
+		talker,
+		FormatTime(fix.utcSeconds).c_str(),
+		FormatDegrees(fix.lat,2,'N','S').c_str(),
+		FormatDegrees(fix.lng,3,'E','W').c_str(),
+		fix.valid ? 1 : 0,
+		fix.satellites,
+		fix.hdop,
+		fix.altMeters);
+	return NMEASentence(b);
+}
+
+
+string NMEAMakeRMC(const NMEAFix &fix,const char *talker)
+{
+	char b[128];
+	snprintf(b,sizeof(b),"%sRMC,%s,%c,%s,%s,%.2f,%.2f,%02d%02d%02d,,,%c",
+		talker,
+		FormatTime(fix.utcSeconds).c_str(),
+		fix.valid ? 'A' : 'V',
+		FormatDegrees(fix.lat,2,'N','S').c_str(),
+		FormatDegrees(fix.lng,3,'E','W').c_str(),
+		fix.speedKnots,
+		fix.course,
+		fix.day,fix.month,fix.year % 100,
+		fix.valid ? 'A' : 'N');
+	return NMEASentence(b);
+}
+
+
+string NMEAMakeVTG(const NMEAFix &fix,const char *talker)
+{
+	char b[96];
+	snprintf(b,sizeof(b),"%sVTG,%.2f,T,,M,%.2f,N,%.2f,K,%c",
+		talker,
+		fix.course,
+		fix.speedKnots,
+		fix.speedKnots * 1.852,
+		fix.valid ? 'A' : 'N');
+	return NMEASentence(b);
+}
@@ -0,0 +1,52 @@
+/************************************************
+NMEA helpers
+
+Checksums and sentence builders shared by the GPS
+command path, the simulators and the benchmarks
+
+***********************************************/
+#ifndef __NMEA_h
+#define __NMEA_h
+
+#include <string>
+#include <stddef.h>
+using namespace std;
+
+#define NMEAKNOTSPERMPS		1.94384449
+
+//Everything needed to print one epoch of GGA/RMC/VTG
+struct NMEAFix
+{
+	double lat;
+	double lng;
+	double altMeters;
+	double speedKnots;
+	double course;
+	double utcSeconds;	//Seconds since midnight UTC
+	int day;
+	int month;
+	int year;
+	int satellites;
+	double hdop;
+	bool valid;
+
+	NMEAFix() : lat(0), lng(0), altMeters(0), speedKnots(0), course(0), utcSeconds(0),
+		day(1), month(1), year(2015), satellites(8), hdop(0.9), valid(true)
+	{}
+};
+
+//XOR of every char between $ and *
+unsigned char NMEAChecksum(const char *body,size_t len);
+
+//Wraps a body (no $ or *) into a full sentence with checksum and CRLF
+string NMEASentence(const string &body);
+
+//Finds a $...*HH sentence in buf whose checksum is good, returns its offset or -1
+//If prefix is given the sentence must start with it, e.g. "$PMTK001,220,"
+long NMEAFindValid(const char *buf,size_t len,const char *prefix = NULL);
+
+string NMEAMakeGGA(const NMEAFix &fix,const char *talker = "GP");
+string NMEAMakeRMC(const NMEAFix &fix,const char *talker = "GP");
+string NMEAMakeVTG(const NMEAFix &fix,const char *talker = "GP");
+
+#endif // def(__NMEA_h)
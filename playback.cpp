@@ -0,0 +1,215 @@
+#include "playback.h"
+#include "gps.h"
+#include <math.h>
+#include <float.h>
+
+
+MacroPlayer::MacroPlayer()
+{
+	speed = PLAYBACKSPEED;
+	rate = 0;
+	cursor = 0;
+	request.heading = 0;
+	request.alt = 0;
+	request.speed = 0;
+	request.leg = -1;
+	request.crossTrack = 0;
+	request.alongTrack = 0;
+	request.done = true;
+}
+
+
+void MacroPlayer::Clear()
+{
+	track.Clear();
+	grid.Build(track);
+	along.clear();
+	length.clear();
+	unitEast.clear();
+	unitNorth.clear();
+	alt.clear();
+	seconds.clear();
+	cursor = 0;
+	request.speed = 0;
+	request.leg = -1;
+	request.done = true;
+}
+
+
+int MacroPlayer::Count() const
+{
+	return track.Count();
+}
+
+
+float MacroPlayer::Length() const
+{
+	return along.empty() ? 0 : along.back();
+}
+
+
+bool MacroPlayer::Load(const WayPoint *wp,int count)
+{
+	Clear();
+	if(count <= 0)
+		return false;
+
+	//A hover records the same spot over and over, one copy of it is enough
+	Track all;
+	all.Load(wp,count);
+	vector<WayPoint> kept;
+	kept.push_back(wp[0]);
+	seconds.push_back(wp[0].seconds);
+	float lastEast = all.east[0],lastNorth = all.north[0];
+	for(int i=1;i<count;i++)
+	{
+		float de = all.east[i] - lastEast;
+		float dn = all.north[i] - lastNorth;
+		if(de * de + dn * dn < PLAYBACKMINSPACING * PLAYBACKMINSPACING)
+			continue;
+		kept.push_back(wp[i]);
+		seconds.push_back(wp[i].seconds);
+		lastEast = all.east[i];
+		lastNorth = all.north[i];
+	}
+	track.Load(kept.data(),(int)kept.size());
+	grid.Build(track);
+
+	int points = track.Count();
+	along.resize(points);
+	alt.resize(points);
+	length.resize(points);
+	unitEast.resize(points);
+	unitNorth.resize(points);
+	along[0] = 0;
+	for(int i=0;i<points;i++)
+	{
+		alt[i] = kept[i].alt;
+		if(i + 1 == points)
+			break;
+		float de = track.east[i + 1] - track.east[i];
+		float dn = track.north[i + 1] - track.north[i];
+		length[i] = sqrtf(de * de + dn * dn);
+		unitEast[i] = de / length[i];
+		unitNorth[i] = dn / length[i];
+		along[i + 1] = along[i] + length[i];
+	}
+	request.heading = wp[0].heading;
+	request.alt = wp[0].alt;
+	Start();
+	return true;
+}
+
+
+void MacroPlayer::Start()
+{
+	cursor = 0;
+	request.done = track.Count() == 0;
+}
+
+
+int MacroPlayer::Rejoin(const GeoPoint &p)
+{
+	float distance;
+	int nearest = grid.NearestLeg(p,distance);
+	cursor = nearest < 0 ? 0 : nearest;
+	return cursor;
+}
+
+
+//At the end of the recording, head back to it if the quad drifts out of the arrival radius
+void MacroPlayer::Hold(float e,float n)
+{
+	int last = track.Count() - 1;
+	float de = track.east[last] - e;
+	float dn = track.north[last] - n;
+	float distance = sqrtf(de * de + dn * dn);
+	request.leg = -1;
+	request.crossTrack = 0;
+	request.alongTrack = Length();
+	request.alt = alt[last];
+	request.done = true;
+	if(distance > MISSIONARRIVAL)
+	{
+		request.heading = GeoCompass(atan2f(de,dn) * GEODEGREES);
+		request.speed = min(speed,distance / MISSIONSLOWDOWN);
+	}
+	else
+		request.speed = 0;
+}
+
+
+const MissionRequest &MacroPlayer::Update(const GeoPoint &p)
+{
+	int points = track.Count();
+	if(points == 0)
+	{
+		request.speed = 0;
+		request.done = true;
+		return request;
+	}
+	float e,n;
+	track.Project(p,e,n);
+	if(points == 1)
+	{
+		Hold(e,n);
+		return request;
+	}
+	const float *east = track.east.data();
+	const float *north = track.north.data();
+
+	//Closest point on the segments just past the cursor, ties go to the later one
+	int last = min(cursor + PLAYBACKWINDOW,points - 1);
+	float best2 = FLT_MAX,bestT = 0;
+	for(int i=cursor;i<last;i++)
+	{
+		float we = e - east[i];
+		float wn = n - north[i];
+		float t = we * unitEast[i] + wn * unitNorth[i];
+		t = t < 0 ? 0 : (t > length[i] ? length[i] : t);
+		float qe = we - t * unitEast[i];
+		float qn = wn - t * unitNorth[i];
+		float d2 = qe * qe + qn * qn;
+		if(d2 <= best2)
+		{
+			best2 = d2;
+			bestT = t;
+			cursor = i;
+		}
+	}
+	float here = along[cursor] + bestT;
+	float total = Length();
+	if(total - here <= MISSIONARRIVAL)
+	{
+		Hold(e,n);
+		return request;
+	}
+
+	//The pursuit point, lookahead further along from here
+	float lookahead = max(PLAYBACKMINLOOKAHEAD,(float)request.speed * PLAYBACKLOOKAHEAD);
+	float target = here + lookahead;
+	int j = cursor;
+	while(j + 1 < last && along[j + 1] < target)
+		j++;
+	float t = min(target - along[j],length[j]);
+	float de = east[j] + t * unitEast[j] - e;
+	float dn = north[j] + t * unitNorth[j] - n;
+
+	float v = speed;
+	if(rate > 0)
+	{
+		//As fast as it was recorded between here and the pursuit point
+		float dt = seconds[j + 1] - seconds[cursor];
+		v = dt > 0 ? rate * (along[j + 1] - along[cursor]) / dt : speed;
+		v = max(v,PLAYBACKMINRATESPEED);
+	}
+
+	request.leg = cursor;
+	request.alongTrack = here;
+	request.crossTrack = (e - east[cursor]) * unitNorth[cursor] - (n - north[cursor]) * unitEast[cursor];
+	request.heading = GeoCompass(atan2f(de,dn) * GEODEGREES);
+	request.alt = alt[cursor] + (alt[cursor + 1] - alt[cursor]) * bestT / length[cursor];
+	request.speed = min(v,(total - here) / MISSIONSLOWDOWN);
+	request.done = false;
+	return request;
+}
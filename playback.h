@@ -0,0 +1,70 @@
+/************************************************
+Macro playback - pure pursuit along a recording
+
+Follows a recorded macro by steering at a point a
+lookahead distance further along the recording
+than the quad is.  Where the quad is along it is a
+cursor that only moves forward, and each tick only
+looks at the PLAYBACKWINDOW segments after it, so
+a tick costs the same on a 10 or 7000 point macro
+and a path that crosses itself cannot pull the
+quad back to an earlier pass.
+
+Speed is either fixed or a multiple of the speed
+the macro was recorded at, taken from the points'
+recorded times over the lookahead.  Publishes the
+same MissionRequest the mission executor does.
+
+***********************************************/
+#ifndef __Playback_h
+#define __Playback_h
+
+#include <vector>
+#include "mission.h"
+using namespace std;
+
+#define PLAYBACKSPEED		2.0f	//Meters per second, when not following the recorded speed
+#define PLAYBACKLOOKAHEAD	1.5f	//Seconds of travel the pursuit point is ahead
+#define PLAYBACKMINLOOKAHEAD	2.0f	//Meters
+#define PLAYBACKWINDOW		32	//Segments past the cursor searched each tick
+#define PLAYBACKMINSPACING	0.01f	//Meters, recorded points closer than this are merged
+#define PLAYBACKMINRATESPEED	0.3f	//Meters per second, floor under the recorded speed so a hover does not stall
+
+
+class MacroPlayer
+{
+	public:
+		MacroPlayer();
+
+		//False with no points
+		bool Load(const WayPoint *wp,int count);
+		void Clear();
+		int Count() const;
+		float Length() const;
+
+		void Start();
+		//Back from a manual override, jump to the closest segment, forward or back.  Returns it.
+		int Rejoin(const GeoPoint &p);
+
+		const MissionRequest &Update(const GeoPoint &p);
+
+		float speed;		//Meters per second
+		float rate;		//0 flies at speed, otherwise this times the recorded speed
+		MissionRequest request;
+		Track track;
+		TrackGrid grid;
+
+	private:
+		//Segment i runs from point i to i + 1
+		vector<float> along;		//Path length to point i
+		vector<float> length;
+		vector<float> unitEast;
+		vector<float> unitNorth;
+		vector<float> alt;		//Feet
+		vector<float> seconds;		//Into the recording at point i
+		int cursor;
+
+		void Hold(float e,float n);
+};
+
+#endif // def(__Playback_h)
@@ -0,0 +1,98 @@
+#include "recorder.h"
+#include "gps.h"
+#include <math.h>
+
+
+MacroRecorder::MacroRecorder()
+{
+	distance = RECORDDISTANCE;
+	turn = RECORDTURN;
+	climb = RECORDCLIMB;
+	maxPeriod = RECORDMAXPERIOD;
+	points = NULL;
+	capacity = 0;
+	count = 0;
+	offered = 0;
+	startTime = 0;
+	lastEast = lastNorth = 0;
+	lastBearing = 0;
+	haveBearing = false;
+}
+
+
+void MacroRecorder::Start(WayPoint *wp,int size)
+{
+	points = wp;
+	capacity = size;
+	count = 0;
+	offered = 0;
+	haveBearing = false;
+}
+
+
+int MacroRecorder::Count() const
+{
+	return count;
+}
+
+
+bool MacroRecorder::Full() const
+{
+	return count >= capacity;
+}
+
+
+void MacroRecorder::Keep(const GPSFix &fix,float e,float n)
+{
+	WayPoint &wp = points[count++];
+	wp.lat = fix.lat;
+	wp.lng = fix.lng;
+	wp.alt = fix.alt;
+	wp.heading = fix.course;
+	wp.seconds = fix.timeStamp - startTime;
+	float de = e - lastEast;
+	float dn = n - lastNorth;
+	if(de * de + dn * dn >= RECORDMINMOVE * RECORDMINMOVE)
+	{
+		lastBearing = atan2f(de,dn);
+		haveBearing = true;
+	}
+	lastEast = e;
+	lastNorth = n;
+}
+
+
+bool MacroRecorder::Add(const GPSFix &fix)
+{
+	offered++;
+	if(Full())
+		return false;
+	if(count == 0)
+	{
+		frame.SetOrigin(fix.position,0);
+		startTime = fix.timeStamp;
+		Keep(fix,0,0);
+		return true;
+	}
+
+	ENUPoint q = frame.ToENU(fix.position,0);
+	float e = q.east / 1000.0f;
+	float n = q.north / 1000.0f;
+	float de = e - lastEast;
+	float dn = n - lastNorth;
+	float moved2 = de * de + dn * dn;
+	const WayPoint &last = points[count - 1];
+
+	bool keep = moved2 >= distance * distance
+		|| fabs(fix.alt - last.alt) >= climb
+		|| fix.timeStamp - startTime - last.seconds >= maxPeriod;
+	if(!keep && haveBearing && moved2 >= RECORDMINMOVE * RECORDMINMOVE)
+	{
+		float off = fabsf(atan2f(de,dn) - lastBearing) * GEODEGREES;
+		off = off > 180 ? 360 - off : off;
+		keep = off >= turn;
+	}
+	if(keep)
+		Keep(fix,e,n);
+	return keep;
+}
@@ -0,0 +1,66 @@
+/************************************************
+Macro recorder - adaptive waypoint sampling
+
+Decides which fixes of a macro recording are worth
+keeping.  A fix is kept once the quad has moved
+RECORDDISTANCE from the last kept one, turned
+RECORDTURN off the direction it was going, or
+climbed or dived RECORDCLIMB, and at least every
+RECORDMAXPERIOD seconds so a hover still shows up.
+A hover no longer fills the buffer at the fix rate.
+
+The direction is the one between kept points, not
+the receiver's course, which wanders at a hover.
+Each kept point carries its time into the recording
+so playback at the recorded speed still works with
+uneven spacing.
+
+***********************************************/
+#ifndef __Recorder_h
+#define __Recorder_h
+
+#include "enu.h"
+
+struct WayPoint;
+struct GPSFix;
+
+#define RECORDDISTANCE		2.0f	//Meters
+#define RECORDTURN		20.0f	//Degrees
+#define RECORDMINMOVE		0.5f	//Meters moved before a turn is measured
+#define RECORDCLIMB		1.0f	//Feet
+#define RECORDMAXPERIOD		10.0	//Seconds
+
+
+class MacroRecorder
+{
+	public:
+		MacroRecorder();
+
+		//Records into wp, which holds capacity points
+		void Start(WayPoint *wp,int capacity);
+
+		//True if fix was kept.  Once full nothing more is kept.
+		bool Add(const GPSFix &fix);
+		int Count() const;
+		bool Full() const;
+
+		float distance;
+		float turn;
+		float climb;
+		double maxPeriod;
+		int offered;		//Fixes passed to Add()
+
+	private:
+		WayPoint *points;
+		int capacity;
+		int count;
+		ENUFrame frame;		//At the first point
+		double startTime;
+		float lastEast,lastNorth;
+		float lastBearing;	//Radians, of the last step between kept points
+		bool haveBearing;
+
+		void Keep(const GPSFix &fix,float e,float n);
+};
+
+#endif // def(__Recorder_h)
@@ -0,0 +1,73 @@
+/************************************************
+SeqLock
+
+Single writer, many reader snapshot of a small
+plain struct.  The writer never waits, readers
+retry if they raced a write, so a reader can never
+see half of one value and half of the next.
+
+***********************************************/
+#ifndef __SeqLock_h
+#define __SeqLock_h
+
+#include <atomic>
+#include <string.h>
+#include <stdint.h>
+
+
+template <class T>
+class SeqLock
+{
+public:
+	SeqLock() : sequence(0)
+	{
+		for(int i=0;i<WORDS;i++)
+			words[i].store(0,std::memory_order_relaxed);
+	}
+
+	//Only one thread may write
+	void Write(const T &value)
+	{
+		uint32_t buf[WORDS];
+		memset(buf,0,sizeof(buf));
+		memcpy(buf,&value,sizeof(T));
+
+		uint32_t s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1,std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for(int i=0;i<WORDS;i++)
+			words[i].store(buf[i],std::memory_order_relaxed);
+		sequence.store(s + 2,std::memory_order_release);
+	}
+
+	//Returns how many writes the snapshot has seen
+	uint32_t Read(T &value) const
+	{
+		uint32_t buf[WORDS];
+		uint32_t s1,s2;
+		do
+		{
+			s1 = sequence.load(std::memory_order_acquire);
+			for(int i=0;i<WORDS;i++)
+				buf[i] = words[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			s2 = sequence.load(std::memory_order_relaxed);
+		} while((s1 & 1) || s1 != s2);
+
+		memcpy(&value,buf,sizeof(T));
+		return s1 / 2;
+	}
+
+	uint32_t Writes() const
+	{
+		return sequence.load(std::memory_order_acquire) / 2;
+	}
+
+private:
+	//32 bit words keep the copies lock free on the Pi as well
+	enum { WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t) };
+	std::atomic<uint32_t> sequence;
+	std::atomic<uint32_t> words[WORDS];
+};
+
+#endif // def(__SeqLock_h)
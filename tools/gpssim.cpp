@@ -0,0 +1,524 @@
+#include "gpssim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <fstream>
+
+//Bytes per epoch the simulated receiver can push, same budget GPS uses
+#define GPSSIMEPOCHBYTES	250
+//Flat earth is plenty over a flight, same sphere as TinyGPS++ and geo.h
+#define GPSSIMMETERSPERDEGREE	(6372795.0 * M_PI / 180.0)
+#define GPSSIMFEETTOMETERS	0.3048
+
+
+GPSSim::GPSSim()
+{
+	receiverType = GPSSIM_MTK;
+	baud = 9600;
+	rateHz = 1;
+	maxBaud = 921600;
+	maxRateHz = 10;
+	fullOutput = true;
+	outMask = UBXPROTONMEA;
+	navPVT = false;
+	coldStartSeconds = 0;
+	hotStartSeconds = 1;
+	hinted = false;
+	fixAt = 0;
+	fix.lat = 35.2058;
+	fix.lng = -97.4457;
+	fix.altMeters = 357.0;
+	fix.utcSeconds = 12 * 3600;
+	trajectory = GPSSIM_HOVER;
+	speed = 0;
+	radius = 10;
+	badChecksumRate = 0;
+	dropRate = 0;
+	seed = 1;
+	startLat = 0;
+	startLng = 0;
+	traveled = 0;
+
+	epochsSent = 0;
+	bytesSent = 0;
+	garbledBytes = 0;
+	commandsSeen = 0;
+	commandsIgnored = 0;
+	checksumsCorrupted = 0;
+	bytesDropped = 0;
+
+	master = -1;
+	shutDown = false;
+	simThread = 0;
+}
+
+
+GPSSim::~GPSSim()
+{
+	Stop();
+	if(master != -1)
+		close(master);
+}
+
+
+//Creates the pty, GPS opens SlavePath()
+bool GPSSim::Open()
+{
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+		return false;
+	slavePath = ptsname(master);
+	//Like a UART, if nobody reads we overrun rather than stall
+	fcntl(master, F_SETFL, O_NONBLOCK);
+	return true;
+}
+
+
+string GPSSim::SlavePath()
+{
+	return slavePath;
+}
+
+
+int GPSSim::Start()
+{
+	shutDown = false;
+	fixAt = Now() + coldStartSeconds;
+	startLat = fix.lat;
+	startLng = fix.lng;
+	traveled = 0;
+	Move(0);
+	return pthread_create(&simThread, NULL, SimThread, this);
+}
+
+
+void GPSSim::Stop()
+{
+	if(simThread == 0)
+		return;
+	shutDown = true;
+	pthread_join(simThread, NULL);
+	simThread = 0;
+}
+
+
+double GPSSim::Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+//Reads a waypoints.txt as autocontrol saves it, lat;lng;feet;heading;seconds a line (older files stop at heading)
+bool GPSSim::LoadWayPoints(const string &path)
+{
+	ifstream iFile(path.c_str());
+	NMEAFix wp = fix;
+	string line;
+	wayPoints.clear();
+	while(getline(iFile,line))
+	{
+		if(sscanf(line.c_str(),"%lf;%lf;%lf",&wp.lat,&wp.lng,&wp.altMeters) < 3)
+			continue;
+		wp.altMeters *= GPSSIMFEETTOMETERS;
+		wayPoints.push_back(wp);
+	}
+	if(wayPoints.empty())
+		return false;
+	fix.lat = wayPoints[0].lat;
+	fix.lng = wayPoints[0].lng;
+	fix.altMeters = wayPoints[0].altMeters;
+	return true;
+}
+
+
+//Puts fix where the trajectory is after another few seconds of flying
+void GPSSim::Move(double seconds)
+{
+	double north = 0;
+	double east = 0;
+	traveled += speed * seconds;
+	fix.speedKnots = trajectory == GPSSIM_HOVER ? 0 : speed * NMEAKNOTSPERMPS;
+
+	if(trajectory == GPSSIM_LINE)
+	{
+		north = traveled * cos(fix.course * M_PI / 180);
+		east = traveled * sin(fix.course * M_PI / 180);
+	}
+	else if(trajectory == GPSSIM_CIRCLE && radius > 0)
+	{
+		//Clockwise from due north of the start, so the course is the angle plus 90
+		double a = traveled / radius;
+		north = radius * cos(a);
+		east = radius * sin(a);
+		fix.course = fmod(a * 180 / M_PI + 90, 360);
+	}
+	else if(trajectory == GPSSIM_WAYPOINTS && wayPoints.size() > 1)
+	{
+		//Legs in flat earth meters, the last one closes the loop
+		double total = 0;
+		vector<double> legs(wayPoints.size());
+		for(size_t i=0;i<wayPoints.size();i++)
+		{
+			const NMEAFix &a = wayPoints[i];
+			const NMEAFix &b = wayPoints[(i + 1) % wayPoints.size()];
+			double dn = (b.lat - a.lat) * GPSSIMMETERSPERDEGREE;
+			double de = (b.lng - a.lng) * GPSSIMMETERSPERDEGREE * cos(a.lat * M_PI / 180);
+			legs[i] = sqrt(dn * dn + de * de);
+			total += legs[i];
+		}
+		double d = total > 0 ? fmod(traveled, total) : 0;
+		size_t i = 0;
+		while(i + 1 < legs.size() && d > legs[i])
+			d -= legs[i++];
+		const NMEAFix &a = wayPoints[i];
+		const NMEAFix &b = wayPoints[(i + 1) % wayPoints.size()];
+		double f = legs[i] > 0 ? d / legs[i] : 0;
+		fix.lat = a.lat + (b.lat - a.lat) * f;
+		fix.lng = a.lng + (b.lng - a.lng) * f;
+		fix.altMeters = a.altMeters + (b.altMeters - a.altMeters) * f;
+		double dn = b.lat - a.lat;
+		double de = (b.lng - a.lng) * cos(a.lat * M_PI / 180);
+		fix.course = fmod(atan2(de, dn) * 180 / M_PI + 360, 360);
+		return;
+	}
+	fix.lat = startLat + north / GPSSIMMETERSPERDEGREE;
+	fix.lng = startLng + east / (GPSSIMMETERSPERDEGREE * cos(startLat * M_PI / 180));
+}
+
+
+//Bad checksums and lost bytes, applied to the NMEA only so commands still get answered
+string GPSSim::Damage(const string &s)
+{
+	if(badChecksumRate <= 0 && dropRate <= 0)
+		return s;
+	string out;
+	out.reserve(s.length());
+	size_t start = 0;
+	while(start < s.length())
+	{
+		size_t end = s.find('\n', start);
+		end = end == string::npos ? s.length() : end + 1;
+		string line = s.substr(start, end - start);
+		start = end;
+
+		size_t star = line.rfind('*');
+		if(star != string::npos && star + 2 < line.length() && rand_r(&seed) < badChecksumRate * RAND_MAX)
+		{
+			line[star + 2] = line[star + 2] == '0' ? '1' : '0';
+			checksumsCorrupted++;
+		}
+		for(size_t i=0;i<line.length();i++)
+		{
+			if(dropRate > 0 && rand_r(&seed) < dropRate * RAND_MAX)
+				bytesDropped++;
+			else
+				out += line[i];
+		}
+	}
+	return out;
+}
+
+
+//The master side of a pty reports the termios the slave set
+int GPSSim::HostBaud()
+{
+	struct termios t;
+	if(tcgetattr(master, &t) != 0)
+		return 0;
+	switch(cfgetospeed(&t))
+	{
+		case B4800: return 4800;
+		case B9600: return 9600;
+		case B19200: return 19200;
+		case B38400: return 38400;
+		case B57600: return 57600;
+		case B115200: return 115200;
+		case B230400: return 230400;
+		case B460800: return 460800;
+		case B921600: return 921600;
+		default: return 0;
+	}
+}
+
+
+//Writes at the simulated baud, 16 bytes (one UART FIFO) at a time
+void GPSSim::Send(const string &s)
+{
+	double usPerByte = 10.0 * 1000000.0 / baud;
+	for(size_t i=0;i<s.length() && !shutDown;i+=16)
+	{
+		char b[16];
+		size_t n = s.length() - i < 16 ? s.length() - i : 16;
+		memcpy(b, s.data() + i, n);
+		//Wrong speed on the host, every char arrives mangled but lines still end
+		if(HostBaud() != baud)
+		{
+			for(size_t j=0;j<n;j++)
+				if(b[j] != '\n')
+					b[j] = (char)((b[j] * 7 + 13) ^ 0x5a);
+			garbledBytes += n;
+		}
+		if(write(master, b, n) > 0)
+			bytesSent += n;
+		usleep((useconds_t)(usPerByte * n));
+		Collect();
+	}
+}
+
+
+UBXSolution GPSSim::MakeSolution(const NMEAFix &fix)
+{
+	UBXSolution sol;
+	long ms = (long)(fix.utcSeconds * 1000 + 0.5);
+	//Any day of the week will do, only the milliseconds matter to GPS
+	sol.iTOW = (uint32_t)(86400000L + ms);
+	sol.year = fix.year;
+	sol.month = fix.month;
+	sol.day = fix.day;
+	sol.hour = (ms / 3600000) % 24;
+	sol.min = (ms / 60000) % 60;
+	sol.sec = (ms / 1000) % 60;
+	sol.valid = UBXPVT_VALIDDATE | UBXPVT_VALIDTIME;
+	sol.fixType = fix.valid ? 3 : 0;
+	sol.flags = fix.valid ? UBXPVT_GNSSFIXOK : 0;
+	sol.numSV = fix.satellites;
+	sol.lat = (int32_t)(fix.lat * 1e7 + (fix.lat < 0 ? -0.5 : 0.5));
+	sol.lng = (int32_t)(fix.lng * 1e7 + (fix.lng < 0 ? -0.5 : 0.5));
+	sol.hMSL = (int32_t)(fix.altMeters * 1000 + 0.5);
+	sol.hAcc = 2500;
+	sol.vAcc = 4000;
+	sol.gSpeed = (int32_t)(fix.speedKnots / NMEAKNOTSPERMPS * 1000 + 0.5);
+	sol.headMot = (int32_t)(fix.course * 1e5 + 0.5);
+	return sol;
+}
+
+
+//A position and time hint, the receiver skips most of its sky search
+void GPSSim::Hint()
+{
+	hinted = true;
+	if(Now() + hotStartSeconds < fixAt)
+		fixAt = Now() + hotStartSeconds;
+}
+
+
+void GPSSim::SendEpoch()
+{
+	string s;
+	fix.valid = Now() >= fixAt;
+	if(outMask & UBXPROTONMEA)
+	{
+		s += NMEAMakeGGA(fix);
+		if(fullOutput)
+		{
+			s += NMEASentence("GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.8,0.9,1.5");
+			s += NMEASentence("GPGSV,3,1,11,04,38,284,42,05,15,039,35,09,29,171,40,12,73,049,44");
+			s += NMEASentence("GPGSV,3,2,11,24,25,304,38,25,55,106,45,29,41,238,41,31,09,090,30");
+			s += NMEASentence("GPGSV,3,3,11,02,05,312,,14,02,150,,21,01,052,");
+		}
+		s += NMEAMakeRMC(fix);
+		s += NMEAMakeVTG(fix);
+		s = Damage(s);
+	}
+	if((outMask & UBXPROTOUBX) && navPVT)
+		s += UBXMakeNavPVT(MakeSolution(fix));
+	Send(s);
+	epochsSent++;
+}
+
+
+void GPSSim::HandleNMEA(const string &sentence)
+{
+	char reply[64];
+	commandsSeen++;
+
+	if(sentence.compare(0, 9, "$PMTK251,") == 0)
+	{
+		int b = atoi(sentence.c_str() + 9);
+		//MTK does not ack a baud change, it just switches
+		if(b > 0 && b <= maxBaud)
+			baud = b;
+	}
+	else if(sentence.compare(0, 9, "$PMTK220,") == 0)
+	{
+		int ms = atoi(sentence.c_str() + 9);
+		int r = ms > 0 ? 1000 / ms : 0;
+		bool ok = r >= 1 && r <= maxRateHz && r * GPSSIMEPOCHBYTES * 10 <= baud;
+		if(ok)
+			rateHz = r;
+		snprintf(reply, sizeof(reply), "PMTK001,220,%d", ok ? 3 : 2);
+		Send(NMEASentence(reply));
+	}
+	else if(sentence.compare(0, 9, "$PMTK314,") == 0)
+	{
+		fullOutput = false;
+		Send(NMEASentence("PMTK001,314,3"));
+	}
+	else if(sentence.compare(0, 9, "$PMTK741,") == 0)
+	{
+		Hint();
+		Send(NMEASentence("PMTK001,741,3"));
+	}
+	else if(sentence.compare(0, 5, "$PMTK") == 0)
+	{
+		//Anything else we take, the way hot start and position hints are fire and forget
+		snprintf(reply, sizeof(reply), "PMTK001,%d,3", atoi(sentence.c_str() + 5));
+		Send(NMEASentence(reply));
+	}
+}
+
+
+void GPSSim::HandleUBX(const uint8_t *frame,size_t len)
+{
+	commandsSeen++;
+	if(len < 8)
+		return;
+	uint8_t cls = frame[2];
+	uint8_t id = frame[3];
+	const uint8_t *p = frame + 6;
+	uint16_t plen = frame[4] | (frame[5] << 8);
+	//The payload must fit in the frame, header and checksum included
+	if(receiverType != GPSSIM_UBLOX || (size_t)plen + 8 > len)
+		return;
+	if(cls == UBXCLASSMGA && id == UBXMGAINI && plen >= 1 && p[0] == UBXMGAINIPOSLLH)
+		Hint();
+	if(cls != UBXCLASSCFG)
+		return;
+
+	uint8_t ack[2] = { cls, id };
+	if(id == UBXCFGPRT && plen >= 20)
+	{
+		int b = p[8] | (p[9] << 8) | (p[10] << 16) | (p[11] << 24);
+		bool ok = b > 0 && b <= maxBaud;
+		//u-blox acks at the old speed, then switches
+		Send(UBXFrame(UBXCLASSACK, ok ? UBXACKACK : UBXACKNAK, ack, 2));
+		if(ok)
+		{
+			baud = b;
+			outMask = p[14] | (p[15] << 8);
+		}
+	}
+	else if(id == UBXCFGMSG && plen >= 3)
+	{
+		if(p[0] == UBXCLASSNAV && p[1] == UBXNAVPVT)
+			navPVT = p[2] != 0;
+		Send(UBXFrame(UBXCLASSACK, UBXACKACK, ack, 2));
+	}
+	else if(id == UBXCFGRATE && plen >= 6)
+	{
+		int ms = p[0] | (p[1] << 8);
+		int r = ms > 0 ? 1000 / ms : 0;
+		bool ok = r >= 1 && r <= maxRateHz && r * GPSSIMEPOCHBYTES * 10 <= baud;
+		if(ok)
+			rateHz = r;
+		Send(UBXFrame(UBXCLASSACK, ok ? UBXACKACK : UBXACKNAK, ack, 2));
+	}
+	else
+		Send(UBXFrame(UBXCLASSACK, UBXACKACK, ack, 2));
+}
+
+
+//Pulls whatever the host wrote.  Called between FIFO loads too, a real
+//receiver listens while it talks and judges each byte at the baud of the moment.
+void GPSSim::Collect()
+{
+	char b[512];
+	int n;
+	while((n = read(master, b, sizeof(b))) > 0)
+	{
+		//A host at the wrong speed sends us noise
+		if(HostBaud() != baud)
+		{
+			commandsIgnored++;
+			continue;
+		}
+		input.append(b, n);
+	}
+}
+
+
+//Acts on the complete commands collected so far
+void GPSSim::ParseInput()
+{
+	while(!input.empty())
+	{
+		size_t dollar = input.find('$');
+		size_t sync = input.find((char)UBXSYNC1);
+		if(dollar == string::npos && sync == string::npos)
+		{
+			input.clear();
+			break;
+		}
+
+		if(sync != string::npos && (dollar == string::npos || sync < dollar))
+		{
+			input.erase(0, sync);
+			if(input.length() < 8)
+				break;
+			size_t plen = (uint8_t)input[4] | ((uint8_t)input[5] << 8);
+			if(input.length() < plen + 8)
+				break;
+			uint8_t a,c;
+			UBXChecksum((const uint8_t *)input.data() + 2, plen + 4, a, c);
+			if((uint8_t)input[1] == UBXSYNC2 && a == (uint8_t)input[plen + 6] && c == (uint8_t)input[plen + 7])
+			{
+				HandleUBX((const uint8_t *)input.data(), plen + 8);
+				input.erase(0, plen + 8);
+			}
+			else
+				input.erase(0, 1);
+			continue;
+		}
+
+		input.erase(0, dollar);
+		size_t end = input.find('\n');
+		if(end == string::npos)
+			break;
+		string line = input.substr(0, end + 1);
+		input.erase(0, end + 1);
+		if(NMEAFindValid(line.c_str(), line.length()) == 0)
+			HandleNMEA(line);
+	}
+}
+
+
+void *GPSSim::SimThread(void *arg)
+{
+	GPSSim *sim = (GPSSim *)arg;
+	double next = sim->Now();
+
+	while(!sim->shutDown)
+	{
+		if(sim->Now() >= next)
+		{
+			sim->SendEpoch();
+			sim->fix.utcSeconds += 1.0 / sim->rateHz;
+			sim->Move(1.0 / sim->rateHz);
+			next += 1.0 / sim->rateHz;
+			//Fell behind, do not try to catch up with a burst
+			if(next < sim->Now())
+				next = sim->Now();
+		}
+
+		int wait = (int)((next - sim->Now()) * 1000);
+		struct pollfd pfd;
+		pfd.fd = sim->master;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if(poll(&pfd, 1, wait > 0 ? wait : 0) > 0 && (pfd.revents & POLLIN))
+			sim->Collect();
+		else if(pfd.revents & POLLHUP)
+			usleep(10000);
+		sim->ParseInput();
+	}
+	return NULL;
+}
@@ -0,0 +1,107 @@
+/************************************************
+GPS receiver simulator
+
+A fake Microstack (or u-blox) on a pseudo-terminal.
+It sends NMEA at its own baud and update rate and
+reacts to the PMTK/UBX configuration commands the
+way the real receivers do.  If the host's UART is
+set to a different baud the output is garbled and
+commands are ignored, like a real mismatched line.
+
+***********************************************/
+#ifndef __GPSSim_h
+#define __GPSSim_h
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "../nmea.h"
+#include "../ubx.h"
+using namespace std;
+
+#define GPSSIM_MTK		0
+#define GPSSIM_UBLOX		1
+#define GPSSIMMAXRATE		50	//Hz, fastest epoch rate the simulator is asked for
+
+//Where the simulated quad goes, see Move()
+#define GPSSIM_HOVER		0	//Stays at the start position
+#define GPSSIM_LINE		1	//Straight on at course and speed
+#define GPSSIM_CIRCLE		2	//Around the start position at radius and speed
+#define GPSSIM_WAYPOINTS	3	//Through a waypoints.txt at speed, then back to the first
+
+
+class GPSSim
+{
+	public:
+		GPSSim();
+		~GPSSim();
+
+		bool Open();
+		string SlavePath();
+		int Start();
+		void Stop();
+		static void *SimThread(void *);
+
+		//Receiver behaviour, set before Start()
+		int receiverType;
+		int baud;
+		int rateHz;
+		int maxBaud;		//PMTK251/CFG-PRT above this are ignored
+		int maxRateHz;		//PMTK220/CFG-RATE above this are refused
+		bool fullOutput;	//GSA and GSV too, PMTK314 turns them off
+		uint16_t outMask;	//UBXPROTO_ flags, CFG-PRT sets it
+		bool navPVT;		//CFG-MSG NAV-PVT on
+		double coldStartSeconds;	//Time to first fix from Start()
+		double hotStartSeconds;		//Time to first fix after a PMTK741/MGA-INI hint
+		NMEAFix fix;
+
+		//Trajectory, set before Start()
+		int trajectory;		//GPSSIM_ flags above
+		double speed;		//Meters per second
+		double radius;		//Meters, GPSSIM_CIRCLE
+		bool LoadWayPoints(const string &path);
+
+		//Damage to the NMEA output, like a noisy line
+		double badChecksumRate;	//Fraction of sentences sent with a wrong checksum
+		double dropRate;	//Fraction of bytes that never arrive
+		unsigned int seed;	//rand_r() state, the same seed gives the same damage
+
+		//The NAV-PVT a u-blox would send for fix
+		static UBXSolution MakeSolution(const NMEAFix &fix);
+
+		//What the host did to us
+		unsigned long epochsSent;
+		unsigned long bytesSent;
+		unsigned long garbledBytes;
+		unsigned long commandsSeen;
+		unsigned long commandsIgnored;
+		unsigned long checksumsCorrupted;
+		unsigned long bytesDropped;
+		bool hinted;
+
+	private:
+		int master;
+		bool shutDown;
+		pthread_t simThread;
+		string input;
+		string slavePath;
+
+		double Now();
+		double fixAt;
+		double startLat;
+		double startLng;
+		double traveled;	//Meters along the trajectory
+		vector<NMEAFix> wayPoints;
+		void Move(double seconds);
+		string Damage(const string &s);
+		void Hint();
+		int HostBaud();
+		void Send(const string &s);
+		void SendEpoch();
+		void Collect();
+		void ParseInput();
+		void HandleNMEA(const string &sentence);
+		void HandleUBX(const uint8_t *frame,size_t len);
+};
+
+#endif // def(__GPSSim_h)
@@ -0,0 +1,105 @@
+/************************************************
+gpssim - fake GPS receiver on a pty
+
+Prints the slave path, point autocontrol or a
+bench at it and it behaves like the Microstack.
+The quad hovers, flies a line, a circle or a
+recorded waypoints.txt at 1 to 50 Hz, optionally
+over a line that corrupts checksums and drops bytes.
+
+usage: gpssim [--ublox] [--baud n] [--rate hz] [--maxbaud n] [--maxrate n] [--cold s]
+	[--hover | --line | --circle | --waypoints file] [--speed m/s] [--course deg] [--radius m]
+	[--badsum fraction] [--drop fraction] [--seed n] [--seconds n]
+
+***********************************************/
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gpssim.h"
+using namespace std;
+
+
+int main(int argc,char **argv)
+{
+	GPSSim sim;
+	int seconds = 0;
+
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"--ublox") == 0)
+			sim.receiverType = GPSSIM_UBLOX;
+		else if(strcmp(argv[i],"--baud") == 0 && i + 1 < argc)
+			sim.baud = atoi(argv[++i]);
+		else if(strcmp(argv[i],"--rate") == 0 && i + 1 < argc)
+			sim.rateHz = atoi(argv[++i]);
+		else if(strcmp(argv[i],"--maxbaud") == 0 && i + 1 < argc)
+			sim.maxBaud = atoi(argv[++i]);
+		else if(strcmp(argv[i],"--maxrate") == 0 && i + 1 < argc)
+			sim.maxRateHz = atoi(argv[++i]);
+		else if(strcmp(argv[i],"--cold") == 0 && i + 1 < argc)
+			sim.coldStartSeconds = atof(argv[++i]);
+		else if(strcmp(argv[i],"--hover") == 0)
+			sim.trajectory = GPSSIM_HOVER;
+		else if(strcmp(argv[i],"--line") == 0)
+			sim.trajectory = GPSSIM_LINE;
+		else if(strcmp(argv[i],"--circle") == 0)
+			sim.trajectory = GPSSIM_CIRCLE;
+		else if(strcmp(argv[i],"--waypoints") == 0 && i + 1 < argc)
+		{
+			sim.trajectory = GPSSIM_WAYPOINTS;
+			if(!sim.LoadWayPoints(argv[++i]))
+			{
+				cerr << "no waypoints in " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i],"--speed") == 0 && i + 1 < argc)
+			sim.speed = atof(argv[++i]);
+		else if(strcmp(argv[i],"--course") == 0 && i + 1 < argc)
+			sim.fix.course = atof(argv[++i]);
+		else if(strcmp(argv[i],"--radius") == 0 && i + 1 < argc)
+			sim.radius = atof(argv[++i]);
+		else if(strcmp(argv[i],"--badsum") == 0 && i + 1 < argc)
+			sim.badChecksumRate = atof(argv[++i]);
+		else if(strcmp(argv[i],"--drop") == 0 && i + 1 < argc)
+			sim.dropRate = atof(argv[++i]);
+		else if(strcmp(argv[i],"--seed") == 0 && i + 1 < argc)
+			sim.seed = atoi(argv[++i]);
+		else if(strcmp(argv[i],"--seconds") == 0 && i + 1 < argc)
+			seconds = atoi(argv[++i]);
+		else
+		{
+			cerr << "usage: gpssim [--ublox] [--baud n] [--rate hz] [--maxbaud n] [--maxrate n] [--cold s] [--hover | --line | --circle | --waypoints file] [--speed m/s] [--course deg] [--radius m] [--badsum fraction] [--drop fraction] [--seed n] [--seconds n]" << endl;
+			return 1;
+		}
+	}
+	if(sim.rateHz < 1 || sim.rateHz > GPSSIMMAXRATE)
+	{
+		cerr << "rate must be 1 to " << GPSSIMMAXRATE << " Hz" << endl;
+		return 1;
+	}
+	//Asking for a rate means the receiver can do it
+	if(sim.maxRateHz < sim.rateHz)
+		sim.maxRateHz = sim.rateHz;
+
+	if(!sim.Open())
+	{
+		cerr << "unable to create pty" << endl;
+		return 1;
+	}
+	cout << sim.SlavePath() << endl;
+	sim.Start();
+
+	//0 runs until killed
+	for(int s=0;seconds == 0 || s < seconds;s++)
+	{
+		sleep(1);
+		printf("baud %d  rate %d Hz  epochs %lu  commands %lu  bad checksums %lu  dropped %lu\n",sim.baud,sim.rateHz,
+			sim.epochsSent,sim.commandsSeen,sim.checksumsCorrupted,sim.bytesDropped);
+		fflush(stdout);
+	}
+	sim.Stop();
+	return 0;
+}
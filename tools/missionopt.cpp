@@ -0,0 +1,402 @@
+#include "missionopt.h"
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+
+static double Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+MissionOptimizer::MissionOptimizer()
+{
+	speed = MISSIONOPTSPEED;
+	climb = MISSIONOPTCLIMB;
+	openEnd = false;
+	count = 0;
+	seedCost = 0;
+	rounds = 0;
+	neighborSeconds = seedSeconds = parallelSeconds = finishSeconds = 0;
+}
+
+
+void MissionOptimizer::Load(const Track &track)
+{
+	count = track.Count();
+	east = track.east;
+	north = track.north;
+	up = track.up;
+}
+
+
+float MissionOptimizer::Cost(int a,int b) const
+{
+	//The open end's free waypoint costs nothing to reach
+	if(a >= count || b >= count)
+		return 0;
+	float de = east[b] - east[a];
+	float dn = north[b] - north[a];
+	return max(sqrtf(de * de + dn * dn) / speed,fabsf(up[b] - up[a]) / climb);
+}
+
+
+float MissionOptimizer::Cost(const vector<int> &order) const
+{
+	float total = 0;
+	for(size_t i=0;i + 1<order.size();i++)
+		total += Cost(order[i],order[i + 1]);
+	return total;
+}
+
+
+//Closest waypoints of first..last - 1, each only writes its own list.  Walks out both ways in order of
+//east from the waypoint and stops each way once the east gap alone costs more than the furthest kept.
+void MissionOptimizer::Neighbors(int first,int last)
+{
+	int k = min(MISSIONOPTNEIGHBORS,count - 1);
+	vector<float> cost(k);
+	for(int a=first;a<last;a++)
+	{
+		int *list = &neighbors[a * MISSIONOPTNEIGHBORS];
+		int found = 0;
+		for(int way=-1;way<=1;way+=2)
+		{
+			for(int r=rank[a] + way;r>=0 && r<count;r+=way)
+			{
+				int b = byEast[r];
+				if(found == k && fabsf(east[b] - east[a]) / speed >= cost[k - 1])
+					break;
+				float c = Cost(a,b);
+				if(found == k && c >= cost[k - 1])
+					continue;
+				int i = found < k ? found++ : k - 1;
+				while(i > 0 && cost[i - 1] > c)
+				{
+					cost[i] = cost[i - 1];
+					list[i] = list[i - 1];
+					i--;
+				}
+				cost[i] = c;
+				list[i] = b;
+			}
+		}
+		for(int i=found;i<MISSIONOPTNEIGHBORS;i++)
+			list[i] = -1;
+	}
+}
+
+
+//Nearest unvisited waypoint each hop, from the neighbor lists when one is left in them
+void MissionOptimizer::Seed()
+{
+	int n = openEnd ? count + 1 : count;
+	int end = n - 1;
+	vector<char> visited(count,0);
+	tour.assign(1,0);
+	visited[0] = 1;
+	if(end < count)
+		visited[end] = 1;
+	int here = 0;
+	for(int step=1;step<end;step++)
+	{
+		int next = -1;
+		for(int i=0;i<MISSIONOPTNEIGHBORS && next < 0;i++)
+		{
+			int c = neighbors[here * MISSIONOPTNEIGHBORS + i];
+			if(c >= 0 && !visited[c])
+				next = c;
+		}
+		if(next < 0)
+		{
+			float best = FLT_MAX;
+			for(int c=0;c<count;c++)
+				if(!visited[c] && Cost(here,c) < best)
+				{
+					best = Cost(here,c);
+					next = c;
+				}
+		}
+		visited[next] = 1;
+		tour.push_back(next);
+		here = next;
+	}
+	tour.push_back(end);
+	pos.resize(n);
+	for(int i=0;i<n;i++)
+		pos[tour[i]] = i;
+}
+
+
+void MissionOptimizer::Reverse(int p,int q)
+{
+	for(;p<q;p++,q--)
+	{
+		swap(tour[p],tour[q]);
+		pos[tour[p]] = p;
+		pos[tour[q]] = q;
+	}
+}
+
+
+//Takes the length waypoints from position p and puts them after the one at position after
+void MissionOptimizer::Move(int p,int length,int after,bool reversed)
+{
+	int segment[3];
+	for(int i=0;i<length;i++)
+		segment[i] = tour[reversed ? p + length - 1 - i : p + i];
+	int first;
+	if(after > p)
+	{
+		for(int i=p;i + length<=after;i++)
+		{
+			tour[i] = tour[i + length];
+			pos[tour[i]] = i;
+		}
+		first = after - length + 1;
+	}
+	else
+	{
+		for(int i=p + length - 1;i - length>after;i--)
+		{
+			tour[i] = tour[i - length];
+			pos[tour[i]] = i;
+		}
+		first = after + 1;
+	}
+	for(int i=0;i<length;i++)
+	{
+		tour[first + i] = segment[i];
+		pos[segment[i]] = first + i;
+	}
+}
+
+
+//Reverses a stretch next to the waypoint at position i if that joins it to one of its closest
+bool MissionOptimizer::TwoOpt(int i,int lo,int hi,int stretch)
+{
+	int a = tour[i];
+	if(i + 1 <= hi)
+	{
+		int succ = tour[i + 1];
+		float old = Cost(a,succ);
+		for(int k=0;k<MISSIONOPTNEIGHBORS;k++)
+		{
+			int c = neighbors[a * MISSIONOPTNEIGHBORS + k];
+			if(c < 0 || Cost(a,c) >= old)
+				break;
+			if(owner[c] != stretch)
+				continue;
+			int j = pos[c];
+			if(j > i + 1 && j + 1 <= hi)
+			{
+				if(Cost(a,c) + Cost(succ,tour[j + 1]) < old + Cost(c,tour[j + 1]) - 1e-4f)
+				{
+					Reverse(i + 1,j);
+					return true;
+				}
+			}
+			else if(j < i && i > lo)
+			{
+				if(Cost(c,a) + Cost(tour[j + 1],succ) < old + Cost(c,tour[j + 1]) - 1e-4f)
+				{
+					Reverse(j + 1,i);
+					return true;
+				}
+			}
+		}
+	}
+	if(i - 1 >= lo && i < hi)
+	{
+		int pred = tour[i - 1];
+		float old = Cost(pred,a);
+		for(int k=0;k<MISSIONOPTNEIGHBORS;k++)
+		{
+			int c = neighbors[a * MISSIONOPTNEIGHBORS + k];
+			if(c < 0 || Cost(a,c) >= old)
+				break;
+			if(owner[c] != stretch)
+				continue;
+			int j = pos[c];
+			if(j < i - 1)
+			{
+				if(Cost(tour[j - 1],pred) + Cost(c,a) < old + Cost(tour[j - 1],c) - 1e-4f)
+				{
+					Reverse(j,i - 1);
+					return true;
+				}
+			}
+			else if(j > i)
+			{
+				if(Cost(pred,tour[j - 1]) + Cost(a,c) < old + Cost(tour[j - 1],c) - 1e-4f)
+				{
+					Reverse(i,j - 1);
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+//Moves one to three waypoints from position p to beside one of the first one's closest
+bool MissionOptimizer::OrOpt(int p,int lo,int hi,int stretch)
+{
+	for(int length=1;length<=3;length++)
+	{
+		int last = p + length - 1;
+		if(p - 1 < lo || last + 1 > hi)
+			break;
+		int s0 = tour[p],s1 = tour[last];
+		int prev = tour[p - 1],next = tour[last + 1];
+		float gain = Cost(prev,s0) + Cost(s1,next) - Cost(prev,next);
+		if(gain <= 1e-4f)
+			continue;
+		for(int k=0;k<MISSIONOPTNEIGHBORS;k++)
+		{
+			int c = neighbors[s0 * MISSIONOPTNEIGHBORS + k];
+			if(c < 0 || Cost(s0,c) >= gain)
+				break;
+			if(owner[c] != stretch)
+				continue;
+			int j = pos[c];
+			if(j >= p && j <= last)
+				continue;
+
+			//c, s0 .. s1, then what followed c
+			if(j != p - 1 && j + 1 <= hi)
+			{
+				int d = tour[j + 1];
+				if(Cost(c,s0) + Cost(s1,d) - Cost(c,d) < gain - 1e-4f)
+				{
+					Move(p,length,j,false);
+					return true;
+				}
+			}
+			//What came before c, s1 .. s0, c
+			if(j != last + 1 && j - 1 >= lo)
+			{
+				int e = tour[j - 1];
+				if(Cost(e,s1) + Cost(s0,c) - Cost(e,c) < gain - 1e-4f)
+				{
+					Move(p,length,j - 1,true);
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+//Positions lo and hi stay put, everything between is improved until no move helps
+void MissionOptimizer::Improve(int lo,int hi,int stretch)
+{
+	bool improved = true;
+	while(improved)
+	{
+		improved = false;
+		for(int i=lo;i<=hi;i++)
+			if(TwoOpt(i,lo,hi,stretch) || (i > lo && i < hi && OrOpt(i,lo,hi,stretch)))
+				improved = true;
+	}
+}
+
+
+float MissionOptimizer::Optimize(vector<int> &order,int threads)
+{
+	order.clear();
+	rounds = 0;
+	neighborSeconds = seedSeconds = parallelSeconds = finishSeconds = 0;
+	if(count < 3)
+	{
+		for(int i=0;i<count;i++)
+			order.push_back(i);
+		seedCost = Cost(order);
+		return seedCost;
+	}
+	if(threads <= 0)
+		threads = max((int)thread::hardware_concurrency(),1);
+	int n = openEnd ? count + 1 : count;
+
+	//Closest lists, split across the threads by waypoint
+	double t = Now();
+	neighbors.assign(count * MISSIONOPTNEIGHBORS,-1);
+	byEast.resize(count);
+	rank.resize(count);
+	for(int i=0;i<count;i++)
+		byEast[i] = i;
+	sort(byEast.begin(),byEast.end(),[this](int a,int b) { return east[a] < east[b]; });
+	for(int i=0;i<count;i++)
+		rank[byEast[i]] = i;
+	int workers = max(min(threads,count / MISSIONOPTMINCHUNK),1);
+	vector< future<void> > jobs;
+	for(int k=1;k<workers;k++)
+		jobs.push_back(async(launch::async,&MissionOptimizer::Neighbors,this,count * k / workers,count * (k + 1) / workers));
+	Neighbors(0,count / workers);
+	for(size_t k=0;k<jobs.size();k++)
+		jobs[k].get();
+	neighborSeconds = Now() - t;
+
+	t = Now();
+	Seed();
+	seedCost = Cost(tour);
+	seedSeconds = Now() - t;
+
+	//A stretch a thread, cut half a stretch further along every other round
+	t = Now();
+	owner.assign(n,-1);
+	int stretches = min(threads,(n - 1) / MISSIONOPTMINCHUNK);
+	float before = seedCost;
+	for(int round=0;stretches > 1 && round<MISSIONOPTROUNDS;round++)
+	{
+		int length = (n - 1) / stretches;
+		int offset = round % 2 ? length / 2 : 0;
+		vector<int> cut(1,0);
+		for(int k=1;offset + k * length<n - 1;k++)
+			cut.push_back(offset + k * length);
+		if(offset > 0)
+			cut.insert(cut.begin() + 1,offset);
+		cut.push_back(n - 1);
+		for(size_t k=0;k + 1<cut.size();k++)
+		{
+			owner[tour[cut[k]]] = -1;
+			for(int i=cut[k] + 1;i<cut[k + 1];i++)
+				owner[tour[i]] = k;
+		}
+		owner[tour[n - 1]] = -1;
+		jobs.clear();
+		for(size_t k=1;k + 1<cut.size();k++)
+			jobs.push_back(async(launch::async,&MissionOptimizer::Improve,this,cut[k],cut[k + 1],(int)k));
+		Improve(cut[0],cut[1],0);
+		for(size_t k=0;k<jobs.size();k++)
+			jobs[k].get();
+		rounds++;
+		float after = Cost(tour);
+		bool settled = before - after < before * MISSIONOPTSETTLED;
+		before = after;
+		if(settled && round > 0)
+			break;
+	}
+	parallelSeconds = Now() - t;
+
+	//Then the whole tour, for moves longer than a stretch
+	t = Now();
+	for(int i=1;i<n - 1;i++)
+		owner[tour[i]] = 0;
+	owner[tour[0]] = owner[tour[n - 1]] = -1;
+	Improve(0,n - 1,0);
+	finishSeconds = Now() - t;
+
+	for(int i=0;i<n;i++)
+		if(tour[i] < count)
+			order.push_back(tour[i]);
+	return Cost(order);
+}
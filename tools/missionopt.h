@@ -0,0 +1,85 @@
+/************************************************
+Mission order optimizer
+
+Reorders the waypoints of a survey or inspection
+mission to fly them in the least time.  The first
+waypoint is where the quad starts and stays first,
+the last stays last unless the end is left open.
+The cost of a hop is the time it takes, the longer
+of the horizontal distance at speed and the height
+change at the climb rate, since the quad climbs
+while it flies.
+
+A nearest neighbor tour seeds 2-opt (reverse a
+stretch) and Or-opt (move one to three points
+elsewhere), both only trying the few closest
+points of each waypoint.  The tour is cut into one
+stretch per core and each is improved on its own
+thread, the cuts moving between rounds so nothing
+stays stuck at one, then a last pass runs over the
+whole tour.
+
+***********************************************/
+#ifndef __MissionOpt_h
+#define __MissionOpt_h
+
+#include <vector>
+#include "../track.h"
+using namespace std;
+
+#define MISSIONOPTSPEED		2.0f	//Meters per second
+#define MISSIONOPTCLIMB		1.0f	//Meters per second
+#define MISSIONOPTNEIGHBORS	10	//Closest points each move is tried with
+#define MISSIONOPTMINCHUNK	250	//Waypoints, a stretch shorter than this is not worth a thread
+#define MISSIONOPTROUNDS	8	//Most rounds of parallel stretches
+#define MISSIONOPTSETTLED	0.001	//A round improving less than this fraction ends them
+
+
+class MissionOptimizer
+{
+	public:
+		MissionOptimizer();
+
+		void Load(const Track &track);
+
+		//Seconds from waypoint a to b, and along order
+		float Cost(int a,int b) const;
+		float Cost(const vector<int> &order) const;
+
+		//order gets every waypoint in the order to fly them, threads 0 for one per core.  Returns its cost.
+		float Optimize(vector<int> &order,int threads = 0);
+
+		float speed;
+		float climb;
+		bool openEnd;		//Finish at whichever waypoint is best, not the last one
+
+		//From the last Optimize()
+		float seedCost;
+		int rounds;
+		double neighborSeconds;
+		double seedSeconds;
+		double parallelSeconds;
+		double finishSeconds;
+
+	private:
+		int count;		//Waypoints, an open end adds a free one after them
+		vector<float> east;
+		vector<float> north;
+		vector<float> up;
+		vector<int> neighbors;	//MISSIONOPTNEIGHBORS a waypoint, closest first
+		vector<int> byEast;	//Waypoints west to east, and where each one is in that
+		vector<int> rank;
+		vector<int> tour;	//Waypoint at each position
+		vector<int> pos;	//Position of each waypoint
+		vector<int> owner;	//Stretch each waypoint is in this round, -1 at the cuts
+
+		void Neighbors(int first,int last);
+		void Seed();
+		void Improve(int lo,int hi,int stretch);
+		bool TwoOpt(int i,int lo,int hi,int stretch);
+		bool OrOpt(int p,int lo,int hi,int stretch);
+		void Reverse(int p,int q);
+		void Move(int p,int length,int after,bool reversed);
+};
+
+#endif // def(__MissionOpt_h)
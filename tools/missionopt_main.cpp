@@ -0,0 +1,86 @@
+/************************************************
+missionopt - reorder a mission to fly it faster
+
+Reads a waypoints.txt, finds the order that flies
+every waypoint in the least time and writes it.
+The first waypoint stays first and the last stays
+last unless --open lets the mission end anywhere.
+
+usage: missionopt [--open] [--speed m/s] [--climb m/s] [--threads n] in out
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "waypoints.h"
+#include "missionopt.h"
+using namespace std;
+
+
+double Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+int main(int argc,char **argv)
+{
+	MissionOptimizer optimizer;
+	int threads = 0;
+	const char *in = NULL,*out = NULL;
+
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"--open") == 0)
+			optimizer.openEnd = true;
+		else if(strcmp(argv[i],"--speed") == 0 && i + 1 < argc)
+			optimizer.speed = atof(argv[++i]);
+		else if(strcmp(argv[i],"--climb") == 0 && i + 1 < argc)
+			optimizer.climb = atof(argv[++i]);
+		else if(strcmp(argv[i],"--threads") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if(argv[i][0] != '-' && in == NULL)
+			in = argv[i];
+		else if(argv[i][0] != '-' && out == NULL)
+			out = argv[i];
+		else
+			in = out = NULL;
+	}
+	if(in == NULL || out == NULL || optimizer.speed <= 0 || optimizer.climb <= 0)
+	{
+		cerr << "usage: missionopt [--open] [--speed m/s] [--climb m/s] [--threads n] in out" << endl;
+		return 1;
+	}
+
+	vector<WayPoint> wp;
+	if(!ReadWayPoints(in,wp))
+	{
+		cerr << "no waypoints in " << in << endl;
+		return 1;
+	}
+	Track track;
+	track.Load(wp.data(),(int)wp.size());
+	optimizer.Load(track);
+	vector<int> order;
+	for(int i=0;i<(int)wp.size();i++)
+		order.push_back(i);
+	float fileCost = optimizer.Cost(order);
+	double t = Now();
+	float cost = optimizer.Optimize(order,threads);
+	t = Now() - t;
+	if(!WriteWayPoints(out,wp,order))
+	{
+		cerr << "unable to write " << out << endl;
+		return 1;
+	}
+	printf("%d waypoints: file order %.0f s, nearest neighbor %.0f s, optimized %.0f s (%.1f%% less than file order)\n",(int)wp.size(),
+		fileCost,optimizer.seedCost,cost,fileCost > 0 ? 100 * (fileCost - cost) / fileCost : 0);
+	printf("%.1f ms: neighbors %.1f, seed %.1f, %d parallel rounds %.1f, whole tour %.1f\n",t * 1000,optimizer.neighborSeconds * 1000,
+		optimizer.seedSeconds * 1000,optimizer.rounds,optimizer.parallelSeconds * 1000,optimizer.finishSeconds * 1000);
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include "simplify.h"
+#include <math.h>
+#include <float.h>
+#include <queue>
+
+
+//From point p of track to the segment from a to b, squared
+static float Distance2(const Track &track,int p,int a,int b)
+{
+	float ae = track.east[a],an = track.north[a],au = track.up[a];
+	float se = track.east[b] - ae,sn = track.north[b] - an,su = track.up[b] - au;
+	float pe = track.east[p] - ae,pn = track.north[p] - an,pu = track.up[p] - au;
+	float length2 = se * se + sn * sn + su * su;
+	float t = length2 > 0 ? (pe * se + pn * sn + pu * su) / length2 : 0;
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	pe -= t * se;
+	pn -= t * sn;
+	pu -= t * su;
+	return pe * pe + pn * pn + pu * pu;
+}
+
+
+//Twice the area of the triangle a b c
+static float Area(const Track &track,int a,int b,int c)
+{
+	float ue = track.east[b] - track.east[a],un = track.north[b] - track.north[a],uu = track.up[b] - track.up[a];
+	float ve = track.east[c] - track.east[a],vn = track.north[c] - track.north[a],vu = track.up[c] - track.up[a];
+	float x = un * vu - uu * vn;
+	float y = uu * ve - ue * vu;
+	float z = ue * vn - un * ve;
+	return sqrtf(x * x + y * y + z * z);
+}
+
+
+//True if every point between a and b is within tolerance of the segment, squared
+static bool Within(const Track &track,int a,int b,float tolerance2)
+{
+	for(int i=a + 1;i<b;i++)
+		if(Distance2(track,i,a,b) > tolerance2)
+			return false;
+	return true;
+}
+
+
+int SimplifyDouglasPeucker(const Track &track,float tolerance,vector<int> &keep)
+{
+	int count = track.Count();
+	keep.clear();
+	if(count <= 2)
+	{
+		for(int i=0;i<count;i++)
+			keep.push_back(i);
+		return count;
+	}
+	vector<char> kept(count,0);
+	kept[0] = kept[count - 1] = 1;
+
+	//Pieces still to check, a stack instead of recursion so a long straight recording cannot overflow
+	vector< pair<int,int> > pieces;
+	pieces.push_back(make_pair(0,count - 1));
+	float tolerance2 = tolerance * tolerance;
+	while(!pieces.empty())
+	{
+		int a = pieces.back().first;
+		int b = pieces.back().second;
+		pieces.pop_back();
+		float worst = -1;
+		int split = -1;
+		for(int i=a + 1;i<b;i++)
+		{
+			float d2 = Distance2(track,i,a,b);
+			if(d2 > worst)
+			{
+				worst = d2;
+				split = i;
+			}
+		}
+		if(split < 0 || worst <= tolerance2)
+			continue;
+		kept[split] = 1;
+		pieces.push_back(make_pair(a,split));
+		pieces.push_back(make_pair(split,b));
+	}
+	for(int i=0;i<count;i++)
+		if(kept[i])
+			keep.push_back(i);
+	return (int)keep.size();
+}
+
+
+struct SimplifyCandidate
+{
+	float area;
+	int point;
+	int version;
+	bool operator<(const SimplifyCandidate &o) const { return area > o.area; }
+};
+
+
+int SimplifyVisvalingam(const Track &track,float tolerance,vector<int> &keep)
+{
+	int count = track.Count();
+	keep.clear();
+	if(count <= 2)
+	{
+		for(int i=0;i<count;i++)
+			keep.push_back(i);
+		return count;
+	}
+
+	//Still kept points as a linked list, a candidate is stale once its point's version moves on
+	vector<int> prev(count),next(count),version(count,0);
+	vector<char> kept(count,1);
+	priority_queue<SimplifyCandidate> candidates;
+	for(int i=0;i<count;i++)
+	{
+		prev[i] = i - 1;
+		next[i] = i + 1;
+		if(i > 0 && i + 1 < count)
+		{
+			SimplifyCandidate c = { Area(track,i - 1,i,i + 1), i, 0 };
+			candidates.push(c);
+		}
+	}
+	float tolerance2 = tolerance * tolerance;
+	while(!candidates.empty())
+	{
+		SimplifyCandidate c = candidates.top();
+		candidates.pop();
+		int p = c.point;
+		if(c.version != version[p] || !kept[p])
+			continue;
+
+		//Stays until a neighbor goes and it is looked at again
+		if(!Within(track,prev[p],next[p],tolerance2))
+			continue;
+		kept[p] = 0;
+		int a = prev[p],b = next[p];
+		next[a] = b;
+		prev[b] = a;
+		if(prev[a] >= 0)
+		{
+			SimplifyCandidate ca = { Area(track,prev[a],a,b), a, ++version[a] };
+			candidates.push(ca);
+		}
+		if(next[b] < count)
+		{
+			SimplifyCandidate cb = { Area(track,a,b,next[b]), b, ++version[b] };
+			candidates.push(cb);
+		}
+	}
+	for(int i=0;i<count;i++)
+		if(kept[i])
+			keep.push_back(i);
+	return (int)keep.size();
+}
+
+
+float SimplifyError(const Track &track,const vector<int> &keep)
+{
+	float worst = 0;
+	for(size_t k=0;k + 1<keep.size();k++)
+		for(int i=keep[k] + 1;i<keep[k + 1];i++)
+			worst = max(worst,Distance2(track,i,keep[k],keep[k + 1]));
+	return sqrtf(worst);
+}
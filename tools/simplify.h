@@ -0,0 +1,37 @@
+/************************************************
+Path simplification for recorded macros
+
+Drops the points of a recording that a straight
+line between their neighbors already passes within
+a tolerance of, so a macro flies the same path
+from fewer points.  The tolerance is in 3D, a
+dropped point is never further than that from the
+simplified path in any direction.
+
+Douglas-Peucker keeps the point furthest off the
+line between the ends and splits there until every
+piece is within the tolerance.  Visvalingam drops
+the point making the smallest triangle with its
+neighbors first, one at a time, as long as every
+point already dropped between them stays within the
+tolerance of the new line.
+
+***********************************************/
+#ifndef __Simplify_h
+#define __Simplify_h
+
+#include <vector>
+#include "../track.h"
+using namespace std;
+
+#define SIMPLIFYTOLERANCE	6.0	//Inches
+#define INCHESTOMETERS		0.0254
+
+//Indexes of the points of track to keep, in order, first and last always.  tolerance in meters.
+int SimplifyDouglasPeucker(const Track &track,float tolerance,vector<int> &keep);
+int SimplifyVisvalingam(const Track &track,float tolerance,vector<int> &keep);
+
+//Furthest any point of track is from the path through keep, meters
+float SimplifyError(const Track &track,const vector<int> &keep);
+
+#endif // def(__Simplify_h)
@@ -0,0 +1,85 @@
+/************************************************
+simplify - thin out a recorded macro
+
+Reads a waypoints.txt as autocontrol saves it and
+writes the points a simplified path keeps, times
+and headings as they were recorded, so the quad
+flies the same path within the tolerance from
+fewer points.
+
+usage: simplify [--dp | --vw] [--tolerance inches] in out
+
+***********************************************/
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "waypoints.h"
+#include "simplify.h"
+using namespace std;
+
+#define SIMPLIFY_DP		0
+#define SIMPLIFY_VW		1
+
+
+double Now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+int main(int argc,char **argv)
+{
+	int method = SIMPLIFY_DP;
+	double inches = SIMPLIFYTOLERANCE;
+	const char *in = NULL,*out = NULL;
+
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"--dp") == 0)
+			method = SIMPLIFY_DP;
+		else if(strcmp(argv[i],"--vw") == 0)
+			method = SIMPLIFY_VW;
+		else if(strcmp(argv[i],"--tolerance") == 0 && i + 1 < argc)
+			inches = atof(argv[++i]);
+		else if(argv[i][0] != '-' && in == NULL)
+			in = argv[i];
+		else if(argv[i][0] != '-' && out == NULL)
+			out = argv[i];
+		else
+			in = out = NULL;
+	}
+	if(in == NULL || out == NULL || inches <= 0)
+	{
+		cerr << "usage: simplify [--dp | --vw] [--tolerance inches] in out" << endl;
+		return 1;
+	}
+
+	vector<WayPoint> wp;
+	if(!ReadWayPoints(in,wp))
+	{
+		cerr << "no waypoints in " << in << endl;
+		return 1;
+	}
+	Track track;
+	track.Load(wp.data(),(int)wp.size());
+	vector<int> keep;
+	double t = Now();
+	if(method == SIMPLIFY_VW)
+		SimplifyVisvalingam(track,inches * INCHESTOMETERS,keep);
+	else
+		SimplifyDouglasPeucker(track,inches * INCHESTOMETERS,keep);
+	t = Now() - t;
+	if(!WriteWayPoints(out,wp,keep))
+	{
+		cerr << "unable to write " << out << endl;
+		return 1;
+	}
+	printf("%s: %d of %d points kept (%.1f%%), furthest %.2f in off the recording, %.2f ms\n",method == SIMPLIFY_VW ? "visvalingam" : "douglas-peucker",
+		(int)keep.size(),(int)wp.size(),100.0 * keep.size() / wp.size(),SimplifyError(track,keep) / INCHESTOMETERS,t * 1000);
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include "waypoints.h"
+#include <fstream>
+#include <string>
+#include <stdio.h>
+
+
+bool ReadWayPoints(const char *path,vector<WayPoint> &wp)
+{
+	ifstream iFile(path);
+	string line;
+	wp.clear();
+	while(getline(iFile,line))
+	{
+		WayPoint p;
+		p.seconds = -1;
+		if(sscanf(line.c_str(),"%lf;%lf;%lf;%lf;%lf",&p.lat,&p.lng,&p.alt,&p.heading,&p.seconds) < 4)
+			continue;
+		wp.push_back(p);
+	}
+	return !wp.empty();
+}
+
+
+bool WriteWayPoints(const char *path,const vector<WayPoint> &wp,const vector<int> &order)
+{
+	ofstream oFile(path);
+	if(!oFile.is_open())
+		return false;
+	//The default 6 digits is only 10 m of latitude
+	oFile.precision(10);
+	size_t count = order.empty() ? wp.size() : order.size();
+	for(size_t i=0;i<count;i++)
+	{
+		const WayPoint &p = wp[order.empty() ? i : order[i]];
+		oFile << p.lat << ";" << p.lng << ";" << p.alt << ";" << p.heading;
+		if(p.seconds >= 0)
+			oFile << ";" << p.seconds;
+		oFile << endl;
+	}
+	return true;
+}
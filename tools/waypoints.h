@@ -0,0 +1,22 @@
+/************************************************
+Waypoint files for the offline tools
+
+Reads and writes waypoints.txt the way autocontrol
+saves it, lat;lng;alt;heading;seconds a line.
+Older files stop at the heading, their points get
+seconds -1 and are written back without it.
+
+***********************************************/
+#ifndef __WayPoints_h
+#define __WayPoints_h
+
+#include <vector>
+#include "../gps.h"
+using namespace std;
+
+//False if there is no file or no points in it
+bool ReadWayPoints(const char *path,vector<WayPoint> &wp);
+//order holds indexes into wp, all of them in file order if empty
+bool WriteWayPoints(const char *path,const vector<WayPoint> &wp,const vector<int> &order);
+
+#endif // def(__WayPoints_h)
@@ -0,0 +1,611 @@
+#include "track.h"
+#include "gps.h"
+#include <math.h>
+#include <float.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRACKHAVEAVX2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TRACKHAVENEON
+#endif
+
+#define TRACKHALFPI		1.57079633f
+#define TRACKPI			3.14159265f
+
+//atan(t) on 0..1, odd polynomial good to 1e-5 rad.  Every kernel uses these.
+#define TRACKATAN1		0.99997726f
+#define TRACKATAN3		-0.33262347f
+#define TRACKATAN5		0.19354346f
+#define TRACKATAN7		-0.11643287f
+#define TRACKATAN9		0.05265332f
+#define TRACKATAN11		-0.01172120f
+
+
+//One set per instruction set, picked once before main()
+struct TrackKernels
+{
+	void (*distances)(const float *e,const float *n,int count,float pe,float pn,float *out);
+	void (*bearings)(const float *e,const float *n,int count,float pe,float pn,float *out);
+	float (*legs)(const float *e,const float *n,int count,float *length,float *bearing,float *cumulative);
+	int (*nearest)(const float *e,const float *n,int count,float pe,float pn,float &d2);
+	int kernel;
+};
+
+
+//---------------- Scalar ----------------
+
+static inline float Atan01(float t)
+{
+	float t2 = t * t;
+	return t * (TRACKATAN1 + t2 * (TRACKATAN3 + t2 * (TRACKATAN5 + t2 * (TRACKATAN7 + t2 * (TRACKATAN9 + t2 * TRACKATAN11)))));
+}
+
+
+//Compass bearing of (east, north) in degrees, 0 is north, clockwise
+static inline float Bearing(float e,float n)
+{
+	float ae = fabsf(e);
+	float an = fabsf(n);
+	float mx = ae > an ? ae : an;
+	float mn = ae > an ? an : ae;
+	float a = Atan01(mx > 0 ? mn / mx : 0);
+	if(ae > an)
+		a = TRACKHALFPI - a;
+	if(n < 0)
+		a = TRACKPI - a;
+	if(e < 0)
+		a = -a;
+	a *= GEODEGREES;
+	return a < 0 ? a + 360 : a;
+}
+
+
+static inline float SegmentDistance2(float ae,float an,float be,float bn,float pe,float pn)
+{
+	float de = be - ae;
+	float dn = bn - an;
+	float we = pe - ae;
+	float wn = pn - an;
+	float dd = de * de + dn * dn;
+	float t = dd > 0 ? (we * de + wn * dn) / dd : 0;
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	float qe = we - t * de;
+	float qn = wn - t * dn;
+	return qe * qe + qn * qn;
+}
+
+
+static void DistancesScalar(const float *e,const float *n,int count,float pe,float pn,float *out)
+{
+	for(int i=0;i<count;i++)
+	{
+		float de = e[i] - pe;
+		float dn = n[i] - pn;
+		out[i] = sqrtf(de * de + dn * dn);
+	}
+}
+
+
+static void BearingsScalar(const float *e,const float *n,int count,float pe,float pn,float *out)
+{
+	for(int i=0;i<count;i++)
+		out[i] = Bearing(e[i] - pe,n[i] - pn);
+}
+
+
+static float LegsScalar(const float *e,const float *n,int count,float *length,float *bearing,float *cumulative)
+{
+	float total = 0;
+	for(int i=0;i + 1<count;i++)
+	{
+		float de = e[i + 1] - e[i];
+		float dn = n[i + 1] - n[i];
+		length[i] = sqrtf(de * de + dn * dn);
+		bearing[i] = Bearing(de,dn);
+		total += length[i];
+		cumulative[i] = total;
+	}
+	return total;
+}
+
+
+static int NearestScalar(const float *e,const float *n,int count,float pe,float pn,float &d2)
+{
+	int best = -1;
+	d2 = FLT_MAX;
+	for(int i=0;i + 1<count;i++)
+	{
+		float d = SegmentDistance2(e[i],n[i],e[i + 1],n[i + 1],pe,pn);
+		if(d < d2)
+		{
+			d2 = d;
+			best = i;
+		}
+	}
+	return best;
+}
+
+
+//---------------- AVX2, eight waypoints a step ----------------
+
+#ifdef TRACKHAVEAVX2
+#define TRACKAVX2 __attribute__((target("avx2,fma")))
+
+TRACKAVX2 static inline __m256 BearingAVX2(__m256 e,__m256 n)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 ae = _mm256_andnot_ps(sign,e);
+	__m256 an = _mm256_andnot_ps(sign,n);
+	__m256 mx = _mm256_max_ps(ae,an);
+	__m256 mn = _mm256_min_ps(ae,an);
+	//0/0 at the point itself, the blend below makes it 0 like the scalar code
+	__m256 zero = _mm256_setzero_ps();
+	__m256 t = _mm256_div_ps(mn,_mm256_max_ps(mx,_mm256_set1_ps(FLT_MIN)));
+	__m256 t2 = _mm256_mul_ps(t,t);
+	__m256 p = _mm256_set1_ps(TRACKATAN11);
+	p = _mm256_fmadd_ps(p,t2,_mm256_set1_ps(TRACKATAN9));
+	p = _mm256_fmadd_ps(p,t2,_mm256_set1_ps(TRACKATAN7));
+	p = _mm256_fmadd_ps(p,t2,_mm256_set1_ps(TRACKATAN5));
+	p = _mm256_fmadd_ps(p,t2,_mm256_set1_ps(TRACKATAN3));
+	p = _mm256_fmadd_ps(p,t2,_mm256_set1_ps(TRACKATAN1));
+	__m256 a = _mm256_mul_ps(p,t);
+	a = _mm256_blendv_ps(a,_mm256_sub_ps(_mm256_set1_ps(TRACKHALFPI),a),_mm256_cmp_ps(ae,an,_CMP_GT_OQ));
+	a = _mm256_blendv_ps(a,_mm256_sub_ps(_mm256_set1_ps(TRACKPI),a),_mm256_cmp_ps(n,zero,_CMP_LT_OQ));
+	a = _mm256_blendv_ps(a,_mm256_sub_ps(zero,a),_mm256_cmp_ps(e,zero,_CMP_LT_OQ));
+	a = _mm256_mul_ps(a,_mm256_set1_ps(GEODEGREES));
+	__m256 wrapped = _mm256_add_ps(a,_mm256_set1_ps(360));
+	return _mm256_blendv_ps(a,wrapped,_mm256_cmp_ps(a,zero,_CMP_LT_OQ));
+}
+
+
+TRACKAVX2 static void DistancesAVX2(const float *e,const float *n,int count,float pe,float pn,float *out)
+{
+	__m256 ve = _mm256_set1_ps(pe);
+	__m256 vn = _mm256_set1_ps(pn);
+	int i = 0;
+	for(;i + 8<=count;i+=8)
+	{
+		__m256 de = _mm256_sub_ps(_mm256_loadu_ps(e + i),ve);
+		__m256 dn = _mm256_sub_ps(_mm256_loadu_ps(n + i),vn);
+		__m256 d2 = _mm256_fmadd_ps(de,de,_mm256_mul_ps(dn,dn));
+		_mm256_storeu_ps(out + i,_mm256_sqrt_ps(d2));
+	}
+	DistancesScalar(e + i,n + i,count - i,pe,pn,out + i);
+}
+
+
+TRACKAVX2 static void BearingsAVX2(const float *e,const float *n,int count,float pe,float pn,float *out)
+{
+	__m256 ve = _mm256_set1_ps(pe);
+	__m256 vn = _mm256_set1_ps(pn);
+	int i = 0;
+	for(;i + 8<=count;i+=8)
+	{
+		__m256 de = _mm256_sub_ps(_mm256_loadu_ps(e + i),ve);
+		__m256 dn = _mm256_sub_ps(_mm256_loadu_ps(n + i),vn);
+		_mm256_storeu_ps(out + i,BearingAVX2(de,dn));
+	}
+	BearingsScalar(e + i,n + i,count - i,pe,pn,out + i);
+}
+
+
+TRACKAVX2 static float LegsAVX2(const float *e,const float *n,int count,float *length,float *bearing,float *cumulative)
+{
+	float total = 0;
+	int legs = count - 1;
+	int i = 0;
+	for(;i + 8<=legs;i+=8)
+	{
+		__m256 de = _mm256_sub_ps(_mm256_loadu_ps(e + i + 1),_mm256_loadu_ps(e + i));
+		__m256 dn = _mm256_sub_ps(_mm256_loadu_ps(n + i + 1),_mm256_loadu_ps(n + i));
+		_mm256_storeu_ps(length + i,_mm256_sqrt_ps(_mm256_fmadd_ps(de,de,_mm256_mul_ps(dn,dn))));
+		_mm256_storeu_ps(bearing + i,BearingAVX2(de,dn));
+		//The running sum is serial, it stays in the same pass over what we just stored
+		for(int k=0;k<8;k++)
+		{
+			total += length[i + k];
+			cumulative[i + k] = total;
+		}
+	}
+	for(;i<legs;i++)
+	{
+		float de = e[i + 1] - e[i];
+		float dn = n[i + 1] - n[i];
+		length[i] = sqrtf(de * de + dn * dn);
+		bearing[i] = Bearing(de,dn);
+		total += length[i];
+		cumulative[i] = total;
+	}
+	return total;
+}
+
+
+TRACKAVX2 static int NearestAVX2(const float *e,const float *n,int count,float pe,float pn,float &d2)
+{
+	int legs = count - 1;
+	if(legs < 8)
+		return NearestScalar(e,n,count,pe,pn,d2);
+
+	__m256 ve = _mm256_set1_ps(pe);
+	__m256 vn = _mm256_set1_ps(pn);
+	__m256 zero = _mm256_setzero_ps();
+	__m256 one = _mm256_set1_ps(1);
+	__m256 best = _mm256_set1_ps(FLT_MAX);
+	__m256i bestIndex = _mm256_set1_epi32(-1);
+	__m256i index = _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+	__m256i eight = _mm256_set1_epi32(8);
+	int i = 0;
+	for(;i + 8<=legs;i+=8)
+	{
+		__m256 ae = _mm256_loadu_ps(e + i);
+		__m256 an = _mm256_loadu_ps(n + i);
+		__m256 de = _mm256_sub_ps(_mm256_loadu_ps(e + i + 1),ae);
+		__m256 dn = _mm256_sub_ps(_mm256_loadu_ps(n + i + 1),an);
+		__m256 we = _mm256_sub_ps(ve,ae);
+		__m256 wn = _mm256_sub_ps(vn,an);
+		__m256 dd = _mm256_fmadd_ps(de,de,_mm256_mul_ps(dn,dn));
+		__m256 t = _mm256_div_ps(_mm256_fmadd_ps(we,de,_mm256_mul_ps(wn,dn)),_mm256_max_ps(dd,_mm256_set1_ps(FLT_MIN)));
+		t = _mm256_blendv_ps(zero,t,_mm256_cmp_ps(dd,zero,_CMP_GT_OQ));
+		t = _mm256_min_ps(_mm256_max_ps(t,zero),one);
+		__m256 qe = _mm256_fnmadd_ps(t,de,we);
+		__m256 qn = _mm256_fnmadd_ps(t,dn,wn);
+		__m256 d = _mm256_fmadd_ps(qe,qe,_mm256_mul_ps(qn,qn));
+		__m256 closer = _mm256_cmp_ps(d,best,_CMP_LT_OQ);
+		best = _mm256_blendv_ps(best,d,closer);
+		bestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndex),_mm256_castsi256_ps(index),closer));
+		index = _mm256_add_epi32(index,eight);
+	}
+
+	float lane[8];
+	int laneIndex[8];
+	_mm256_storeu_ps(lane,best);
+	_mm256_storeu_si256((__m256i *)laneIndex,bestIndex);
+	int found = -1;
+	d2 = FLT_MAX;
+	for(int k=0;k<8;k++)
+		if(lane[k] < d2 || (lane[k] == d2 && laneIndex[k] < found))
+		{
+			d2 = lane[k];
+			found = laneIndex[k];
+		}
+	for(;i<legs;i++)
+	{
+		float d = SegmentDistance2(e[i],n[i],e[i + 1],n[i + 1],pe,pn);
+		if(d < d2)
+		{
+			d2 = d;
+			found = i;
+		}
+	}
+	return found;
+}
+#endif
+
+
+//---------------- NEON, four waypoints a step ----------------
+
+#ifdef TRACKHAVENEON
+//ARMv7 NEON has no divide or square root, reciprocal estimates and two Newton steps
+//get within an ulp or two of the scalar answer
+static inline float32x4_t DivNEON(float32x4_t a,float32x4_t b)
+{
+#ifdef __aarch64__
+	return vdivq_f32(a,b);
+#else
+	float32x4_t r = vrecpeq_f32(b);
+	r = vmulq_f32(vrecpsq_f32(b,r),r);
+	r = vmulq_f32(vrecpsq_f32(b,r),r);
+	return vmulq_f32(a,r);
+#endif
+}
+
+
+static inline float32x4_t SqrtNEON(float32x4_t x)
+{
+#ifdef __aarch64__
+	return vsqrtq_f32(x);
+#else
+	float32x4_t r = vrsqrteq_f32(x);
+	r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x,r),r),r);
+	r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x,r),r),r);
+	//rsqrt(0) is infinite, keep 0 at 0
+	uint32x4_t isZero = vceqq_f32(x,vdupq_n_f32(0));
+	return vbslq_f32(isZero,vdupq_n_f32(0),vmulq_f32(x,r));
+#endif
+}
+
+
+static inline float32x4_t BearingNEON(float32x4_t e,float32x4_t n)
+{
+	float32x4_t zero = vdupq_n_f32(0);
+	float32x4_t ae = vabsq_f32(e);
+	float32x4_t an = vabsq_f32(n);
+	float32x4_t mx = vmaxq_f32(ae,an);
+	float32x4_t mn = vminq_f32(ae,an);
+	float32x4_t t = DivNEON(mn,vmaxq_f32(mx,vdupq_n_f32(FLT_MIN)));
+	float32x4_t t2 = vmulq_f32(t,t);
+	float32x4_t p = vdupq_n_f32(TRACKATAN11);
+	p = vmlaq_f32(vdupq_n_f32(TRACKATAN9),p,t2);
+	p = vmlaq_f32(vdupq_n_f32(TRACKATAN7),p,t2);
+	p = vmlaq_f32(vdupq_n_f32(TRACKATAN5),p,t2);
+	p = vmlaq_f32(vdupq_n_f32(TRACKATAN3),p,t2);
+	p = vmlaq_f32(vdupq_n_f32(TRACKATAN1),p,t2);
+	float32x4_t a = vmulq_f32(p,t);
+	a = vbslq_f32(vcgtq_f32(ae,an),vsubq_f32(vdupq_n_f32(TRACKHALFPI),a),a);
+	a = vbslq_f32(vcltq_f32(n,zero),vsubq_f32(vdupq_n_f32(TRACKPI),a),a);
+	a = vbslq_f32(vcltq_f32(e,zero),vnegq_f32(a),a);
+	a = vmulq_f32(a,vdupq_n_f32(GEODEGREES));
+	return vbslq_f32(vcltq_f32(a,zero),vaddq_f32(a,vdupq_n_f32(360)),a);
+}
+
+
+static void DistancesNEON(const float *e,const float *n,int count,float pe,float pn,float *out)
+{
+	float32x4_t ve = vdupq_n_f32(pe);
+	float32x4_t vn = vdupq_n_f32(pn);
+	int i = 0;
+	for(;i + 4<=count;i+=4)
+	{
+		float32x4_t de = vsubq_f32(vld1q_f32(e + i),ve);
+		float32x4_t dn = vsubq_f32(vld1q_f32(n + i),vn);
+		vst1q_f32(out + i,SqrtNEON(vmlaq_f32(vmulq_f32(dn,dn),de,de)));
+	}
+	DistancesScalar(e + i,n + i,count - i,pe,pn,out + i);
+}
+
+
+static void BearingsNEON(const float *e,const float *n,int count,float pe,float pn,float *out)
+{
+	float32x4_t ve = vdupq_n_f32(pe);
+	float32x4_t vn = vdupq_n_f32(pn);
+	int i = 0;
+	for(;i + 4<=count;i+=4)
+	{
+		float32x4_t de = vsubq_f32(vld1q_f32(e + i),ve);
+		float32x4_t dn = vsubq_f32(vld1q_f32(n + i),vn);
+		vst1q_f32(out + i,BearingNEON(de,dn));
+	}
+	BearingsScalar(e + i,n + i,count - i,pe,pn,out + i);
+}
+
+
+static float LegsNEON(const float *e,const float *n,int count,float *length,float *bearing,float *cumulative)
+{
+	float total = 0;
+	int legs = count - 1;
+	int i = 0;
+	for(;i + 4<=legs;i+=4)
+	{
+		float32x4_t de = vsubq_f32(vld1q_f32(e + i + 1),vld1q_f32(e + i));
+		float32x4_t dn = vsubq_f32(vld1q_f32(n + i + 1),vld1q_f32(n + i));
+		vst1q_f32(length + i,SqrtNEON(vmlaq_f32(vmulq_f32(dn,dn),de,de)));
+		vst1q_f32(bearing + i,BearingNEON(de,dn));
+		for(int k=0;k<4;k++)
+		{
+			total += length[i + k];
+			cumulative[i + k] = total;
+		}
+	}
+	for(;i<legs;i++)
+	{
+		float de = e[i + 1] - e[i];
+		float dn = n[i + 1] - n[i];
+		length[i] = sqrtf(de * de + dn * dn);
+		bearing[i] = Bearing(de,dn);
+		total += length[i];
+		cumulative[i] = total;
+	}
+	return total;
+}
+
+
+static int NearestNEON(const float *e,const float *n,int count,float pe,float pn,float &d2)
+{
+	int legs = count - 1;
+	if(legs < 4)
+		return NearestScalar(e,n,count,pe,pn,d2);
+
+	float32x4_t ve = vdupq_n_f32(pe);
+	float32x4_t vn = vdupq_n_f32(pn);
+	float32x4_t zero = vdupq_n_f32(0);
+	float32x4_t one = vdupq_n_f32(1);
+	float32x4_t best = vdupq_n_f32(FLT_MAX);
+	int32_t start[4] = { 0, 1, 2, 3 };
+	int32x4_t index = vld1q_s32(start);
+	int32x4_t bestIndex = vdupq_n_s32(-1);
+	int32x4_t four = vdupq_n_s32(4);
+	int i = 0;
+	for(;i + 4<=legs;i+=4)
+	{
+		float32x4_t ae = vld1q_f32(e + i);
+		float32x4_t an = vld1q_f32(n + i);
+		float32x4_t de = vsubq_f32(vld1q_f32(e + i + 1),ae);
+		float32x4_t dn = vsubq_f32(vld1q_f32(n + i + 1),an);
+		float32x4_t we = vsubq_f32(ve,ae);
+		float32x4_t wn = vsubq_f32(vn,an);
+		float32x4_t dd = vmlaq_f32(vmulq_f32(dn,dn),de,de);
+		float32x4_t t = DivNEON(vmlaq_f32(vmulq_f32(wn,dn),we,de),vmaxq_f32(dd,vdupq_n_f32(FLT_MIN)));
+		t = vbslq_f32(vcgtq_f32(dd,zero),t,zero);
+		t = vminq_f32(vmaxq_f32(t,zero),one);
+		float32x4_t qe = vmlsq_f32(we,t,de);
+		float32x4_t qn = vmlsq_f32(wn,t,dn);
+		float32x4_t d = vmlaq_f32(vmulq_f32(qn,qn),qe,qe);
+		uint32x4_t closer = vcltq_f32(d,best);
+		best = vbslq_f32(closer,d,best);
+		bestIndex = vbslq_s32(closer,index,bestIndex);
+		index = vaddq_s32(index,four);
+	}
+
+	float lane[4];
+	int32_t laneIndex[4];
+	vst1q_f32(lane,best);
+	vst1q_s32(laneIndex,bestIndex);
+	int found = -1;
+	d2 = FLT_MAX;
+	for(int k=0;k<4;k++)
+		if(lane[k] < d2 || (lane[k] == d2 && laneIndex[k] < found))
+		{
+			d2 = lane[k];
+			found = laneIndex[k];
+		}
+	for(;i<legs;i++)
+	{
+		float d = SegmentDistance2(e[i],n[i],e[i + 1],n[i + 1],pe,pn);
+		if(d < d2)
+		{
+			d2 = d;
+			found = i;
+		}
+	}
+	return found;
+}
+#endif
+
+
+static const TrackKernels scalarKernels = { DistancesScalar, BearingsScalar, LegsScalar, NearestScalar, TRACK_SCALAR };
+#ifdef TRACKHAVEAVX2
+static const TrackKernels avx2Kernels = { DistancesAVX2, BearingsAVX2, LegsAVX2, NearestAVX2, TRACK_AVX2 };
+#endif
+#ifdef TRACKHAVENEON
+static const TrackKernels neonKernels = { DistancesNEON, BearingsNEON, LegsNEON, NearestNEON, TRACK_NEON };
+#endif
+
+
+static const TrackKernels *BestKernels()
+{
+#ifdef TRACKHAVEAVX2
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return &avx2Kernels;
+#endif
+#ifdef TRACKHAVENEON
+	return &neonKernels;
+#endif
+	return &scalarKernels;
+}
+
+//Chosen before main() so no caller races the first pick
+static const TrackKernels *kernels = BestKernels();
+
+
+int Track::Kernel()
+{
+	return kernels->kernel;
+}
+
+
+bool Track::Use(int kernel)
+{
+	if(kernel == TRACK_SCALAR)
+	{
+		kernels = &scalarKernels;
+		return true;
+	}
+#ifdef TRACKHAVEAVX2
+	if(kernel == TRACK_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		kernels = &avx2Kernels;
+		return true;
+	}
+#endif
+#ifdef TRACKHAVENEON
+	if(kernel == TRACK_NEON)
+	{
+		kernels = &neonKernels;
+		return true;
+	}
+#endif
+	return false;
+}
+
+
+Track::Track()
+{
+}
+
+
+void Track::Clear()
+{
+	frame.Clear();
+	east.clear();
+	north.clear();
+	up.clear();
+}
+
+
+void Track::Project(const GeoPoint &p,float &e,float &n) const
+{
+	ENUPoint q = frame.ToENU(p,0);
+	e = q.east / 1000.0f;
+	n = q.north / 1000.0f;
+}
+
+
+void Track::Add(const GeoPoint &p,double upMeters)
+{
+	//The first point fixes the origin, floats keep a millimetre out to 8 km from it
+	if(!frame.haveOrigin)
+		frame.SetOrigin(p,0);
+	float e,n;
+	Project(p,e,n);
+	east.push_back(e);
+	north.push_back(n);
+	up.push_back((float)upMeters);
+}
+
+
+void Track::Load(const WayPoint *wp,int count)
+{
+	Clear();
+	east.reserve(count);
+	north.reserve(count);
+	up.reserve(count);
+	for(int i=0;i<count;i++)
+		Add(GeoFromDegrees(wp[i].lat,wp[i].lng),wp[i].alt * FEETTOMM / 1000);
+}
+
+
+int Track::Count() const
+{
+	return (int)east.size();
+}
+
+
+void Track::Distances(const GeoPoint &p,float *out) const
+{
+	float e,n;
+	Project(p,e,n);
+	kernels->distances(east.data(),north.data(),Count(),e,n,out);
+}
+
+
+void Track::Bearings(const GeoPoint &p,float *out) const
+{
+	float e,n;
+	Project(p,e,n);
+	kernels->bearings(east.data(),north.data(),Count(),e,n,out);
+}
+
+
+float Track::Legs(float *length,float *bearing,float *cumulative) const
+{
+	if(Count() < 2)
+		return 0;
+	return kernels->legs(east.data(),north.data(),Count(),length,bearing,cumulative);
+}
+
+
+int Track::NearestLeg(const GeoPoint &p,float &distance) const
+{
+	distance = 0;
+	if(Count() < 2)
+		return -1;
+	float e,n,d2;
+	Project(p,e,n);
+	int i = kernels->nearest(east.data(),north.data(),Count(),e,n,d2);
+	distance = sqrtf(d2);
+	return i;
+}
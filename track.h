@@ -0,0 +1,65 @@
+/************************************************
+Track - structure of arrays waypoint storage
+
+A recorded or loaded mission kept as separate
+east, north and up float arrays (meters from the
+ENU origin of its first point) so whole missions
+can be worked on eight or four points at a time.
+
+Batch kernels: distance and bearing from one point
+to every waypoint, per leg length, bearing and
+running path length, and the nearest leg.  AVX2 is
+picked at runtime on x86, NEON when the compiler
+targets it (-mfpu=neon on a Pi 2 or later, always
+on 64 bit ARM), otherwise plain C++.
+
+***********************************************/
+#ifndef __Track_h
+#define __Track_h
+
+#include <vector>
+#include "enu.h"
+using namespace std;
+
+#define TRACK_SCALAR		0
+#define TRACK_AVX2		1
+#define TRACK_NEON		2
+
+struct WayPoint;
+
+class Track
+{
+	public:
+		Track();
+
+		void Clear();
+		void Add(const GeoPoint &p,double upMeters);
+		//autocontrol's waypoint arrays, alt in feet
+		void Load(const WayPoint *wp,int count);
+		int Count() const;
+
+		//From p to every waypoint, out holds Count() floats.  Meters and degrees 0..360.
+		void Distances(const GeoPoint &p,float *out) const;
+		void Bearings(const GeoPoint &p,float *out) const;
+
+		//Leg i runs from waypoint i to i + 1, each array holds Count() - 1 floats.
+		//cumulative[i] is the path length to the end of leg i.  Returns the total.
+		float Legs(float *length,float *bearing,float *cumulative) const;
+
+		//Leg closest to p, -1 with fewer than two waypoints
+		int NearestLeg(const GeoPoint &p,float &distance) const;
+
+		//Which kernels run, TRACK_ flags.  Use() refuses what this CPU or build cannot do.
+		static int Kernel();
+		static bool Use(int kernel);
+
+		//p in this track's meters
+		void Project(const GeoPoint &p,float &e,float &n) const;
+
+		ENUFrame frame;
+		vector<float> east;
+		vector<float> north;
+		vector<float> up;
+};
+
+#endif // def(__Track_h)
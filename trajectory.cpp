@@ -0,0 +1,298 @@
+#include "trajectory.h"
+#include <math.h>
+#include <future>
+#include <thread>
+
+#define TRAJECTORYSTILL		0.05f		//Meters per second, slower than this the heading is the leg's
+#define TRAJECTORYMINTHREADLEGS	256		//Fewer legs than this a thread are not worth starting one for
+#define TRAJECTORYMINDURATION	0.1f		//Seconds
+
+
+//Minimum jerk from 0 at v0 to d at v1 in duration, no acceleration at either end.  c holds c1..c5.
+static void Quintic(float d,float v0,float v1,float duration,float *c)
+{
+	float t = duration;
+	float t2 = t * t;
+	float t3 = t2 * t;
+	c[0] = v0;
+	c[1] = 0;
+	c[2] = (20 * d - (8 * v1 + 12 * v0) * t) / (2 * t3);
+	c[3] = (-30 * d + (14 * v1 + 16 * v0) * t) / (2 * t3 * t);
+	c[4] = (12 * d - 6 * (v1 + v0) * t) / (2 * t3 * t2);
+}
+
+
+static inline float Position(const float *c,float t)
+{
+	return t * (c[0] + t * (c[1] + t * (c[2] + t * (c[3] + t * c[4]))));
+}
+
+
+static inline float Velocity(const float *c,float t)
+{
+	return c[0] + t * (2 * c[1] + t * (3 * c[2] + t * (4 * c[3] + t * 5 * c[4])));
+}
+
+
+static inline float Acceleration(const float *c,float t)
+{
+	return 2 * c[1] + t * (6 * c[2] + t * (12 * c[3] + t * 20 * c[4]));
+}
+
+
+Trajectory::Trajectory()
+{
+	maxSpeed = TRAJECTORYSPEED;
+	maxAccel = TRAJECTORYACCEL;
+	maxClimb = TRAJECTORYCLIMB;
+	clock = 0;
+	bucketSeconds = 1;
+	request.heading = 0;
+	request.alt = 0;
+	request.speed = 0;
+	request.leg = -1;
+	request.crossTrack = 0;
+	request.alongTrack = 0;
+	request.done = true;
+}
+
+
+void Trajectory::Clear()
+{
+	legs.clear();
+	bucket.clear();
+	clock = 0;
+	request.speed = 0;
+	request.leg = -1;
+	request.done = true;
+}
+
+
+int Trajectory::Count() const
+{
+	return (int)legs.size();
+}
+
+
+float Trajectory::Duration() const
+{
+	return legs.empty() ? 0 : legs.back().start + legs.back().duration;
+}
+
+
+//Legs first..last - 1, each on its own so any number of these can run at once
+void Trajectory::Fit(const Track &track,const vector<float> &ve,const vector<float> &vn,const vector<float> &vu,int first,int last)
+{
+	for(int i=first;i<last;i++)
+	{
+		TrajectoryLeg &l = legs[i];
+		l.east = track.east[i];
+		l.north = track.north[i];
+		l.up = track.up[i];
+		float de = track.east[i + 1] - l.east;
+		float dn = track.north[i + 1] - l.north;
+		float du = track.up[i + 1] - l.up;
+		float length = sqrtf(de * de + dn * dn);
+		l.unitEast = length > 0 ? de / length : 0;
+		l.unitNorth = length > 0 ? dn / length : 1;
+
+		//No faster than the limits on average, then stretched until no sample breaks them
+		float duration = max(max(length / maxSpeed,fabsf(du) / maxClimb),TRAJECTORYMINDURATION);
+		for(int fit=0;fit<TRAJECTORYFITS;fit++)
+		{
+			Quintic(de,ve[i],ve[i + 1],duration,l.e);
+			Quintic(dn,vn[i],vn[i + 1],duration,l.n);
+			Quintic(du,vu[i],vu[i + 1],duration,l.u);
+			float over = 1;
+			for(int k=0;k<=TRAJECTORYSAMPLES;k++)
+			{
+				float t = duration * k / TRAJECTORYSAMPLES;
+				float se = Velocity(l.e,t),sn = Velocity(l.n,t),su = Velocity(l.u,t);
+				float ae = Acceleration(l.e,t),an = Acceleration(l.n,t),au = Acceleration(l.u,t);
+				over = max(over,sqrtf(se * se + sn * sn) / maxSpeed);
+				over = max(over,fabsf(su) / maxClimb);
+				over = max(over,sqrtf(sqrtf(ae * ae + an * an + au * au) / maxAccel));
+			}
+			if(over <= 1.01f)
+				break;
+			duration *= over;
+		}
+		l.duration = duration;
+	}
+}
+
+
+bool Trajectory::Build(const Track &track,int threads)
+{
+	Clear();
+	int points = track.Count();
+	if(points < 2)
+		return false;
+	frame = track.frame;
+	int count = points - 1;
+	legs.resize(count);
+
+	//Through each waypoint along the bisector of the turn, slowing for sharp turns and short legs
+	vector<float> ve(points,0),vn(points,0),vu(points,0);
+	for(int i=1;i + 1<points;i++)
+	{
+		float ie = track.east[i] - track.east[i - 1],in = track.north[i] - track.north[i - 1];
+		float oe = track.east[i + 1] - track.east[i],on = track.north[i + 1] - track.north[i];
+		float inLength = sqrtf(ie * ie + in * in);
+		float outLength = sqrtf(oe * oe + on * on);
+		if(inLength == 0 || outLength == 0)
+			continue;
+		ie /= inLength;
+		in /= inLength;
+		oe /= outLength;
+		on /= outLength;
+		float be = ie + oe,bn = in + on;
+		float bisector = sqrtf(be * be + bn * bn);
+		if(bisector < 0.01f)
+			continue;
+		float turn = ie * oe + in * on;
+		float speed = min(maxSpeed * (1 + turn) / 2,sqrtf(maxAccel * min(inLength,outLength)));
+		ve[i] = be / bisector * speed;
+		vn[i] = bn / bisector * speed;
+
+		//Keep climbing through a waypoint only if both legs climb (or both descend)
+		float inSlope = (track.up[i] - track.up[i - 1]) / inLength;
+		float outSlope = (track.up[i + 1] - track.up[i]) / outLength;
+		if(inSlope * outSlope > 0)
+			vu[i] = max(min(speed * (inSlope + outSlope) / 2,maxClimb),-maxClimb);
+	}
+
+	if(threads <= 0)
+		threads = max((int)thread::hardware_concurrency(),1);
+	threads = max(min(threads,count / TRAJECTORYMINTHREADLEGS),1);
+	vector< future<void> > fits;
+	for(int k=1;k<threads;k++)
+		fits.push_back(async(launch::async,&Trajectory::Fit,this,cref(track),cref(ve),cref(vn),cref(vu),count * k / threads,count * (k + 1) / threads));
+	Fit(track,ve,vn,vu,0,count / threads);
+	for(size_t k=0;k<fits.size();k++)
+		fits[k].get();
+
+	//Start times, then which leg each bucket of time begins in
+	float start = 0;
+	for(int i=0;i<count;i++)
+	{
+		legs[i].start = start;
+		start += legs[i].duration;
+	}
+	bucketSeconds = start / count;
+	bucket.resize(count + 1);
+	int leg = 0;
+	for(int k=0;k<=count;k++)
+	{
+		while(leg + 1 < count && legs[leg + 1].start <= k * bucketSeconds)
+			leg++;
+		bucket[k] = leg;
+	}
+	Start();
+	return true;
+}
+
+
+int Trajectory::Find(float t) const
+{
+	int k = (int)(t / bucketSeconds);
+	k = k < 0 ? 0 : (k >= (int)bucket.size() ? (int)bucket.size() - 1 : k);
+	int leg = bucket[k];
+	while(leg + 1 < (int)legs.size() && legs[leg + 1].start <= t)
+		leg++;
+	return leg;
+}
+
+
+TrajectoryState Trajectory::Evaluate(float t) const
+{
+	TrajectoryState s;
+	if(legs.empty())
+	{
+		s.east = s.north = s.up = 0;
+		s.velocityEast = s.velocityNorth = s.velocityUp = 0;
+		s.speed = 0;
+		s.heading = 0;
+		s.leg = -1;
+		return s;
+	}
+	int leg = Find(t);
+	const TrajectoryLeg &l = legs[leg];
+	float local = t - l.start;
+	local = local < 0 ? 0 : (local > l.duration ? l.duration : local);
+	s.leg = leg;
+	s.east = l.east + Position(l.e,local);
+	s.north = l.north + Position(l.n,local);
+	s.up = l.up + Position(l.u,local);
+	s.velocityEast = Velocity(l.e,local);
+	s.velocityNorth = Velocity(l.n,local);
+	s.velocityUp = Velocity(l.u,local);
+	s.speed = sqrtf(s.velocityEast * s.velocityEast + s.velocityNorth * s.velocityNorth);
+	if(s.speed > TRAJECTORYSTILL)
+		s.heading = GeoCompass(atan2f(s.velocityEast,s.velocityNorth) * GEODEGREES);
+	else
+		s.heading = GeoCompass(atan2f(l.unitEast,l.unitNorth) * GEODEGREES);
+	return s;
+}
+
+
+void Trajectory::Start()
+{
+	clock = 0;
+	request.done = legs.empty();
+}
+
+
+void Trajectory::Rejoin(int leg)
+{
+	if(leg >= 0 && leg < (int)legs.size())
+		clock = legs[leg].start;
+}
+
+
+const MissionRequest &Trajectory::Update(const GeoPoint &p,double seconds)
+{
+	if(legs.empty())
+	{
+		request.speed = 0;
+		request.done = true;
+		return request;
+	}
+	ENUPoint q = frame.ToENU(p,0);
+	float e = q.east / 1000.0f;
+	float n = q.north / 1000.0f;
+
+	//The clock runs while the quad keeps up and stops once it is TRAJECTORYMAXLAG behind, ahead or off to the side it runs on
+	TrajectoryState now = Evaluate(clock);
+	const TrajectoryLeg &l = legs[now.leg];
+	float le = now.east - e;
+	float ln = now.north - n;
+	float lag = sqrtf(le * le + ln * ln);
+	float behind = now.speed > TRAJECTORYSTILL ? (le * now.velocityEast + ln * now.velocityNorth) / now.speed : le * l.unitEast + ln * l.unitNorth;
+	float run = 1 - behind / TRAJECTORYMAXLAG;
+	run = run < 0 ? 0 : (run > 1 ? 1 : run);
+	float end = Duration();
+	clock = min(clock + (float)seconds * run,end);
+
+	//Fly the trajectory's velocity a little ahead, plus whatever closes the gap to it
+	TrajectoryState ahead = Evaluate(clock + TRAJECTORYLEAD);
+	float de = ahead.velocityEast + le / TRAJECTORYCATCHUP;
+	float dn = ahead.velocityNorth + ln / TRAJECTORYCATCHUP;
+	float v = sqrtf(de * de + dn * dn);
+	request.leg = now.leg;
+	request.alongTrack = (e - l.east) * l.unitEast + (n - l.north) * l.unitNorth;
+	request.crossTrack = (e - l.east) * l.unitNorth - (n - l.north) * l.unitEast;
+	request.heading = v > TRAJECTORYSTILL ? GeoCompass(atan2f(de,dn) * GEODEGREES) : ahead.heading;
+	request.alt = ahead.up * 1000 / FEETTOMM;
+	request.speed = min(maxSpeed,v);
+	request.done = false;
+
+	//At the end hold the last waypoint like the executor does
+	if(clock >= end)
+	{
+		request.leg = -1;
+		request.done = true;
+		request.speed = lag > MISSIONARRIVAL ? min(maxSpeed,lag / MISSIONSLOWDOWN) : 0;
+	}
+	return request;
+}
@@ -0,0 +1,102 @@
+/************************************************
+Trajectory - minimum jerk splines through waypoints
+
+Fitted once when a mission loads.  Each leg is a
+quintic in time on every axis, the minimum jerk
+curve between its end points, passing each
+waypoint at a velocity along the bisector of the
+turn there (slower the sharper the turn) and with
+no acceleration.  A leg's duration is stretched
+until its speed and acceleration stay inside the
+limits.  Legs only depend on their neighbors so
+they are fitted in parallel.
+
+Stored as coefficient tables, 22 floats a leg, and
+a table of time buckets so finding the leg for a
+time is a lookup: position, velocity and heading
+at any t cost the same on any length of mission.
+
+Update() follows it like MissionExecutor, flying
+the trajectory's velocity a moment ahead plus a
+pull back onto it.  The trajectory clock slows and
+stops if the quad falls behind, so it is never
+chasing a point far away.
+
+***********************************************/
+#ifndef __Trajectory_h
+#define __Trajectory_h
+
+#include <vector>
+#include "mission.h"
+using namespace std;
+
+#define TRAJECTORYSPEED		2.0f	//Meters per second, most along the path
+#define TRAJECTORYACCEL		1.0f	//Meters per second squared
+#define TRAJECTORYCLIMB		1.0f	//Meters per second, most up or down
+#define TRAJECTORYSAMPLES	16	//Points a leg is checked against the limits at
+#define TRAJECTORYFITS		8	//Times a leg may be stretched
+#define TRAJECTORYLEAD		1.0f	//Seconds ahead of the clock the velocity is taken from
+#define TRAJECTORYMAXLAG	5.0f	//Meters behind the trajectory at which the clock stops
+#define TRAJECTORYCATCHUP	4.0f	//Seconds to close the gap when behind
+
+
+struct TrajectoryState
+{
+	float east;		//Meters, the track's frame
+	float north;
+	float up;
+	float velocityEast;	//Meters per second
+	float velocityNorth;
+	float velocityUp;
+	float speed;		//Horizontal
+	float heading;		//Degrees true, the leg's bearing when stopped
+	int leg;
+};
+
+
+//One leg, position is start + c1 t + c2 t^2 + ... + c5 t^5 for t in 0..duration on each axis
+struct TrajectoryLeg
+{
+	float start;		//Seconds into the mission
+	float duration;
+	float east,north,up;
+	float e[5],n[5],u[5];	//c1..c5
+	float unitEast,unitNorth;	//Along the chord, north when the leg is straight up or down
+};
+
+
+class Trajectory
+{
+	public:
+		Trajectory();
+
+		//Fits every leg of track, threads 0 for one per core.  False with fewer than two waypoints.
+		bool Build(const Track &track,int threads = 0);
+		void Clear();
+		int Count() const;
+		float Duration() const;
+
+		TrajectoryState Evaluate(float t) const;
+
+		//Follower, seconds since the last call
+		void Start();
+		void Rejoin(int leg);
+		const MissionRequest &Update(const GeoPoint &p,double seconds);
+
+		float maxSpeed;
+		float maxAccel;
+		float maxClimb;
+		ENUFrame frame;		//The track's, for projecting fixes
+		float clock;		//Seconds into the trajectory the follower is at
+		MissionRequest request;
+
+	private:
+		vector<TrajectoryLeg> legs;
+		vector<int> bucket;	//Leg that starts the bucket of bucketSeconds
+		float bucketSeconds;
+
+		void Fit(const Track &track,const vector<float> &ve,const vector<float> &vn,const vector<float> &vu,int first,int last);
+		int Find(float t) const;
+};
+
+#endif // def(__Trajectory_h)
@@ -0,0 +1,293 @@
+#include "ubx.h"
+#include <string.h>
+
+
+void UBXChecksum(const uint8_t *data,size_t len,uint8_t &a,uint8_t &b)
+{
+	a = 0;
+	b = 0;
+	for(size_t i=0;i<len;i++)
+	{
+		a += data[i];
+		b += a;
+	}
+}
+
+
+string UBXFrame(uint8_t msgClass,uint8_t msgId,const uint8_t *payload,uint16_t len)
+{
+	string f;
+	f += (char)UBXSYNC1;
+	f += (char)UBXSYNC2;
+	f += (char)msgClass;
+	f += (char)msgId;
+	f += (char)(len & 0xff);
+	f += (char)(len >> 8);
+	if(len)
+		f.append((const char *)payload,len);
+
+	uint8_t a,b;
+	UBXChecksum((const uint8_t *)f.data() + 2,f.length() - 2,a,b);
+	f += (char)a;
+	f += (char)b;
+	return f;
+}
+
+
+static void Put16(uint8_t *p,uint16_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+
+static void Put32(uint8_t *p,uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+
+//UBX is little endian whatever we run on, the compiler turns these into single loads on the Pi
+static inline uint16_t Get16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+static inline uint32_t Get32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+string UBXSetBaud(int baud,uint16_t outMask)
+{
+	uint8_t p[20];
+	memset(p,0,sizeof(p));
+	p[0] = 1;			//UART1
+	Put32(p + 4,0x000008d0);	//8N1
+	Put32(p + 8,baud);
+	Put16(p + 12,0x0003);		//in UBX+NMEA
+	Put16(p + 14,outMask);
+	return UBXFrame(UBXCLASSCFG,UBXCFGPRT,p,sizeof(p));
+}
+
+
+string UBXSetMessageRate(uint8_t msgClass,uint8_t msgId,uint8_t rate)
+{
+	uint8_t p[3] = { msgClass,msgId,rate };
+	return UBXFrame(UBXCLASSCFG,UBXCFGMSG,p,sizeof(p));
+}
+
+
+string UBXSetRate(int ms)
+{
+	uint8_t p[6];
+	Put16(p,ms);
+	Put16(p + 2,1);			//one navigation solution per measurement
+	Put16(p + 4,1);			//aligned to GPS time
+	return UBXFrame(UBXCLASSCFG,UBXCFGRATE,p,sizeof(p));
+}
+
+
+string UBXInitPosition(int32_t lat,int32_t lng,int32_t altCm,uint32_t accuracyCm)
+{
+	uint8_t p[20];
+	memset(p,0,sizeof(p));
+	p[0] = UBXMGAINIPOSLLH;
+	Put32(p + 4,lat);
+	Put32(p + 8,lng);
+	Put32(p + 12,altCm);
+	Put32(p + 16,accuracyCm);
+	return UBXFrame(UBXCLASSMGA,UBXMGAINI,p,sizeof(p));
+}
+
+
+string UBXInitTime(int year,int month,int day,int hour,int minute,int second,uint16_t accuracySeconds)
+{
+	uint8_t p[24];
+	memset(p,0,sizeof(p));
+	p[0] = UBXMGAINITIMEUTC;
+	p[3] = 0x80;			//Leap seconds unknown
+	Put16(p + 4,year);
+	p[6] = month;
+	p[7] = day;
+	p[8] = hour;
+	p[9] = minute;
+	p[10] = second;
+	Put16(p + 16,accuracySeconds);
+	return UBXFrame(UBXCLASSMGA,UBXMGAINI,p,sizeof(p));
+}
+
+
+UBXParser::UBXParser()
+{
+	ackClass = 0;
+	ackId = 0;
+	acked = 0;
+	framesDecoded = 0;
+	checksumFailures = 0;
+	frameLen = 0;
+	frameNeed = 0;
+	skip = 0;
+	decoded = 0;
+}
+
+
+//Collects one frame at a time into frame[], checks it and decodes the NAV
+//messages we know.  Anything between frames (NMEA, acks for other messages,
+//line noise) is skipped with memchr rather than a byte at a time.
+uint32_t UBXParser::encode(const uint8_t *buf,size_t len)
+{
+	decoded = 0;
+	size_t i = 0;
+	while(i < len)
+	{
+		if(skip)
+		{
+			//Payload of a frame too big to be one of ours
+			size_t n = skip < len - i ? skip : len - i;
+			skip -= n;
+			i += n;
+			continue;
+		}
+
+		if(frameLen == 0)
+		{
+			const uint8_t *sync = (const uint8_t *)memchr(buf + i,UBXSYNC1,len - i);
+			if(sync == NULL)
+				break;
+			i = sync - buf;
+			frame[frameLen++] = buf[i++];
+			continue;
+		}
+
+		if(frameLen < 6)
+		{
+			frame[frameLen++] = buf[i++];
+			if(frameLen == 2 && frame[1] != UBXSYNC2)
+				frameLen = frame[1] == UBXSYNC1 ? 1 : 0;
+			else if(frameLen == 6)
+			{
+				size_t payload = Get16(frame + 4);
+				if(payload > UBXMAXPAYLOAD)
+				{
+					skip = payload + 2;
+					frameLen = 0;
+				}
+				else
+					frameNeed = payload + UBXFRAMEOVERHEAD;
+			}
+			continue;
+		}
+
+		size_t n = frameNeed - frameLen < len - i ? frameNeed - frameLen : len - i;
+		memcpy(frame + frameLen,buf + i,n);
+		frameLen += n;
+		i += n;
+		if(frameLen == frameNeed)
+		{
+			uint8_t a,b;
+			UBXChecksum(frame + 2,frameNeed - 4,a,b);
+			if(a == frame[frameNeed - 2] && b == frame[frameNeed - 1])
+				Decode();
+			else
+				checksumFailures++;
+			frameLen = 0;
+			frameNeed = 0;
+		}
+	}
+	return decoded;
+}
+
+
+void UBXParser::Decode()
+{
+	const uint8_t *p = frame + 6;
+	size_t len = frameNeed - UBXFRAMEOVERHEAD;
+	framesDecoded++;
+	if(frame[2] == UBXCLASSACK && len == 2)
+	{
+		ackClass = p[0];
+		ackId = p[1];
+		acked = frame[3] == UBXACKACK ? 1 : -1;
+		decoded |= UBX_ACK;
+		return;
+	}
+	if(frame[2] != UBXCLASSNAV)
+		return;
+
+	if(frame[3] == UBXNAVPVT && len == UBXNAVPVTLEN)
+	{
+		solution.iTOW = Get32(p);
+		solution.year = Get16(p + 4);
+		solution.month = p[6];
+		solution.day = p[7];
+		solution.hour = p[8];
+		solution.min = p[9];
+		solution.sec = p[10];
+		solution.valid = p[11];
+		solution.nano = (int32_t)Get32(p + 16);
+		solution.fixType = p[20];
+		solution.flags = p[21];
+		solution.numSV = p[23];
+		solution.lng = (int32_t)Get32(p + 24);
+		solution.lat = (int32_t)Get32(p + 28);
+		solution.hMSL = (int32_t)Get32(p + 36);
+		solution.hAcc = Get32(p + 40);
+		solution.vAcc = Get32(p + 44);
+		solution.gSpeed = (int32_t)Get32(p + 60);
+		solution.headMot = (int32_t)Get32(p + 64);
+		decoded |= UBX_PVT;
+	}
+	else if(frame[3] == UBXNAVVELNED && len == UBXNAVVELNEDLEN)
+	{
+		solution.iTOW = Get32(p);
+		solution.gSpeed = (int32_t)Get32(p + 20) * 10;
+		solution.headMot = (int32_t)Get32(p + 24);
+		decoded |= UBX_VELNED;
+	}
+}
+
+
+string UBXMakeNavPVT(const UBXSolution &sol)
+{
+	uint8_t p[UBXNAVPVTLEN];
+	memset(p,0,sizeof(p));
+	Put32(p,sol.iTOW);
+	Put16(p + 4,sol.year);
+	p[6] = sol.month;
+	p[7] = sol.day;
+	p[8] = sol.hour;
+	p[9] = sol.min;
+	p[10] = sol.sec;
+	p[11] = sol.valid;
+	Put32(p + 16,sol.nano);
+	p[20] = sol.fixType;
+	p[21] = sol.flags;
+	p[23] = sol.numSV;
+	Put32(p + 24,sol.lng);
+	Put32(p + 28,sol.lat);
+	Put32(p + 32,sol.hMSL);		//Height above the ellipsoid, no geoid model here
+	Put32(p + 36,sol.hMSL);
+	Put32(p + 40,sol.hAcc);
+	Put32(p + 44,sol.vAcc);
+	Put32(p + 60,sol.gSpeed);
+	Put32(p + 64,sol.headMot);
+	return UBXFrame(UBXCLASSNAV,UBXNAVPVT,p,sizeof(p));
+}
+
+
+string UBXMakeNavVELNED(const UBXSolution &sol)
+{
+	uint8_t p[UBXNAVVELNEDLEN];
+	memset(p,0,sizeof(p));
+	Put32(p,sol.iTOW);
+	Put32(p + 16,sol.gSpeed / 10);
+	Put32(p + 20,sol.gSpeed / 10);
+	Put32(p + 24,sol.headMot);
+	return UBXFrame(UBXCLASSNAV,UBXNAVVELNED,p,sizeof(p));
+}
@@ -0,0 +1,143 @@
+/************************************************
+u-blox UBX binary protocol helpers
+
+Frame builder and Fletcher checksum for the
+configuration messages GPS sends at startup,
+and a NAV-PVT/NAV-VELNED decoder for running
+the receiver in binary instead of NMEA
+
+***********************************************/
+#ifndef __UBX_h
+#define __UBX_h
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+using namespace std;
+
+#define UBXSYNC1		0xb5
+#define UBXSYNC2		0x62
+
+//Classes and ids we use
+#define UBXCLASSNAV		0x01
+#define UBXCLASSACK		0x05
+#define UBXCLASSCFG		0x06
+#define UBXCLASSMGA		0x13
+#define UBXACKNAK		0x00
+#define UBXACKACK		0x01
+#define UBXCFGPRT		0x00
+#define UBXCFGMSG		0x01
+#define UBXCFGRATE		0x08
+#define UBXNAVPVT		0x07
+#define UBXNAVVELNED		0x12
+#define UBXMGAINI		0x40
+#define UBXMGAINIPOSLLH		0x01	//MGA-INI payload types
+#define UBXMGAINITIMEUTC	0x10
+
+//CFG-PRT protocol masks
+#define UBXPROTOUBX		0x0001
+#define UBXPROTONMEA		0x0002
+
+//Payload and whole frame sizes, a frame is payload plus 6 header and 2 checksum bytes
+#define UBXNAVPVTLEN		92
+#define UBXNAVVELNEDLEN		36
+#define UBXFRAMEOVERHEAD	8
+#define UBXMAXPAYLOAD		128	//Longer frames are not ours, the parser skips them
+
+//UBXParser::encode() return flags, which messages updated the solution
+#define UBX_PVT			1
+#define UBX_VELNED		2
+#define UBX_ACK			4	//ACK-ACK or ACK-NAK, see ackClass/ackId/acked
+
+//NAV-PVT flags and valid bits we look at
+#define UBXPVT_VALIDDATE	0x01
+#define UBXPVT_VALIDTIME	0x02
+#define UBXPVT_GNSSFIXOK	0x01
+
+
+//8 bit Fletcher over class, id, length and payload
+void UBXChecksum(const uint8_t *data,size_t len,uint8_t &a,uint8_t &b);
+
+//A complete frame, sync chars through checksum
+string UBXFrame(uint8_t msgClass,uint8_t msgId,const uint8_t *payload,uint16_t len);
+
+//CFG-PRT for UART1 at baud, UBX+NMEA in, outMask out
+string UBXSetBaud(int baud,uint16_t outMask = UBXPROTOUBX | UBXPROTONMEA);
+
+//CFG-MSG, send msgClass/msgId once every rate solutions on the current port, 0 turns it off
+string UBXSetMessageRate(uint8_t msgClass,uint8_t msgId,uint8_t rate);
+
+//CFG-RATE, one solution every ms milliseconds
+string UBXSetRate(int ms);
+
+
+
+//MGA-INI-POS_LLH, a hot start position hint.  lat/lng 1e-7 degrees, alt and accuracy in cm
+string UBXInitPosition(int32_t lat,int32_t lng,int32_t altCm,uint32_t accuracyCm);
+
+//MGA-INI-TIME_UTC, a hot start time hint good to accuracySeconds
+string UBXInitTime(int year,int month,int day,int hour,int minute,int second,uint16_t accuracySeconds);
+
+
+//The NAV-PVT and NAV-VELNED fields GPS uses, in the receiver's own units
+struct UBXSolution
+{
+	uint32_t iTOW;		//ms into the GPS week, ties PVT and VELNED of one epoch together
+	uint16_t year;
+	uint8_t month;
+	uint8_t day;
+	uint8_t hour;
+	uint8_t min;
+	uint8_t sec;
+	int32_t nano;		//-1e9..1e9 correction to sec
+	uint8_t valid;		//UBXPVT_VALID flags
+	uint8_t fixType;	//0 none, 2 2D, 3 3D
+	uint8_t flags;		//UBXPVT_GNSSFIXOK
+	uint8_t numSV;
+	int32_t lng;		//1e-7 degrees
+	int32_t lat;		//1e-7 degrees
+	int32_t hMSL;		//mm above mean sea level
+	uint32_t hAcc;		//mm
+	uint32_t vAcc;		//mm
+	int32_t gSpeed;		//mm/s, cm/s scaled up when it came from VELNED
+	int32_t headMot;	//1e-5 degrees
+
+	UBXSolution() : iTOW(0), year(0), month(0), day(0), hour(0), min(0), sec(0), nano(0), valid(0),
+		fixType(0), flags(0), numSV(0), lng(0), lat(0), hMSL(0), hAcc(0), vAcc(0), gSpeed(0), headMot(0)
+	{}
+};
+
+
+//Streaming UBX decoder, feed it whatever read() returned
+class UBXParser
+{
+	public:
+		UBXParser();
+
+		//Returns the UBX_ flags of the messages decoded from this chunk
+		uint32_t encode(const uint8_t *buf,size_t len);
+
+		UBXSolution solution;
+		//Last acknowledgement seen, acked is 1 for ACK-ACK and -1 for ACK-NAK
+		uint8_t ackClass;
+		uint8_t ackId;
+		int acked;
+		uint32_t framesDecoded;
+		uint32_t checksumFailures;
+
+	private:
+		void Decode();
+		uint8_t frame[UBXMAXPAYLOAD + UBXFRAMEOVERHEAD];
+		size_t frameLen;	//Bytes of the current frame we have
+		size_t frameNeed;	//Bytes the current frame will have, 0 until the header is in
+		size_t skip;		//Bytes left of a frame we are not collecting
+		uint32_t decoded;
+};
+
+//A NAV-PVT frame for sol, what the simulator and benches send
+string UBXMakeNavPVT(const UBXSolution &sol);
+
+//A NAV-VELNED frame carrying sol's speed and heading
+string UBXMakeNavVELNED(const UBXSolution &sol);
+
+#endif // def(__UBX_h)